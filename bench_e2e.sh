@@ -0,0 +1,158 @@
+#!/bin/bash
+#
+# End-to-end benchmark: pitch_feed -> loopback multicast -> packet_logger
+#
+# Drives the real packet_logger binary at a series of constant rates and
+# records, for each step, the packets lost, the logger's CPU time per packet,
+# the send-stamp latency percentiles and the log bytes written per packet.
+# The highest rate with no loss is reported as the sustainable rate. A step
+# where pitch_feed reaches less than 95% of its rate is marked feed_limited
+# and ends the sweep, since it measures the sender rather than the logger.
+# Results go to a JSON file so runs can be compared for regressions.
+#
+# Environment:
+#   RATES         Offered rates in packets per second per line, ascending
+#                 (default "25000 50000 100000 200000 400000")
+#   STEP_SECONDS  Seconds of traffic per step (default 3)
+#   UNITS         Units in the feed (default 1,2,3,4)
+#   RESULT        Result file (default bench_e2e_result.json)
+#   BASE_CONFIG   Runtime config the logger settings are appended to (optional)
+#   KEEP_GOING    1 = run every rate even after one loses packets (default 0)
+
+set -euo pipefail
+
+RATES=${RATES:-"25000 50000 100000 200000 400000"}
+STEP_SECONDS=${STEP_SECONDS:-3}
+UNITS=${UNITS:-1,2,3,4}
+RESULT=${RESULT:-bench_e2e_result.json}
+BASE_CONFIG=${BASE_CONFIG:-}
+KEEP_GOING=${KEEP_GOING:-0}
+
+BIN_DIR=$(cd "$(dirname "$0")" && pwd)
+LOGGER=$BIN_DIR/packet_logger
+FEED=$BIN_DIR/pitch_feed
+READER=$BIN_DIR/log_reader
+for binary in "$LOGGER" "$FEED" "$READER"; do
+    if [ ! -x "$binary" ]; then
+        echo "Missing $binary, run 'make all pitch_feed' first" >&2
+        exit 1
+    fi
+done
+
+WORK_DIR=$(mktemp -d -t bench_e2e.XXXXXX)
+LOGGER_PID=
+cleanup() {
+    if [ -n "$LOGGER_PID" ]; then
+        kill -INT "$LOGGER_PID" 2>/dev/null || true
+        wait "$LOGGER_PID" 2>/dev/null || true
+    fi
+    rm -rf "$WORK_DIR"
+}
+trap cleanup EXIT
+
+CLOCK_TICKS=$(getconf CLK_TCK)
+
+# utime + stime of a process, in clock ticks
+cpu_ticks() {
+    awk '{ sub(/^.*\) /, ""); print $12 + $13 }' "/proc/$1/stat"
+}
+
+# Field following a label in the latency line of the logger's output, in us
+latency_field() {
+    awk -v label="$2" '/^UDP latency port1/ {
+        for (i = 1; i <= NF; i++) if ($i == label) { value = $(i + 1); sub(/us,?$/, "", value); print value; exit }
+    }' "$1"
+}
+
+json_steps=
+max_sustainable=0
+for rate in $RATES; do
+    step_dir=$WORK_DIR/$rate
+    mkdir -p "$step_dir"
+    packets=$((rate * STEP_SECONDS))
+    {
+        if [ -n "$BASE_CONFIG" ]; then
+            cat "$BASE_CONFIG"
+        fi
+        echo "interface_ip = 127.0.0.1"
+        echo "log_file = $step_dir/packets_binary.log"
+        echo "checkpoint_file ="
+        echo "measure_send_latency = true"
+        echo "stats_interval = 100000000"
+    } > "$step_dir/logger.conf"
+
+    "$LOGGER" --fresh -c "$step_dir/logger.conf" > "$step_dir/logger.txt" 2>&1 &
+    LOGGER_PID=$!
+    sleep 1
+    if ! kill -0 "$LOGGER_PID" 2>/dev/null; then
+        echo "packet_logger failed to start:" >&2
+        cat "$step_dir/logger.txt" >&2
+        exit 1
+    fi
+
+    ticks_before=$(cpu_ticks "$LOGGER_PID")
+    "$FEED" --transport udp --units "$UNITS" --send-stamp --rate "$rate" --packets "$packets" \
+        > "$step_dir/feed.txt" 2>&1
+    sleep 1     # Let the logger drain its socket buffers
+    ticks_after=$(cpu_ticks "$LOGGER_PID")
+    kill -INT "$LOGGER_PID"
+    wait "$LOGGER_PID" || true
+    LOGGER_PID=
+
+    achieved=$(awk '/^Sent / { for (i = 1; i <= NF; i++) if ($i == "pps,") print $(i - 1) }' "$step_dir/feed.txt")
+    received=$(awk '/PERFORMANCE:/ { for (i = 1; i <= NF; i++) if ($i == "packets,") print $(i - 1) }' "$step_dir/logger.txt")
+    received=${received:-0}
+    offered=$((packets * 2))
+    lost=$((offered > received ? offered - received : 0))
+    # Messages missing on both lines, from the log itself
+    missing=$("$READER" -g "$step_dir/packets_binary.log" 2>/dev/null |
+              awk '/Union \(all ports\)/ { for (i = 1; i <= NF; i++) if ($i == "missing") sum += $(i - 1) } END { print sum + 0 }')
+    log_bytes=$(cat "$step_dir"/packets_binary.log* 2>/dev/null | wc -c)
+    read -r cpu_ns_per_packet bytes_per_packet < <(awk -v t=$((ticks_after - ticks_before)) -v hz="$CLOCK_TICKS" \
+        -v n="$received" -v b="$log_bytes" 'BEGIN { if (n == 0) n = 1; printf "%.0f %.1f\n", t * 1e9 / hz / n, b / n }')
+    p50=$(latency_field "$step_dir/logger.txt" p50)
+    p99=$(latency_field "$step_dir/logger.txt" p99)
+    p999=$(latency_field "$step_dir/logger.txt" p99.9)
+    max_us=$(latency_field "$step_dir/logger.txt" max)
+
+    achieved=${achieved:-0}
+    feed_limited=false
+    if [ $((achieved * 100)) -lt $((rate * 95)) ]; then
+        feed_limited=true
+    fi
+
+    printf "%8s pps: achieved %s pps/line, received %s/%s, %s lost, %s messages missing, %s ns CPU/packet, %s bytes/packet, p50 %sus p99 %sus p99.9 %sus\n" \
+        "$rate" "$achieved" "$received" "$offered" "$lost" "$missing" "$cpu_ns_per_packet" "$bytes_per_packet" \
+        "${p50:-?}" "${p99:-?}" "${p999:-?}"
+    if [ "$feed_limited" = true ]; then
+        echo "          pitch_feed fell short of the rate; the sender, not the logger, is the limit"
+    fi
+
+    json_steps+="${json_steps:+,
+}    {\"rate\": $rate, \"achieved_pps\": $achieved, \"feed_limited\": $feed_limited, \"packets_offered\": $offered, \"packets_received\": $received, \"packets_lost\": $lost, \"messages_missing\": $missing, \"cpu_ns_per_packet\": $cpu_ns_per_packet, \"log_bytes_per_packet\": $bytes_per_packet, \"latency_us\": {\"p50\": ${p50:-null}, \"p99\": ${p99:-null}, \"p99_9\": ${p999:-null}, \"max\": ${max_us:-null}}}"
+
+    if [ "$feed_limited" = true ]; then
+        break
+    elif [ "$lost" -eq 0 ] && [ "$missing" -eq 0 ]; then
+        max_sustainable=$rate
+    elif [ "$KEEP_GOING" != 1 ]; then
+        break
+    fi
+done
+
+cat > "$RESULT" <<EOF
+{
+  "benchmark": "bench_e2e",
+  "timestamp": "$(date -u +%Y-%m-%dT%H:%M:%SZ)",
+  "host": "$(hostname)",
+  "cpus": $(nproc),
+  "revision": "$(git -C "$BIN_DIR" rev-parse --short HEAD 2>/dev/null || echo unknown)",
+  "units": "$UNITS",
+  "step_seconds": $STEP_SECONDS,
+  "max_sustainable_pps": $max_sustainable,
+  "steps": [
+$json_steps
+  ]
+}
+EOF
+echo "Highest rate without loss: $max_sustainable pps per line (results in $RESULT)"
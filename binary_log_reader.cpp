@@ -9,147 +9,10 @@
 #include <sstream>
 #include <map>
 #include <algorithm>
-
-// Must match the binary logger structures exactly
-#pragma pack(push, 1)
-struct BinaryLogRecord {
-    uint64_t timestamp_ns;      // 8 bytes - nanosecond timestamp
-    uint32_t packet_id;         // 4 bytes - packet sequence
-    uint32_t sequence;          // 4 bytes - CBOE sequence number
-    uint32_t src_ip;            // 4 bytes - source IP (binary)
-    uint16_t port;              // 2 bytes - port number
-    uint16_t length;            // 2 bytes - packet length
-    uint8_t count;              // 1 byte - message count
-    uint8_t unit;               // 1 byte - unit identifier
-    uint8_t packet_type;        // 1 byte - packet type enum
-    uint8_t order_status;       // 1 byte - order status enum
-    uint16_t payload_length;    // 2 bytes - actual payload length stored
-    // Variable length payload follows
-};
-
-// CBOE Sequenced Unit Header structure
-struct CboeSequencedUnitHeader {
-    uint16_t hdr_length;    // Length of the packet
-    uint8_t hdr_count;      // Number of messages in packet
-    uint8_t hdr_unit;       // Unit identifier
-    uint32_t hdr_sequence;  // Sequence number
-};
-
-// CBOE Message Header structure
-struct CboeMessageHeader {
-    uint8_t length;         // Length of this message
-    uint8_t message_type;   // Message type identifier
-};
-#pragma pack(pop)
-
-// Enumerations matching the logger
-enum class PacketType : uint8_t {
-    HEARTBEAT = 0,
-    ADMIN = 1,
-    UNSEQUENCED = 2,
-    DATA = 3
-};
-
-enum class OrderStatus : uint8_t {
-    UNSEQUENCED = 0,
-    SEQUENCED_FIRST = 1,
-    SEQUENCED_IN_ORDER = 2,
-    SEQUENCED_OUT_OF_ORDER_LATE = 3,
-    SEQUENCED_OUT_OF_ORDER_EARLY = 4,
-    SEQUENCED_DUPLICATE = 5
-};
-
-// CBOE Message Type mapping
-struct MessageTypeInfo {
-    uint8_t type_id;
-    const char* name;
-    const char* description;
-};
-
-static const MessageTypeInfo CBOE_MESSAGE_TYPES[] = {
-    {0x97, "UNIT_CLEAR", "Unit Clear"},
-    {0x3B, "TRADING_STATUS", "Trading Status"},
-    {0x37, "ADD_ORDER", "Add Order"},
-    {0x38, "ORDER_EXECUTED", "Order Executed"},
-    {0x58, "ORDER_EXECUTED_AT_PRICE", "Order Executed at Price"},
-    {0x39, "REDUCE_SIZE", "Reduce Size"},
-    {0x3A, "MODIFY_ORDER", "Modify Order"},
-    {0x3C, "DELETE_ORDER", "Delete Order"},
-    {0x3D, "TRADE", "Trade"},
-    {0x3E, "TRADE_BREAK", "Trade Break"},
-    {0xE3, "CALCULATED_VALUE", "Calculated Value"},
-    {0x2D, "END_OF_SESSION", "End of Session"},
-    {0x59, "AUCTION_UPDATE", "Auction Update"},
-    {0x5A, "AUCTION_SUMMARY", "Auction Summary"},
-    {0x01, "LOGIN", "Login"},
-    {0x02, "LOGIN_RESPONSE", "Login Response"},
-    {0x03, "GAP_REQUEST", "Gap Request"},
-    {0x04, "GAP_RESPONSE", "Gap Response"},
-    {0x80, "SPIN_IMAGE_AVAILABLE", "Spin Image Available"},
-    {0x81, "SPIN_REQUEST", "Spin Request"},
-    {0x82, "SPIN_RESPONSE", "Spin Response"},
-    {0x83, "SPIN_FINISHED", "Spin Finished"}
-};
-
-static const int NUM_MESSAGE_TYPES = sizeof(CBOE_MESSAGE_TYPES) / sizeof(MessageTypeInfo);
-
-class BinaryLogReader {
-private:
-    std::ifstream file;
-    std::string filename;
-    size_t file_size;
-    size_t bytes_read;
-    
-public:
-    BinaryLogReader(const std::string& fname) : filename(fname), bytes_read(0) {
-        file.open(filename, std::ios::binary);
-        if (!file.is_open()) {
-            throw std::runtime_error("Cannot open file: " + filename);
-        }
-        
-        // Get file size
-        file.seekg(0, std::ios::end);
-        file_size = file.tellg();
-        file.seekg(0, std::ios::beg);
-    }
-    
-    ~BinaryLogReader() {
-        if (file.is_open()) {
-            file.close();
-        }
-    }
-    
-    bool read_record(BinaryLogRecord& record, std::vector<char>& payload) {
-        if (bytes_read >= file_size) {
-            return false;
-        }
-        
-        // Read the fixed part of the record
-        file.read(reinterpret_cast<char*>(&record), sizeof(BinaryLogRecord));
-        if (file.gcount() != sizeof(BinaryLogRecord)) {
-            return false;
-        }
-        bytes_read += sizeof(BinaryLogRecord);
-        
-        // Read the variable payload
-        payload.resize(record.payload_length);
-        if (record.payload_length > 0) {
-            file.read(payload.data(), record.payload_length);
-            if (file.gcount() != record.payload_length) {
-                return false;
-            }
-            bytes_read += record.payload_length;
-        }
-        
-        return true;
-    }
-    
-    size_t get_file_size() const { return file_size; }
-    size_t get_bytes_read() const { return bytes_read; }
-    double get_progress() const { 
-        return file_size > 0 ? static_cast<double>(bytes_read) / file_size * 100.0 : 0.0; 
-    }
-};
+#include <array>
+#include "binary_log_reader.h"
+#include "interval_set.h"
+#include "packet_types.h"
 
 /**
  * Convert binary IP back to string
@@ -184,6 +47,8 @@ const char* packet_type_to_string(PacketType type) {
         case PacketType::ADMIN: return "ADMIN";
         case PacketType::UNSEQUENCED: return "UNSEQUENCED";
         case PacketType::DATA: return "DATA";
+        case PacketType::FOOTER: return "FOOTER";
+        case PacketType::CHECKPOINT: return "CHECKPOINT";
         default: return "UNKNOWN";
     }
 }
@@ -199,37 +64,12 @@ const char* order_status_to_string(OrderStatus status) {
         case OrderStatus::SEQUENCED_OUT_OF_ORDER_LATE: return "SEQUENCED-OUT-OF-ORDER-LATE";
         case OrderStatus::SEQUENCED_OUT_OF_ORDER_EARLY: return "SEQUENCED-OUT-OF-ORDER-EARLY";
         case OrderStatus::SEQUENCED_DUPLICATE: return "SEQUENCED-DUPLICATE";
+        case OrderStatus::SEQUENCED_RESET: return "SEQUENCED-RESET";
+        case OrderStatus::SEQUENCED_QUARANTINED: return "SEQUENCED-QUARANTINED";
         default: return "UNKNOWN";
     }
 }
 
-/**
- * Lookup message type information
- */
-const MessageTypeInfo* lookup_message_type(uint8_t type_id) {
-    for (int i = 0; i < NUM_MESSAGE_TYPES; i++) {
-        if (CBOE_MESSAGE_TYPES[i].type_id == type_id) {
-            return &CBOE_MESSAGE_TYPES[i];
-        }
-    }
-    return nullptr;
-}
-
-/**
- * Safe little-endian conversion functions
- */
-uint16_t le16toh_safe(uint16_t val) {
-    return le16toh(val);
-}
-
-uint32_t le32toh_safe(uint32_t val) {
-    return le32toh(val);
-}
-
-uint64_t le64toh_safe(uint64_t val) {
-    return le64toh(val);
-}
-
 /**
  * Parse messages within payload for detailed analysis
  */
@@ -397,12 +237,398 @@ struct LogStatistics {
     }
 };
 
+/**
+ * Per-(port, unit) sequence coverage reconstructed from logged packets
+ * Each DATA record covers hdr_count messages starting at its sequence.
+ * Coverage is kept per session epoch: a line's SEQUENCED-RESET record starts
+ * its next epoch. Ports that never start an epoch themselves (GRP and spin
+ * ports) follow the unit's latest epoch.
+ */
+struct GapAnalysis {
+    static constexpr size_t MAX_RANGES_SHOWN = 50;
+
+    using PortCoverage = std::map<uint16_t, SequenceIntervalSet>;
+    std::map<uint8_t, std::map<uint32_t, PortCoverage>> coverage;   // unit -> epoch -> port -> messages seen
+    std::map<std::pair<uint8_t, uint16_t>, uint32_t> line_epochs;   // (unit, line port) -> current epoch
+    std::map<uint8_t, uint32_t> unit_epochs;                         // unit -> latest epoch on any line
+    std::map<std::pair<uint8_t, uint16_t>, SequenceIntervalSet> quarantined; // (unit, line port) -> unconfirmed run
+    uint64_t records_used = 0;
+
+    void update(const BinaryLogRecord& record) {
+        if (record.sequence == 0 || static_cast<PacketType>(record.packet_type) != PacketType::DATA) {
+            return;
+        }
+
+        uint32_t message_count = (record.count > 0) ? record.count : 1;
+        uint64_t last = static_cast<uint64_t>(record.sequence) + message_count - 1;
+        if (last > UINT32_MAX) {
+            last = UINT32_MAX;
+        }
+
+        // A quarantined run only counts once the packet following it on the
+        // same line shows the tracker accepted the jump; otherwise it would
+        // stretch the expected span with a spoofed sequence
+        OrderStatus status = static_cast<OrderStatus>(record.order_status);
+        auto run = quarantined.find({record.unit, record.port});
+        if (status == OrderStatus::SEQUENCED_QUARANTINED) {
+            if (run == quarantined.end() || static_cast<uint64_t>(run->second.max()) + 1 != record.sequence) {
+                run = quarantined.insert_or_assign({record.unit, record.port}, SequenceIntervalSet()).first;
+            }
+            run->second.insert(record.sequence, static_cast<uint32_t>(last));
+            return;
+        }
+        auto line = line_epochs.find({record.unit, record.port});
+        if (status == OrderStatus::SEQUENCED_RESET) {
+            uint32_t epoch = (line != line_epochs.end()) ? line->second + 1 : 1;
+            line = line_epochs.insert_or_assign({record.unit, record.port}, epoch).first;
+            unit_epochs[record.unit] = std::max(unit_epochs[record.unit], epoch);
+        } else if (status == OrderStatus::SEQUENCED_FIRST && line == line_epochs.end()) {
+            line = line_epochs.emplace(std::make_pair(record.unit, record.port), 0).first;
+        }
+        uint32_t epoch = (line != line_epochs.end()) ? line->second : unit_epochs[record.unit];
+
+        SequenceIntervalSet& seen = coverage[record.unit][epoch][record.port];
+        if (run != quarantined.end()) {
+            if (status != OrderStatus::SEQUENCED_RESET && static_cast<uint64_t>(run->second.max()) + 1 == record.sequence) {
+                for (const auto& [first, run_last] : run->second.ranges()) {
+                    seen.insert(first, run_last);
+                }
+            }
+            quarantined.erase(run);
+        }
+        seen.insert(record.sequence, static_cast<uint32_t>(last));
+        records_used++;
+    }
+
+    static void print_ranges(const std::vector<SequenceIntervalSet::Range>& ranges) {
+        size_t shown = 0;
+        for (const auto& [first, last] : ranges) {
+            if (shown++ >= MAX_RANGES_SHOWN) {
+                std::cout << "    ... " << (ranges.size() - MAX_RANGES_SHOWN) << " more ranges" << std::endl;
+                break;
+            }
+            std::cout << "    missing " << first << "-" << last
+                     << " (" << (static_cast<uint64_t>(last) - first + 1) << ")" << std::endl;
+        }
+    }
+
+    static uint64_t total_missing(const std::vector<SequenceIntervalSet::Range>& ranges) {
+        uint64_t total = 0;
+        for (const auto& [first, last] : ranges) {
+            total += static_cast<uint64_t>(last) - first + 1;
+        }
+        return total;
+    }
+
+    static void print_coverage_line(const std::string& label, uint64_t expected,
+                                    const SequenceIntervalSet& set,
+                                    const std::vector<SequenceIntervalSet::Range>& gaps) {
+        double percentage = expected > 0 ? static_cast<double>(set.covered()) / expected * 100.0 : 0.0;
+        std::cout << "  " << label << ": " << set.covered() << " received ("
+                 << std::fixed << std::setprecision(3) << percentage << "%), "
+                 << gaps.size() << " gaps, " << total_missing(gaps) << " missing" << std::endl;
+    }
+
+    static void print_unit(const std::string& label, const PortCoverage& ports) {
+        // Union of all lines defines the expected span for the unit
+        SequenceIntervalSet combined;
+        for (const auto& [port, set] : ports) {
+            combined.merge(set);
+        }
+        uint32_t first = combined.min();
+        uint32_t last = combined.max();
+        uint64_t expected = static_cast<uint64_t>(last) - first + 1;
+
+        std::cout << "\n" << label << ": sequences " << first << " to " << last
+                 << " (" << expected << " messages)" << std::endl;
+
+        for (const auto& [port, set] : ports) {
+            auto gaps = set.missing(first, last);
+            print_coverage_line("Port " + std::to_string(port), expected, set, gaps);
+            print_ranges(gaps);
+        }
+
+        if (ports.size() > 1) {
+            auto union_gaps = combined.missing(first, last);
+            print_coverage_line("Union (all ports)", expected, combined, union_gaps);
+            print_ranges(union_gaps);
+
+            for (const auto& [port, set] : ports) {
+                std::cout << "  Recovered from other lines for port " << port << ": "
+                         << (combined.covered() - set.covered()) << " messages" << std::endl;
+            }
+        }
+    }
+
+    void print_report() const {
+        std::cout << "\n=== SEQUENCE GAP ANALYSIS ===" << std::endl;
+        std::cout << "Sequenced records analyzed: " << records_used << std::endl;
+
+        for (const auto& [unit, epochs] : coverage) {
+            for (const auto& [epoch, ports] : epochs) {
+                std::string label = "Unit " + std::to_string(unit);
+                if (epochs.size() > 1) {
+                    label += " session " + std::to_string(epoch + 1);
+                }
+                print_unit(label, ports);
+            }
+        }
+    }
+};
+
+/**
+ * Format a nanosecond duration with a readable unit
+ */
+std::string format_duration_ns(uint64_t ns) {
+    std::ostringstream oss;
+    if (ns < 1000) {
+        oss << ns << "ns";
+    } else if (ns < 1000000) {
+        oss << std::fixed << std::setprecision(ns < 10000 ? 1 : 0) << ns / 1e3 << "us";
+    } else if (ns < 1000000000) {
+        oss << std::fixed << std::setprecision(ns < 10000000 ? 1 : 0) << ns / 1e6 << "ms";
+    } else {
+        oss << std::fixed << std::setprecision(2) << ns / 1e9 << "s";
+    }
+    return oss.str();
+}
+
+/**
+ * Sliding-window packet counter with fixed memory
+ * The window is split into SUB_BUCKETS slots kept in a ring, so the maximum
+ * is exact to within one slot width (window / SUB_BUCKETS).
+ */
+class SlidingWindowCounter {
+public:
+    static constexpr int SUB_BUCKETS = 16;
+
+    explicit SlidingWindowCounter(uint64_t window_ns)
+        : window_ns_(window_ns), slot_ns_(std::max<uint64_t>(1, window_ns / SUB_BUCKETS)) {}
+
+    /**
+     * Count one packet; timestamps must be non-decreasing (older ones are
+     * attributed to the current slot)
+     */
+    void add(uint64_t timestamp_ns) {
+        uint64_t slot = timestamp_ns / slot_ns_;
+        if (!started_) {
+            current_slot_ = slot;
+            started_ = true;
+        } else if (slot > current_slot_) {
+            if (slot - current_slot_ >= SUB_BUCKETS) {
+                slots_.fill(0);
+                window_count_ = 0;
+            } else {
+                for (uint64_t s = current_slot_ + 1; s <= slot; s++) {
+                    window_count_ -= slots_[s % SUB_BUCKETS];
+                    slots_[s % SUB_BUCKETS] = 0;
+                }
+            }
+            current_slot_ = slot;
+        }
+
+        slots_[current_slot_ % SUB_BUCKETS]++;
+        window_count_++;
+        if (window_count_ > max_count_) {
+            max_count_ = window_count_;
+            max_timestamp_ = timestamp_ns;
+        }
+    }
+
+    uint64_t window_ns() const { return window_ns_; }
+    uint64_t count() const { return window_count_; }
+    uint64_t max_count() const { return max_count_; }
+    uint64_t max_timestamp() const { return max_timestamp_; }
+    double max_rate_pps() const { return static_cast<double>(max_count_) * 1e9 / window_ns_; }
+
+private:
+    uint64_t window_ns_;
+    uint64_t slot_ns_;
+    std::array<uint64_t, SUB_BUCKETS> slots_{};
+    uint64_t current_slot_ = 0;
+    uint64_t window_count_ = 0;
+    uint64_t max_count_ = 0;
+    uint64_t max_timestamp_ = 0;
+    bool started_ = false;
+};
+
+/**
+ * Log2-bucketed inter-arrival histogram for one port/unit stream
+ */
+struct InterArrivalHistogram {
+    static constexpr int NUM_BUCKETS = 40; // 2^39 ns ~ 9 minutes
+
+    std::array<uint64_t, NUM_BUCKETS> buckets{};
+    uint64_t last_timestamp = 0;
+    uint64_t samples = 0;
+    uint64_t max_gap_ns = 0;
+
+    void add(uint64_t timestamp_ns) {
+        if (last_timestamp != 0) {
+            uint64_t gap = (timestamp_ns > last_timestamp) ? timestamp_ns - last_timestamp : 0;
+            int bucket = (gap == 0) ? 0 : 63 - __builtin_clzll(gap);
+            buckets[std::min(bucket, NUM_BUCKETS - 1)]++;
+            max_gap_ns = std::max(max_gap_ns, gap);
+            samples++;
+        }
+        last_timestamp = timestamp_ns;
+    }
+
+    /**
+     * Upper bound of the bucket containing the given percentile
+     */
+    uint64_t percentile_upper_bound(double pct) const {
+        uint64_t target = static_cast<uint64_t>(samples * pct / 100.0);
+        uint64_t seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += buckets[i];
+            if (seen > target) {
+                return 2ULL << i;
+            }
+        }
+        return max_gap_ns;
+    }
+};
+
+/**
+ * Single-pass microburst analysis: peak rates per window size, burst
+ * episodes and inter-arrival distributions. Records must be fed in
+ * capture order (pass rotated segments oldest first).
+ */
+struct BurstAnalysis {
+    static constexpr uint64_t EPISODE_WINDOW_NS = 1000000; // Episodes detected on the 1ms window
+    static constexpr size_t MAX_EPISODES_KEPT = 100;
+
+    struct Episode {
+        uint64_t start_ns;
+        uint64_t end_ns;
+        uint64_t packets;
+        uint64_t peak_count;
+    };
+
+    std::vector<SlidingWindowCounter> windows;
+    std::map<std::pair<uint16_t, uint8_t>, InterArrivalHistogram> inter_arrival; // (port, unit)
+    SlidingWindowCounter episode_window{EPISODE_WINDOW_NS};
+    uint64_t episode_threshold;
+    std::vector<Episode> episodes;
+    uint64_t episodes_total = 0;
+    bool in_episode = false;
+    Episode current{};
+    uint64_t total_packets = 0;
+    uint64_t first_timestamp = 0;
+    uint64_t last_timestamp = 0;
+
+    explicit BurstAnalysis(uint64_t burst_threshold_pps)
+        : episode_threshold(std::max<uint64_t>(1, burst_threshold_pps * EPISODE_WINDOW_NS / 1000000000ULL)) {
+        for (uint64_t window_ns : {1000ULL, 10000ULL, 1000000ULL, 1000000000ULL}) {
+            windows.emplace_back(window_ns);
+        }
+    }
+
+    void update(const BinaryLogRecord& record) {
+        uint64_t ts = record.timestamp_ns;
+        if (total_packets == 0) {
+            first_timestamp = ts;
+        }
+        last_timestamp = std::max(last_timestamp, ts);
+        total_packets++;
+
+        for (auto& window : windows) {
+            window.add(ts);
+        }
+        inter_arrival[{record.port, record.unit}].add(ts);
+
+        episode_window.add(ts);
+        uint64_t level = episode_window.count();
+        if (level >= episode_threshold) {
+            if (!in_episode) {
+                in_episode = true;
+                current = Episode{ts, ts, 0, 0};
+            }
+            current.end_ns = ts;
+            current.packets++;
+            current.peak_count = std::max(current.peak_count, level);
+        } else if (in_episode) {
+            close_episode();
+        }
+    }
+
+    void close_episode() {
+        in_episode = false;
+        episodes_total++;
+        if (episodes.size() < MAX_EPISODES_KEPT) {
+            episodes.push_back(current);
+        }
+    }
+
+    void print_report() {
+        if (in_episode) {
+            close_episode();
+        }
+
+        std::cout << "\n=== MICROBURST ANALYSIS ===" << std::endl;
+        std::cout << "Packets: " << total_packets << std::endl;
+        if (total_packets == 0) {
+            return;
+        }
+
+        uint64_t duration_ns = last_timestamp - first_timestamp;
+        if (duration_ns > 0) {
+            std::cout << "Average Rate: " << std::fixed << std::setprecision(1)
+                     << total_packets * 1e9 / duration_ns << " packets/second" << std::endl;
+        }
+
+        std::cout << "\nPeak Rates (sliding window, 1/" << SlidingWindowCounter::SUB_BUCKETS
+                 << " window resolution):" << std::endl;
+        for (const auto& window : windows) {
+            std::cout << "  " << std::setw(6) << format_duration_ns(window.window_ns()) << " window: "
+                     << std::setw(8) << window.max_count() << " packets = "
+                     << std::fixed << std::setprecision(0) << window.max_rate_pps() << " pps at "
+                     << timestamp_to_string(window.max_timestamp()) << std::endl;
+        }
+
+        std::cout << "\nBurst Episodes (" << format_duration_ns(EPISODE_WINDOW_NS) << " window >= "
+                 << episode_threshold << " packets): " << episodes_total << std::endl;
+        for (size_t i = 0; i < episodes.size(); i++) {
+            const Episode& e = episodes[i];
+            std::cout << "  " << i + 1 << ": " << timestamp_to_string(e.start_ns)
+                     << " duration " << format_duration_ns(e.end_ns - e.start_ns)
+                     << ", " << e.packets << " packets, peak "
+                     << std::fixed << std::setprecision(0)
+                     << e.peak_count * 1e9 / EPISODE_WINDOW_NS << " pps" << std::endl;
+        }
+        if (episodes_total > episodes.size()) {
+            std::cout << "  ... " << (episodes_total - episodes.size()) << " more episodes" << std::endl;
+        }
+
+        std::cout << "\nInter-arrival Times:" << std::endl;
+        for (const auto& [key, hist] : inter_arrival) {
+            std::cout << "  Port " << key.first << " Unit " << static_cast<int>(key.second)
+                     << ": " << hist.samples << " gaps, p50 <= " << format_duration_ns(hist.percentile_upper_bound(50))
+                     << ", p99 <= " << format_duration_ns(hist.percentile_upper_bound(99))
+                     << ", p99.9 <= " << format_duration_ns(hist.percentile_upper_bound(99.9))
+                     << ", max " << format_duration_ns(hist.max_gap_ns) << std::endl;
+            for (int i = 0; i < InterArrivalHistogram::NUM_BUCKETS; i++) {
+                if (hist.buckets[i] == 0) {
+                    continue;
+                }
+                uint64_t low = (i == 0) ? 0 : (1ULL << i);
+                std::cout << "    [" << std::setw(6) << format_duration_ns(low) << ", "
+                         << std::setw(6) << format_duration_ns(2ULL << i) << "): " << hist.buckets[i] << std::endl;
+            }
+        }
+    }
+};
+
 /**
  * Command-line options
  */
 struct Options {
-    std::string filename;
+    std::vector<std::string> filenames;
     bool show_statistics = false;
+    bool show_gaps = false;
+    bool show_bursts = false;
+    uint64_t burst_threshold_pps = 100000;
     bool show_details = false;
     bool show_messages = false;
     uint64_t max_records = 0; // 0 = unlimited
@@ -414,9 +640,12 @@ struct Options {
 };
 
 void print_usage(const char* program_name) {
-    std::cout << "Usage: " << program_name << " [options] <binary_log_file>" << std::endl;
+    std::cout << "Usage: " << program_name << " [options] <binary_log_file> [more_files...]" << std::endl;
     std::cout << "\nOptions:" << std::endl;
     std::cout << "  -s, --stats          Show statistics summary" << std::endl;
+    std::cout << "  -g, --gaps           Show per-port/unit missing sequence ranges across all files" << std::endl;
+    std::cout << "  -b, --bursts         Show peak rates, burst episodes and inter-arrival histograms" << std::endl;
+    std::cout << "  --burst-pps N        Rate over a 1ms window that starts a burst episode (default 100000)" << std::endl;
     std::cout << "  -d, --details        Show detailed packet information" << std::endl;
     std::cout << "  -m, --messages       Show message details within packets" << std::endl;
     std::cout << "  -n, --max-records N  Limit output to N records" << std::endl;
@@ -445,6 +674,14 @@ Options parse_arguments(int argc, char* argv[]) {
             opts.help = true;
         } else if (arg == "-s" || arg == "--stats") {
             opts.show_statistics = true;
+        } else if (arg == "-g" || arg == "--gaps") {
+            opts.show_gaps = true;
+        } else if (arg == "-b" || arg == "--bursts") {
+            opts.show_bursts = true;
+        } else if (arg == "--burst-pps") {
+            if (i + 1 < argc) {
+                opts.burst_threshold_pps = std::stoull(argv[++i]);
+            }
         } else if (arg == "-d" || arg == "--details") {
             opts.show_details = true;
         } else if (arg == "-m" || arg == "--messages") {
@@ -470,7 +707,7 @@ Options parse_arguments(int argc, char* argv[]) {
                 opts.filter_packet_type = string_to_packet_type(argv[++i]);
             }
         } else if (arg[0] != '-') {
-            opts.filename = arg;
+            opts.filenames.push_back(arg);
         }
     }
     
@@ -480,95 +717,131 @@ Options parse_arguments(int argc, char* argv[]) {
 int main(int argc, char* argv[]) {
     Options opts = parse_arguments(argc, argv);
     
-    if (opts.help || opts.filename.empty()) {
+    if (opts.help || opts.filenames.empty()) {
         print_usage(argv[0]);
         return opts.help ? 0 : 1;
     }
     
     try {
-        BinaryLogReader reader(opts.filename);
         LogStatistics stats;
-        
-        std::cout << "Reading binary log file: " << opts.filename << std::endl;
-        std::cout << "File size: " << reader.get_file_size() << " bytes" << std::endl;
+        GapAnalysis gaps;
+        BurstAnalysis bursts(opts.burst_threshold_pps);
         
         BinaryLogRecord record;
         std::vector<char> payload;
         uint64_t records_processed = 0;
         uint64_t records_shown = 0;
         
-        while (reader.read_record(record, payload)) {
-            records_processed++;
+        for (const auto& filename : opts.filenames) {
+            BinaryLogReader reader(filename);
+        
+            std::cout << "Reading binary log file: " << filename << std::endl;
+            std::cout << "File size: " << reader.get_file_size() << " bytes" << std::endl;
+        
+            while (reader.read_record(record, payload)) {
+                // The footer describes the log rather than a packet
+                if (static_cast<PacketType>(record.packet_type) == PacketType::FOOTER) {
+                    LogFooter footer;
+                    if (payload.size() == sizeof(LogFooter) &&
+                        (memcpy(&footer, payload.data(), sizeof(footer)), footer.magic == Config::LOG_FOOTER_MAGIC)) {
+                        std::cout << "Footer: closed cleanly at " << timestamp_to_string(record.timestamp_ns) << ", "
+                                  << footer.records << " records logged by that run, "
+                                  << footer.shutdown_lost << " packets lost at shutdown" << std::endl;
+                    }
+                    continue;
+                }
+                // Checkpoint markers only serve warm restarts
+                if (static_cast<PacketType>(record.packet_type) == PacketType::CHECKPOINT) {
+                    continue;
+                }
+                records_processed++;
             
-            // Apply filters
-            bool pass_filter = true;
+                // Apply filters
+                bool pass_filter = true;
             
-            if (opts.filter_port != 0 && record.port != opts.filter_port) {
-                pass_filter = false;
-            }
+                if (opts.filter_port != 0 && record.port != opts.filter_port) {
+                    pass_filter = false;
+                }
             
-            if (opts.filter_packet_type != static_cast<PacketType>(255) && 
-                static_cast<PacketType>(record.packet_type) != opts.filter_packet_type) {
-                pass_filter = false;
-            }
+                if (opts.filter_packet_type != static_cast<PacketType>(255) && 
+                    static_cast<PacketType>(record.packet_type) != opts.filter_packet_type) {
+                    pass_filter = false;
+                }
             
-            if (opts.filter_sequence_start > 0 && record.sequence < opts.filter_sequence_start) {
-                pass_filter = false;
-            }
+                if (opts.filter_sequence_start > 0 && record.sequence < opts.filter_sequence_start) {
+                    pass_filter = false;
+                }
             
-            if (opts.filter_sequence_end > 0 && record.sequence > opts.filter_sequence_end) {
-                pass_filter = false;
-            }
+                if (opts.filter_sequence_end > 0 && record.sequence > opts.filter_sequence_end) {
+                    pass_filter = false;
+                }
             
-            if (pass_filter) {
-                stats.update(record, payload);
+                if (pass_filter) {
+                    if (opts.show_statistics) {
+                        stats.update(record, payload);
+                    }
+                    if (opts.show_gaps) {
+                        gaps.update(record);
+                    }
+                    if (opts.show_bursts) {
+                        bursts.update(record);
+                    }
                 
-                if (opts.show_details && (opts.max_records == 0 || records_shown < opts.max_records)) {
-                    std::cout << "\n--- Record " << records_shown + 1 << " ---" << std::endl;
-                    std::cout << "Timestamp: " << timestamp_to_string(record.timestamp_ns) << std::endl;
-                    std::cout << "Packet ID: " << record.packet_id << std::endl;
-                    std::cout << "Sequence: " << record.sequence << std::endl;
-                    std::cout << "Source IP: " << binary_to_ip(record.src_ip) << std::endl;
-                    std::cout << "Port: " << record.port << std::endl;
-                    std::cout << "Length: " << record.length << std::endl;
-                    std::cout << "Count: " << static_cast<int>(record.count) << std::endl;
-                    std::cout << "Unit: " << static_cast<int>(record.unit) << std::endl;
-                    std::cout << "Packet Type: " << packet_type_to_string(static_cast<PacketType>(record.packet_type)) << std::endl;
-                    std::cout << "Order Status: " << order_status_to_string(static_cast<OrderStatus>(record.order_status)) << std::endl;
-                    std::cout << "Payload Length: " << record.payload_length << std::endl;
+                    if (opts.show_details && (opts.max_records == 0 || records_shown < opts.max_records)) {
+                        std::cout << "\n--- Record " << records_shown + 1 << " ---" << std::endl;
+                        std::cout << "Timestamp: " << timestamp_to_string(record.timestamp_ns) << std::endl;
+                        std::cout << "Packet ID: " << record.packet_id << std::endl;
+                        std::cout << "Sequence: " << record.sequence << std::endl;
+                        std::cout << "Source IP: " << binary_to_ip(record.src_ip) << std::endl;
+                        std::cout << "Port: " << record.port << std::endl;
+                        std::cout << "Length: " << record.length << std::endl;
+                        std::cout << "Count: " << static_cast<int>(record.count) << std::endl;
+                        std::cout << "Unit: " << static_cast<int>(record.unit) << std::endl;
+                        std::cout << "Packet Type: " << packet_type_to_string(static_cast<PacketType>(record.packet_type)) << std::endl;
+                        std::cout << "Order Status: " << order_status_to_string(static_cast<OrderStatus>(record.order_status)) << std::endl;
+                        std::cout << "Payload Length: " << record.payload_length << std::endl;
                     
-                    if (opts.show_messages && !payload.empty()) {
-                        std::vector<std::string> messages = parse_payload_messages(payload);
-                        if (!messages.empty()) {
-                            std::cout << "Messages:" << std::endl;
-                            for (size_t i = 0; i < messages.size(); i++) {
-                                std::cout << "  " << i + 1 << ": " << messages[i] << std::endl;
+                        if (opts.show_messages && !payload.empty()) {
+                            std::vector<std::string> messages = parse_payload_messages(payload);
+                            if (!messages.empty()) {
+                                std::cout << "Messages:" << std::endl;
+                                for (size_t i = 0; i < messages.size(); i++) {
+                                    std::cout << "  " << i + 1 << ": " << messages[i] << std::endl;
+                                }
                             }
                         }
-                    }
                     
-                    records_shown++;
+                        records_shown++;
+                    }
                 }
-            }
             
-            // Progress indicator for large files
-            if (records_processed % 10000 == 0) {
-                std::cout << "\rProgress: " << std::fixed << std::setprecision(1) 
-                         << reader.get_progress() << "% (" << records_processed 
-                         << " records processed)" << std::flush;
+                // Progress indicator for large files
+                if (records_processed % 10000 == 0) {
+                    std::cout << "\rProgress: " << std::fixed << std::setprecision(1) 
+                             << reader.get_progress() << "% (" << records_processed 
+                             << " records processed)" << std::flush;
+                }
             }
-        }
         
-        std::cout << "\rCompleted: 100.0% (" << records_processed << " records processed)" << std::endl;
+            std::cout << "\rCompleted: 100.0% (" << records_processed << " records processed)" << std::endl;
+        }
         
         if (opts.show_statistics) {
             stats.print_summary();
         }
         
-        if (!opts.show_details && !opts.show_statistics) {
+        if (opts.show_gaps) {
+            gaps.print_report();
+        }
+        
+        if (opts.show_bursts) {
+            bursts.print_report();
+        }
+        
+        if (!opts.show_details && !opts.show_statistics && !opts.show_gaps && !opts.show_bursts) {
             std::cout << "\nQuick Summary:" << std::endl;
             std::cout << "Total records processed: " << records_processed << std::endl;
-            std::cout << "Use -s for statistics, -d for details, -m for message parsing" << std::endl;
+            std::cout << "Use -s for statistics, -g for gaps, -d for details, -m for message parsing, -b for bursts" << std::endl;
         }
         
     } catch (const std::exception& e) {
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "packet_types.h"
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Sequential reader of a binary log segment written by BinaryLogger
+ * Reads through a 1MB stream buffer and returns one record at a time with
+ * its stored payload; the payload vector is reused, so a caller that keeps
+ * it across calls reads without allocating once it has grown.
+ */
+class BinaryLogReader {
+private:
+    static constexpr size_t READ_BUFFER_SIZE = 1024 * 1024;
+
+    std::vector<char> read_buffer;
+    std::ifstream file;
+    std::string filename;
+    size_t file_size;
+    size_t bytes_read;
+    
+public:
+    BinaryLogReader(const std::string& fname) : read_buffer(READ_BUFFER_SIZE), filename(fname), bytes_read(0) {
+        // Large stream buffer so multi-GB segments are read in big chunks
+        file.rdbuf()->pubsetbuf(read_buffer.data(), read_buffer.size());
+        file.open(filename, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot open file: " + filename);
+        }
+        
+        // Get file size
+        file.seekg(0, std::ios::end);
+        file_size = file.tellg();
+        file.seekg(0, std::ios::beg);
+    }
+    
+    ~BinaryLogReader() {
+        if (file.is_open()) {
+            file.close();
+        }
+    }
+    
+    bool read_record(BinaryLogRecord& record, std::vector<char>& payload) {
+        if (bytes_read >= file_size) {
+            return false;
+        }
+        
+        // Read the fixed part of the record
+        file.read(reinterpret_cast<char*>(&record), sizeof(BinaryLogRecord));
+        if (file.gcount() != sizeof(BinaryLogRecord)) {
+            return false;
+        }
+        bytes_read += sizeof(BinaryLogRecord);
+        
+        // Read the variable payload
+        payload.resize(record.payload_length);
+        if (record.payload_length > 0) {
+            file.read(payload.data(), record.payload_length);
+            if (file.gcount() != record.payload_length) {
+                return false;
+            }
+            bytes_read += record.payload_length;
+        }
+        
+        // spdlog terminates every entry with an end-of-line separator
+        if (file.peek() == '\n') {
+            file.get();
+            bytes_read++;
+        }
+        
+        return true;
+    }
+    
+    size_t get_file_size() const { return file_size; }
+    size_t get_bytes_read() const { return bytes_read; }
+    double get_progress() const { 
+        return file_size > 0 ? static_cast<double>(bytes_read) / file_size * 100.0 : 0.0; 
+    }
+};
@@ -1,30 +1,147 @@
 #include "binary_logger.h"
+#include "runtime_config.h"
+#include "sequence_checkpoint.h"
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
-#include <spdlog/async.h>
 #include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
 #include <stdexcept>
 #include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-BinaryLogger::BinaryLogger() {
+/**
+ * File sink that lines the writer threads up at checkpoint markers
+ * A marker is queued once per writer thread. Each copy holds its thread
+ * until every thread holds one, so every record queued before the marker has
+ * been written and none queued after it has been taken off the queue yet;
+ * the last copy to arrive is written, the others are dropped. The marker thus
+ * splits the file exactly however the threads interleave their writes. The
+ * copies are queued back to back, so they normally meet within microseconds;
+ * a copy lost from a full queue (overrun_oldest) or a thread preempted in
+ * between would stall the others, so waiting copies give up after
+ * Config::CHECKPOINT_BARRIER_WAIT_US, and that checkpoint gets no marker (and
+ * is therefore never committed).
+ * A written marker is flushed to the file at once and remembered for
+ * wait_written(), which the checkpoint writer blocks on.
+ */
+class BinaryLogger::CheckpointBarrierSink : public spdlog::sinks::sink {
+public:
+    CheckpointBarrierSink(std::shared_ptr<spdlog::sinks::sink> file, int threads)
+        : file_(std::move(file)), threads_(threads) {}
+
+    void log(const spdlog::details::log_msg& msg) override {
+        uint64_t timestamp_ns;
+        if (!checkpoint_marker(msg, timestamp_ns)) {
+            file_->log(msg);
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (timestamp_ns != marker_ns_) {
+            // First copy of a new marker; copies still waiting on an older one leave
+            marker_ns_ = timestamp_ns;
+            arrived_ = 0;
+            generation_++;
+            cv_.notify_all();
+        }
+        uint64_t generation = generation_;
+        if (++arrived_ < threads_) {
+            if (!cv_.wait_for(lock, std::chrono::microseconds(Config::CHECKPOINT_BARRIER_WAIT_US),
+                              [&] { return generation_ != generation; })) {
+                marker_ns_ = 0;     // Abandoned
+                arrived_ = 0;
+                generation_++;
+                cv_.notify_all();
+            }
+            return;
+        }
+        file_->log(msg);
+        file_->flush();
+        written_.push_back(timestamp_ns);
+        if (written_.size() > WRITTEN_KEPT) {
+            written_.pop_front();
+        }
+        marker_ns_ = 0;
+        arrived_ = 0;
+        generation_++;
+        cv_.notify_all();
+    }
+
+    bool wait_written(uint64_t timestamp_ns, int timeout_ms) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [&] {
+            return std::find(written_.begin(), written_.end(), timestamp_ns) != written_.end();
+        });
+    }
+
+    void flush() override { file_->flush(); }
+    void set_pattern(const std::string& pattern) override { file_->set_pattern(pattern); }
+    void set_formatter(std::unique_ptr<spdlog::formatter> formatter) override {
+        file_->set_formatter(std::move(formatter));
+    }
+
+private:
+    static constexpr size_t WRITTEN_KEPT = 16;  // Markers remembered for wait_written()
+    
+    std::shared_ptr<spdlog::sinks::sink> file_;
+    int threads_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    uint64_t marker_ns_ = 0;    // Marker the waiting copies belong to
+    int arrived_ = 0;
+    uint64_t generation_ = 0;   // Bumped whenever the waiting copies are released
+    std::deque<uint64_t> written_;  // Timestamps of the markers written last, oldest first
+
+    static bool checkpoint_marker(const spdlog::details::log_msg& msg, uint64_t& timestamp_ns) {
+        if (msg.payload.size() < sizeof(BinaryLogRecord) ||
+            static_cast<PacketType>(msg.payload.data()[offsetof(BinaryLogRecord, packet_type)]) != PacketType::CHECKPOINT) {
+            return false;
+        }
+        memcpy(&timestamp_ns, msg.payload.data() + offsetof(BinaryLogRecord, timestamp_ns), sizeof(timestamp_ns));
+        return true;
+    }
+};
+
+BinaryLogger::BinaryLogger() : BinaryLogger(runtime_config().log_file, "binary_logger") {
+}
+
+BinaryLogger::BinaryLogger(const std::string& log_file, const std::string& name) : log_file_(log_file), name_(name) {
     init_logging();
 }
 
 BinaryLogger::~BinaryLogger() {
     if (binary_logger_) {
         binary_logger_->flush();
+        spdlog::drop(name_);
+        binary_logger_.reset();
     }
-    spdlog::shutdown();
+    // The pool's destructor writes out whatever is still queued, then joins
+    writer_pool_.reset();
 }
 
 void BinaryLogger::init_logging() {
+    const RuntimeConfig& config = runtime_config();
+    uint64_t torn_bytes = truncate_torn_record();
+    
     try {
         // Initialize async logging with MASSIVE queue for 14M packets
-        spdlog::init_thread_pool(Config::ASYNC_QUEUE_SIZE, Config::ASYNC_THREADS);
+        std::vector<int> writer_cpus = config.writer_cpus;
+        writer_pool_ = std::make_shared<spdlog::details::thread_pool>(
+            config.async_queue_size, config.async_threads, [writer_cpus]() {
+            pin_current_thread(writer_cpus);
+        });
         
         // Create rotating file sink optimized for binary data
         auto rotating_sink = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
-            "packets_binary.log", Config::LOG_FILE_SIZE, Config::LOG_FILE_COUNT);
+            log_file_, config.log_file_size, config.log_file_count);
         
         // Disable automatic flushing for maximum performance
         rotating_sink->set_level(spdlog::level::info);
@@ -32,12 +149,16 @@ void BinaryLogger::init_logging() {
         // Create console sink for status messages only
         auto console_sink = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
         
+        writer_threads_ = config.async_threads;
+        barrier_sink_ = std::make_shared<CheckpointBarrierSink>(rotating_sink, writer_threads_);
+        
         // Create async binary logger with maximum performance settings
         binary_logger_ = std::make_shared<spdlog::async_logger>(
-            "binary_logger", 
-            rotating_sink, 
-            spdlog::thread_pool(),
-            spdlog::async_overflow_policy::block);  // Block instead of dropping packets
+            name_, 
+            barrier_sink_, 
+            writer_pool_,
+            config.block_on_full_queue ? spdlog::async_overflow_policy::block  // Block instead of dropping packets
+                                       : spdlog::async_overflow_policy::overrun_oldest);
         
         // Create console logger for status messages
         console_logger_ = std::make_shared<spdlog::logger>("console", console_sink);
@@ -54,12 +175,14 @@ void BinaryLogger::init_logging() {
         // We'll manually flush periodically
         binary_logger_->flush_on(spdlog::level::off);  
         
-        // Register loggers
+        // Register the binary logger; console loggers are private to each instance
         spdlog::register_logger(binary_logger_);
-        spdlog::register_logger(console_logger_);
         
-        console_logger_->info("HIGH-VOLUME binary logging initialized: {}MB files, {} threads, {}K queue", 
-                               Config::LOG_FILE_SIZE/(1024*1024), Config::ASYNC_THREADS, Config::ASYNC_QUEUE_SIZE/1024);
+        console_logger_->info("HIGH-VOLUME binary logging initialized: {}, {}MB files, {} threads, {}K queue", 
+                               log_file_, config.log_file_size/(1024*1024), config.async_threads, config.async_queue_size/1024);
+        if (torn_bytes > 0) {
+            console_logger_->warn("Removed {} bytes of a torn record from the end of {}", torn_bytes, log_file_);
+        }
         
     } catch (const spdlog::spdlog_ex& ex) {
         throw std::runtime_error("spdlog initialization failed: " + std::string(ex.what()));
@@ -69,15 +192,21 @@ void BinaryLogger::init_logging() {
 void BinaryLogger::log_packet(uint32_t packet_id, uint16_t port, const char* buffer, uint16_t len,
                               uint32_t sequence, uint8_t count, uint8_t unit, 
                               PacketType packet_type, OrderStatus order_status,
-                              uint32_t src_ip) {
+                              uint32_t src_ip, uint16_t max_payload_length,
+                              uint64_t rx_timestamp_ns) {
     
-    // Get high-precision timestamp
-    auto now = std::chrono::high_resolution_clock::now();
-    uint64_t timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        now.time_since_epoch()).count();
+    // Get high-precision timestamp unless the packet was stamped on arrival
+    uint64_t timestamp_ns;
+    if (rx_timestamp_ns != 0) {
+        timestamp_ns = rx_timestamp_ns;
+    } else {
+        auto now = std::chrono::high_resolution_clock::now();
+        timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            now.time_since_epoch()).count();
+    }
     
-    // Limit payload size for binary logging (store first 256 bytes for analysis)
-    uint16_t payload_length = std::min(static_cast<uint16_t>(len), static_cast<uint16_t>(256));
+    // Limit payload size for binary logging (store the first bytes for analysis)
+    uint16_t payload_length = std::min(len, max_payload_length);
     
     // Create compact binary record
     BinaryLogRecord record = {
@@ -102,11 +231,185 @@ void BinaryLogger::log_packet(uint32_t packet_id, uint16_t port, const char* buf
     // Append binary record
     log_entry.append(reinterpret_cast<const char*>(&record), sizeof(BinaryLogRecord));
     
-    // Append limited payload (first 256 bytes for analysis)
+    // Append limited payload
     log_entry.append(buffer, record.payload_length);
     
     // Log to spdlog as raw binary data - EXTREMELY fast
     binary_logger_->info(log_entry);
+    
+    if (records_logged_++ == 0) {
+        first_timestamp_ns_ = timestamp_ns;
+    }
+    last_timestamp_ns_ = timestamp_ns;
+}
+
+void BinaryLogger::log_checkpoint_marker(uint64_t checkpoint_timestamp_ns) {
+    BinaryLogRecord record = {
+        .timestamp_ns = checkpoint_timestamp_ns,
+        .packet_id = 0,
+        .sequence = 0,
+        .src_ip = 0,
+        .port = 0,
+        .length = 0,
+        .count = 0,
+        .unit = 0,
+        .packet_type = static_cast<uint8_t>(PacketType::CHECKPOINT),
+        .order_status = static_cast<uint8_t>(OrderStatus::UNSEQUENCED),
+        .payload_length = 0
+    };
+    std::string log_entry(reinterpret_cast<const char*>(&record), sizeof(BinaryLogRecord));
+    for (int i = 0; i < writer_threads_; i++) {
+        binary_logger_->info(log_entry);    // One copy per writer thread, see CheckpointBarrierSink
+    }
+}
+
+bool BinaryLogger::wait_for_checkpoint_marker(uint64_t checkpoint_timestamp_ns, int timeout_ms) {
+    return barrier_sink_ && barrier_sink_->wait_written(checkpoint_timestamp_ns, timeout_ms);
+}
+
+void BinaryLogger::close(uint64_t shutdown_lost) {
+    if (!binary_logger_) {
+        return;
+    }
+    
+    LogFooter footer = {Config::LOG_FOOTER_MAGIC, records_logged_, first_timestamp_ns_, last_timestamp_ns_, shutdown_lost};
+    uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    BinaryLogRecord record = {
+        .timestamp_ns = std::max(now_ns, last_timestamp_ns_ + 1),
+        .packet_id = 0,
+        .sequence = 0,
+        .src_ip = 0,
+        .port = 0,
+        .length = sizeof(LogFooter),
+        .count = 0,
+        .unit = 0,
+        .packet_type = static_cast<uint8_t>(PacketType::FOOTER),
+        .order_status = static_cast<uint8_t>(OrderStatus::UNSEQUENCED),
+        .payload_length = sizeof(LogFooter)
+    };
+    std::string log_entry(reinterpret_cast<const char*>(&record), sizeof(BinaryLogRecord));
+    log_entry.append(reinterpret_cast<const char*>(&footer), sizeof(LogFooter));
+    binary_logger_->info(log_entry);
+    
+    // flush() only queues a request; the pool's destructor returns once the
+    // writer threads have written everything, the footer last
+    binary_logger_->flush();
+    spdlog::drop(name_);
+    binary_logger_.reset();
+    writer_pool_.reset();
+    
+    try {
+        write_index(footer);
+    } catch (const std::exception& e) {
+        log_error(e.what());
+    }
+    console_logger_->info("Closed {}: {} records, {} lost at shutdown", log_file_, records_logged_, shutdown_lost);
+}
+
+uint64_t BinaryLogger::truncate_torn_record() const {
+    int fd = ::open(log_file_.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return 0;
+    }
+    
+    // The last complete entry starts within two of the longest entries from the end
+    constexpr uint64_t MAX_ENTRY = sizeof(BinaryLogRecord) + UINT16_MAX + 1;
+    uint64_t size = static_cast<uint64_t>(st.st_size);
+    uint64_t base = size > 2 * MAX_ENTRY ? size - 2 * MAX_ENTRY : 0;
+    std::vector<char> tail(size - base);
+    ssize_t n = ::pread(fd, tail.data(), tail.size(), static_cast<off_t>(base));
+    ::close(fd);
+    if (n != static_cast<ssize_t>(tail.size())) {
+        return 0;
+    }
+    
+    // Entries are a record, its payload and spdlog's end of line, with nothing
+    // marking where one starts. Walking back from the end, chain_end[p] is
+    // where the last complete entry ends if an entry starts at p, or -1 if the
+    // bytes at p cannot be a chain of entries. Every real entry start in the
+    // window leads to the same end, so the end reached from the most offsets
+    // wins; the start of the file is an entry start for certain.
+    int64_t length = static_cast<int64_t>(tail.size());
+    std::vector<int64_t> chain_end(tail.size() + 1, -1);
+    std::vector<bool> whole_entry(tail.size() + 1, false);     // A complete entry starts here
+    chain_end[tail.size()] = length;
+    for (int64_t pos = length - 1; pos >= 0; pos--) {
+        if (pos + static_cast<int64_t>(sizeof(BinaryLogRecord)) > length) {
+            chain_end[pos] = pos;       // A record header cut off by the end of the file
+            continue;
+        }
+        BinaryLogRecord record;
+        memcpy(&record, tail.data() + pos, sizeof(record));
+        if (record.packet_type > static_cast<uint8_t>(PacketType::CHECKPOINT) ||
+            record.order_status > static_cast<uint8_t>(OrderStatus::SEQUENCED_QUARANTINED) ||
+            record.payload_length > record.length) {
+            continue;
+        }
+        int64_t next = pos + static_cast<int64_t>(sizeof(BinaryLogRecord)) + record.payload_length + 1;
+        if (next > length) {
+            chain_end[pos] = pos;       // Payload cut off
+        } else if (tail[next - 1] == '\n') {
+            chain_end[pos] = chain_end[next];
+            whole_entry[pos] = chain_end[pos] >= 0;
+        }
+    }
+    
+    int64_t complete = -1;
+    if (base == 0) {
+        complete = chain_end[0];
+    } else {
+        std::map<int64_t, int> votes;
+        for (int64_t pos = 0; pos < length; pos++) {
+            if (whole_entry[pos]) {
+                votes[chain_end[pos]]++;
+            }
+        }
+        int best = 0;
+        for (const auto& [end, count] : votes) {
+            if (count > best) {
+                best = count;
+                complete = end;
+            }
+        }
+    }
+    if (complete < 0 || complete == length) {
+        return 0;   // Intact, or no entry boundary recognized; leave the file as it is
+    }
+    uint64_t kept = base + static_cast<uint64_t>(complete);
+    if (::truncate(log_file_.c_str(), static_cast<off_t>(kept)) != 0) {
+        throw std::runtime_error("Cannot truncate the torn record at the end of " + log_file_);
+    }
+    return size - kept;
+}
+
+void BinaryLogger::write_index(const LogFooter& footer) const {
+    std::vector<std::string> segments = log_segments_newest_first(log_file_, runtime_config().log_file_count + 1);
+    std::string path = log_file_ + ".index";
+    std::string tmp_path = path + ".tmp";
+    
+    std::ofstream out(tmp_path, std::ios::trunc);
+    out << "# Segments of " << log_file_ << ", oldest first: file bytes first_timestamp_ns\n";
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+        struct stat st;
+        uint64_t first_ns = 0;
+        for_each_log_record(*it, [&](const BinaryLogRecord& record) {
+            first_ns = record.timestamp_ns;
+            return false;
+        });
+        out << *it << " " << (::stat(it->c_str(), &st) == 0 ? st.st_size : 0) << " " << first_ns << "\n";
+    }
+    out << "# Footer: " << footer.records << " records, last_timestamp_ns " << footer.last_timestamp_ns
+        << ", " << footer.shutdown_lost << " lost at shutdown\n";
+    out.close();
+    if (!out || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot write log index " + path);
+    }
 }
 
 void BinaryLogger::flush() {
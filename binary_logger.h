@@ -2,20 +2,29 @@
 
 #include "packet_types.h"
 #include <spdlog/spdlog.h>
+#include <spdlog/async.h>
 #include <memory>
 #include <string>
 
 /**
  * High-performance binary logger using spdlog async infrastructure
  * Optimized for logging millions of packets with minimal latency
+ * Each instance owns its writer thread pool, so several loggers (one per
+ * processing shard) write their files independently.
  */
 class BinaryLogger {
 public:
     /**
      * Constructor - initializes spdlog with high-performance settings
+     * Writes to the configured log_file.
      */
     BinaryLogger();
     
+    /**
+     * Log to another file under a distinct logger name (processing shards)
+     */
+    BinaryLogger(const std::string& log_file, const std::string& name);
+    
     /**
      * Destructor - ensures proper cleanup and final flush
      */
@@ -33,17 +42,51 @@ public:
      * @param packet_type Type of packet
      * @param order_status Sequence order status
      * @param src_ip Source IP address (binary format)
+     * @param max_payload_length Maximum number of payload bytes stored
+     * @param rx_timestamp_ns Arrival time measured upstream (e.g. by zmq_bridge),
+     *                        0 to stamp the record with the current time
      */
     void log_packet(uint32_t packet_id, uint16_t port, const char* buffer, uint16_t len,
                    uint32_t sequence, uint8_t count, uint8_t unit, 
                    PacketType packet_type, OrderStatus order_status,
-                   uint32_t src_ip);
+                   uint32_t src_ip, uint16_t max_payload_length = Config::MAX_LOGGED_PAYLOAD,
+                   uint64_t rx_timestamp_ns = 0);
+    
+    /**
+     * Mark where a sequence checkpoint was taken
+     * Appends a CHECKPOINT record carrying the checkpoint's timestamp; every
+     * packet logged before it is covered by that checkpoint, so warm-restart
+     * replay starts after it. The writer threads are lined up on the marker,
+     * so it lands exactly between the packets logged before and after this
+     * call. The file is flushed right after the marker is written. Not
+     * counted in the footer totals.
+     */
+    void log_checkpoint_marker(uint64_t checkpoint_timestamp_ns);
+    
+    /**
+     * Wait until the marker of a checkpoint has been written and flushed
+     * A checkpoint may only replace the previous one once this returns true;
+     * otherwise a crash leaves a checkpoint whose marker is not in the log.
+     * @return false if it was not written within timeout_ms (still queued, or
+     *         abandoned by the writer threads)
+     */
+    bool wait_for_checkpoint_marker(uint64_t checkpoint_timestamp_ns, int timeout_ms);
     
     /**
      * Force flush of pending log data
      */
     void flush();
     
+    /**
+     * End the log on a clean shutdown
+     * Appends a FOOTER record (LogFooter payload), waits until the writer
+     * threads have written every queued record, then writes the segment
+     * index <log_file>.index: each segment on disk, oldest first, with its
+     * size and first timestamp. Nothing may be logged afterwards.
+     * @param shutdown_lost Packets lost while shutting down, stored in the footer
+     */
+    void close(uint64_t shutdown_lost);
+    
     /**
      * Log informational message to console
      */
@@ -60,11 +103,36 @@ public:
     void log_error(const std::string& message);
 
 private:
+    class CheckpointBarrierSink;
+    
+    std::string log_file_;
+    std::string name_;
+    std::shared_ptr<spdlog::details::thread_pool> writer_pool_;
     std::shared_ptr<spdlog::logger> binary_logger_;
     std::shared_ptr<spdlog::logger> console_logger_;
+    std::shared_ptr<CheckpointBarrierSink> barrier_sink_;
+    int writer_threads_ = 1;        // Size of writer_pool_, and copies queued per checkpoint marker
+    
+    // Totals for the footer
+    uint64_t records_logged_ = 0;
+    uint64_t first_timestamp_ns_ = 0;
+    uint64_t last_timestamp_ns_ = 0;
     
     /**
      * Initialize the logging system with optimized settings
      */
     void init_logging();
+    
+    /**
+     * Cut a record left half-written by a crash off the end of the log file
+     * Records appended after it would otherwise be read out of step. Only the
+     * last two maximum-size entries of the file are read.
+     * @return Bytes removed
+     */
+    uint64_t truncate_torn_record() const;
+    
+    /**
+     * Write <log_file>.index after the footer reached the file
+     */
+    void write_index(const LogFooter& footer) const;
 };
\ No newline at end of file
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "packet_types.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * Fixed set of frame buffers lent to ZeroMQ for zero-copy sends
+ * The bridge thread acquires a buffer, fills it and passes it to
+ * zmq_msg_init_data with release as the free function, which ZeroMQ calls
+ * (usually from its I/O thread) once the frame has been written out. The
+ * pool never grows, so it also bounds the memory queued behind a slow reader.
+ */
+class FramePool {
+public:
+    FramePool(size_t buffer_size, size_t count)
+        : buffer_size_(buffer_size), storage_(new char[buffer_size * count]) {
+        free_.reserve(count);
+        for (size_t i = count; i-- > 0;) {
+            free_.push_back(storage_.get() + i * buffer_size);
+        }
+    }
+
+    /**
+     * Take a free buffer
+     * @return nullptr while every buffer is in flight
+     */
+    char* acquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty()) {
+            return nullptr;
+        }
+        char* buffer = free_.back();
+        free_.pop_back();
+        return buffer;
+    }
+
+    /**
+     * zmq_free_fn: return a buffer to the pool passed as hint
+     */
+    static void release(void* data, void* hint) {
+        FramePool* pool = static_cast<FramePool*>(hint);
+        std::lock_guard<std::mutex> lock(pool->mutex_);
+        pool->free_.push_back(static_cast<char*>(data));
+    }
+
+    size_t buffer_size() const { return buffer_size_; }
+
+private:
+    size_t buffer_size_;
+    std::unique_ptr<char[]> storage_;
+    std::mutex mutex_;
+    std::vector<char*> free_;
+};
+
+/**
+ * Coalesces datagrams into one zmq_bridge frame
+ * A frame is a run of records, each a BridgeHeader followed by its
+ * payload_length datagram bytes, so a batch of one is the unbatched format.
+ * The batch is due when it holds max_packets datagrams, reaches max_bytes,
+ * or its oldest datagram has waited max_delay. Frames are built in buffers
+ * from a FramePool and handed over whole by take().
+ */
+class BridgeBatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Pool buffer size for frames of max_bytes (the last record may overshoot it)
+     */
+    static size_t buffer_size(size_t max_bytes) { return max_bytes + sizeof(BridgeHeader) + Config::MAX_BUF; }
+
+    BridgeBatcher(FramePool& pool, size_t max_bytes, uint32_t max_packets, std::chrono::microseconds max_delay)
+        : pool_(&pool), max_bytes_(max_bytes), max_packets_(max_packets), max_delay_(max_delay) {}
+
+    BridgeBatcher(const BridgeBatcher&) = delete;
+    BridgeBatcher& operator=(const BridgeBatcher&) = delete;
+
+    ~BridgeBatcher() {
+        if (frame_) {
+            FramePool::release(frame_, pool_);
+        }
+    }
+
+    /**
+     * Make sure a buffer is at hand for add()
+     * @return false while the pool is exhausted
+     */
+    bool ready() {
+        if (!frame_) {
+            frame_ = pool_->acquire();
+        }
+        return frame_ != nullptr;
+    }
+
+    /**
+     * Append one datagram; requires ready()
+     * @return true when the batch is due and should be sent now
+     */
+    bool add(const BridgeHeader& header, const char* payload, Clock::time_point now) {
+        if (packets_ == 0) {
+            deadline_ = now + max_delay_;
+        }
+        memcpy(frame_ + size_, &header, sizeof(header));
+        memcpy(frame_ + size_ + sizeof(header), payload, header.payload_length);
+        size_ += sizeof(header) + header.payload_length;
+        packets_++;
+        return packets_ >= max_packets_ || size_ >= max_bytes_;
+    }
+
+    /**
+     * Start an empty batch in the same buffer (after the frame was copied out)
+     */
+    void clear() {
+        size_ = 0;
+        packets_ = 0;
+    }
+
+    /**
+     * Hand the filled buffer over (to zmq_msg_init_data with FramePool::release)
+     * and start an empty batch; the next ready() acquires a fresh buffer
+     */
+    char* take() {
+        char* frame = frame_;
+        frame_ = nullptr;
+        size_ = 0;
+        packets_ = 0;
+        return frame;
+    }
+
+    /**
+     * True when a partial batch has waited max_delay
+     */
+    bool expired(Clock::time_point now) const { return packets_ > 0 && now >= deadline_; }
+
+    /**
+     * When the current batch falls due (meaningless while empty)
+     */
+    Clock::time_point deadline() const { return deadline_; }
+
+    bool empty() const { return packets_ == 0; }
+    uint32_t packets() const { return packets_; }
+    const char* data() const { return frame_; }
+    size_t size() const { return size_; }
+    FramePool& pool() { return *pool_; }
+
+private:
+    FramePool* pool_;
+    size_t max_bytes_;
+    uint32_t max_packets_;
+    std::chrono::microseconds max_delay_;
+    char* frame_ = nullptr;
+    size_t size_ = 0;
+    uint32_t packets_ = 0;
+    Clock::time_point deadline_;
+};
+
+/**
+ * Call fn(header, payload) for every record of a zmq_bridge frame
+ * @return false if the frame does not start with a BridgeHeader or a record
+ *         is truncated; records before the damage have been delivered
+ */
+template <typename Fn>
+bool for_each_bridge_record(const char* frame, size_t size, Fn&& fn) {
+    size_t offset = 0;
+    while (offset < size) {
+        BridgeHeader header;
+        if (size - offset < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, frame + offset, sizeof(header));
+        offset += sizeof(header);
+        if (header.magic != Config::BRIDGE_HEADER_MAGIC || header.payload_length > size - offset) {
+            return false;
+        }
+        fn(header, frame + offset);
+        offset += header.payload_length;
+    }
+    return size > 0;
+}
@@ -0,0 +1,330 @@
+#include "packet_types.h"
+#include "binary_logger.h"
+#include "binary_log_reader.h"
+#include "perf_counters.h"
+#include "pitch_generator.h"
+#include "runtime_config.h"
+#include "sequence_tracker.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+/**
+ * Microbenchmarks of the per-packet hot path
+ *
+ * Each benchmark runs one component over packets of the synthetic PITCH
+ * feed (pitch_generator.h) and reports the wall time, heap allocations and,
+ * where perf_event_open is permitted, cycles and instructions per operation.
+ * Allocations are counted by replacing the global operator new in this
+ * binary; only the benchmark thread's allocations are counted, so the
+ * logger's writer threads do not show up in log_packet.
+ */
+
+namespace {
+
+thread_local uint64_t t_allocations = 0;
+
+} // namespace
+
+void* operator new(size_t size) {
+    t_allocations++;
+    if (void* pointer = malloc(size ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
+}
+
+namespace {
+
+constexpr size_t PACKET_POOL = 4096;        // Packets cycled through by the stateless benchmarks
+constexpr int LINE_A_PORT = Config::PORT1;
+
+struct Options {
+    uint64_t ops = 2000000;
+    uint64_t log_ops = 200000;      // Below the async queue size, so log_packet never blocks
+    std::string dir = "/tmp";
+};
+
+struct Packet {
+    std::vector<char> data;
+    uint32_t sequence;
+    uint8_t count;
+    uint8_t unit;
+};
+
+struct Result {
+    uint64_t ops = 0;
+    double seconds = 0;
+    uint64_t allocations = 0;
+    uint64_t counters[2] = {};
+};
+
+/**
+ * Keep the compiler from discarding a result that is otherwise unused
+ */
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options] [benchmark...]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --ops N                      Operations per benchmark (default 2000000)" << std::endl;
+    std::cout << "  --log-ops N                  Operations of the log_packet and read_record benchmarks (default 200000)" << std::endl;
+    std::cout << "  --dir DIR                    Directory for the temporary binary log (default /tmp)" << std::endl;
+    std::cout << "  -h, --help                   Show this help message" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Benchmarks run whose name contains one of the given words, e.g. 'sequence'." << std::endl;
+}
+
+std::vector<Packet> build_packets(size_t count) {
+    PitchGeneratorOptions generator_options;
+    generator_options.pool_packets = count;
+    PitchFeedGenerator generator(generator_options);
+
+    std::vector<Packet> packets;
+    packets.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        const PitchFeedGenerator::Packet& packet = generator.next();
+        Packet copy;
+        copy.data.assign(packet.data, packet.data + packet.length);
+        memcpy(&copy.sequence, packet.data + offsetof(CboeSequencedUnitHeader, hdr_sequence), sizeof(copy.sequence));
+        copy.count = packet.count;
+        copy.unit = packet.unit;
+        packets.push_back(std::move(copy));
+    }
+    return packets;
+}
+
+/**
+ * Time body(i) for i in [0, ops) with the allocation and hardware counters
+ */
+template <typename Body>
+Result measure(PerfCounters& counters, uint64_t ops, Body&& body) {
+    Result result;
+    uint64_t counters_before[2], counters_after[2];
+    uint64_t allocations_before = t_allocations;
+    counters.read(counters_before);
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < ops; i++) {
+        body(i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    counters.read(counters_after);
+    result.allocations = t_allocations - allocations_before;
+    result.ops = ops;
+    result.seconds = std::chrono::duration<double>(end - start).count();
+    for (int i = 0; i < 2; i++) {
+        result.counters[i] = counters_after[i] - counters_before[i];
+    }
+    return result;
+}
+
+void print_header(const PerfCounters& counters) {
+    std::cout << std::left << std::setw(34) << "benchmark" << std::right << std::setw(10) << "ops"
+              << std::setw(10) << "ns/op" << std::setw(11) << "allocs/op" << std::setw(11) << "cycles/op"
+              << std::setw(10) << "instr/op" << std::endl;
+    if (!counters.available()) {
+        std::cout << "(hardware counters unavailable: perf_event_open not permitted or no PMU)" << std::endl;
+    }
+}
+
+void print_result(const std::string& name, const Result& result, const PerfCounters& counters) {
+    double ops = static_cast<double>(result.ops ? result.ops : 1);
+    std::cout << std::left << std::setw(34) << name << std::right << std::setw(10) << result.ops
+              << std::fixed << std::setprecision(1) << std::setw(10) << result.seconds * 1e9 / ops
+              << std::setprecision(2) << std::setw(11) << result.allocations / ops;
+    if (counters.available()) {
+        std::cout << std::setprecision(1) << std::setw(11) << result.counters[0] / ops
+                  << std::setw(10) << result.counters[1] / ops;
+    } else {
+        std::cout << std::setw(11) << "-" << std::setw(10) << "-";
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * Sequence numbers of one unit in delivery order
+ * "in-order" delivers every packet, "reorder" swaps every 8th packet with the
+ * one after it, "loss" drops every 100th packet.
+ */
+std::vector<Packet> sequence_pattern(const std::vector<Packet>& packets, uint64_t ops, const std::string& pattern) {
+    std::vector<Packet> delivered;
+    delivered.reserve(ops + ops / 99 + 1);
+    uint32_t sequence = 1;
+    for (uint64_t i = 0; delivered.size() < ops; i++) {
+        const Packet& source = packets[i % packets.size()];
+        Packet packet{{}, sequence, source.count, 1};
+        sequence += source.count;
+        if (pattern == "loss" && i % 100 == 99) {
+            continue;
+        }
+        delivered.push_back(std::move(packet));
+    }
+    if (pattern == "reorder") {
+        for (size_t i = 0; i + 1 < delivered.size(); i += 8) {
+            std::swap(delivered[i], delivered[i + 1]);
+        }
+    }
+    return delivered;
+}
+
+bool selected(const std::vector<std::string>& words, const std::string& name) {
+    if (words.empty()) {
+        return true;
+    }
+    for (const std::string& word : words) {
+        if (name.find(word) != std::string::npos) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Options parse_arguments(int argc, char* argv[], std::vector<std::string>& words) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](const char* name) -> std::string {
+            if (i + 1 >= argc) {
+                throw std::runtime_error(std::string(name) + " requires a value");
+            }
+            return argv[++i];
+        };
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            exit(0);
+        } else if (arg == "--ops") {
+            opts.ops = std::stoull(value("--ops"));
+        } else if (arg == "--log-ops") {
+            opts.log_ops = std::stoull(value("--log-ops"));
+        } else if (arg == "--dir") {
+            opts.dir = value("--dir");
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            exit(1);
+        } else {
+            words.push_back(arg);
+        }
+    }
+    if (opts.ops == 0 || opts.log_ops == 0) {
+        throw std::runtime_error("--ops and --log-ops must be at least 1");
+    }
+    return opts;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    try {
+        std::vector<std::string> words;
+        Options opts = parse_arguments(argc, argv, words);
+
+        std::vector<Packet> packets = build_packets(PACKET_POOL);
+        std::vector<uint8_t> message_types;
+        for (const Packet& packet : packets) {
+            size_t offset = sizeof(CboeSequencedUnitHeader);
+            for (uint8_t m = 0; m < packet.count && offset + sizeof(CboeMessageHeader) <= packet.data.size(); m++) {
+                const CboeMessageHeader* message = reinterpret_cast<const CboeMessageHeader*>(packet.data.data() + offset);
+                message_types.push_back(message->message_type);
+                offset += message->length;
+            }
+        }
+
+        PerfCounters counters({PerfCounters::CYCLES, PerfCounters::INSTRUCTIONS});
+        std::cout << "Component microbenchmarks: " << packets.size() << " synthetic PITCH packets, "
+                  << message_types.size() << " messages" << std::endl;
+        print_header(counters);
+
+        if (selected(words, "validate_packet")) {
+            print_result("validate_packet", measure(counters, opts.ops, [&](uint64_t i) {
+                const Packet& packet = packets[i % PACKET_POOL];
+                keep(validate_packet(packet.data.data(), static_cast<int>(packet.data.size())));
+            }), counters);
+        }
+
+        if (selected(words, "classify_packet_type")) {
+            print_result("classify_packet_type", measure(counters, opts.ops, [&](uint64_t i) {
+                const Packet& packet = packets[i % PACKET_POOL];
+                keep(classify_packet_type(packet.sequence, packet.count, static_cast<int>(packet.data.size())));
+            }), counters);
+        }
+
+        if (selected(words, "lookup_message_type")) {
+            print_result("lookup_message_type", measure(counters, opts.ops, [&](uint64_t i) {
+                keep(lookup_message_type(message_types[i % message_types.size()]));
+            }), counters);
+        }
+
+        for (const char* pattern : {"in-order", "reorder", "loss"}) {
+            std::string name = std::string("determine_order_status/") + pattern;
+            if (!selected(words, name)) {
+                continue;
+            }
+            std::vector<Packet> delivered = sequence_pattern(packets, opts.ops, pattern);
+            BasicSequenceManager<DefaultFeedPolicy> manager;
+            print_result(name, measure(counters, opts.ops, [&](uint64_t i) {
+                const Packet& packet = delivered[i];
+                keep(manager.determine_order_status(packet.sequence, packet.count, LINE_A_PORT, packet.unit));
+            }), counters);
+        }
+
+        bool log = selected(words, "log_packet");
+        bool read = selected(words, "read_record");
+        if (log || read) {
+            std::string log_file = opts.dir + "/component_bench_" + std::to_string(getpid()) + ".log";
+            {
+                BinaryLogger logger(log_file, "component_bench");
+                Result result = measure(counters, opts.log_ops, [&](uint64_t i) {
+                    const Packet& packet = packets[i % PACKET_POOL];
+                    logger.log_packet(static_cast<uint32_t>(i), LINE_A_PORT, packet.data.data(),
+                                      static_cast<uint16_t>(packet.data.size()), packet.sequence, packet.count,
+                                      packet.unit, PacketType::DATA, OrderStatus::SEQUENCED_IN_ORDER, 0,
+                                      runtime_config().max_logged_payload);
+                });
+                if (log) {
+                    print_result("BinaryLogger::log_packet (enqueue)", result, counters);
+                }
+            }   // Drains the queue and closes the file
+
+            if (read) {
+                BinaryLogReader reader(log_file);
+                BinaryLogRecord record;
+                std::vector<char> payload;
+                uint64_t records = 0;
+                Result result = measure(counters, opts.log_ops, [&](uint64_t) {
+                    records += reader.read_record(record, payload);
+                });
+                if (records != opts.log_ops) {
+                    std::cerr << "Warning: read " << records << " of " << opts.log_ops << " records back" << std::endl;
+                }
+                print_result("BinaryLogReader::read_record", result, counters);
+            }
+            remove(log_file.c_str());
+            remove((log_file + ".index").c_str());   // Written by BinaryLogger::close()
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
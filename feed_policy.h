@@ -0,0 +1,80 @@
+#pragma once
+
+#include "packet_types.h"
+#include "runtime_config.h"
+#include <cstdint>
+
+/**
+ * Feed policies describe the structural knobs of a deployment: the two line
+ * ports, heartbeat handling, logged payload size and A/B line arbitration.
+ *
+ * The processing pipeline (BasicPacketProcessor, BasicSequenceManager,
+ * BasicNetworkHandler) is templated on a policy. With StaticFeedPolicy every
+ * knob is a constant expression, so the hot path compiles down to a single
+ * specialized, branch-free variant. RuntimeFeedPolicy exposes the same
+ * interface backed by member fields for builds configured at startup.
+ */
+
+/**
+ * Compile-time feed policy
+ */
+template <uint16_t Port1, uint16_t Port2, bool SkipHeartbeats, uint16_t MaxLoggedPayload, bool LineArbitration>
+struct StaticFeedPolicy {
+    static constexpr uint16_t port1() { return Port1; }
+    static constexpr uint16_t port2() { return Port2; }
+    static constexpr bool skip_heartbeats() { return SkipHeartbeats; }
+    static constexpr uint16_t max_logged_payload() { return MaxLoggedPayload; }
+    static constexpr bool line_arbitration() { return LineArbitration; }
+
+    /**
+     * Port carried by the given socket/line index (0 or 1)
+     */
+    static constexpr uint16_t port_for_line(int line) { return line == 0 ? Port1 : Port2; }
+
+    /**
+     * Line index for a port; any port other than port1 is the second line
+     */
+    static constexpr int line_for_port(int port) { return port == Port1 ? 0 : 1; }
+};
+
+/**
+ * Startup-configurable feed policy with the same interface as StaticFeedPolicy
+ */
+struct RuntimeFeedPolicy {
+    uint16_t port1_ = Config::PORT1;
+    uint16_t port2_ = Config::PORT2;
+    bool skip_heartbeats_ = Config::SKIP_HEARTBEATS;
+    uint16_t max_logged_payload_ = Config::MAX_LOGGED_PAYLOAD;
+    bool line_arbitration_ = Config::LINE_ARBITRATION;
+
+    static RuntimeFeedPolicy from_config(const RuntimeConfig& config) {
+        RuntimeFeedPolicy policy;
+        policy.port1_ = config.port1;
+        policy.port2_ = config.port2;
+        policy.skip_heartbeats_ = config.skip_heartbeats;
+        policy.max_logged_payload_ = config.max_logged_payload;
+        policy.line_arbitration_ = config.line_arbitration;
+        return policy;
+    }
+
+    uint16_t port1() const { return port1_; }
+    uint16_t port2() const { return port2_; }
+    bool skip_heartbeats() const { return skip_heartbeats_; }
+    uint16_t max_logged_payload() const { return max_logged_payload_; }
+    bool line_arbitration() const { return line_arbitration_; }
+    uint16_t port_for_line(int line) const { return line == 0 ? port1_ : port2_; }
+    int line_for_port(int port) const { return port == port1_ ? 0 : 1; }
+};
+
+// Policy built from the Config namespace constants
+using DefaultFeedPolicy = StaticFeedPolicy<Config::PORT1, Config::PORT2, Config::SKIP_HEARTBEATS,
+                                           Config::MAX_LOGGED_PAYLOAD, Config::LINE_ARBITRATION>;
+
+// Policy used by the logger binaries; build with -DRUNTIME_FEED_POLICY for the runtime variant.
+// Every policy listed here must be explicitly instantiated in sequence_tracker.cpp,
+// packet_processor.cpp and network_handler.cpp.
+#ifdef RUNTIME_FEED_POLICY
+using ActiveFeedPolicy = RuntimeFeedPolicy;
+#else
+using ActiveFeedPolicy = DefaultFeedPolicy;
+#endif
@@ -0,0 +1,512 @@
+#include "grp_client.h"
+#include "session_util.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr auto HEARTBEAT_INTERVAL = std::chrono::seconds(1);
+constexpr auto SESSION_TIMEOUT = std::chrono::seconds(5);
+constexpr auto RECONNECT_DELAY = std::chrono::seconds(1);
+constexpr size_t MAX_MESSAGES_PER_PACKET = 255;
+
+} // namespace
+
+GrpClient::GrpClient(const RuntimeConfig& config, int wakeup_fd)
+    : host_(config.grp_host),
+      port_(config.grp_port),
+      session_sub_id_(config.grp_session_sub_id),
+      username_(config.grp_username),
+      password_(config.grp_password),
+      requests_per_second_(config.grp_requests_per_second),
+      max_count_(std::clamp<uint32_t>(config.grp_max_count, 1, 65535)),
+      multicast_ip_(config.grp_multicast_ip),
+      multicast_port_(config.grp_multicast_port),
+      interface_ip_(config.interface_ip),
+      request_event_fd_(-1),
+      retransmissions_ready_(false),
+      wakeup_fd_(wakeup_fd),
+      running_(false),
+      sock_(-1),
+      multicast_sock_(-1),
+      connecting_(false),
+      logged_in_(false) {
+    request_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (request_event_fd_ < 0) {
+        throw std::runtime_error("Failed to create GRP eventfd: " + std::string(strerror(errno)));
+    }
+    for (auto& unit : units_) {
+        unit.tokens = requests_per_second_;
+    }
+    if (!multicast_ip_.empty()) {
+        try {
+            open_multicast(config.socket_buffer_bytes);
+        } catch (...) {
+            close(request_event_fd_);
+            throw;
+        }
+    }
+}
+
+GrpClient::~GrpClient() {
+    stop();
+    if (multicast_sock_ >= 0) close(multicast_sock_);
+    if (request_event_fd_ >= 0) close(request_event_fd_);
+}
+
+void GrpClient::open_multicast(int buffer_bytes) {
+    multicast_sock_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (multicast_sock_ < 0) {
+        throw std::runtime_error("Failed to create GRP multicast socket: " + std::string(strerror(errno)));
+    }
+    int reuse = 1;
+    setsockopt(multicast_sock_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    // A large gap comes back as one burst
+    setsockopt(multicast_sock_, SOL_SOCKET, SO_RCVBUF, &buffer_bytes, sizeof(buffer_bytes));
+
+    sockaddr_in local_addr{};
+    local_addr.sin_family = AF_INET;
+    local_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    local_addr.sin_port = htons(multicast_port_);
+    ip_mreq mreq{};
+    mreq.imr_multiaddr.s_addr = inet_addr(multicast_ip_.c_str());
+    mreq.imr_interface.s_addr = inet_addr(interface_ip_.c_str());
+    if (bind(multicast_sock_, reinterpret_cast<sockaddr*>(&local_addr), sizeof(local_addr)) < 0 ||
+        setsockopt(multicast_sock_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        std::string error = strerror(errno);
+        close(multicast_sock_);
+        multicast_sock_ = -1;
+        throw std::runtime_error("Failed to join GRP gap response group " + multicast_ip_ + ":" +
+                                 std::to_string(multicast_port_) + ": " + error);
+    }
+}
+
+void GrpClient::start() {
+    running_ = true;
+    thread_ = std::thread(&GrpClient::run, this);
+}
+
+void GrpClient::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        signal_event(request_event_fd_);
+        thread_.join();
+    }
+    if (sock_ >= 0) {
+        close(sock_);
+        sock_ = -1;
+    }
+}
+
+void GrpClient::request(uint8_t unit, uint32_t first, uint32_t last) {
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        incoming_.push_back({unit, first, last});
+    }
+    signal_event(request_event_fd_);
+}
+
+void GrpClient::reset_unit(uint8_t unit) {
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        incoming_.push_back({unit, 0, 0});
+    }
+    signal_event(request_event_fd_);
+}
+
+void GrpClient::take_retransmissions(std::vector<std::string>& packets) {
+    std::lock_guard<std::mutex> lock(retransmit_mutex_);
+    packets.swap(retransmissions_);
+    retransmissions_.clear();
+    retransmissions_ready_.store(false, std::memory_order_relaxed);
+}
+
+void GrpClient::run() {
+    last_refill_ = Clock::now();
+    next_connect_ = last_refill_;
+
+    while (running_) {
+        auto now = Clock::now();
+        if (sock_ < 0 && now >= next_connect_) {
+            connect_session();
+        }
+
+        struct pollfd fds[3];
+        fds[0].fd = request_event_fd_;
+        fds[0].events = POLLIN;
+        fds[1].fd = sock_;  // Ignored by poll while negative
+        fds[1].events = POLLIN;
+        if (connecting_ || !outbound_.empty()) {
+            fds[1].events |= POLLOUT;
+        }
+        fds[2].fd = multicast_sock_;
+        fds[2].events = POLLIN;
+
+        // Short timeout keeps heartbeats and token refills on schedule
+        int ready = poll(fds, 3, 50);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "GRP poll error: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            clear_event(request_event_fd_);
+        }
+        if (ready > 0 && (fds[2].revents & POLLIN)) {
+            read_multicast();
+        }
+        accept_requests();
+        refill_tokens();
+
+        if (sock_ >= 0 && ready > 0 && fds[1].revents) {
+            if (connecting_ && (fds[1].revents & (POLLOUT | POLLERR | POLLHUP))) {
+                int error = 0;
+                socklen_t len = sizeof(error);
+                getsockopt(sock_, SOL_SOCKET, SO_ERROR, &error, &len);
+                if (error != 0) {
+                    close_session("connect failed: " + std::string(strerror(error)));
+                    continue;
+                }
+                connecting_ = false;
+                stats_.connects++;
+                last_received_ = Clock::now();
+
+                GrpLoginMessage login{};
+                login.length = sizeof(GrpLoginMessage);
+                login.message_type = GrpMessageType::LOGIN;
+                copy_padded(login.session_sub_id, sizeof(login.session_sub_id), session_sub_id_);
+                copy_padded(login.username, sizeof(login.username), username_);
+                copy_padded(login.filler, sizeof(login.filler), "");
+                copy_padded(login.password, sizeof(login.password), password_);
+                queue_packet(std::string(reinterpret_cast<const char*>(&login), sizeof(login)), 1);
+            } else if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) {
+                if (!read_inbound()) {
+                    continue;
+                }
+            }
+        }
+
+        if (sock_ < 0 || connecting_) {
+            continue;
+        }
+
+        now = Clock::now();
+        if (now - last_received_ > SESSION_TIMEOUT) {
+            close_session("no data from server for 5s");
+            continue;
+        }
+        if (logged_in_) {
+            send_gap_requests();
+        }
+        if (outbound_.empty() && now - last_sent_ >= HEARTBEAT_INTERVAL) {
+            queue_packet(std::string(), 0);
+        }
+        if (!flush_outbound()) {
+            continue;
+        }
+    }
+}
+
+void GrpClient::connect_session() {
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    std::string port = std::to_string(port_);
+    int rc = getaddrinfo(host_.c_str(), port.c_str(), &hints, &result);
+    if (rc != 0 || !result) {
+        std::cerr << "GRP: cannot resolve " << host_ << ": " << gai_strerror(rc) << std::endl;
+        next_connect_ = Clock::now() + RECONNECT_DELAY;
+        return;
+    }
+
+    sock_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sock_ < 0) {
+        freeaddrinfo(result);
+        next_connect_ = Clock::now() + RECONNECT_DELAY;
+        return;
+    }
+    int nodelay = 1;
+    setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    rc = ::connect(sock_, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (rc < 0 && errno != EINPROGRESS) {
+        close_session("connect failed: " + std::string(strerror(errno)));
+        return;
+    }
+    connecting_ = true;
+}
+
+void GrpClient::close_session(const std::string& reason) {
+    if (sock_ >= 0) {
+        close(sock_);
+        sock_ = -1;
+    }
+    if (logged_in_) {
+        stats_.disconnects++;
+        std::cerr << "GRP session to " << host_ << ":" << port_ << " closed: " << reason << std::endl;
+    }
+    connecting_ = false;
+    logged_in_ = false;
+    outbound_.clear();
+    inbound_.clear();
+    next_connect_ = Clock::now() + RECONNECT_DELAY;
+
+    // Unanswered requests are asked for again in the next session
+    for (const auto& range : unanswered_) {
+        units_[range.unit].queued.insert(range.first, range.last);
+    }
+    unanswered_.clear();
+}
+
+void GrpClient::accept_requests() {
+    std::vector<GapRange> ranges;
+    {
+        std::lock_guard<std::mutex> lock(request_mutex_);
+        ranges.swap(incoming_);
+    }
+    for (const auto& range : ranges) {
+        UnitState& unit = units_[range.unit];
+        if (range.first == 0) {
+            // New session: earlier ranges refer to the previous sequence space
+            unit.queued = SequenceIntervalSet();
+            unit.requested = SequenceIntervalSet();
+            unanswered_.erase(std::remove_if(unanswered_.begin(), unanswered_.end(),
+                                             [&](const GapRange& r) { return r.unit == range.unit; }),
+                              unanswered_.end());
+            continue;
+        }
+        for (const auto& [first, last] : unit.requested.missing(range.first, range.last)) {
+            unit.queued.insert(first, last);
+        }
+    }
+}
+
+void GrpClient::refill_tokens() {
+    auto now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+    last_refill_ = now;
+    for (auto& unit : units_) {
+        unit.tokens = std::min(requests_per_second_, unit.tokens + elapsed * requests_per_second_);
+    }
+}
+
+void GrpClient::send_gap_requests() {
+    std::string messages;
+    uint8_t count = 0;
+
+    for (size_t u = 0; u < units_.size(); u++) {
+        UnitState& unit = units_[u];
+        while (!unit.queued.empty() && unit.tokens >= 1.0) {
+            // Oldest range first, split at the per-request message limit
+            auto [first, last] = *unit.queued.ranges().begin();
+            uint32_t end = (static_cast<uint64_t>(last) - first + 1 > max_count_) ? first + max_count_ - 1 : last;
+
+            unit.queued.erase(first, end);
+            unit.requested.insert(first, end);
+            unit.tokens -= 1.0;
+
+            GrpGapRequestMessage request{};
+            request.length = sizeof(GrpGapRequestMessage);
+            request.message_type = GrpMessageType::GAP_REQUEST;
+            request.unit = static_cast<uint8_t>(u);
+            request.sequence = htole32(first);
+            request.count = htole16(static_cast<uint16_t>(end - first + 1));
+            messages.append(reinterpret_cast<const char*>(&request), sizeof(request));
+            unanswered_.push_back({static_cast<uint8_t>(u), first, end});
+            stats_.requests_sent++;
+            stats_.messages_requested += end - first + 1;
+
+            if (++count == MAX_MESSAGES_PER_PACKET) {
+                queue_packet(messages, count);
+                messages.clear();
+                count = 0;
+            }
+        }
+    }
+
+    if (count > 0) {
+        queue_packet(messages, count);
+    }
+}
+
+void GrpClient::queue_packet(const std::string& messages, uint8_t count) {
+    CboeSequencedUnitHeader header{};
+    header.hdr_length = htole16(static_cast<uint16_t>(sizeof(header) + messages.size()));
+    header.hdr_count = count;
+    header.hdr_unit = 0;
+    header.hdr_sequence = 0;
+    outbound_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    outbound_.append(messages);
+}
+
+bool GrpClient::flush_outbound() {
+    while (!outbound_.empty()) {
+        ssize_t n = ::send(sock_, outbound_.data(), outbound_.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true; // Remainder goes out when the socket is writable again
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            close_session("send failed: " + std::string(strerror(errno)));
+            return false;
+        }
+        outbound_.erase(0, static_cast<size_t>(n));
+        last_sent_ = Clock::now();
+    }
+    return true;
+}
+
+bool GrpClient::read_inbound() {
+    char buffer[64 * 1024];
+    while (true) {
+        ssize_t n = ::recv(sock_, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            inbound_.append(buffer, static_cast<size_t>(n));
+            last_received_ = Clock::now();
+            continue;
+        }
+        if (n == 0) {
+            close_session("closed by server");
+            return false;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        close_session("receive failed: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    // Split the stream into sequenced units using the header length
+    size_t offset = 0;
+    while (inbound_.size() - offset >= sizeof(CboeSequencedUnitHeader)) {
+        const auto* header = reinterpret_cast<const CboeSequencedUnitHeader*>(inbound_.data() + offset);
+        uint16_t length = le16toh_safe(header->hdr_length);
+        if (length < sizeof(CboeSequencedUnitHeader)) {
+            close_session("malformed packet length " + std::to_string(length));
+            return false;
+        }
+        if (inbound_.size() - offset < length) {
+            break;
+        }
+        if (header->hdr_unit != 0 && le32toh_safe(header->hdr_sequence) != 0) {
+            deliver_retransmission(inbound_.data() + offset, length);
+        } else {
+            handle_session_packet(inbound_.data() + offset, length);
+            if (sock_ < 0) {
+                return false;
+            }
+        }
+        offset += length;
+    }
+    inbound_.erase(0, offset);
+    return true;
+}
+
+void GrpClient::read_multicast() {
+    char buffer[Config::MAX_BUF];
+    while (true) {
+        ssize_t n = ::recv(multicast_sock_, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "GRP multicast receive failed: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        // One sequenced unit per datagram; heartbeats (sequence 0) carry nothing to recover
+        if (static_cast<size_t>(n) < sizeof(CboeSequencedUnitHeader)) {
+            continue;
+        }
+        const auto* header = reinterpret_cast<const CboeSequencedUnitHeader*>(buffer);
+        uint16_t length = le16toh_safe(header->hdr_length);
+        if (length >= sizeof(CboeSequencedUnitHeader) && length <= n && header->hdr_unit != 0 &&
+            le32toh_safe(header->hdr_sequence) != 0) {
+            deliver_retransmission(buffer, length);
+        }
+    }
+}
+
+void GrpClient::handle_session_packet(const char* packet, size_t len) {
+    size_t offset = sizeof(CboeSequencedUnitHeader);
+    while (offset + sizeof(CboeMessageHeader) <= len) {
+        const auto* message = reinterpret_cast<const CboeMessageHeader*>(packet + offset);
+        if (message->length < sizeof(CboeMessageHeader) || offset + message->length > len) {
+            break;
+        }
+        handle_message(packet + offset, message->length);
+        offset += message->length;
+    }
+}
+
+void GrpClient::handle_message(const char* message, size_t len) {
+    uint8_t type = reinterpret_cast<const CboeMessageHeader*>(message)->message_type;
+
+    if (type == GrpMessageType::LOGIN_RESPONSE && len >= sizeof(GrpLoginResponseMessage)) {
+        const auto* response = reinterpret_cast<const GrpLoginResponseMessage*>(message);
+        if (response->status == 'A') {
+            logged_in_ = true;
+            std::cout << "GRP session logged in to " << host_ << ":" << port_ << std::endl;
+        } else {
+            std::cerr << "GRP login to " << host_ << ":" << port_ << " rejected with status '"
+                      << static_cast<char>(response->status) << "'" << std::endl;
+            close_session("login rejected");
+        }
+    } else if (type == GrpMessageType::GAP_RESPONSE && len >= sizeof(GrpGapResponseMessage)) {
+        const auto* response = reinterpret_cast<const GrpGapResponseMessage*>(message);
+        uint32_t first = le32toh_safe(response->sequence);
+        uint32_t last = first + le16toh_safe(response->count) - 1;
+
+        auto it = std::find_if(unanswered_.begin(), unanswered_.end(), [&](const GapRange& r) {
+            return r.unit == response->unit && r.first == first && r.last == last;
+        });
+        if (it != unanswered_.end()) {
+            unanswered_.erase(it);
+        }
+
+        if (response->status == 'A') {
+            stats_.requests_accepted++;
+        } else if (response->status == 'S' || response->status == 'M') {
+            // Over the server's allocation: ask again later
+            stats_.requests_throttled++;
+            UnitState& unit = units_[response->unit];
+            unit.queued.insert(first, last);
+            unit.requested.erase(first, last);
+            unit.tokens = 0;
+        } else {
+            stats_.requests_rejected++;
+            std::cerr << "GRP gap request unit " << static_cast<int>(response->unit) << " " << first << "-" << last
+                      << " rejected with status '" << static_cast<char>(response->status) << "'" << std::endl;
+        }
+    }
+}
+
+void GrpClient::deliver_retransmission(const char* packet, size_t len) {
+    stats_.retransmitted_packets++;
+    {
+        std::lock_guard<std::mutex> lock(retransmit_mutex_);
+        retransmissions_.emplace_back(packet, len);
+        retransmissions_ready_.store(true, std::memory_order_relaxed);
+    }
+    signal_event(wakeup_fd_);
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "packet_types.h"
+#include "interval_set.h"
+#include "runtime_config.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Asynchronous Gap Request Proxy (GRP) client
+ *
+ * Runs its own thread with a non-blocking TCP session: logs in, sends
+ * heartbeats, reconnects after failures and turns missed sequence ranges into
+ * Gap Request messages. The packet thread only enqueues ranges (request) and
+ * collects retransmitted packets (take_retransmissions); neither call waits
+ * on the network.
+ *
+ * Requests are coalesced per unit, split at grp_max_count messages, and
+ * limited to grp_requests_per_second per unit with a token bucket. Ranges
+ * rejected for exceeding the server's per-second or per-minute allocation
+ * are queued again; other rejections are counted and dropped.
+ *
+ * A GRP sends the requested messages on the gap response multicast channel;
+ * with grp_multicast_ip set, the client joins that group on interface_ip and
+ * delivers every sequenced unit (non-zero unit and sequence) it carries. The
+ * channel also carries what other subscribers asked for, which the trackers
+ * count as duplicates. Sequenced units arriving on the session itself are
+ * delivered as well, which is what grp_standin does without --multicast.
+ */
+class GrpClient {
+public:
+    struct Statistics {
+        std::atomic<uint64_t> connects{0};
+        std::atomic<uint64_t> disconnects{0};
+        std::atomic<uint64_t> requests_sent{0};
+        std::atomic<uint64_t> messages_requested{0};
+        std::atomic<uint64_t> requests_accepted{0};
+        std::atomic<uint64_t> requests_rejected{0};
+        std::atomic<uint64_t> requests_throttled{0};   // Re-queued after a 'S'/'M' response
+        std::atomic<uint64_t> retransmitted_packets{0};
+    };
+
+    /**
+     * @param wakeup_fd eventfd signalled whenever retransmissions become
+     *                  available, so an idle receive loop can poll it
+     * @throws std::runtime_error if the gap response group cannot be joined
+     */
+    GrpClient(const RuntimeConfig& config, int wakeup_fd);
+    ~GrpClient();
+
+    void start();
+    void stop();
+
+    /**
+     * Ask for the messages [first, last] of a unit (packet thread)
+     * Ranges already requested earlier in this session are skipped.
+     */
+    void request(uint8_t unit, uint32_t first, uint32_t last);
+    
+    /**
+     * Forget everything queued or requested for a unit (packet thread)
+     * Called when the unit's sequence numbers start over in a new session.
+     */
+    void reset_unit(uint8_t unit);
+
+    /**
+     * True when retransmitted packets are waiting (one relaxed load)
+     */
+    bool has_retransmissions() const { return retransmissions_ready_.load(std::memory_order_relaxed); }
+
+    /**
+     * Move all waiting retransmitted packets into packets (packet thread)
+     */
+    void take_retransmissions(std::vector<std::string>& packets);
+
+    const Statistics& get_statistics() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct GapRange {
+        uint8_t unit;
+        uint32_t first;
+        uint32_t last;
+    };
+
+    struct UnitState {
+        SequenceIntervalSet queued;      // Waiting for a token
+        SequenceIntervalSet requested;   // Already asked for in this session
+        double tokens = 0;
+    };
+
+    // Settings (copied at construction)
+    std::string host_;
+    uint16_t port_;
+    std::string session_sub_id_;
+    std::string username_;
+    std::string password_;
+    double requests_per_second_;
+    uint32_t max_count_;
+    std::string multicast_ip_;
+    uint16_t multicast_port_;
+    std::string interface_ip_;
+
+    // Packet thread -> client thread (first == 0 marks a unit reset)
+    std::mutex request_mutex_;
+    std::vector<GapRange> incoming_;
+    int request_event_fd_;
+
+    // Client thread -> packet thread
+    std::mutex retransmit_mutex_;
+    std::vector<std::string> retransmissions_;
+    std::atomic<bool> retransmissions_ready_;
+    int wakeup_fd_;
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+    Statistics stats_;
+
+    // Client thread state
+    int sock_;
+    int multicast_sock_;                 // Gap response group, -1 without grp_multicast_ip
+    bool connecting_;
+    bool logged_in_;
+    std::string outbound_;
+    std::string inbound_;
+    std::array<UnitState, 256> units_;
+    std::vector<GapRange> unanswered_;   // Sent, no Gap Response yet; re-queued on disconnect
+    Clock::time_point last_sent_;
+    Clock::time_point last_received_;
+    Clock::time_point last_refill_;
+    Clock::time_point next_connect_;
+
+    void run();
+    void open_multicast(int buffer_bytes);
+    void read_multicast();
+    void connect_session();
+    void close_session(const std::string& reason);
+    void accept_requests();
+    void refill_tokens();
+    void send_gap_requests();
+    void queue_packet(const std::string& messages, uint8_t count);
+    bool flush_outbound();
+    bool read_inbound();
+    void handle_session_packet(const char* packet, size_t len);
+    void handle_message(const char* message, size_t len);
+    void deliver_retransmission(const char* packet, size_t len);
+};
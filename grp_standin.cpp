@@ -0,0 +1,388 @@
+#include "packet_types.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Local stand-in for a CBOE Gap Request Proxy
+ *
+ * Accepts GRP sessions on TCP, answers logins and gap requests, and sends the
+ * requested messages as synthetic sequenced units (one zero-filled Add Order
+ * per sequence number): on a gap response multicast group, one unit per
+ * datagram, as a real GRP does, or back on the session itself. Per-request
+ * count limits and per-unit request rates can be set to exercise the client's
+ * rejection and re-queue paths.
+ */
+
+volatile sig_atomic_t running = 1;
+
+void signal_handler(int signal) {
+    std::cout << "\nReceived signal " << signal << ", stopping GRP stand-in..." << std::endl;
+    running = 0;
+}
+
+struct Options {
+    uint16_t port = 18000;
+    uint32_t max_count = 65535;        // Larger requests get status 'C'
+    uint32_t per_second = 0;           // Requests per unit per second, 0 = unlimited ('S' beyond)
+    uint32_t messages_per_packet = 10;
+    std::string multicast_ip;          // Gap response group; empty = retransmit on the session
+    uint16_t multicast_port = 0;
+    std::string interface_ip = "127.0.0.1";
+};
+
+/**
+ * Gap response multicast channel (fd -1 when retransmitting on the session)
+ */
+struct GapResponseChannel {
+    int fd = -1;
+    sockaddr_in addr{};
+};
+
+struct Session {
+    int fd;
+    bool logged_in = false;
+    std::string inbound;
+    std::string outbound;
+    std::chrono::steady_clock::time_point last_sent;
+};
+
+struct UnitRate {
+    std::chrono::steady_clock::time_point window_start;
+    uint32_t requests = 0;
+};
+
+struct Statistics {
+    uint64_t sessions = 0;
+    uint64_t gap_requests = 0;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t messages_sent = 0;
+};
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -p, --port N                 TCP port to listen on (default 18000)" << std::endl;
+    std::cout << "  --max-count N                Reject requests above N messages with 'C' (default 65535)" << std::endl;
+    std::cout << "  --per-second N               Accept at most N requests per unit per second, 'S' beyond" << std::endl;
+    std::cout << "  --messages-per-packet N      Messages per retransmitted packet (default 10)" << std::endl;
+    std::cout << "  --multicast GROUP:PORT       Retransmit on this gap response group instead of the session" << std::endl;
+    std::cout << "  --interface IP               Multicast interface (default 127.0.0.1)" << std::endl;
+    std::cout << "  -h, --help                   Show this help message" << std::endl;
+}
+
+void append_packet(std::string& out, uint8_t unit, uint32_t sequence, uint8_t count, const std::string& messages) {
+    CboeSequencedUnitHeader header{};
+    header.hdr_length = htole16(static_cast<uint16_t>(sizeof(header) + messages.size()));
+    header.hdr_count = count;
+    header.hdr_unit = unit;
+    header.hdr_sequence = htole32(sequence);
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(messages);
+}
+
+template <typename Message>
+std::string as_bytes(const Message& message) {
+    return std::string(reinterpret_cast<const char*>(&message), sizeof(message));
+}
+
+/**
+ * Send the retransmission of [first, first + count) as synthetic packets,
+ * on the gap response group if there is one, else queued on the session
+ */
+void append_retransmission(Session& session, const Options& opts, const GapResponseChannel& channel, uint8_t unit,
+                           uint32_t first, uint32_t count, Statistics& stats) {
+    const uint8_t add_order_length = 34;
+    uint32_t seq = first;
+    uint32_t end = first + count;
+    while (seq != end) {
+        uint8_t in_packet = static_cast<uint8_t>(std::min(end - seq, opts.messages_per_packet));
+        std::string messages;
+        for (uint8_t i = 0; i < in_packet; i++) {
+            std::string message(add_order_length, '\0');
+            message[0] = static_cast<char>(add_order_length);
+            message[1] = 0x37;
+            messages += message;
+        }
+        if (channel.fd >= 0) {
+            std::string packet;
+            append_packet(packet, unit, seq, in_packet, messages);
+            sendto(channel.fd, packet.data(), packet.size(), 0, reinterpret_cast<const sockaddr*>(&channel.addr),
+                   sizeof(channel.addr));
+        } else {
+            append_packet(session.outbound, unit, seq, in_packet, messages);
+        }
+        stats.messages_sent += in_packet;
+        seq += in_packet;
+    }
+}
+
+void handle_message(Session& session, const Options& opts, const GapResponseChannel& channel, const char* message,
+                    size_t len, std::map<uint8_t, UnitRate>& rates, Statistics& stats) {
+    uint8_t type = reinterpret_cast<const CboeMessageHeader*>(message)->message_type;
+
+    if (type == GrpMessageType::LOGIN && len >= sizeof(GrpLoginMessage)) {
+        const auto* login = reinterpret_cast<const GrpLoginMessage*>(message);
+        std::cout << "Login from session " << std::string(login->session_sub_id, 4)
+                  << " user " << std::string(login->username, 4) << std::endl;
+        GrpLoginResponseMessage response{};
+        response.length = sizeof(response);
+        response.message_type = GrpMessageType::LOGIN_RESPONSE;
+        response.status = 'A';
+        append_packet(session.outbound, 0, 0, 1, as_bytes(response));
+        session.logged_in = true;
+    } else if (type == GrpMessageType::GAP_REQUEST && len >= sizeof(GrpGapRequestMessage) && session.logged_in) {
+        const auto* request = reinterpret_cast<const GrpGapRequestMessage*>(message);
+        uint32_t first = le32toh_safe(request->sequence);
+        uint16_t count = le16toh_safe(request->count);
+        stats.gap_requests++;
+
+        uint8_t status = 'A';
+        if (request->unit == 0) {
+            status = 'I';
+        } else if (count == 0 || first == 0) {
+            status = 'O';
+        } else if (count > opts.max_count) {
+            status = 'C';
+        } else if (opts.per_second > 0) {
+            auto now = std::chrono::steady_clock::now();
+            UnitRate& rate = rates[request->unit];
+            if (now - rate.window_start >= std::chrono::seconds(1)) {
+                rate.window_start = now;
+                rate.requests = 0;
+            }
+            if (++rate.requests > opts.per_second) {
+                status = 'S';
+            }
+        }
+
+        GrpGapResponseMessage response{};
+        response.length = sizeof(response);
+        response.message_type = GrpMessageType::GAP_RESPONSE;
+        response.unit = request->unit;
+        response.sequence = request->sequence;
+        response.count = request->count;
+        response.status = status;
+        append_packet(session.outbound, 0, 0, 1, as_bytes(response));
+
+        if (status == 'A') {
+            stats.accepted++;
+            append_retransmission(session, opts, channel, request->unit, first, count, stats);
+        } else {
+            stats.rejected++;
+        }
+    }
+}
+
+/**
+ * Parse complete sequenced units from the session's input buffer
+ * @return false if the stream is malformed
+ */
+bool handle_input(Session& session, const Options& opts, const GapResponseChannel& channel,
+                  std::map<uint8_t, UnitRate>& rates, Statistics& stats) {
+    size_t offset = 0;
+    while (session.inbound.size() - offset >= sizeof(CboeSequencedUnitHeader)) {
+        const auto* header = reinterpret_cast<const CboeSequencedUnitHeader*>(session.inbound.data() + offset);
+        uint16_t length = le16toh_safe(header->hdr_length);
+        if (length < sizeof(CboeSequencedUnitHeader)) {
+            return false;
+        }
+        if (session.inbound.size() - offset < length) {
+            break;
+        }
+
+        size_t pos = offset + sizeof(CboeSequencedUnitHeader);
+        size_t end = offset + length;
+        while (pos + sizeof(CboeMessageHeader) <= end) {
+            uint8_t message_length = static_cast<uint8_t>(session.inbound[pos]);
+            if (message_length < sizeof(CboeMessageHeader) || pos + message_length > end) {
+                break;
+            }
+            handle_message(session, opts, channel, session.inbound.data() + pos, message_length, rates, stats);
+            pos += message_length;
+        }
+        offset = end;
+    }
+    session.inbound.erase(0, offset);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if ((arg == "-p" || arg == "--port") && i + 1 < argc) {
+            opts.port = static_cast<uint16_t>(std::stoul(argv[++i]));
+        } else if (arg == "--max-count" && i + 1 < argc) {
+            opts.max_count = std::stoul(argv[++i]);
+        } else if (arg == "--per-second" && i + 1 < argc) {
+            opts.per_second = std::stoul(argv[++i]);
+        } else if (arg == "--messages-per-packet" && i + 1 < argc) {
+            opts.messages_per_packet = std::clamp<uint32_t>(std::stoul(argv[++i]), 1, 255);
+        } else if (arg == "--multicast" && i + 1 < argc) {
+            std::string value = argv[++i];
+            size_t colon = value.find(':');
+            if (colon == std::string::npos) {
+                std::cerr << "--multicast needs GROUP:PORT" << std::endl;
+                return 1;
+            }
+            opts.multicast_ip = value.substr(0, colon);
+            opts.multicast_port = static_cast<uint16_t>(std::stoul(value.substr(colon + 1)));
+        } else if (arg == "--interface" && i + 1 < argc) {
+            opts.interface_ip = argv[++i];
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(opts.port);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener, 8) < 0) {
+        std::cerr << "Failed to listen on port " << opts.port << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    GapResponseChannel channel;
+    if (!opts.multicast_ip.empty()) {
+        channel.fd = socket(AF_INET, SOCK_DGRAM, 0);
+        in_addr interface{};
+        interface.s_addr = inet_addr(opts.interface_ip.c_str());
+        unsigned char loop = 1;
+        if (channel.fd < 0 ||
+            setsockopt(channel.fd, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface)) < 0 ||
+            setsockopt(channel.fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+            std::cerr << "Failed to set up the gap response group: " << strerror(errno) << std::endl;
+            return 1;
+        }
+        channel.addr.sin_family = AF_INET;
+        channel.addr.sin_addr.s_addr = inet_addr(opts.multicast_ip.c_str());
+        channel.addr.sin_port = htons(opts.multicast_port);
+    }
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "CBOE GRP Stand-in Server" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Listening on TCP port " << opts.port << std::endl;
+    std::cout << "Max count per request: " << opts.max_count << std::endl;
+    std::cout << "Requests per unit per second: " << (opts.per_second ? std::to_string(opts.per_second) : "unlimited") << std::endl;
+    std::cout << "Retransmissions on: " << (channel.fd >= 0 ? opts.multicast_ip + ":" + std::to_string(opts.multicast_port)
+                                                            : std::string("the session")) << std::endl;
+    std::cout << "Press Ctrl+C to stop" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    std::vector<Session> sessions;
+    std::map<uint8_t, UnitRate> rates;
+    Statistics stats;
+
+    while (running) {
+        std::vector<pollfd> fds;
+        fds.push_back({listener, POLLIN, 0});
+        for (const auto& session : sessions) {
+            short events = POLLIN;
+            if (!session.outbound.empty()) events |= POLLOUT;
+            fds.push_back({session.fd, events, 0});
+        }
+
+        int ready = poll(fds.data(), fds.size(), 100);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd >= 0) {
+                int nodelay = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+                sessions.push_back({fd, false, "", "", std::chrono::steady_clock::now()});
+                stats.sessions++;
+                std::cout << "Session connected" << std::endl;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < sessions.size(); i++) {
+            Session& session = sessions[i];
+            short revents = (i + 1 < fds.size()) ? fds[i + 1].revents : 0;
+            bool alive = true;
+
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                char buffer[64 * 1024];
+                ssize_t n = recv(session.fd, buffer, sizeof(buffer), 0);
+                if (n > 0) {
+                    session.inbound.append(buffer, static_cast<size_t>(n));
+                    alive = handle_input(session, opts, channel, rates, stats);
+                } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    alive = false;
+                }
+            }
+
+            // Keep the session alive while idle
+            if (alive && session.logged_in && session.outbound.empty() &&
+                now - session.last_sent >= std::chrono::seconds(1)) {
+                append_packet(session.outbound, 0, 0, 0, "");
+            }
+
+            while (alive && !session.outbound.empty()) {
+                ssize_t n = send(session.fd, session.outbound.data(), session.outbound.size(), MSG_NOSIGNAL);
+                if (n > 0) {
+                    session.outbound.erase(0, static_cast<size_t>(n));
+                    session.last_sent = now;
+                } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    break;
+                } else if (!(n < 0 && errno == EINTR)) {
+                    alive = false;
+                }
+            }
+
+            if (!alive) {
+                std::cout << "Session disconnected" << std::endl;
+                close(session.fd);
+                sessions.erase(sessions.begin() + static_cast<long>(i));
+                fds.erase(fds.begin() + static_cast<long>(i) + 1);
+                i--;
+            }
+        }
+    }
+
+    for (const auto& session : sessions) {
+        close(session.fd);
+    }
+    close(listener);
+    if (channel.fd >= 0) {
+        close(channel.fd);
+    }
+
+    std::cout << "GRP stand-in stopped. Sessions: " << stats.sessions
+              << ", gap requests: " << stats.gap_requests
+              << " (" << stats.accepted << " accepted, " << stats.rejected << " rejected)"
+              << ", messages retransmitted: " << stats.messages_sent << std::endl;
+    return 0;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
+
+/**
+ * Compact set of closed sequence ranges [first, last]
+ * Overlapping and adjacent ranges are merged on insert, so a loss-free
+ * stream is stored as a single entry no matter how many messages it covers.
+ */
+class SequenceIntervalSet {
+public:
+    using Range = std::pair<uint32_t, uint32_t>;
+
+    /**
+     * Add the range [first, last] to the set
+     */
+    void insert(uint32_t first, uint32_t last) {
+        if (last < first) {
+            return;
+        }
+
+        auto it = ranges_.upper_bound(first);
+        if (it != ranges_.begin()) {
+            auto prev = std::prev(it);
+            if (static_cast<uint64_t>(prev->second) + 1 >= first) {
+                if (prev->second >= last) {
+                    return; // Already fully covered
+                }
+                first = prev->first;
+                covered_ -= range_size(*prev);
+                ranges_.erase(prev);
+            }
+        }
+
+        // Absorb every following range that overlaps or touches [first, last]
+        while (it != ranges_.end() && it->first <= static_cast<uint64_t>(last) + 1) {
+            if (it->second > last) {
+                last = it->second;
+            }
+            covered_ -= range_size(*it);
+            it = ranges_.erase(it);
+        }
+
+        ranges_.emplace_hint(it, first, last);
+        covered_ += static_cast<uint64_t>(last) - first + 1;
+    }
+
+    /**
+     * Remove the range [first, last] from the set, splitting ranges as needed
+     */
+    void erase(uint32_t first, uint32_t last) {
+        if (last < first) {
+            return;
+        }
+
+        auto it = ranges_.upper_bound(first);
+        if (it != ranges_.begin()) {
+            --it;
+        }
+        while (it != ranges_.end() && it->first <= last) {
+            uint32_t range_first = it->first;
+            uint32_t range_last = it->second;
+            if (range_last < first) {
+                ++it;
+                continue;
+            }
+            covered_ -= range_size(*it);
+            it = ranges_.erase(it);
+            if (range_first < first) {
+                ranges_.emplace(range_first, first - 1);
+                covered_ += static_cast<uint64_t>(first - 1) - range_first + 1;
+            }
+            if (range_last > last) {
+                it = ranges_.emplace(last + 1, range_last).first;
+                covered_ += static_cast<uint64_t>(range_last) - last;
+                break;
+            }
+        }
+    }
+
+    /**
+     * Merge all ranges of another set into this one
+     */
+    void merge(const SequenceIntervalSet& other) {
+        for (const auto& [first, last] : other.ranges_) {
+            insert(first, last);
+        }
+    }
+
+    bool contains(uint32_t seq) const {
+        auto it = ranges_.upper_bound(seq);
+        if (it == ranges_.begin()) {
+            return false;
+        }
+        return std::prev(it)->second >= seq;
+    }
+
+    /**
+     * Ranges inside [first, last] that are not covered by the set
+     */
+    std::vector<Range> missing(uint32_t first, uint32_t last) const {
+        std::vector<Range> gaps;
+        uint64_t cursor = first;
+
+        auto it = ranges_.upper_bound(first);
+        if (it != ranges_.begin()) {
+            --it;
+        }
+        for (; it != ranges_.end() && it->first <= last; ++it) {
+            if (it->second < cursor) {
+                continue;
+            }
+            if (it->first > cursor) {
+                gaps.emplace_back(static_cast<uint32_t>(cursor), it->first - 1);
+            }
+            cursor = static_cast<uint64_t>(it->second) + 1;
+        }
+        if (cursor <= last) {
+            gaps.emplace_back(static_cast<uint32_t>(cursor), last);
+        }
+        return gaps;
+    }
+
+    bool empty() const { return ranges_.empty(); }
+    size_t range_count() const { return ranges_.size(); }
+    uint64_t covered() const { return covered_; }
+    uint32_t min() const { return ranges_.empty() ? 0 : ranges_.begin()->first; }
+    uint32_t max() const { return ranges_.empty() ? 0 : ranges_.rbegin()->second; }
+    const std::map<uint32_t, uint32_t>& ranges() const { return ranges_; }
+
+    void clear() {
+        ranges_.clear();
+        covered_ = 0;
+    }
+
+private:
+    std::map<uint32_t, uint32_t> ranges_;  // first -> last (inclusive)
+    uint64_t covered_ = 0;
+
+    static uint64_t range_size(const std::pair<const uint32_t, uint32_t>& r) {
+        return static_cast<uint64_t>(r.second) - r.first + 1;
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "packet_types.h"
+#include "tsc_clock.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+/**
+ * Log-linear latency histogram
+ * Values below 16ns are counted exactly; above that each power of two is
+ * split into 16 buckets, so a percentile is reported at most 1/16 above the
+ * true value. Values from about 9 minutes up share the last bucket. Not
+ * thread-safe: keep one per thread and merge() them for the report.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 39;
+    static constexpr int NUM_BUCKETS = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    void add(uint64_t ns) {
+        buckets_[bucket_of(ns)]++;
+        count_++;
+        sum_ns_ += ns;
+        max_ns_ = std::max(max_ns_, ns);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        sum_ns_ += other.sum_ns_;
+        max_ns_ = std::max(max_ns_, other.max_ns_);
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t max_ns() const { return max_ns_; }
+    uint64_t mean_ns() const { return count_ ? sum_ns_ / count_ : 0; }
+
+    /**
+     * Upper bound of the bucket holding the given percentile (0-100)
+     */
+    uint64_t percentile_ns(double pct) const {
+        uint64_t target = static_cast<uint64_t>(count_ * pct / 100.0);
+        uint64_t seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += buckets_[i];
+            if (seen > target) {
+                return std::min(upper_bound_of(i), max_ns_);
+            }
+        }
+        return max_ns_;
+    }
+
+    /**
+     * "N samples, mean, p50, p90, p99, p99.9 and max" in microseconds
+     */
+    std::string summary() const {
+        if (count_ == 0) {
+            return "no samples";
+        }
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(1) << count_ << " samples, mean " << mean_ns() / 1000.0
+            << "us, p50 " << percentile_ns(50) / 1000.0 << "us, p90 " << percentile_ns(90) / 1000.0
+            << "us, p99 " << percentile_ns(99) / 1000.0 << "us, p99.9 " << percentile_ns(99.9) / 1000.0
+            << "us, max " << max_ns_ / 1000.0 << "us";
+        return out.str();
+    }
+
+private:
+    std::array<uint64_t, NUM_BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ns_ = 0;
+    uint64_t max_ns_ = 0;
+
+    static int bucket_of(uint64_t ns) {
+        if (ns < SUB_BUCKETS) {
+            return static_cast<int>(ns);
+        }
+        int exponent = 63 - __builtin_clzll(ns);
+        if (exponent > MAX_EXPONENT) {
+            return NUM_BUCKETS - 1;
+        }
+        int sub = static_cast<int>((ns >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    static uint64_t upper_bound_of(int bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return static_cast<uint64_t>(bucket);
+        }
+        int exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+        uint64_t width = 1ULL << (exponent - SUB_BUCKET_BITS);
+        return (static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << (exponent - SUB_BUCKET_BITS)) + width - 1;
+    }
+};
+
+/**
+ * Send stamp a load generator appended to a datagram (see SendStamp)
+ * @return false if the datagram has none
+ */
+inline bool read_send_stamp(const char* data, size_t len, uint64_t& send_tsc) {
+    if (len < sizeof(CboeSequencedUnitHeader) + sizeof(SendStamp)) {
+        return false;
+    }
+    uint16_t hdr_length;
+    memcpy(&hdr_length, data, sizeof(hdr_length));
+    if (len != hdr_length + sizeof(SendStamp)) {
+        return false;
+    }
+    SendStamp stamp;
+    memcpy(&stamp, data + hdr_length, sizeof(stamp));
+    if (stamp.magic != Config::SEND_STAMP_MAGIC) {
+        return false;
+    }
+    send_tsc = stamp.send_tsc;
+    return true;
+}
+
+/**
+ * One-way latency from a send stamp to a TSC read on receipt
+ * A stamp ahead of the receive time (unsynchronized cores) counts as 0.
+ */
+inline uint64_t send_stamp_latency_ns(uint64_t send_tsc, uint64_t receive_tsc) {
+    return receive_tsc > send_tsc ? TscClock::to_ns(receive_tsc - send_tsc) : 0;
+}
@@ -0,0 +1,557 @@
+#include "packet_types.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <iomanip>
+#include <sstream>
+#include <array>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+
+/**
+ * Compare captures of the same feed taken on different hosts or lines.
+ * Log sets are merged by timestamp and joined on (unit, sequence) through a
+ * bounded hash table. An entry is resolved once the merge clock has moved a
+ * full join horizon past its first arrival; sides that have not seen it by
+ * then are charged with the loss, and later copies count as duplicates.
+ */
+
+constexpr int MAX_SIDES = 8;
+
+/**
+ * Sequential reader over the rotated segments of one log set
+ */
+class SegmentReader {
+public:
+    explicit SegmentReader(std::vector<std::string> files)
+        : files_(std::move(files)), buffer_(1024 * 1024) {}
+
+    /**
+     * Read the next record (header only, payload skipped)
+     */
+    bool next(BinaryLogRecord& record) {
+        while (true) {
+            if (!file_.is_open()) {
+                if (file_index_ >= files_.size()) {
+                    return false;
+                }
+                file_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+                file_.open(files_[file_index_], std::ios::binary);
+                if (!file_.is_open()) {
+                    throw std::runtime_error("Cannot open file: " + files_[file_index_]);
+                }
+            }
+
+            if (file_.read(reinterpret_cast<char*>(&record), sizeof(BinaryLogRecord)) &&
+                file_.ignore(record.payload_length)) {
+                // spdlog terminates every entry with an end-of-line separator
+                if (file_.peek() == '\n') {
+                    file_.get();
+                }
+                return true;
+            }
+
+            file_.close();
+            file_.clear();
+            file_index_++;
+        }
+    }
+
+private:
+    std::vector<std::string> files_;
+    std::vector<char> buffer_;
+    std::ifstream file_;
+    size_t file_index_ = 0;
+};
+
+/**
+ * Signed log-linear histogram of arrival differences
+ * 16 sub-buckets per power of two keep relative error below ~6%.
+ */
+class SignedLatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int NUM_BUCKETS = 64 * SUB_BUCKETS;
+
+    void add(int64_t value) {
+        if (value < 0) {
+            negative_[bucket_index(static_cast<uint64_t>(-(value + 1)) + 1)]++;
+        } else {
+            positive_[bucket_index(static_cast<uint64_t>(value))]++;
+        }
+        count_++;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    uint64_t count() const { return count_; }
+    int64_t min() const { return count_ ? min_ : 0; }
+    int64_t max() const { return count_ ? max_ : 0; }
+
+    int64_t percentile(double pct) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>((count_ - 1) * pct / 100.0);
+        uint64_t seen = 0;
+        for (int i = NUM_BUCKETS - 1; i >= 0; i--) {
+            seen += negative_[i];
+            if (seen > target) {
+                return std::max(min_, -static_cast<int64_t>(bucket_value(i)));
+            }
+        }
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += positive_[i];
+            if (seen > target) {
+                return std::min(max_, static_cast<int64_t>(bucket_value(i)));
+            }
+        }
+        return max_;
+    }
+
+private:
+    std::array<uint64_t, NUM_BUCKETS> negative_{};
+    std::array<uint64_t, NUM_BUCKETS> positive_{};
+    uint64_t count_ = 0;
+    int64_t min_ = std::numeric_limits<int64_t>::max();
+    int64_t max_ = std::numeric_limits<int64_t>::min();
+
+    static int bucket_index(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<int>(value);
+        }
+        int shift = (63 - __builtin_clzll(value)) - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<int>((value >> shift) - SUB_BUCKETS);
+    }
+
+    static uint64_t bucket_value(int index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+        int shift = index / SUB_BUCKETS - 1;
+        uint64_t low = static_cast<uint64_t>(index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+        return low + ((1ULL << shift) >> 1);
+    }
+};
+
+/**
+ * Command-line options
+ */
+struct Options {
+    std::vector<std::pair<std::string, std::vector<std::string>>> sets; // label -> files
+    std::map<std::string, int64_t> offsets_ns;
+    bool by_port = false;
+    int64_t horizon_ns = 1000000000;       // 1s join horizon
+    size_t max_pending = 2000000;           // Hard cap on unmatched entries
+    bool help = false;
+};
+
+/**
+ * One participant of the join: a log set, or a (log set, port) pair with --by-port
+ */
+struct Side {
+    std::string label;
+    uint64_t packets = 0;
+    uint64_t duplicates = 0;
+    uint64_t first_arrivals = 0;
+    uint64_t missed_packets = 0;
+    uint64_t missed_messages = 0;
+    uint64_t unique_missed_packets = 0;
+    uint64_t unique_missed_messages = 0;
+    SignedLatencyHistogram diff_vs_reference;
+};
+
+struct PendingPacket {
+    std::array<int64_t, MAX_SIDES> arrival_ns;
+    uint32_t seen_mask = 0;
+    uint32_t message_count = 1;
+    int64_t first_seen_ns = 0;
+};
+
+class LogJoin {
+public:
+    explicit LogJoin(const Options& opts) : opts_(opts) {
+        pending_.reserve(std::min<size_t>(opts.max_pending, 1 << 20));
+    }
+
+    /**
+     * Register a side before the merge starts
+     * Every side must exist before the first packet is finalized, or it would
+     * never be charged for packets it missed; the first side added is the
+     * reference. The port is ignored without --by-port.
+     */
+    void add_side(size_t set_index, uint16_t port) {
+        if (sides_.size() >= MAX_SIDES) {
+            throw std::runtime_error("Too many sides to compare (max " + std::to_string(MAX_SIDES) + ")");
+        }
+        Side side;
+        side.label = opts_.sets[set_index].first;
+        if (opts_.by_port) {
+            side.label += ":" + std::to_string(port);
+        }
+        sides_.push_back(side);
+        side_index_[std::make_pair(set_index, opts_.by_port ? port : uint16_t(0))] =
+            static_cast<int>(sides_.size() - 1);
+    }
+
+    int side_for(size_t set_index, uint16_t port) const {
+        auto it = side_index_.find(std::make_pair(set_index, opts_.by_port ? port : uint16_t(0)));
+        if (it == side_index_.end()) {
+            throw std::runtime_error("Port " + std::to_string(port) + " of set " + opts_.sets[set_index].first +
+                                     " was not found by the port scan (was the log appended to?)");
+        }
+        return it->second;
+    }
+
+    void add(int side, const BinaryLogRecord& record, int64_t arrival_ns) {
+        evict(arrival_ns);
+        sides_[side].packets++;
+
+        uint64_t key = (static_cast<uint64_t>(record.unit) << 32) | record.sequence;
+        auto [it, inserted] = pending_.try_emplace(key);
+        PendingPacket& entry = it->second;
+        if (inserted) {
+            entry.first_seen_ns = arrival_ns;
+            entry.message_count = record.count > 0 ? record.count : 1;
+            fifo_.emplace_back(key, arrival_ns);
+        }
+
+        uint32_t bit = 1u << side;
+        if (entry.seen_mask & bit) {
+            sides_[side].duplicates++;
+            return;
+        }
+        entry.seen_mask |= bit;
+        entry.arrival_ns[side] = arrival_ns;
+    }
+
+    /**
+     * Resolve everything still pending once all inputs are exhausted
+     */
+    void finish() {
+        for (const auto& [key, entry] : pending_) {
+            finalize(key, entry);
+        }
+        pending_.clear();
+        fifo_.clear();
+    }
+
+    void print_report() const;
+
+private:
+    const Options& opts_;
+    std::vector<Side> sides_;
+    std::map<std::pair<size_t, uint16_t>, int> side_index_;
+    std::unordered_map<uint64_t, PendingPacket> pending_;
+    std::deque<std::pair<uint64_t, int64_t>> fifo_; // (key, first_seen) in arrival order
+    std::map<std::pair<uint8_t, int>, SignedLatencyHistogram> unit_diffs_; // (unit, side) vs reference
+    uint64_t joined_keys_ = 0;
+    uint64_t matched_all_ = 0;
+    uint64_t evicted_capacity_ = 0;
+
+    uint32_t all_sides_mask() const {
+        return sides_.size() >= 32 ? ~0u : ((1u << sides_.size()) - 1);
+    }
+
+    void evict(int64_t now_ns) {
+        while (!fifo_.empty()) {
+            auto [key, first_seen] = fifo_.front();
+            bool expired = now_ns - first_seen > opts_.horizon_ns;
+            bool over_capacity = pending_.size() > opts_.max_pending;
+            if (!expired && !over_capacity) {
+                break;
+            }
+            fifo_.pop_front();
+
+            auto it = pending_.find(key);
+            if (it == pending_.end()) {
+                continue;
+            }
+            if (!expired) {
+                evicted_capacity_++;
+            }
+            finalize(key, it->second);
+            pending_.erase(it);
+        }
+    }
+
+    void finalize(uint64_t key, const PendingPacket& entry) {
+        joined_keys_++;
+        int num_sides = static_cast<int>(sides_.size());
+        int seen = __builtin_popcount(entry.seen_mask);
+
+        if (entry.seen_mask == all_sides_mask()) {
+            matched_all_++;
+        }
+
+        int earliest = -1;
+        for (int s = 0; s < num_sides; s++) {
+            if (!(entry.seen_mask & (1u << s))) {
+                sides_[s].missed_packets++;
+                sides_[s].missed_messages += entry.message_count;
+                if (seen == num_sides - 1) {
+                    sides_[s].unique_missed_packets++;
+                    sides_[s].unique_missed_messages += entry.message_count;
+                }
+            } else if (earliest < 0 || entry.arrival_ns[s] < entry.arrival_ns[earliest]) {
+                earliest = s;
+            }
+        }
+        if (seen > 1) {
+            sides_[earliest].first_arrivals++;
+        }
+
+        // Side 0 is the reference every other side is compared against
+        if (!(entry.seen_mask & 1u)) {
+            return;
+        }
+        uint8_t unit = static_cast<uint8_t>(key >> 32);
+        for (int s = 1; s < num_sides; s++) {
+            if (entry.seen_mask & (1u << s)) {
+                int64_t diff = entry.arrival_ns[s] - entry.arrival_ns[0];
+                sides_[s].diff_vs_reference.add(diff);
+                unit_diffs_[{unit, s}].add(diff);
+            }
+        }
+    }
+};
+
+/**
+ * Format a signed nanosecond value with a readable unit
+ */
+std::string format_signed_ns(int64_t ns) {
+    std::ostringstream oss;
+    double magnitude = static_cast<double>(ns < 0 ? -ns : ns);
+    oss << (ns < 0 ? "-" : "+") << std::fixed;
+    if (magnitude < 1e3) {
+        oss << std::setprecision(0) << magnitude << "ns";
+    } else if (magnitude < 1e6) {
+        oss << std::setprecision(1) << magnitude / 1e3 << "us";
+    } else if (magnitude < 1e9) {
+        oss << std::setprecision(2) << magnitude / 1e6 << "ms";
+    } else {
+        oss << std::setprecision(3) << magnitude / 1e9 << "s";
+    }
+    return oss.str();
+}
+
+void print_distribution(const SignedLatencyHistogram& hist) {
+    std::cout << "n=" << hist.count()
+             << " min " << format_signed_ns(hist.min())
+             << " p1 " << format_signed_ns(hist.percentile(1))
+             << " p50 " << format_signed_ns(hist.percentile(50))
+             << " p99 " << format_signed_ns(hist.percentile(99))
+             << " max " << format_signed_ns(hist.max()) << std::endl;
+}
+
+void LogJoin::print_report() const {
+    std::cout << "\n=== LOG SET COMPARISON ===" << std::endl;
+    std::cout << "Distinct (unit, sequence) packets: " << joined_keys_
+             << ", seen by all sides: " << matched_all_ << std::endl;
+    std::cout << "Resolved before horizon due to --max-pending: " << evicted_capacity_ << std::endl;
+
+    std::cout << "\nPer Side:" << std::endl;
+    for (const auto& side : sides_) {
+        double first_pct = joined_keys_ > 0 ? static_cast<double>(side.first_arrivals) / joined_keys_ * 100.0 : 0.0;
+        std::cout << "  " << side.label << ": " << side.packets << " packets, first to arrive "
+                 << side.first_arrivals << " (" << std::fixed << std::setprecision(2) << first_pct << "%), "
+                 << "missed " << side.missed_packets << " packets/" << side.missed_messages << " msgs, "
+                 << "unique loss " << side.unique_missed_packets << " packets/" << side.unique_missed_messages
+                 << " msgs, " << side.duplicates << " dups" << std::endl;
+    }
+
+    if (sides_.size() < 2) {
+        return;
+    }
+
+    std::cout << "\nClock Offset Estimate vs " << sides_[0].label << " (median arrival difference):" << std::endl;
+    for (size_t s = 1; s < sides_.size(); s++) {
+        const auto& hist = sides_[s].diff_vs_reference;
+        std::cout << "  " << sides_[s].label << ": " << format_signed_ns(hist.percentile(50))
+                 << " (use --offset " << sides_[s].label.substr(0, sides_[s].label.find(':'))
+                 << "=" << hist.percentile(50) << " to align)" << std::endl;
+        std::cout << "    ";
+        print_distribution(hist);
+    }
+
+    std::cout << "\nPer-Unit Arrival Difference vs " << sides_[0].label << ":" << std::endl;
+    for (const auto& [key, hist] : unit_diffs_) {
+        std::cout << "  Unit " << static_cast<int>(key.first) << " " << sides_[key.second].label << ": ";
+        print_distribution(hist);
+    }
+}
+
+/**
+ * Records the join compares: sequenced data packets
+ */
+bool joinable(const BinaryLogRecord& record) {
+    return record.sequence != 0 && static_cast<PacketType>(record.packet_type) == PacketType::DATA;
+}
+
+/**
+ * Ports of a log set's joinable records, for creating the --by-port sides up front
+ */
+std::set<uint16_t> scan_ports(const std::vector<std::string>& files) {
+    SegmentReader reader(files);
+    BinaryLogRecord record;
+    std::set<uint16_t> ports;
+    while (reader.next(record)) {
+        if (joinable(record)) {
+            ports.insert(record.port);
+        }
+    }
+    return ports;
+}
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options] LABEL=file[,file...] LABEL=file[,file...] ..." << std::endl;
+    std::cout << "\nJoins two or more binary log sets on (unit, sequence). Files of a set are read" << std::endl;
+    std::cout << "in the order given (list rotated segments oldest first). The first set is the" << std::endl;
+    std::cout << "reference for arrival differences." << std::endl;
+    std::cout << "\nOptions:" << std::endl;
+    std::cout << "  --by-port            Treat each port within a set as its own side (A/B lines);" << std::endl;
+    std::cout << "                       reads each set twice, once to find its ports" << std::endl;
+    std::cout << "  --offset LABEL=NS    Subtract NS nanoseconds from the timestamps of set LABEL" << std::endl;
+    std::cout << "  --horizon-ms N       Declare a packet lost N ms after its first arrival (default 1000)" << std::endl;
+    std::cout << "  --max-pending N      Maximum unmatched packets held in memory (default 2000000)" << std::endl;
+    std::cout << "  -h, --help           Show this help message" << std::endl;
+}
+
+Options parse_arguments(int argc, char* argv[]) {
+    Options opts;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg == "-h" || arg == "--help") {
+            opts.help = true;
+        } else if (arg == "--by-port") {
+            opts.by_port = true;
+        } else if (arg == "--offset") {
+            if (i + 1 < argc) {
+                std::string value = argv[++i];
+                size_t eq = value.find('=');
+                if (eq != std::string::npos) {
+                    opts.offsets_ns[value.substr(0, eq)] = std::stoll(value.substr(eq + 1));
+                }
+            }
+        } else if (arg == "--horizon-ms") {
+            if (i + 1 < argc) {
+                opts.horizon_ns = std::stoll(argv[++i]) * 1000000;
+            }
+        } else if (arg == "--max-pending") {
+            if (i + 1 < argc) {
+                opts.max_pending = std::stoull(argv[++i]);
+            }
+        } else if (arg[0] != '-') {
+            size_t eq = arg.find('=');
+            std::string label = (eq != std::string::npos) ? arg.substr(0, eq) : "set" + std::to_string(opts.sets.size());
+            std::string list = (eq != std::string::npos) ? arg.substr(eq + 1) : arg;
+
+            std::vector<std::string> files;
+            std::istringstream iss(list);
+            std::string file;
+            while (std::getline(iss, file, ',')) {
+                if (!file.empty()) {
+                    files.push_back(file);
+                }
+            }
+            opts.sets.emplace_back(label, files);
+        }
+    }
+
+    return opts;
+}
+
+int main(int argc, char* argv[]) {
+    Options opts = parse_arguments(argc, argv);
+
+    if (opts.help || opts.sets.size() < 2) {
+        print_usage(argv[0]);
+        return opts.help ? 0 : 1;
+    }
+
+    try {
+        struct Input {
+            std::unique_ptr<SegmentReader> reader;
+            BinaryLogRecord record;
+            int64_t offset_ns = 0;
+            bool valid = false;
+
+            // Advance to the next sequenced data record
+            void advance() {
+                while ((valid = reader->next(record))) {
+                    if (joinable(record)) {
+                        return;
+                    }
+                }
+            }
+            int64_t arrival_ns() const { return static_cast<int64_t>(record.timestamp_ns) - offset_ns; }
+        };
+
+        std::vector<Input> inputs(opts.sets.size());
+        for (size_t i = 0; i < opts.sets.size(); i++) {
+            std::cout << "Log set " << opts.sets[i].first << ": " << opts.sets[i].second.size() << " file(s)" << std::endl;
+            inputs[i].reader = std::make_unique<SegmentReader>(opts.sets[i].second);
+            auto offset = opts.offsets_ns.find(opts.sets[i].first);
+            inputs[i].offset_ns = (offset != opts.offsets_ns.end()) ? offset->second : 0;
+            inputs[i].advance();
+        }
+
+        // Sides in command-line order, ports ascending within a set, so the
+        // first set (its lowest port with --by-port) is the reference
+        LogJoin join(opts);
+        for (size_t i = 0; i < opts.sets.size(); i++) {
+            if (!opts.by_port) {
+                join.add_side(i, 0);
+                continue;
+            }
+            std::set<uint16_t> ports = scan_ports(opts.sets[i].second);
+            if (ports.empty()) {
+                throw std::runtime_error("Log set " + opts.sets[i].first + " has no sequenced data records");
+            }
+            for (uint16_t port : ports) {
+                join.add_side(i, port);
+            }
+        }
+        uint64_t records_processed = 0;
+
+        // K-way merge by corrected timestamp keeps the join window small
+        while (true) {
+            int next = -1;
+            for (size_t i = 0; i < inputs.size(); i++) {
+                if (inputs[i].valid && (next < 0 || inputs[i].arrival_ns() < inputs[next].arrival_ns())) {
+                    next = static_cast<int>(i);
+                }
+            }
+            if (next < 0) {
+                break;
+            }
+
+            Input& input = inputs[next];
+            join.add(join.side_for(next, input.record.port), input.record, input.arrival_ns());
+            input.advance();
+
+            if (++records_processed % 1000000 == 0) {
+                std::cout << "\rProcessed " << records_processed << " records" << std::flush;
+            }
+        }
+
+        join.finish();
+        std::cout << "\rCompleted: " << records_processed << " records processed" << std::endl;
+        join.print_report();
+
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
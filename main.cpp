@@ -1,6 +1,7 @@
 #include "network_handler.h"
 #include "packet_processor.h"
 #include "packet_types.h"
+#include "runtime_config.h"
 #include <iostream>
 #include <csignal>
 #include <memory>
@@ -9,6 +10,7 @@
 // Global instances for signal handling
 std::unique_ptr<NetworkHandler> g_network_handler;
 std::unique_ptr<PacketProcessor> g_packet_processor;
+std::unique_ptr<ConfigReloader> g_config_reloader;
 
 /**
  * Signal handler for graceful shutdown
@@ -25,61 +27,127 @@ void signal_handler(int signal) {
 /**
  * Print startup banner and configuration
  */
-void print_startup_info() {
+void print_startup_info(const ActiveFeedPolicy& policy, const std::string& config_path) {
+    const RuntimeConfig& config = runtime_config();
+    
     std::cout << "========================================" << std::endl;
     std::cout << "ULTRA HIGH-VOLUME CBOE PITCH Binary Logger" << std::endl;
     std::cout << "========================================" << std::endl;
     std::cout << "Target capacity: 14+ million packets" << std::endl;
-    std::cout << "Multicast group: " << Config::MULTICAST_IP << std::endl;
-    std::cout << "Monitoring ports: " << Config::PORT1 << ", " << Config::PORT2 << std::endl;
+    std::cout << "Config file: " << (config_path.empty() ? "(none, compiled-in defaults)" : config_path) << std::endl;
+    std::cout << "Multicast group: " << config.multicast_ip << " on interface " << config.interface_ip << std::endl;
+    std::cout << "Monitoring ports: " << policy.port1() << ", " << policy.port2() << std::endl;
     std::cout << "Binary record size: " << sizeof(BinaryLogRecord) << " bytes + payload" << std::endl;
     std::cout << std::endl;
     
     std::cout << "Performance Configuration:" << std::endl;
-    std::cout << "  Log file size: " << (Config::LOG_FILE_SIZE / (1024*1024)) << "MB per file" << std::endl;
-    std::cout << "  Log file count: " << Config::LOG_FILE_COUNT << " files" << std::endl;
-    std::cout << "  Total log capacity: " << ((Config::LOG_FILE_SIZE / (1024*1024)) * Config::LOG_FILE_COUNT / 1024) << "GB" << std::endl;
-    std::cout << "  Async queue size: " << (Config::ASYNC_QUEUE_SIZE / 1024) << "K entries" << std::endl;
-    std::cout << "  Background threads: " << Config::ASYNC_THREADS << std::endl;
-    std::cout << "  Socket buffer: 64MB per socket" << std::endl;
-    std::cout << "  Heartbeat filtering: " << (Config::SKIP_HEARTBEATS ? "ENABLED" : "DISABLED") << std::endl;
+    std::cout << "  Log file: " << config.log_file << std::endl;
+    std::cout << "  Log file size: " << (config.log_file_size / (1024*1024)) << "MB per file" << std::endl;
+    std::cout << "  Log file count: " << config.log_file_count << " files" << std::endl;
+    std::cout << "  Total log capacity: " << ((config.log_file_size / (1024*1024)) * config.log_file_count / 1024) << "GB" << std::endl;
+    std::cout << "  Async queue size: " << (config.async_queue_size / 1024) << "K entries" << std::endl;
+    std::cout << "  Background threads: " << config.async_threads << std::endl;
+    std::cout << "  Queue full policy: " << (config.block_on_full_queue ? "block" : "overrun oldest") << std::endl;
+    std::cout << "  Socket buffer: " << (config.socket_buffer_bytes / (1024*1024)) << "MB per socket" << std::endl;
+    std::cout << "  Sequence checkpoint: " << (config.checkpoint_file.empty() ? std::string("disabled") :
+        config.checkpoint_file + " every " + std::to_string(config.checkpoint_interval_ms) + "ms") << std::endl;
+    std::cout << "  Gap recovery: " << (config.grp_host.empty() ? std::string("disabled") :
+        "GRP " + config.grp_host + ":" + std::to_string(config.grp_port)) << std::endl;
+    std::cout << "  Snapshot recovery: " << (config.spin_servers.empty() ? std::string("disabled") :
+        std::to_string(config.spin_servers.size()) + " spin server(s)") << std::endl;
+    std::cout << "  Receive CPU: " << (config.receive_cpu >= 0 ? std::to_string(config.receive_cpu) : "not pinned") << std::endl;
+    std::cout << "  Heartbeat filtering: " << (policy.skip_heartbeats() ? "ENABLED" : "DISABLED") << std::endl;
+    std::cout << "  Line arbitration: " << (policy.line_arbitration() ? "ENABLED" : "DISABLED") << std::endl;
+#ifdef RUNTIME_FEED_POLICY
+    std::cout << "  Feed policy: runtime" << std::endl;
+#else
+    std::cout << "  Feed policy: compile-time specialized" << std::endl;
+#endif
     std::cout << std::endl;
     
-    std::cout << "Performance Reporting:" << std::endl;
-    std::cout << "  Statistics interval: Every " << (Config::STATS_INTERVAL / 1000) << "K packets" << std::endl;
-    std::cout << "  Flush interval: Every " << (Config::FLUSH_INTERVAL / 1000000) << "M packets" << std::endl;
+    std::cout << "Performance Reporting (reloadable with SIGHUP):" << std::endl;
+    std::cout << "  Statistics interval: Every " << config.stats_interval << " packets" << std::endl;
+    std::cout << "  Flush interval: Every " << config.flush_interval << " packets" << std::endl;
+    std::cout << "  Logged units: " << (config.logged_units.all() ? std::string("all") : std::to_string(config.logged_units.count())) << std::endl;
     std::cout << std::endl;
     
     std::cout << "Press Ctrl+C to stop capture and view final statistics" << std::endl;
     std::cout << "========================================" << std::endl;
 }
 
+/**
+ * Build the feed policy for this binary from the loaded configuration
+ * The compile-time policy ignores the file; warn when the two disagree.
+ */
+ActiveFeedPolicy make_feed_policy(const RuntimeConfig& config) {
+#ifdef RUNTIME_FEED_POLICY
+    return RuntimeFeedPolicy::from_config(config);
+#else
+    ActiveFeedPolicy policy;
+    if (config.port1 != policy.port1() || config.port2 != policy.port2() ||
+        config.skip_heartbeats != policy.skip_heartbeats() ||
+        config.max_logged_payload != policy.max_logged_payload() ||
+        config.line_arbitration != policy.line_arbitration()) {
+        std::cerr << "Warning: ports/heartbeat/payload/arbitration settings in the config file are "
+                  << "ignored by this compile-time build; use packet_logger_runtime" << std::endl;
+    }
+    return policy;
+#endif
+}
+
 /**
  * Main application entry point
  */
 int main(int argc, char* argv[]) {
+    std::string config_path;
+    bool resume = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-c" || arg == "--config") && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (arg == "--fresh") {
+            resume = false;
+        } else if (arg == "-h" || arg == "--help") {
+            std::cout << "Usage: " << argv[0] << " [-c|--config FILE] [--fresh]" << std::endl;
+            std::cout << "  --fresh  Ignore the sequence checkpoint and start with empty trackers" << std::endl;
+            std::cout << "Send SIGHUP to reload stats_interval, flush_interval and logged_units" << std::endl;
+            return 0;
+        }
+    }
+    
     try {
+        // SIGHUP is consumed by the reloader thread; block it before any thread exists
+        ConfigReloader::block_reload_signal();
+        
+        if (!config_path.empty()) {
+            publish_runtime_config(std::make_unique<RuntimeConfig>(load_runtime_config(config_path)));
+        }
+        ActiveFeedPolicy policy = make_feed_policy(runtime_config());
+        
         // Print startup information
-        print_startup_info();
+        print_startup_info(policy, config_path);
         
         // Install signal handlers for graceful shutdown
         signal(SIGINT, signal_handler);
         signal(SIGTERM, signal_handler);
         
         // Create main components
-        g_packet_processor = std::make_unique<PacketProcessor>();
-        g_network_handler = std::make_unique<NetworkHandler>();
+        g_packet_processor = std::make_unique<PacketProcessor>(policy);
+        g_packet_processor->start_checkpointing(resume);
+        g_packet_processor->start_gap_recovery();
+        g_packet_processor->start_snapshot_recovery();
+        g_network_handler = std::make_unique<NetworkHandler>(policy);
+        
+        if (!config_path.empty()) {
+            g_config_reloader = std::make_unique<ConfigReloader>(config_path);
+            g_config_reloader->start();
+        }
         
         std::cout << "Initialization complete. Starting packet capture..." << std::endl;
         std::cout << "Waiting for packets..." << std::endl;
         
-        // Define packet processing callback
-        auto packet_callback = [](int packet_id, int port, const char* buffer, int len, const std::string& src_ip) {
-            g_packet_processor->process_packet(packet_id, port, buffer, len, src_ip);
-        };
-        
         // Start the main capture loop (blocks until stop_capture() is called)
-        g_network_handler->start_capture(packet_callback);
+        g_network_handler->start_capture(*g_packet_processor);
 
         // Capture stopped (either by signal or error), perform cleanup
         std::cout << "\nPacket capture stopped. Performing cleanup..." << std::endl;
@@ -87,12 +155,14 @@ int main(int argc, char* argv[]) {
         if (g_packet_processor) {
             std::cout << "Flushing remaining log data..." << std::endl;
             g_packet_processor->flush_logs();
+            g_packet_processor->save_checkpoint();
 
             std::cout << "\nFinal performance report:" << std::endl;
             g_packet_processor->print_performance_report();
         }
 
         // Explicitly reset unique_ptrs to ensure proper cleanup order
+        g_config_reloader.reset();
         g_network_handler.reset();
         g_packet_processor.reset();
 
@@ -1,31 +1,77 @@
 #include "zmq_network_handler.h"
-#include "packet_processor.h"
+#include "packet_shards.h"
 #include "packet_types.h"
+#include "runtime_config.h"
 #include <iostream>
+#include <cerrno>
 #include <csignal>
+#include <cstring>
 #include <memory>
-#include <thread>
-#include <chrono>
+#include <stdexcept>
+#include <vector>
+#include <sys/signalfd.h>
+#include <unistd.h>
 
-// Global instances for signal handling
-std::unique_ptr<ZmqNetworkHandler> g_zmq_handler;
-std::unique_ptr<PacketProcessor> g_packet_processor;
+/**
+ * Block SIGINT and SIGTERM in every thread and return a signalfd for them
+ * Call before creating any thread; the main thread reads the fd, so the
+ * shutdown runs in normal context instead of a signal handler.
+ */
+int open_shutdown_signalfd() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGINT);
+    sigaddset(&set, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+    int fd = signalfd(-1, &set, SFD_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("signalfd: " + std::string(strerror(errno)));
+    }
+    return fd;
+}
 
-void signal_handler(int signal) {
-    std::cout << "\nReceived signal " << signal << ", initiating graceful shutdown..." << std::endl;
-    
-    if (g_zmq_handler) {
-        g_zmq_handler->stop_capture();
+/**
+ * Block until SIGINT or SIGTERM arrives
+ * @return The signal number
+ */
+int wait_for_shutdown_signal(int fd) {
+    struct signalfd_siginfo info;
+    while (read(fd, &info, sizeof(info)) != static_cast<ssize_t>(sizeof(info))) {
+        if (errno != EINTR) {
+            throw std::runtime_error("signalfd read: " + std::string(strerror(errno)));
+        }
     }
+    return static_cast<int>(info.ssi_signo);
+}
+
+/**
+ * Drain everything already received and close the logs
+ * Order matters: the sockets are drained into the shard queues, the shards
+ * process their queues, and only then are checkpoints, footers and indexes
+ * written, so every packet that reached the logger is either logged or
+ * counted as lost.
+ */
+void shutdown_capture(ZmqNetworkHandler& handler, PacketShards& shards) {
+    int drain_ms = runtime_config().shutdown_drain_ms;
+    std::vector<uint64_t> dropped_before = shards.dropped_by_shard();
+    
+    handler.stop_capture(drain_ms);
+    std::cout << "Flushing remaining log data..." << std::endl;
+    shards.stop();
+    shards.save_checkpoint();
+    shards.print_performance_report();
     
-    if (g_packet_processor) {
-        std::cout << "Flushing remaining log data..." << std::endl;
-        g_packet_processor->flush_logs();
-        g_packet_processor->print_performance_report();
+    ZmqNetworkHandler::Statistics stats = handler.get_statistics();
+    uint64_t unread = stats.shutdown_lost;
+    uint64_t dropped = shards.dropped();
+    for (uint64_t before : dropped_before) {
+        dropped -= before;
     }
+    shards.close_logs(handler.shutdown_lost_by_unit(), dropped_before);
     
-    std::cout << "Shutdown complete." << std::endl;
-    exit(0);
+    std::cout << "Lost at shutdown: " << (unread + dropped) << " packets (" << unread
+              << " still queued at the " << drain_ms << "ms drain deadline, " << dropped
+              << " dropped at full shard queues)" << std::endl;
 }
 
 void print_zmq_startup_info() {
@@ -33,16 +79,29 @@ void print_zmq_startup_info() {
     std::cout << "CBOE PITCH ZeroMQ Binary Logger" << std::endl;
     std::cout << "========================================" << std::endl;
     std::cout << "Transport: ZeroMQ Publisher-Subscriber" << std::endl;
-    std::cout << "Endpoints: ipc:///tmp/cboe_port1.ipc, ipc:///tmp/cboe_port2.ipc" << std::endl;
+    if (runtime_config().zmq_transport == ZmqTransport::SHM) {
+        std::cout << "Endpoints: shared memory " << runtime_config().shm_name << " (lanes for port1/port2)" << std::endl;
+    } else {
+        std::cout << "Endpoints: ipc:///tmp/cboe_port1.ipc, ipc:///tmp/cboe_port2.ipc" << std::endl;
+        if (runtime_config().zmq_pattern == ZmqPattern::SUB) {
+            const auto& units = runtime_config().zmq_units;
+            std::cout << "Subscribed units: " << (units.all() ? std::string("all") : std::to_string(units.count())) << std::endl;
+        }
+    }
     std::cout << "Target rate: 100,000 packets/second" << std::endl;
     std::cout << "Binary record size: " << sizeof(BinaryLogRecord) << " bytes + payload" << std::endl;
     std::cout << std::endl;
     
     std::cout << "Performance Configuration:" << std::endl;
-    std::cout << "  Log file size: " << (Config::LOG_FILE_SIZE / (1024*1024)) << "MB per file" << std::endl;
-    std::cout << "  Log file count: " << Config::LOG_FILE_COUNT << " files" << std::endl;
-    std::cout << "  ZMQ High Water Mark: 1M messages" << std::endl;
-    std::cout << "  Receive timeout: 100ms" << std::endl;
+    std::cout << "  Log file size: " << (runtime_config().log_file_size / (1024*1024)) << "MB per file" << std::endl;
+    std::cout << "  Log file count: " << runtime_config().log_file_count << " files" << std::endl;
+    if (runtime_config().zmq_transport != ZmqTransport::SHM) {
+        std::cout << "  ZMQ High Water Mark: " << ZmqNetworkHandler::RECEIVE_HWM << " messages" << std::endl;
+    }
+    std::cout << "  Wait strategy: " << ZmqNetworkHandler::wait_strategy_name(runtime_config().zmq_wait_strategy)
+              << " (poll timeout " << runtime_config().zmq_poll_timeout_ms << "ms)" << std::endl;
+    std::cout << "  Processing shards: " << runtime_config().zmq_shards << " (queue "
+              << runtime_config().zmq_shard_queue_packets << " packets per line)" << std::endl;
     std::cout << std::endl;
     
     std::cout << "Waiting for ZMQ publisher (CBOE pcap replayer)..." << std::endl;
@@ -51,31 +110,61 @@ void print_zmq_startup_info() {
 }
 
 int main(int argc, char* argv[]) {
+    std::string config_path;
+    bool resume = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-c" || arg == "--config") && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (arg == "--fresh") {
+            resume = false;
+        }
+    }
+    
     try {
-        print_zmq_startup_info();
+        // SIGHUP is consumed by the reloader thread and SIGINT/SIGTERM by the
+        // main thread; block them before any thread exists
+        ConfigReloader::block_reload_signal();
+        int signal_fd = open_shutdown_signalfd();
+        if (!config_path.empty()) {
+            publish_runtime_config(std::make_unique<RuntimeConfig>(load_runtime_config(config_path)));
+        }
         
-        // Install signal handlers
-        signal(SIGINT, signal_handler);
-        signal(SIGTERM, signal_handler);
+        print_zmq_startup_info();
         
         // Create components
-        g_packet_processor = std::make_unique<PacketProcessor>();
-        g_zmq_handler = std::make_unique<ZmqNetworkHandler>();
+        auto shards = std::make_unique<PacketShards>(runtime_config().zmq_shards, resume);
+        shards->start();
+        auto zmq_handler = std::make_unique<ZmqNetworkHandler>();
+        
+        std::unique_ptr<ConfigReloader> config_reloader;
+        if (!config_path.empty()) {
+            config_reloader = std::make_unique<ConfigReloader>(config_path);
+            config_reloader->start();
+        }
         
         std::cout << "Initialization complete. Starting ZMQ packet capture..." << std::endl;
         
-        // Define packet processing callback
-        auto packet_callback = [](int packet_id, int port, const char* buffer, int len, const std::string& src_ip) {
-            g_packet_processor->process_packet(packet_id, port, buffer, len, src_ip);
+        // Define packet processing callback (called from both receive threads)
+        PacketShards* sink = shards.get();
+        auto packet_callback = [sink](const ZmqPacket& packet) {
+            sink->submit(packet);
         };
         
         // Start ZMQ capture
-        g_zmq_handler->start_capture(packet_callback);
+        zmq_handler->start_capture(packet_callback);
+        
+        int signal = wait_for_shutdown_signal(signal_fd);
+        std::cout << "\nReceived signal " << signal << ", initiating graceful shutdown..." << std::endl;
+        shutdown_capture(*zmq_handler, *shards);
         
-        // Keep main thread alive
-        while (true) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (config_reloader) {
+            config_reloader->stop();
         }
+        zmq_handler.reset();
+        shards.reset();
+        close(signal_fd);
+        std::cout << "Shutdown complete." << std::endl;
         
     } catch (const std::exception& e) {
         std::cerr << "FATAL ERROR: " << e.what() << std::endl;
@@ -1,4 +1,6 @@
 #include "network_handler.h"
+#include "packet_processor.h"
+#include "stage_probes.h"
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/socket.h>
@@ -9,18 +11,22 @@
 #include <iostream>
 #include <cerrno>
 
-NetworkHandler::NetworkHandler() : sock1_(-1), sock2_(-1), capturing_(false) {
-    sock1_ = create_multicast_socket(Config::PORT1);
-    sock2_ = create_multicast_socket(Config::PORT2);
+template <typename FeedPolicy>
+BasicNetworkHandler<FeedPolicy>::BasicNetworkHandler(const FeedPolicy& policy)
+    : policy_(policy), sock1_(-1), sock2_(-1), capturing_(false) {
+    sock1_ = create_multicast_socket(policy_.port_for_line(0));
+    sock2_ = create_multicast_socket(policy_.port_for_line(1));
 }
 
-NetworkHandler::~NetworkHandler() {
+template <typename FeedPolicy>
+BasicNetworkHandler<FeedPolicy>::~BasicNetworkHandler() {
     stop_capture();
     if (sock1_ >= 0) close(sock1_);
     if (sock2_ >= 0) close(sock2_);
 }
 
-int NetworkHandler::create_multicast_socket(uint16_t port) {
+template <typename FeedPolicy>
+int BasicNetworkHandler<FeedPolicy>::create_multicast_socket(uint16_t port) {
     int sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (sock < 0) {
         throw std::runtime_error("Failed to create socket: " + std::string(strerror(errno)));
@@ -31,8 +37,10 @@ int NetworkHandler::create_multicast_socket(uint16_t port) {
         std::cerr << "Warning: Failed to set SO_REUSEADDR: " << strerror(errno) << std::endl;
     }
 
+    const RuntimeConfig& config = runtime_config();
+
     // CRITICAL: Increase socket buffer for 14M packets
-    int rcvbuf = 64 * 1024 * 1024;  // 64MB socket buffer
+    int rcvbuf = config.socket_buffer_bytes;
     if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
         std::cerr << "Warning: Failed to set SO_RCVBUF: " << strerror(errno) << std::endl;
     }
@@ -53,8 +61,8 @@ int NetworkHandler::create_multicast_socket(uint16_t port) {
     }
 
     ip_mreq mreq{};
-    mreq.imr_multiaddr.s_addr = inet_addr(Config::MULTICAST_IP);
-    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    mreq.imr_multiaddr.s_addr = inet_addr(config.multicast_ip.c_str());
+    mreq.imr_interface.s_addr = inet_addr(config.interface_ip.c_str());
     if (setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
         close(sock);
         throw std::runtime_error("Failed to join multicast group: " + std::string(strerror(errno)));
@@ -63,22 +71,55 @@ int NetworkHandler::create_multicast_socket(uint16_t port) {
     return sock;
 }
 
-void NetworkHandler::start_capture(PacketCallback callback) {
+template <typename FeedPolicy>
+void BasicNetworkHandler<FeedPolicy>::start_capture(PacketCallback callback) {
+    capture_loop([&callback](int packet_id, int port, const char* buffer, int len, const sockaddr_in& sender) {
+        callback(packet_id, port, buffer, len, inet_ntoa(sender.sin_addr));
+    }, []() { return -1; }, -1);
+}
+
+template <typename FeedPolicy>
+void BasicNetworkHandler<FeedPolicy>::start_capture(BasicPacketProcessor<FeedPolicy>& processor) {
+    capture_loop([&processor](int packet_id, int port, const char* buffer, int len, const sockaddr_in& sender) {
+        processor.process_packet(packet_id, port, buffer, len, static_cast<uint32_t>(sender.sin_addr.s_addr));
+    }, [&processor]() { return processor.service(); }, processor.wakeup_fd());
+}
+
+template <typename FeedPolicy>
+template <typename Sink, typename Service>
+void BasicNetworkHandler<FeedPolicy>::capture_loop(Sink&& sink, Service&& service, int wake_fd) {
     capturing_ = true;
+    const bool measure_latency = runtime_config().measure_send_latency;
+    if (measure_latency) {
+        TscClock::calibrate();  // Not on the first stamped datagram
+    }
+
+    int receive_cpu = runtime_config().receive_cpu;
+    if (receive_cpu >= 0 && !pin_current_thread({receive_cpu})) {
+        std::cerr << "Warning: Failed to pin receive thread to CPU " << receive_cpu << std::endl;
+    }
 
-    struct pollfd fds[2];
+    struct pollfd fds[3];
     fds[0].fd = sock1_;
     fds[0].events = POLLIN;
     fds[1].fd = sock2_;
     fds[1].events = POLLIN;
+    fds[2].fd = wake_fd;  // Ignored by poll while negative
+    fds[2].events = POLLIN;
 
     int packet_id = 0;
     char buffer[Config::MAX_BUF];
     char control_buffer[1024];
 
     while (capturing_) {
-        // Use 100ms timeout for better CPU efficiency while maintaining responsiveness
-        int ready = poll(fds, 2, 100);
+        // Use 100ms timeout for better CPU efficiency while maintaining responsiveness,
+        // shortened when queued work (e.g. a gap request) falls due sooner
+        int timeout = 100;
+        int service_timeout = service();
+        if (service_timeout >= 0 && service_timeout < timeout) {
+            timeout = service_timeout;
+        }
+        int ready = poll(fds, 3, timeout);
 
         if (ready < 0) {
             // Handle poll errors
@@ -113,15 +154,17 @@ void NetworkHandler::start_capture(PacketCallback callback) {
                 msg.msg_control = control_buffer;
                 msg.msg_controllen = sizeof(control_buffer);
 
+                STAGE_PROBE(RECEIVE);
                 ssize_t len = recvmsg(fds[i].fd, &msg, 0);
+                STAGE_PROBE_END(RECEIVE);
 
                 if (len > 0) {
                     packet_id++;
-                    int port = (fds[i].fd == sock1_) ? Config::PORT1 : Config::PORT2;
-                    std::string src_ip = inet_ntoa(sender_addr.sin_addr);
-
-                    // Call the provided callback function
-                    callback(packet_id, port, buffer, static_cast<int>(len), src_ip);
+                    uint64_t send_tsc;
+                    if (measure_latency && read_send_stamp(buffer, static_cast<size_t>(len), send_tsc)) {
+                        latency_[i].add(send_stamp_latency_ns(send_tsc, TscClock::now()));
+                    }
+                    sink(packet_id, policy_.port_for_line(i), buffer, static_cast<int>(len), sender_addr);
                 } else if (len < 0) {
                     // Handle receive errors
                     if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -129,7 +172,7 @@ void NetworkHandler::start_capture(PacketCallback callback) {
                         continue;
                     }
                     std::cerr << "recvmsg error on port "
-                              << ((fds[i].fd == sock1_) ? Config::PORT1 : Config::PORT2)
+                              << policy_.port_for_line(i)
                               << ": " << strerror(errno) << std::endl;
                 }
             }
@@ -137,15 +180,27 @@ void NetworkHandler::start_capture(PacketCallback callback) {
             // Check for error events
             if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
                 std::cerr << "Socket error on port "
-                          << ((fds[i].fd == sock1_) ? Config::PORT1 : Config::PORT2)
+                          << policy_.port_for_line(i)
                           << std::endl;
                 capturing_ = false;
                 break;
             }
         }
     }
+
+    for (int i = 0; i < 2; ++i) {
+        if (latency_[i].count() != 0) {
+            std::cout << "UDP latency port" << (i + 1) << " (send stamp to receipt): " << latency_[i].summary()
+                      << std::endl;
+        }
+    }
 }
 
-void NetworkHandler::stop_capture() {
+template <typename FeedPolicy>
+void BasicNetworkHandler<FeedPolicy>::stop_capture() {
     capturing_ = false;
-}
\ No newline at end of file
+}
+
+// Explicit instantiations for every supported feed policy
+template class BasicNetworkHandler<DefaultFeedPolicy>;
+template class BasicNetworkHandler<RuntimeFeedPolicy>;
\ No newline at end of file
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "packet_types.h"
+#include "feed_policy.h"
+#include "latency_histogram.h"
+#include <netinet/in.h>
 #include <string>
 #include <functional>
 #include <atomic>
@@ -11,20 +14,26 @@
  */
 using PacketCallback = std::function<void(int, int, const char*, int, const std::string&)>;
 
+template <typename FeedPolicy>
+class BasicPacketProcessor;
+
 /**
  * Handles multicast socket creation and packet reception
+ * Socket i carries policy port_for_line(i), so the port of a packet is
+ * known from the poll slot without comparing descriptors.
  */
-class NetworkHandler {
+template <typename FeedPolicy>
+class BasicNetworkHandler {
 public:
     /**
      * Constructor - creates and configures multicast sockets
      */
-    NetworkHandler();
+    explicit BasicNetworkHandler(const FeedPolicy& policy = FeedPolicy());
     
     /**
      * Destructor - cleans up sockets
      */
-    ~NetworkHandler();
+    ~BasicNetworkHandler();
     
     /**
      * Start packet capture loop
@@ -32,6 +41,13 @@ public:
      */
     void start_capture(PacketCallback callback);
     
+    /**
+     * Start packet capture loop feeding a processor directly
+     * The call is resolved at compile time and the source address is passed
+     * in binary form, so no std::function or string is involved per packet.
+     */
+    void start_capture(BasicPacketProcessor<FeedPolicy>& processor);
+    
     /**
      * Stop packet capture (can be called from signal handler)
      */
@@ -43,12 +59,26 @@ public:
     bool is_capturing() const { return capturing_; }
 
 private:
+    FeedPolicy policy_;
     int sock1_;
     int sock2_;
     std::atomic<bool> capturing_;
+    LatencyHistogram latency_[2];   // Send stamp to receipt, per line (stamped test feeds only)
     
     /**
      * Create and configure a multicast socket for the given port
      */
     int create_multicast_socket(uint16_t port);
-};
\ No newline at end of file
+    
+    /**
+     * Receive loop shared by both start_capture variants
+     * @param sink Called as sink(packet_id, port, buffer, len, sender_addr)
+     * @param service Called every loop iteration; returns the longest the loop
+     *                may sleep in ms, or -1 for no limit
+     * @param wake_fd Extra descriptor that interrupts the wait (-1 for none)
+     */
+    template <typename Sink, typename Service>
+    void capture_loop(Sink&& sink, Service&& service, int wake_fd);
+};
+
+using NetworkHandler = BasicNetworkHandler<ActiveFeedPolicy>;
\ No newline at end of file
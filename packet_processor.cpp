@@ -1,26 +1,94 @@
 #include "packet_processor.h"
+#include "runtime_config.h"
+#include "stage_probes.h"
+#include <algorithm>
 #include <iomanip>
+#include <map>
 #include <sstream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
-PacketProcessor::PacketProcessor() 
-    : logger_(std::make_unique<BinaryLogger>()),
-      sequence_manager_(std::make_unique<SequenceManager>()) {
+namespace {
+
+/**
+ * Wall-clock nanoseconds on the same clock BinaryLogger stamps records with
+ */
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Last sequence number carried by a packet
+ */
+uint64_t last_sequence(uint32_t seq, uint8_t count) {
+    return static_cast<uint64_t>(seq) + (count > 0 ? count : 1) - 1;
+}
+
+} // namespace
+
+template <typename FeedPolicy>
+BasicPacketProcessor<FeedPolicy>::BasicPacketProcessor(const FeedPolicy& policy, int shard)
+    : policy_(policy),
+      log_file_(shard_file_name(runtime_config().log_file, shard)),
+      checkpoint_file_(shard_file_name(runtime_config().checkpoint_file, shard)),
+      logger_(std::make_unique<BinaryLogger>(log_file_, shard == 0 ? std::string("binary_logger")
+                                                                   : "binary_logger.shard" + std::to_string(shard))),
+      sequence_manager_(std::make_unique<BasicSequenceManager<FeedPolicy>>(policy)) {
     
     stats_.start_time = std::chrono::high_resolution_clock::now();
     
+    const RuntimeConfig& config = runtime_config();
+    sequence_manager_->set_limits(config.max_sequence_jump, config.max_pending_sequences);
+    
     logger_->log_info("PacketProcessor initialized and ready for high-volume processing");
 }
 
-void PacketProcessor::process_packet(int packet_id, int port, const char* buffer, int len, const std::string& src_ip) {
+template <typename FeedPolicy>
+BasicPacketProcessor<FeedPolicy>::~BasicPacketProcessor() {
+    // Client threads signal the wakeup descriptor until they are stopped
+    grp_client_.reset();
+    spin_client_.reset();
+    if (wakeup_fd_ >= 0) {
+        close(wakeup_fd_);
+    }
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::process_packet(int packet_id, int port, const char* buffer, int len, const std::string& src_ip) {
+    process_packet(packet_id, port, buffer, len, ip_to_binary(src_ip));
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::process_packet(int packet_id, int port, const char* buffer, int len, uint32_t src_ip,
+                                                      uint64_t rx_timestamp_ns) {
     stats_.total_packets++;
+    STAGE_PROBE_PACKET();
+    
+    // Periodic tracker checkpoint; the snapshot excludes this packet, which is
+    // logged after the checkpoint timestamp and therefore replayed on restart
+    if (checkpoint_writer_ && (stats_.total_packets & (CHECKPOINT_CHECK_PACKETS - 1)) == 0) {
+        maybe_checkpoint();
+    }
+    
+    if ((grp_client_ && (grp_client_->has_retransmissions() || !pending_gaps_.empty())) ||
+        (spin_client_ && spin_client_->has_events())) {
+        service();
+    }
     
     // Validate packet structure
+    STAGE_PROBE(VALIDATE);
     if (!validate_packet(buffer, len)) {
         logger_->log_warning("Invalid packet structure, packet_id: " + std::to_string(packet_id));
         return;
     }
+    STAGE_PROBE_END(VALIDATE);
     
     // Parse CBOE header
+    STAGE_PROBE(DECODE);
     const CboeSequencedUnitHeader* header = reinterpret_cast<const CboeSequencedUnitHeader*>(buffer);
     
     uint32_t sequence = le32toh_safe(header->hdr_sequence);
@@ -30,11 +98,12 @@ void PacketProcessor::process_packet(int packet_id, int port, const char* buffer
     
     // Classify packet type
     PacketType packet_type = classify_packet_type(sequence, count, len);
+    STAGE_PROBE_END(DECODE);
     
     // Update statistics
     switch (packet_type) {
         case PacketType::HEARTBEAT:
-            if (Config::SKIP_HEARTBEATS) {
+            if (policy_.skip_heartbeats()) {
                 stats_.heartbeats_skipped++;
                 return; // Skip logging heartbeats
             }
@@ -48,40 +117,37 @@ void PacketProcessor::process_packet(int packet_id, int port, const char* buffer
         case PacketType::UNSEQUENCED:
             stats_.unsequenced_packets++;
             break;
+        case PacketType::FOOTER:
+        case PacketType::CHECKPOINT:
+            break; // Written by the logger itself, never classified from the wire
     }
     
-    // Determine sequence order status
-    OrderStatus order_status = sequence_manager_->determine_order_status(sequence, count, port, unit);
+    const RuntimeConfig& config = runtime_config();
     
-    // Update order statistics
-    switch (order_status) {
-        case OrderStatus::SEQUENCED_OUT_OF_ORDER_EARLY:
-        case OrderStatus::SEQUENCED_OUT_OF_ORDER_LATE:
-            stats_.out_of_order_packets++;
-            break;
-        case OrderStatus::SEQUENCED_DUPLICATE:
-            stats_.duplicate_packets++;
-            break;
-        default:
-            break;
+    if (spin_client_ && sequence != 0) {
+        // A unit first seen well into the session is brought current from its image
+        if (config.spin_on_start && sequence > 1 && !spin_on_start_done_.test(unit) &&
+            !sequence_manager_->is_tracking_unit(unit)) {
+            spin_on_start_done_.set(unit);
+            start_spin(unit);
+        }
+        if (spinning_.test(unit)) {
+            std::vector<BufferedPacket>& held = spin_buffers_[unit];
+            held.push_back({static_cast<uint32_t>(packet_id), static_cast<uint16_t>(port), src_ip, rx_timestamp_ns,
+                            std::string(buffer, len)});
+            if (held.size() >= config.spin_max_buffered) {
+                logger_->log_warning("Spin of unit " + std::to_string(unit) + " abandoned after buffering " +
+                                     std::to_string(held.size()) + " live packets");
+                spin_client_->cancel_spin(unit);
+                spin_cancelled_.set(unit);
+                release_spin_buffer(unit);
+            }
+            return;
+        }
     }
     
-    // Convert IP to binary format
-    uint32_t src_ip_binary = ip_to_binary(src_ip);
-    
-    // Log the packet
-    logger_->log_packet(
-        static_cast<uint32_t>(packet_id),
-        static_cast<uint16_t>(port),
-        buffer,
-        static_cast<uint16_t>(len),
-        sequence,
-        count,
-        unit,
-        packet_type,
-        order_status,
-        src_ip_binary
-    );
+    sequence_and_log(static_cast<uint32_t>(packet_id), static_cast<uint16_t>(port), buffer, len, src_ip,
+                     sequence, count, unit, packet_type, rx_timestamp_ns);
     
     // Periodic performance reporting
     if (should_report_statistics()) {
@@ -89,49 +155,93 @@ void PacketProcessor::process_packet(int packet_id, int port, const char* buffer
     }
 
     // Periodic flushing for data safety (silent flush for performance)
-    if (stats_.total_packets % Config::FLUSH_INTERVAL == 0) {
+    if (stats_.total_packets % config.flush_interval == 0) {
         flush_logs();
         // Note: Flush info is included in performance report to avoid extra I/O
     }
 }
 
-bool PacketProcessor::validate_packet(const char* buffer, int len) const {
-    if (len < static_cast<int>(sizeof(CboeSequencedUnitHeader))) {
-        return false;
-    }
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::sequence_and_log(uint32_t packet_id, uint16_t port, const char* buffer, int len,
+                                                        uint32_t src_ip, uint32_t sequence, uint8_t count,
+                                                        uint8_t unit, PacketType packet_type,
+                                                        uint64_t rx_timestamp_ns) {
+    // Determine sequence order status; session boundary messages can start a new epoch
+    STAGE_PROBE(SEQUENCE);
+    uint8_t session_events = (packet_type == PacketType::DATA) ? scan_session_events(buffer, len, count)
+                                                               : SessionEvent::NONE;
+    OrderStatus order_status = sequence_manager_->determine_order_status(sequence, count, port, unit, session_events);
     
-    const CboeSequencedUnitHeader* header = reinterpret_cast<const CboeSequencedUnitHeader*>(buffer);
-    uint16_t declared_length = le16toh_safe(header->hdr_length);
-    
-    // Basic sanity checks
-    if (declared_length == 0 || declared_length > Config::MAX_BUF) {
-        return false;
+    // Update order statistics
+    switch (order_status) {
+        case OrderStatus::SEQUENCED_OUT_OF_ORDER_EARLY:
+            stats_.out_of_order_packets++;
+            if (grp_client_ || spin_client_) {
+                queue_gap_requests();
+            }
+            break;
+        case OrderStatus::SEQUENCED_OUT_OF_ORDER_LATE:
+            stats_.out_of_order_packets++;
+            break;
+        case OrderStatus::SEQUENCED_DUPLICATE:
+            stats_.duplicate_packets++;
+            // With line arbitration the other line already delivered this copy
+            if (policy_.line_arbitration()) {
+                stats_.arbitrated_packets++;
+                return;
+            }
+            break;
+        case OrderStatus::SEQUENCED_RESET:
+            handle_session_reset(port, unit, sequence);
+            break;
+        default:
+            break;
     }
     
-    // Length should be reasonable compared to actual received length
-    if (static_cast<int>(declared_length) > len + 100) { // Allow some tolerance
-        return false;
-    }
+    STAGE_PROBE_END(SEQUENCE);
     
-    return true;
+    // Log the packet unless its unit is filtered out (reloadable; sequencing still sees it)
+    if (runtime_config().logged_units.test(unit)) {
+        STAGE_PROBE(LOG_ENQUEUE);
+        logger_->log_packet(
+            packet_id,
+            port,
+            buffer,
+            static_cast<uint16_t>(len),
+            sequence,
+            count,
+            unit,
+            packet_type,
+            order_status,
+            src_ip,
+            policy_.max_logged_payload(),
+            rx_timestamp_ns
+        );
+    } else {
+        stats_.filtered_packets++;
+    }
 }
 
-bool PacketProcessor::should_report_statistics() const {
-    return (stats_.total_packets % Config::STATS_INTERVAL == 0) && (stats_.total_packets > 0);
+template <typename FeedPolicy>
+bool BasicPacketProcessor<FeedPolicy>::should_report_statistics() const {
+    return (stats_.total_packets % runtime_config().stats_interval == 0) && (stats_.total_packets > 0);
 }
 
-double PacketProcessor::Statistics::get_packets_per_second() const {
+template <typename FeedPolicy>
+double BasicPacketProcessor<FeedPolicy>::Statistics::get_packets_per_second() const {
     double elapsed = get_elapsed_seconds();
     return (elapsed > 0) ? static_cast<double>(total_packets) / elapsed : 0.0;
 }
 
-double PacketProcessor::Statistics::get_elapsed_seconds() const {
+template <typename FeedPolicy>
+double BasicPacketProcessor<FeedPolicy>::Statistics::get_elapsed_seconds() const {
     auto now = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time);
     return duration.count() / 1000.0;
 }
 
-void PacketProcessor::print_performance_report() const {
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::print_performance_report() const {
     double pps = stats_.get_packets_per_second();
     double elapsed = stats_.get_elapsed_seconds();
     
@@ -149,14 +259,480 @@ void PacketProcessor::print_performance_report() const {
             << stats_.duplicate_packets << " dups";
     }
     
+    if (stats_.arbitrated_packets > 0) {
+        oss << ", " << stats_.arbitrated_packets << " arbitrated";
+    }
+    
+    if (stats_.session_resets > 0) {
+        oss << ", " << stats_.session_resets << " session resets";
+    }
+    
+    const auto& protection = sequence_manager_->get_protection_stats();
+    if (protection.quarantined_packets > 0 || protection.holes_abandoned > 0) {
+        oss << ", " << protection.quarantined_packets << " quarantined, "
+            << protection.messages_abandoned << " messages abandoned";
+    }
+    
+    if (grp_client_ && grp_client_->get_statistics().requests_sent > 0) {
+        oss << ", " << grp_client_->get_statistics().requests_sent << " gap requests, "
+            << stats_.recovered_packets << " recovered";
+    }
+    
+    if (spin_client_ && spin_client_->get_statistics().spins_requested > 0) {
+        oss << ", " << spin_client_->get_statistics().spins_finished << "/"
+            << spin_client_->get_statistics().spins_requested << " spins, "
+            << stats_.snapshot_packets << " snapshot packets";
+    }
+    
+    if (stats_.filtered_packets > 0) {
+        oss << ", " << stats_.filtered_packets << " filtered";
+    }
+    
     // Performance warning for high-volume scenarios
     if (pps < 50000 && stats_.total_packets > 100000) {
         oss << " [WARNING: Below 50K pps target]";
     }
     
     logger_->log_info(oss.str());
+    
+#ifdef STAGE_PROBES
+    for (const std::string& line : stage_probe_report()) {
+        logger_->log_info(line);
+    }
+#endif
 }
 
-void PacketProcessor::flush_logs() {
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::flush_logs() {
     logger_->flush();
-}
\ No newline at end of file
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::close_log(uint64_t shutdown_lost) {
+    logger_->close(shutdown_lost);
+}
+
+template <typename FeedPolicy>
+bool BasicPacketProcessor<FeedPolicy>::start_checkpointing(bool resume) {
+    const RuntimeConfig& config = runtime_config();
+    if (checkpoint_file_.empty()) {
+        return false;
+    }
+    
+    bool resumed = false;
+    SequenceCheckpoint checkpoint;
+    try {
+        if (!resume) {
+            logger_->log_info("Warm restart disabled; starting with empty sequence state");
+        } else if (!read_checkpoint(checkpoint_file_, checkpoint)) {
+            logger_->log_info("No sequence checkpoint at " + checkpoint_file_ + "; starting with empty sequence state");
+        } else {
+            uint64_t now = now_ns();
+            uint64_t max_age_ns = static_cast<uint64_t>(config.checkpoint_max_age_s) * 1000000000ULL;
+            if (checkpoint.timestamp_ns > now || now - checkpoint.timestamp_ns > max_age_ns) {
+                throw std::runtime_error("checkpoint is older than checkpoint_max_age_s or from the future");
+            }
+            
+            auto start = std::chrono::steady_clock::now();
+            stats_.resumed_trackers = sequence_manager_->restore_state(checkpoint);
+            stats_.replayed_packets = replay_log_tail(checkpoint);
+            double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            
+            std::ostringstream oss;
+            oss << "Warm restart: " << stats_.resumed_trackers << " trackers from checkpoint taken "
+                << std::fixed << std::setprecision(1) << (now - checkpoint.timestamp_ns) / 1e9 << "s ago, "
+                << stats_.replayed_packets << " packets replayed from the log tail in "
+                << elapsed_ms << "ms";
+            logger_->log_info(oss.str());
+            resumed = true;
+        }
+    } catch (const std::exception& e) {
+        sequence_manager_->clear();
+        stats_.resumed_trackers = 0;
+        stats_.replayed_packets = 0;
+        logger_->log_warning("Sequence checkpoint rejected, starting with empty sequence state: " + std::string(e.what()));
+    }
+    
+    // A checkpoint only replaces the previous one once its marker is in the log
+    checkpoint_writer_ = std::make_unique<CheckpointWriter>(checkpoint_file_, [this](uint64_t timestamp_ns) {
+        return logger_->wait_for_checkpoint_marker(timestamp_ns, Config::CHECKPOINT_MARKER_TIMEOUT_MS);
+    });
+    checkpoint_writer_->start();
+    next_checkpoint_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(config.checkpoint_interval_ms);
+    return resumed;
+}
+
+template <typename FeedPolicy>
+uint64_t BasicPacketProcessor<FeedPolicy>::replay_log_tail(const SequenceCheckpoint& checkpoint) {
+    const RuntimeConfig& config = runtime_config();
+    
+    // Rotation keeps log_file_count old segments next to the active one
+    std::vector<std::string> segments = log_segments_newest_first(log_file_, config.log_file_count + 1);
+    
+    // Walk back to the newest segment holding the checkpoint's marker record
+    size_t first_segment = segments.size();
+    for (size_t i = 0; i < segments.size() && first_segment == segments.size(); i++) {
+        for_each_log_record(segments[i], [&](const BinaryLogRecord& record) {
+            if (static_cast<PacketType>(record.packet_type) == PacketType::CHECKPOINT &&
+                record.timestamp_ns == checkpoint.timestamp_ns) {
+                first_segment = i;
+                return false;
+            }
+            return true;
+        });
+    }
+    if (first_segment == segments.size()) {
+        if (segments.empty() || checkpoint.trackers.empty()) {
+            return 0;
+        }
+        throw std::runtime_error("the checkpoint's marker record is not in the log segments on disk");
+    }
+    
+    // Oldest first: packets logged before the marker must already be covered by
+    // the checkpoint, packets logged after it are fed through the trackers again
+    // (with session events from the stored payload, as far as it was logged).
+    // Only the last session epoch before the checkpoint has to match it, so a
+    // contradiction is forgotten when its tracker starts a new epoch later on
+    uint64_t replayed = 0;
+    bool after_marker = false;
+    std::map<uint32_t, std::string> contradictions; // (port << 8 | unit) -> first mismatch
+    for (size_t i = first_segment + 1; i-- > 0;) {
+        for_each_log_record_with_payload(segments[i], [&](const BinaryLogRecord& record, const char* payload) {
+            PacketType type = static_cast<PacketType>(record.packet_type);
+            if (type == PacketType::CHECKPOINT && record.timestamp_ns == checkpoint.timestamp_ns) {
+                after_marker = true;
+                return true;
+            }
+            OrderStatus status = static_cast<OrderStatus>(record.order_status);
+            if (status == OrderStatus::UNSEQUENCED || record.sequence == 0) {
+                return true;
+            }
+            if (after_marker) {
+                // Only resets the live run logged start an epoch; the tracker never infers one here
+                if (status == OrderStatus::SEQUENCED_RESET) {
+                    sequence_manager_->start_new_epoch(record.port, record.unit);
+                }
+                uint8_t session_events = (type == PacketType::DATA)
+                                       ? scan_session_events(payload, record.payload_length, record.count)
+                                       : SessionEvent::NONE;
+                sequence_manager_->determine_order_status(record.sequence, record.count, record.port, record.unit,
+                                                          session_events, false);
+                replayed++;
+                return true;
+            }
+            
+            if (status == OrderStatus::SEQUENCED_QUARANTINED) {
+                return true; // Never applied to the trackers, so not covered by the checkpoint
+            }
+            uint32_t port = policy_.line_arbitration() ? 0 : record.port;  // Arbitrated lines share one tracker
+            uint32_t key = (port << 8) | record.unit;
+            if (status == OrderStatus::SEQUENCED_RESET) {
+                contradictions.erase(key);
+            }
+            const SequenceTracker* tracker = sequence_manager_->get_tracker(record.port, record.unit);
+            uint64_t last = last_sequence(record.sequence, record.count);
+            if ((!tracker || last > std::max(tracker->last_confirmed_seq, tracker->highest_seen_seq)) &&
+                contradictions.find(key) == contradictions.end()) {
+                contradictions[key] = segments[i] + " has unit " + std::to_string(record.unit) + " port " +
+                                      std::to_string(record.port) + " sequence " + std::to_string(last) +
+                                      " logged before the checkpoint but not covered by it";
+            }
+            return true;
+        });
+    }
+    if (!contradictions.empty()) {
+        throw std::runtime_error(contradictions.begin()->second);
+    }
+    return replayed;
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::maybe_checkpoint() {
+    auto now = std::chrono::steady_clock::now();
+    if (now < next_checkpoint_) {
+        return;
+    }
+    
+    SequenceCheckpoint checkpoint;
+    checkpoint.timestamp_ns = now_ns();
+    sequence_manager_->save_state(checkpoint);
+    uint64_t timestamp_ns = checkpoint.timestamp_ns;
+    
+    // Declined offers (writer still busy) are retried at the next check
+    if (checkpoint_writer_->offer(std::move(checkpoint))) {
+        logger_->log_checkpoint_marker(timestamp_ns);
+        next_checkpoint_ = now + std::chrono::milliseconds(runtime_config().checkpoint_interval_ms);
+    }
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::save_checkpoint() {
+    if (!checkpoint_writer_) {
+        return;
+    }
+    checkpoint_writer_->stop();
+    
+    SequenceCheckpoint checkpoint;
+    checkpoint.timestamp_ns = now_ns();
+    sequence_manager_->save_state(checkpoint);
+    logger_->log_checkpoint_marker(checkpoint.timestamp_ns);
+    if (!logger_->wait_for_checkpoint_marker(checkpoint.timestamp_ns, Config::CHECKPOINT_MARKER_TIMEOUT_MS)) {
+        logger_->log_error("Final sequence checkpoint skipped: its marker did not reach the log; keeping the previous one");
+        checkpoint_writer_.reset();
+        return;
+    }
+    try {
+        write_checkpoint(checkpoint_file_, checkpoint);
+        logger_->log_info("Sequence checkpoint saved: " + std::to_string(checkpoint.trackers.size()) +
+                          " trackers to " + checkpoint_file_);
+    } catch (const std::exception& e) {
+        logger_->log_error(std::string("Final sequence checkpoint failed: ") + e.what());
+    }
+    checkpoint_writer_.reset();
+}
+
+template <typename FeedPolicy>
+bool BasicPacketProcessor<FeedPolicy>::start_gap_recovery() {
+    const RuntimeConfig& config = runtime_config();
+    if (config.grp_host.empty()) {
+        return false;
+    }
+    
+    grp_request_delay_ = std::chrono::milliseconds(config.grp_request_delay_ms);
+    grp_port_ = config.grp_port;
+    sequence_manager_->set_gap_reporting(true);
+    open_wakeup_fd();
+    grp_client_ = std::make_unique<GrpClient>(config, wakeup_fd_);
+    grp_client_->start();
+    logger_->log_info("Gap recovery enabled via GRP " + config.grp_host + ":" + std::to_string(config.grp_port));
+    return true;
+}
+
+template <typename FeedPolicy>
+bool BasicPacketProcessor<FeedPolicy>::start_snapshot_recovery() {
+    const RuntimeConfig& config = runtime_config();
+    if (config.spin_servers.empty()) {
+        return false;
+    }
+    
+    sequence_manager_->set_gap_reporting(true);
+    open_wakeup_fd();
+    spin_client_ = std::make_unique<SpinClient>(config, wakeup_fd_);
+    spin_client_->start();
+    
+    std::string servers;
+    for (const auto& server : config.spin_servers) {
+        servers += (servers.empty() ? "" : ", ") + std::string("unit ") + std::to_string(server.unit) + " via " +
+                   server.host + ":" + std::to_string(server.port);
+    }
+    logger_->log_info("Snapshot recovery enabled: " + servers);
+    return true;
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::open_wakeup_fd() {
+    if (wakeup_fd_ >= 0) {
+        return;
+    }
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeup_fd_ < 0) {
+        throw std::runtime_error("Failed to create recovery eventfd: " + std::string(strerror(errno)));
+    }
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::queue_gap_requests() {
+    sequence_manager_->take_gaps(new_gaps_);
+    auto due = std::chrono::steady_clock::now() + grp_request_delay_;
+    uint32_t spin_min_gap = runtime_config().spin_min_gap;
+    for (const auto& gap : new_gaps_) {
+        // Large gaps are cheaper to recover from the image than message by message
+        if (spin_client_ && gap.last - gap.first + 1 >= spin_min_gap) {
+            if (!spinning_.test(gap.unit)) {
+                start_spin(gap.unit);
+            }
+            if (spinning_.test(gap.unit)) {
+                continue;
+            }
+        }
+        if (grp_client_) {
+            pending_gaps_.push_back({gap, due});
+        }
+    }
+    new_gaps_.clear();
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::handle_session_reset(int port, uint8_t unit, uint32_t sequence) {
+    stats_.session_resets++;
+    logger_->log_info("Unit " + std::to_string(unit) + " on port " + std::to_string(port) +
+                      ": sequence reset to " + std::to_string(sequence) + ", session epoch " +
+                      std::to_string(sequence_manager_->get_epoch(port, unit)));
+    
+    // Gaps found so far refer to the previous sequence space
+    pending_gaps_.erase(std::remove_if(pending_gaps_.begin(), pending_gaps_.end(),
+                                       [unit](const PendingGap& pending) { return pending.gap.unit == unit; }),
+                        pending_gaps_.end());
+    if (grp_client_) {
+        grp_client_->reset_unit(unit);
+    }
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::start_spin(uint8_t unit) {
+    if (spin_cancelled_.test(unit) || !spin_client_->request_spin(unit)) {
+        return; // No server for this unit, or the abandoned spin has not wound down yet
+    }
+    spinning_.set(unit);
+    logger_->log_info("Spin of unit " + std::to_string(unit) + " requested; holding its live packets");
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::release_spin_buffer(uint8_t unit) {
+    spinning_.reset(unit);
+    std::vector<BufferedPacket> held;
+    held.swap(spin_buffers_[unit]);
+    for (const auto& packet : held) {
+        const CboeSequencedUnitHeader* header = reinterpret_cast<const CboeSequencedUnitHeader*>(packet.data.data());
+        uint32_t sequence = le32toh_safe(header->hdr_sequence);
+        int len = static_cast<int>(packet.data.size());
+        sequence_and_log(packet.packet_id, packet.port, packet.data.data(), len, packet.src_ip,
+                         sequence, header->hdr_count, unit, classify_packet_type(sequence, header->hdr_count, len),
+                         packet.rx_timestamp_ns);
+    }
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::handle_spin_event(const SpinClient::Event& event) {
+    uint8_t unit = event.unit;
+    switch (event.type) {
+        case SpinClient::Event::Type::IMAGE_PACKET: {
+            if (!spinning_.test(unit) || !validate_packet(event.packet.data(), static_cast<int>(event.packet.size()))) {
+                return;
+            }
+            stats_.snapshot_packets++;
+            if (runtime_config().logged_units.test(unit)) {
+                const CboeSequencedUnitHeader* header = reinterpret_cast<const CboeSequencedUnitHeader*>(event.packet.data());
+                logger_->log_packet(0, event.port, event.packet.data(), static_cast<uint16_t>(event.packet.size()),
+                                    0, header->hdr_count, unit, PacketType::UNSEQUENCED, OrderStatus::UNSEQUENCED,
+                                    0, policy_.max_logged_payload());
+            }
+            return;
+        }
+        case SpinClient::Event::Type::FINISHED: {
+            if (!spinning_.test(unit)) {
+                return;
+            }
+            size_t held = spin_buffers_[unit].size();
+            sequence_manager_->splice_snapshot(unit, event.sequence);
+            release_spin_buffer(unit);
+            logger_->log_info("Spin of unit " + std::to_string(unit) + " finished at sequence " +
+                              std::to_string(event.sequence) + "; " + std::to_string(held) +
+                              " held live packets sequenced after the image");
+            return;
+        }
+        case SpinClient::Event::Type::FAILED:
+            if (spin_cancelled_.test(unit)) {
+                spin_cancelled_.reset(unit);
+                return;
+            }
+            if (!spinning_.test(unit)) {
+                return;
+            }
+            logger_->log_warning("Spin of unit " + std::to_string(unit) + " failed (" + event.packet +
+                                 "); sequencing " + std::to_string(spin_buffers_[unit].size()) +
+                                 " held live packets without the image");
+            release_spin_buffer(unit);
+            return;
+    }
+}
+
+template <typename FeedPolicy>
+int BasicPacketProcessor<FeedPolicy>::service() {
+    if (wakeup_fd_ >= 0) {
+        uint64_t value;
+        ssize_t ignored = ::read(wakeup_fd_, &value, sizeof(value));
+        (void)ignored;
+    }
+    
+    if (spin_client_ && spin_client_->has_events()) {
+        spin_client_->take_events(spin_events_);
+        for (const auto& event : spin_events_) {
+            handle_spin_event(event);
+        }
+        spin_events_.clear();
+    }
+    
+    if (!grp_client_) {
+        return -1;
+    }
+    
+    if (grp_client_->has_retransmissions()) {
+        grp_client_->take_retransmissions(retransmissions_);
+        for (const auto& packet : retransmissions_) {
+            process_retransmission(packet);
+        }
+        retransmissions_.clear();
+    }
+    
+    if (pending_gaps_.empty()) {
+        return -1;
+    }
+    
+    // Request whatever neither line has delivered by now
+    auto now = std::chrono::steady_clock::now();
+    while (!pending_gaps_.empty() && pending_gaps_.front().due <= now) {
+        const SequenceGap& gap = pending_gaps_.front().gap;
+        for (const auto& [first, last] : sequence_manager_->missing_ranges(gap.unit, gap.first, gap.last)) {
+            grp_client_->request(gap.unit, first, last);
+        }
+        pending_gaps_.pop_front();
+    }
+    
+    if (pending_gaps_.empty()) {
+        return -1;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(pending_gaps_.front().due - now).count();
+    return static_cast<int>(std::max<int64_t>(wait, 1));
+}
+
+template <typename FeedPolicy>
+void BasicPacketProcessor<FeedPolicy>::process_retransmission(const std::string& packet) {
+    if (!validate_packet(packet.data(), static_cast<int>(packet.size()))) {
+        return;
+    }
+    
+    const CboeSequencedUnitHeader* header = reinterpret_cast<const CboeSequencedUnitHeader*>(packet.data());
+    uint32_t sequence = le32toh_safe(header->hdr_sequence);
+    uint8_t count = header->hdr_count;
+    uint8_t unit = header->hdr_unit;
+    
+    // Feed every line that has been tracking this unit; a line that already
+    // had the messages reports a duplicate and is left unchanged. A late
+    // retransmission never counts as a session reset
+    OrderStatus order_status = OrderStatus::SEQUENCED_DUPLICATE;
+    int lines = policy_.line_arbitration() ? 1 : 2;
+    for (int line = 0; line < lines; line++) {
+        int port = policy_.port_for_line(line);
+        if (!sequence_manager_->get_tracker(port, unit)) {
+            continue;
+        }
+        OrderStatus status = sequence_manager_->determine_order_status(sequence, count, port, unit,
+                                                                       SessionEvent::NONE, false);
+        if (status != OrderStatus::SEQUENCED_DUPLICATE) {
+            order_status = status;
+        }
+    }
+    stats_.recovered_packets++;
+    
+    if (runtime_config().logged_units.test(unit)) {
+        logger_->log_packet(0, grp_port_, packet.data(), static_cast<uint16_t>(packet.size()),
+                            sequence, count, unit,
+                            classify_packet_type(sequence, count, static_cast<int>(packet.size())),
+                            order_status, 0, policy_.max_logged_payload());
+    }
+}
+
+// Explicit instantiations for every supported feed policy
+template class BasicPacketProcessor<DefaultFeedPolicy>;
+template class BasicPacketProcessor<RuntimeFeedPolicy>;
\ No newline at end of file
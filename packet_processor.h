@@ -1,27 +1,39 @@
 #pragma once
 
 #include "packet_types.h"
+#include "feed_policy.h"
 #include "sequence_tracker.h"
 #include "binary_logger.h"
+#include "sequence_checkpoint.h"
+#include "grp_client.h"
+#include "spin_client.h"
+#include <array>
+#include <bitset>
 #include <memory>
 #include <string>
 #include <chrono>
+#include <deque>
+#include <vector>
 
 /**
  * Main packet processing engine
  * Handles packet classification, sequence tracking, and logging
+ * Templated on the feed policy so static deployments are fully specialized
  */
-class PacketProcessor {
+template <typename FeedPolicy>
+class BasicPacketProcessor {
 public:
     /**
      * Constructor
+     * @param shard Processing shard (packet_logger_zmq); shards other than 0
+     *              log and checkpoint to their own files (shard_file_name)
      */
-    PacketProcessor();
+    explicit BasicPacketProcessor(const FeedPolicy& policy = FeedPolicy(), int shard = 0);
     
     /**
      * Destructor
      */
-    ~PacketProcessor() = default;
+    ~BasicPacketProcessor();
     
     /**
      * Process a received packet
@@ -33,6 +45,15 @@ public:
      */
     void process_packet(int packet_id, int port, const char* buffer, int len, const std::string& src_ip);
     
+    /**
+     * Process a received packet with the source address already in binary form
+     * (network byte order), avoiding the per-packet string round trip
+     * @param rx_timestamp_ns Arrival time measured upstream (e.g. by zmq_bridge),
+     *                        0 to log the packet with the time it is processed
+     */
+    void process_packet(int packet_id, int port, const char* buffer, int len, uint32_t src_ip,
+                        uint64_t rx_timestamp_ns = 0);
+    
     /**
      * Get performance statistics
      */
@@ -44,6 +65,13 @@ public:
         uint64_t unsequenced_packets = 0;
         uint64_t out_of_order_packets = 0;
         uint64_t duplicate_packets = 0;
+        uint64_t arbitrated_packets = 0;
+        uint64_t session_resets = 0;
+        uint64_t filtered_packets = 0;
+        uint64_t recovered_packets = 0;
+        uint64_t snapshot_packets = 0;
+        uint64_t resumed_trackers = 0;
+        uint64_t replayed_packets = 0;
         std::chrono::high_resolution_clock::time_point start_time;
         
         double get_packets_per_second() const;
@@ -61,19 +89,162 @@ public:
      * Force flush of logger
      */
     void flush_logs();
+    
+    /**
+     * Write the footer and segment index and wait for the writer threads
+     * Last call on a clean shutdown; no packet may be processed afterwards.
+     * @param shutdown_lost Packets lost while shutting down
+     */
+    void close_log(uint64_t shutdown_lost);
+    
+    /**
+     * Restore sequence state from the checkpoint file for a warm restart
+     * The checkpoint is validated against the packets logged before its marker
+     * record, then every packet logged after it is replayed from the log tail, so the
+     * trackers end up exactly where the previous run stopped logging.
+     * Call before the first packet; starts the checkpoint writer thread.
+     * @param resume false to ignore any existing checkpoint
+     * @return true if state was restored
+     */
+    bool start_checkpointing(bool resume);
+    
+    /**
+     * Write a final checkpoint synchronously and stop the writer thread
+     */
+    void save_checkpoint();
+    
+    /**
+     * Start the GRP client if grp_host is configured
+     * Gaps that are still missing on every line after grp_request_delay_ms
+     * are requested; retransmitted packets are merged into sequencing and
+     * logged with the GRP port as their port.
+     * @return true if gap recovery is enabled
+     */
+    bool start_gap_recovery();
+    
+    /**
+     * Start the spin client if spin_servers are configured
+     * A unit first seen mid-session (spin_on_start) or a gap of at least
+     * spin_min_gap messages starts a spin of that unit. Its live packets are
+     * held back until the image has been logged, then sequenced after it, so
+     * the trackers continue from the image sequence without a gap.
+     * @return true if snapshot recovery is enabled
+     */
+    bool start_snapshot_recovery();
+    
+    /**
+     * Merge waiting retransmissions and spin events, send gap requests that are due
+     * Called from the receive loop between packets and when idle.
+     * @return Milliseconds until the next gap request is due, or -1 if none
+     */
+    int service();
+    
+    /**
+     * Descriptor that becomes readable when recovery data is waiting (-1 without recovery)
+     */
+    int wakeup_fd() const { return wakeup_fd_; }
 
 private:
+    FeedPolicy policy_;
+    std::string log_file_;
+    std::string checkpoint_file_;
     std::unique_ptr<BinaryLogger> logger_;
-    std::unique_ptr<SequenceManager> sequence_manager_;
+    std::unique_ptr<BasicSequenceManager<FeedPolicy>> sequence_manager_;
     Statistics stats_;
+    std::unique_ptr<CheckpointWriter> checkpoint_writer_;
+    std::chrono::steady_clock::time_point next_checkpoint_;
+    
+    // Gap recovery (receive thread only, apart from the GRP client's own thread)
+    struct PendingGap {
+        SequenceGap gap;
+        std::chrono::steady_clock::time_point due;
+    };
+    std::unique_ptr<GrpClient> grp_client_;
+    std::deque<PendingGap> pending_gaps_;
+    std::vector<SequenceGap> new_gaps_;
+    std::vector<std::string> retransmissions_;
+    std::chrono::milliseconds grp_request_delay_{0};
+    uint16_t grp_port_ = 0;
+    int wakeup_fd_ = -1;
+    
+    // Snapshot recovery: live packets of a spinning unit wait in its buffer
+    struct BufferedPacket {
+        uint32_t packet_id;
+        uint16_t port;
+        uint32_t src_ip;
+        uint64_t rx_timestamp_ns;
+        std::string data;
+    };
+    std::unique_ptr<SpinClient> spin_client_;
+    std::array<std::vector<BufferedPacket>, 256> spin_buffers_;
+    std::bitset<256> spinning_;
+    std::bitset<256> spin_cancelled_;   // A FAILED event for the abandoned spin is still due
+    std::bitset<256> spin_on_start_done_;
+    std::vector<SpinClient::Event> spin_events_;
     
     /**
-     * Validate packet structure
+     * Create the shared wakeup eventfd on first use
      */
-    bool validate_packet(const char* buffer, int len) const;
+    void open_wakeup_fd();
+    
+    /**
+     * Hand newly detected gaps to the spin client or the GRP client
+     * GRP requests wait until the other line had a chance to fill the gap.
+     */
+    void queue_gap_requests();
+    
+    /**
+     * Sequence, count and log one packet once it has been classified
+     */
+    void sequence_and_log(uint32_t packet_id, uint16_t port, const char* buffer, int len, uint32_t src_ip,
+                          uint32_t sequence, uint8_t count, uint8_t unit, PacketType packet_type,
+                          uint64_t rx_timestamp_ns);
+    
+    /**
+     * Report a new session epoch and drop recovery work for the old sequence space
+     */
+    void handle_session_reset(int port, uint8_t unit, uint32_t sequence);
+    
+    /**
+     * Begin a spin of a unit; later live packets of the unit are buffered
+     */
+    void start_spin(uint8_t unit);
+    
+    /**
+     * Stop buffering a unit and sequence its buffered packets
+     */
+    void release_spin_buffer(uint8_t unit);
+    
+    /**
+     * Apply one event from the spin client
+     */
+    void handle_spin_event(const SpinClient::Event& event);
+    
+    /**
+     * Sequence and log one packet retransmitted by the GRP
+     */
+    void process_retransmission(const std::string& packet);
+    
+    // Clock is only read every this many packets (power of two)
+    static constexpr uint64_t CHECKPOINT_CHECK_PACKETS = 256;
+    
+    /**
+     * Offer a tracker snapshot to the writer if the interval has elapsed
+     */
+    void maybe_checkpoint();
+    
+    /**
+     * Validate a loaded checkpoint against the log and replay the packets logged after it
+     * The log is split at the CHECKPOINT record written with the checkpoint.
+     * @return Number of replayed packets
+     * @throws std::runtime_error if the log contradicts the checkpoint
+     */
+    uint64_t replay_log_tail(const SequenceCheckpoint& checkpoint);
     
     /**
      * Check if we should report statistics
      */
     bool should_report_statistics() const;
-};
\ No newline at end of file
+};
+
+using PacketProcessor = BasicPacketProcessor<ActiveFeedPolicy>;
@@ -0,0 +1,234 @@
+#include "packet_shards.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+// Packets processed per line before a drain pass returns
+constexpr size_t DRAIN_BURST = 256;
+
+} // namespace
+
+PacketShards::PacketShards(int shards, bool resume) : running_(false) {
+    const RuntimeConfig& config = runtime_config();
+    block_on_full_ = config.block_on_full_queue;
+    wait_strategy_ = config.zmq_wait_strategy;
+    spin_iterations_ = config.zmq_spin_iterations;
+    poll_timeout_ms_ = config.zmq_poll_timeout_ms;
+
+    for (int i = 0; i < shards; i++) {
+        auto shard = std::make_unique<Shard>();
+        shard->index = i;
+#ifdef RUNTIME_FEED_POLICY
+        shard->processor = std::make_unique<PacketProcessor>(RuntimeFeedPolicy::from_config(config), i);
+#else
+        shard->processor = std::make_unique<PacketProcessor>(ActiveFeedPolicy(), i);
+#endif
+        shard->processor->start_checkpointing(resume);
+        shard->processor->start_gap_recovery();
+        shard->processor->start_snapshot_recovery();
+        for (auto& queue : shard->queues) {
+            queue = std::make_unique<SpscQueue<QueuedPacket>>(config.zmq_shard_queue_packets);
+        }
+        shard->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (shard->event_fd < 0) {
+            throw std::runtime_error("eventfd: " + std::string(strerror(errno)));
+        }
+        shards_.push_back(std::move(shard));
+    }
+}
+
+PacketShards::~PacketShards() {
+    stop();
+    for (auto& shard : shards_) {
+        close(shard->event_fd);
+    }
+}
+
+void PacketShards::start() {
+    running_ = true;
+    for (auto& shard : shards_) {
+        shard->thread = std::thread(&PacketShards::run, this, std::ref(*shard));
+    }
+}
+
+void PacketShards::stop() {
+    running_ = false;
+    for (auto& shard : shards_) {
+        uint64_t one = 1;
+        ssize_t ignored = write(shard->event_fd, &one, sizeof(one));
+        (void)ignored;
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+void PacketShards::submit(const ZmqPacket& packet) {
+    uint8_t unit = 0;
+    if (packet.len >= static_cast<int>(sizeof(CboeSequencedUnitHeader))) {
+        unit = static_cast<uint8_t>(packet.data[offsetof(CboeSequencedUnitHeader, hdr_unit)]);
+    }
+    Shard& shard = *shards_[unit % shards_.size()];
+    SpscQueue<QueuedPacket>& queue = *shard.queues[packet.line];
+
+    QueuedPacket* slot = queue.claim();
+    while (!slot) {
+        if (!block_on_full_) {
+            shard.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::this_thread::yield();
+        slot = queue.claim();
+    }
+    // Datagrams never exceed MAX_BUF; longer unframed messages are cut there
+    uint16_t len = static_cast<uint16_t>(std::clamp(packet.len, 0, Config::MAX_BUF));
+    slot->packet_id = static_cast<uint32_t>(packet.packet_id);
+    slot->port = packet.port;
+    slot->len = len;
+    slot->src_ip = packet.src_ip;
+    slot->rx_timestamp_ns = packet.rx_timestamp_ns;
+    slot->arrival_ns = packet.rx_timestamp_ns;
+    if (slot->arrival_ns == 0) {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        slot->arrival_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+    }
+    memcpy(slot->data, packet.data, len);
+    queue.publish();
+
+    // Pairs with the fence in wait_for_work(): either the shard sees this packet
+    // before blocking, or this load sees it asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (shard.sleeping.load(std::memory_order_relaxed)) {
+        uint64_t one = 1;
+        ssize_t ignored = write(shard.event_fd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+size_t PacketShards::drain(Shard& shard) {
+    const QueuedPacket* heads[LINES];
+    for (int line = 0; line < LINES; line++) {
+        heads[line] = shard.queues[line]->front();
+    }
+    size_t processed = 0;
+    while (processed < DRAIN_BURST * LINES) {
+        int line = -1;
+        for (int candidate = 0; candidate < LINES; candidate++) {
+            if (heads[candidate] && (line < 0 || heads[candidate]->arrival_ns < heads[line]->arrival_ns)) {
+                line = candidate;
+            }
+        }
+        if (line < 0) {
+            break;
+        }
+        const QueuedPacket* packet = heads[line];
+        shard.processor->process_packet(static_cast<int>(packet->packet_id), packet->port, packet->data,
+                                        packet->len, packet->src_ip, packet->rx_timestamp_ns);
+        shard.queues[line]->pop();
+        heads[line] = shard.queues[line]->front();
+        processed++;
+    }
+    return processed;
+}
+
+void PacketShards::run(Shard& shard) {
+    uint32_t empty_passes = 0;
+    while (true) {
+        // Receive threads are stopped before running_ is cleared, so once
+        // it is clear a pass that finds nothing has seen the last packet
+        bool stopping = !running_.load();
+        if (drain(shard) > 0) {
+            empty_passes = 0;
+            continue;
+        }
+        if (stopping) {
+            break;
+        }
+
+        int service_ms = shard.processor->service();
+        if (wait_strategy_ == ZmqWaitStrategy::SPIN ||
+            (wait_strategy_ == ZmqWaitStrategy::SPIN_THEN_POLL && ++empty_passes < spin_iterations_)) {
+            continue;
+        }
+        wait_for_work(shard, service_ms >= 0 ? std::min(service_ms, poll_timeout_ms_) : poll_timeout_ms_);
+    }
+}
+
+void PacketShards::wait_for_work(Shard& shard, int timeout_ms) {
+    shard.sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool idle = running_.load();
+    for (auto& queue : shard.queues) {
+        idle = idle && queue->empty();
+    }
+    if (idle) {
+        struct pollfd fds[2] = {{shard.event_fd, POLLIN, 0}, {shard.processor->wakeup_fd(), POLLIN, 0}};
+        poll(fds, fds[1].fd >= 0 ? 2 : 1, timeout_ms);
+    }
+    shard.sleeping.store(false, std::memory_order_relaxed);
+    uint64_t value;
+    ssize_t ignored = read(shard.event_fd, &value, sizeof(value));
+    (void)ignored;
+}
+
+void PacketShards::flush_logs() {
+    for (auto& shard : shards_) {
+        shard->processor->flush_logs();
+    }
+}
+
+void PacketShards::save_checkpoint() {
+    for (auto& shard : shards_) {
+        shard->processor->save_checkpoint();
+    }
+}
+
+void PacketShards::close_logs(const std::array<uint64_t, 256>& unread_by_unit,
+                              const std::vector<uint64_t>& dropped_before) {
+    for (auto& shard : shards_) {
+        uint64_t shutdown_lost = shard->dropped.load(std::memory_order_relaxed) - dropped_before[shard->index];
+        for (size_t unit = shard->index; unit < unread_by_unit.size(); unit += shards_.size()) {
+            shutdown_lost += unread_by_unit[unit];
+        }
+        shard->processor->close_log(shutdown_lost);
+    }
+}
+
+void PacketShards::print_performance_report() const {
+    for (const auto& shard : shards_) {
+        if (shards_.size() > 1) {
+            std::cout << "Shard " << shard->index << ":" << std::endl;
+        }
+        shard->processor->print_performance_report();
+    }
+    uint64_t lost = dropped();
+    if (lost > 0) {
+        std::cout << lost << " packets dropped at full shard queues" << std::endl;
+    }
+}
+
+std::vector<uint64_t> PacketShards::dropped_by_shard() const {
+    std::vector<uint64_t> dropped;
+    for (const auto& shard : shards_) {
+        dropped.push_back(shard->dropped.load(std::memory_order_relaxed));
+    }
+    return dropped;
+}
+
+uint64_t PacketShards::dropped() const {
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        total += shard->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "packet_processor.h"
+#include "runtime_config.h"
+#include "spsc_queue.h"
+#include "zmq_network_handler.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Unit-sharded packet processing for packet_logger_zmq
+ *
+ * Each shard is a PacketProcessor with its own sequence trackers, binary log
+ * file, checkpoint file and recovery sessions, running on its own thread.
+ * Unit u belongs to shard u % zmq_shards, so a unit is only ever sequenced
+ * by one shard. Receive threads copy packets into one SpscQueue per
+ * (receive line, shard). The shard always takes whichever queue head arrived
+ * first (by the bridge's receive time, or the time submit() saw the packet
+ * when there is none), so a unit's packets are sequenced in arrival order
+ * across both lines, as far as both lines have queued them.
+ *
+ * A shard that finds its queues empty waits as set by zmq_wait_strategy,
+ * blocking on an eventfd that submit() signals only while the shard sleeps.
+ */
+class PacketShards {
+public:
+    static constexpr int LINES = 2;
+
+    /**
+     * Create the shards, restore their checkpoints and start their recovery clients
+     * @param resume false to ignore existing checkpoints (--fresh)
+     */
+    PacketShards(int shards, bool resume);
+    ~PacketShards();
+
+    PacketShards(const PacketShards&) = delete;
+    PacketShards& operator=(const PacketShards&) = delete;
+
+    /**
+     * Start the processing threads
+     */
+    void start();
+
+    /**
+     * Queue a packet for its unit's shard (receive thread of packet.line)
+     * With block_on_full_queue the call waits for room, otherwise a packet
+     * arriving at a full queue is dropped and counted.
+     */
+    void submit(const ZmqPacket& packet);
+
+    /**
+     * Process everything still queued, then stop the processing threads
+     * Call after the receive threads have stopped.
+     */
+    void stop();
+
+    void flush_logs();
+    void save_checkpoint();
+    void print_performance_report() const;
+
+    /**
+     * Write every shard's log footer and index (after stop())
+     * Each footer counts only the shard's own losses: the unread packets of
+     * its units, and what its queues dropped since dropped_before.
+     * @param unread_by_unit Packets left unread by the receive threads, per unit
+     * @param dropped_before dropped_by_shard() when shutdown began
+     */
+    void close_logs(const std::array<uint64_t, 256>& unread_by_unit, const std::vector<uint64_t>& dropped_before);
+
+    /**
+     * Packets dropped at full shard queues
+     */
+    uint64_t dropped() const;
+
+    /**
+     * Packets dropped at full queues, per shard
+     */
+    std::vector<uint64_t> dropped_by_shard() const;
+
+    int size() const { return static_cast<int>(shards_.size()); }
+
+private:
+    struct QueuedPacket {
+        uint32_t packet_id;
+        uint16_t port;
+        uint16_t len;
+        uint32_t src_ip;
+        uint64_t rx_timestamp_ns;
+        uint64_t arrival_ns;        // Merge key across lines: rx_timestamp_ns, or CLOCK_REALTIME in submit()
+        char data[Config::MAX_BUF];
+    };
+
+    struct Shard {
+        int index;
+        std::unique_ptr<PacketProcessor> processor;
+        std::unique_ptr<SpscQueue<QueuedPacket>> queues[LINES];
+        std::thread thread;
+        int event_fd = -1;                      // Signalled by submit() while sleeping
+        std::atomic<bool> sleeping{false};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<bool> running_;
+
+    // Settings (copied at construction)
+    bool block_on_full_;
+    ZmqWaitStrategy wait_strategy_;
+    uint32_t spin_iterations_;
+    int poll_timeout_ms_;
+
+    void run(Shard& shard);
+
+    /**
+     * Process up to a burst of queued packets per line, oldest arrival first
+     * @return Number of packets processed
+     */
+    size_t drain(Shard& shard);
+
+    /**
+     * Block until submit() signals, recovery data arrives or timeout_ms passes
+     */
+    void wait_for_work(Shard& shard, int timeout_ms);
+};
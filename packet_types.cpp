@@ -59,6 +59,52 @@ PacketType classify_packet_type(uint32_t seq, uint8_t count, int len) {
     return PacketType::DATA;
 }
 
+/**
+ * Validate the sequenced unit header against the received length
+ */
+bool validate_packet(const char* buffer, int len) {
+    if (len < static_cast<int>(sizeof(CboeSequencedUnitHeader))) {
+        return false;
+    }
+    
+    const CboeSequencedUnitHeader* header = reinterpret_cast<const CboeSequencedUnitHeader*>(buffer);
+    uint16_t declared_length = le16toh_safe(header->hdr_length);
+    
+    // Basic sanity checks
+    if (declared_length == 0 || declared_length > Config::MAX_BUF) {
+        return false;
+    }
+    
+    // Length should be reasonable compared to actual received length
+    if (static_cast<int>(declared_length) > len + 100) { // Allow some tolerance
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Find Unit Clear and End of Session messages in a sequenced packet
+ * Walks the message length bytes only; stops at the first malformed message.
+ */
+uint8_t scan_session_events(const char* buffer, int len, uint8_t count) {
+    uint8_t events = SessionEvent::NONE;
+    int offset = sizeof(CboeSequencedUnitHeader);
+    for (uint8_t i = 0; i < count && offset + static_cast<int>(sizeof(CboeMessageHeader)) <= len; i++) {
+        const CboeMessageHeader* message = reinterpret_cast<const CboeMessageHeader*>(buffer + offset);
+        if (message->message_type == SessionEvent::UNIT_CLEAR_TYPE) {
+            events |= SessionEvent::UNIT_CLEAR;
+        } else if (message->message_type == SessionEvent::END_OF_SESSION_TYPE) {
+            events |= SessionEvent::END_OF_SESSION;
+        }
+        if (message->length < sizeof(CboeMessageHeader)) {
+            break;
+        }
+        offset += message->length;
+    }
+    return events;
+}
+
 /**
  * Convert string IP to binary format for compact storage
  */
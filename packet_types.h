@@ -10,6 +10,8 @@ namespace Config {
     constexpr uint16_t PORT2 = 30502;
     constexpr int MAX_BUF = 2048;
     constexpr bool SKIP_HEARTBEATS = true;
+    constexpr uint16_t MAX_LOGGED_PAYLOAD = 256;         // Payload bytes stored per binary record
+    constexpr bool LINE_ARBITRATION = false;             // Sequence both ports as one feed, drop the later copy
     
     // Binary logging configuration - optimized for 14M packets
     constexpr size_t LOG_FILE_SIZE = 500 * 1024 * 1024;  // 500MB per file
@@ -18,6 +20,33 @@ namespace Config {
     constexpr int ASYNC_THREADS = 4;                     // 4 background threads
     constexpr int STATS_INTERVAL = 100000;              // Report every 100K packets
     constexpr int FLUSH_INTERVAL = 1000000;             // Force flush every 1M packets
+    
+    // Sequence state checkpoints for warm restarts
+    constexpr int CHECKPOINT_INTERVAL_MS = 1000;        // Snapshot trackers every second
+    constexpr int CHECKPOINT_MAX_AGE_S = 12 * 3600;     // Older checkpoints are ignored on startup
+    constexpr int CHECKPOINT_MARKER_TIMEOUT_MS = 5000;  // Longest wait for a checkpoint's marker to reach the log file
+    constexpr int CHECKPOINT_BARRIER_WAIT_US = 2000;    // Longest a writer thread waits for the others at a marker
+    
+    // Session rollover detection (see BasicSequenceManager::determine_order_status)
+    constexpr uint32_t SESSION_START_WINDOW = 1000;      // A new session's first packet is at or below this sequence
+    constexpr uint32_t SESSION_RESET_MIN_JUMP = 100000;  // Backward jump treated as a reset without any marker
+    
+    // Tracker protection against corrupt or spoofed sequence numbers
+    constexpr uint32_t MAX_SEQUENCE_JUMP = 1000000;      // Larger forward jumps are quarantined
+    constexpr int QUARANTINE_CONFIRM_PACKETS = 3;        // Consecutive packets that make a jump plausible
+    constexpr size_t MAX_PENDING_SEQUENCES = 100000;     // Out-of-order entries kept per tracker
+    
+    // zmq_bridge framing; larger than any valid hdr_length, so framed and raw datagrams can't be confused
+    constexpr uint16_t BRIDGE_HEADER_MAGIC = 0xBD1E;
+    
+    // packet_logger_zmq: longest time spent counting frames still queued at the shutdown drain deadline
+    constexpr int SHUTDOWN_DISCARD_MS = 200;
+    
+    // Payload marker of the footer record closing a binary log on a clean shutdown
+    constexpr uint32_t LOG_FOOTER_MAGIC = 0x464F4F54;   // "FOOT"
+    
+    // Marker of the send timestamp load generators append after hdr_length
+    constexpr uint32_t SEND_STAMP_MAGIC = 0x504D5453;   // "STMP"
 }
 
 // CBOE Sequenced Unit Header structure (packed to match network format)
@@ -50,14 +79,193 @@ struct BinaryLogRecord {
     uint16_t payload_length;    // 2 bytes - actual payload length stored
     // Variable length payload follows in the same log entry
 } __attribute__((packed));
+
+// Payload of the FOOTER record; the record itself has sequence 0 and unit 0
+struct LogFooter {
+    uint32_t magic;                 // Config::LOG_FOOTER_MAGIC
+    uint64_t records;               // Records the logger wrote before the footer since it started
+    uint64_t first_timestamp_ns;    // Of those records, 0 if there were none
+    uint64_t last_timestamp_ns;
+    uint64_t shutdown_lost;         // Packets received but not logged while shutting down
+} __attribute__((packed));
+
+// Send time a load generator appends to a datagram, after the hdr_length bytes
+// of the PITCH packet, so parsers that follow hdr_length never see it
+struct SendStamp {
+    uint32_t magic;             // Config::SEND_STAMP_MAGIC
+    uint64_t send_tsc;          // TscClock::now() when the packet was handed to the transport
+} __attribute__((packed));
+
+// Receive metadata zmq_bridge puts in front of every forwarded datagram
+struct BridgeHeader {
+    uint16_t magic;             // Config::BRIDGE_HEADER_MAGIC
+    uint16_t payload_length;    // Datagram bytes following the header
+    uint16_t ingress_port;      // UDP port the datagram arrived on
+    uint16_t src_port;          // Sender port (host byte order)
+    uint32_t src_ip;            // Sender address (network byte order)
+    uint64_t rx_timestamp_ns;   // Kernel receive time (CLOCK_REALTIME), 0 if unavailable
+    uint64_t bridge_sequence;   // Per ingress port, starting at 1; a jump means the bridge dropped frames
+} __attribute__((packed));
+
+// Gap Request Proxy (GRP) session messages, carried in sequenced units with unit 0 / sequence 0
+// (Login and Login Response are shared with spin server sessions)
+struct GrpLoginMessage {
+    uint8_t length;             // 22
+    uint8_t message_type;       // 0x01
+    char session_sub_id[4];
+    char username[4];
+    char filler[2];
+    char password[10];
+};
+
+struct GrpLoginResponseMessage {
+    uint8_t length;             // 3
+    uint8_t message_type;       // 0x02
+    uint8_t status;             // 'A' accepted, 'N' not authorized, 'B' session in use, 'S' invalid session
+};
+
+struct GrpGapRequestMessage {
+    uint8_t length;             // 9
+    uint8_t message_type;       // 0x03
+    uint8_t unit;
+    uint32_t sequence;          // First missing sequence
+    uint16_t count;             // Number of messages requested
+};
+
+struct GrpGapResponseMessage {
+    uint8_t length;             // 10
+    uint8_t message_type;       // 0x04
+    uint8_t unit;
+    uint32_t sequence;
+    uint16_t count;
+    uint8_t status;             // 'A' accepted, 'O' out of range, 'D'/'M'/'S' daily/minute/second limit,
+                                // 'C' count too large, 'I' invalid unit, 'U' unit unavailable
+};
+
+// Spin server session messages; image messages follow in unsequenced units of the spun unit
+struct SpinImageAvailableMessage {
+    uint8_t length;             // 6
+    uint8_t message_type;       // 0x80
+    uint32_t sequence;          // Last sequence reflected in the image on offer
+};
+
+struct SpinRequestMessage {
+    uint8_t length;             // 6
+    uint8_t message_type;       // 0x81
+    uint32_t sequence;          // Sequence from a Spin Image Available message
+};
+
+struct SpinResponseMessage {
+    uint8_t length;             // 11
+    uint8_t message_type;       // 0x82
+    uint32_t sequence;
+    uint32_t order_count;       // Messages in the image
+    uint8_t status;             // 'A' accepted, 'O' out of range, 'S' spin already in progress
+};
+
+struct SpinFinishedMessage {
+    uint8_t length;             // 6
+    uint8_t message_type;       // 0x83
+    uint32_t sequence;          // Image is current up to and including this sequence
+};
+
+// Order book messages, as produced by the synthetic feed (pitch_generator.h)
+// Prices are binary with 4 implied decimals; symbols are space padded.
+struct PitchAddOrderMessage {
+    uint8_t length;             // 34
+    uint8_t message_type;       // 0x37
+    uint32_t time_offset;       // Nanoseconds into the current second
+    uint64_t order_id;
+    char side;                  // 'B' or 'S'
+    uint32_t quantity;
+    char symbol[6];
+    uint64_t price;
+    uint8_t flags;
+};
+
+struct PitchOrderExecutedMessage {
+    uint8_t length;             // 27
+    uint8_t message_type;       // 0x38
+    uint32_t time_offset;
+    uint64_t order_id;
+    uint32_t executed_quantity;
+    uint64_t execution_id;
+    char trade_condition;
+};
+
+struct PitchReduceSizeMessage {
+    uint8_t length;             // 18
+    uint8_t message_type;       // 0x39
+    uint32_t time_offset;
+    uint64_t order_id;
+    uint32_t cancelled_quantity;
+};
+
+struct PitchModifyOrderMessage {
+    uint8_t length;             // 27
+    uint8_t message_type;       // 0x3A
+    uint32_t time_offset;
+    uint64_t order_id;
+    uint32_t quantity;          // New displayed quantity
+    uint64_t price;             // New price
+    uint8_t flags;
+};
+
+struct PitchDeleteOrderMessage {
+    uint8_t length;             // 14
+    uint8_t message_type;       // 0x3C
+    uint32_t time_offset;
+    uint64_t order_id;
+};
+
+struct PitchTradeMessage {
+    uint8_t length;             // 42
+    uint8_t message_type;       // 0x3D
+    uint32_t time_offset;
+    uint64_t order_id;          // 0 for a trade against a non-displayed order
+    char side;
+    uint32_t quantity;
+    char symbol[6];
+    uint64_t price;
+    uint64_t execution_id;
+    char trade_condition;
+};
 #pragma pack(pop)
 
+// Order book message type identifiers (see CBOE_MESSAGE_TYPES)
+namespace PitchMessageType {
+    constexpr uint8_t ADD_ORDER = 0x37;
+    constexpr uint8_t ORDER_EXECUTED = 0x38;
+    constexpr uint8_t REDUCE_SIZE = 0x39;
+    constexpr uint8_t MODIFY_ORDER = 0x3A;
+    constexpr uint8_t DELETE_ORDER = 0x3C;
+    constexpr uint8_t TRADE = 0x3D;
+}
+
+// Spin message type identifiers (see CBOE_MESSAGE_TYPES)
+namespace SpinMessageType {
+    constexpr uint8_t IMAGE_AVAILABLE = 0x80;
+    constexpr uint8_t REQUEST = 0x81;
+    constexpr uint8_t RESPONSE = 0x82;
+    constexpr uint8_t FINISHED = 0x83;
+}
+
+// GRP message type identifiers (see CBOE_MESSAGE_TYPES)
+namespace GrpMessageType {
+    constexpr uint8_t LOGIN = 0x01;
+    constexpr uint8_t LOGIN_RESPONSE = 0x02;
+    constexpr uint8_t GAP_REQUEST = 0x03;
+    constexpr uint8_t GAP_RESPONSE = 0x04;
+}
+
 // Packet type enumeration for binary storage
 enum class PacketType : uint8_t {
     HEARTBEAT = 0,
     ADMIN = 1,
     UNSEQUENCED = 2,
-    DATA = 3
+    DATA = 3,
+    FOOTER = 4,         // Last record of a log closed by a clean shutdown (LogFooter payload)
+    CHECKPOINT = 5      // Position of a sequence checkpoint; timestamp_ns is the checkpoint's, no payload
 };
 
 // Order status enumeration for binary storage
@@ -67,9 +275,21 @@ enum class OrderStatus : uint8_t {
     SEQUENCED_IN_ORDER = 2,
     SEQUENCED_OUT_OF_ORDER_LATE = 3,
     SEQUENCED_OUT_OF_ORDER_EARLY = 4,
-    SEQUENCED_DUPLICATE = 5
+    SEQUENCED_DUPLICATE = 5,
+    SEQUENCED_RESET = 6,            // First packet of a new session epoch on its line
+    SEQUENCED_QUARANTINED = 7       // Implausible forward jump; not applied to the tracker
 };
 
+// Session boundary messages found in a packet (bit flags)
+namespace SessionEvent {
+    constexpr uint8_t UNIT_CLEAR_TYPE = 0x97;
+    constexpr uint8_t END_OF_SESSION_TYPE = 0x2D;
+    
+    constexpr uint8_t NONE = 0x00;
+    constexpr uint8_t UNIT_CLEAR = 0x01;
+    constexpr uint8_t END_OF_SESSION = 0x02;
+}
+
 // Message type information structure
 struct MessageTypeInfo {
     uint8_t type_id;
@@ -90,6 +310,8 @@ struct SequenceTracker {
 // Function declarations
 const MessageTypeInfo* lookup_message_type(uint8_t type_id);
 PacketType classify_packet_type(uint32_t seq, uint8_t count, int len);
+bool validate_packet(const char* buffer, int len);
+uint8_t scan_session_events(const char* buffer, int len, uint8_t count);
 uint32_t ip_to_binary(const std::string& ip_str);
 
 // Safe endian conversion functions
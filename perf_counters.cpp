@@ -0,0 +1,160 @@
+#include "perf_counters.h"
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+int open_event(PerfCounters::Event event, int group_fd) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    switch (event) {
+        case PerfCounters::CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case PerfCounters::INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case PerfCounters::LLC_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+        case PerfCounters::BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+    }
+    attr.disabled = group_fd < 0 ? 1 : 0;   // The leader starts the whole group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+inline uint64_t rdpmc(uint32_t counter) {
+    uint32_t low, high;
+    asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(counter));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters(std::initializer_list<Event> events) : events_(events) {
+    if (events_.size() > MAX_EVENTS) {
+        throw std::runtime_error("at most 8 events per counter group");
+    }
+    for (Event event : events_) {
+        int fd = open_event(event, fds_.empty() ? -1 : fds_.front());
+        if (fd < 0) {
+            // All or nothing: a partial group would misattribute the report
+            for (int open_fd : fds_) {
+                close(open_fd);
+            }
+            fds_.clear();
+            return;
+        }
+        fds_.push_back(fd);
+    }
+    if (!fds_.empty()) {
+        group_fd_ = fds_.front();
+        ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        map_pages();
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (void* page : pages_) {
+        munmap(page, page_size);
+    }
+    for (int fd : fds_) {
+        close(fd);
+    }
+}
+
+void PerfCounters::map_pages() {
+#if defined(__x86_64__) || defined(__i386__)
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    for (int fd : fds_) {
+        void* page = mmap(nullptr, page_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (page == MAP_FAILED) {
+            return;
+        }
+        pages_.push_back(page);
+        if (!static_cast<const perf_event_mmap_page*>(page)->cap_user_rdpmc) {
+            return;
+        }
+    }
+    rdpmc_ = true;
+#endif
+}
+
+bool PerfCounters::read_rdpmc(uint64_t* values) const {
+#if defined(__x86_64__) || defined(__i386__)
+    for (size_t i = 0; i < pages_.size(); i++) {
+        const volatile perf_event_mmap_page* page = static_cast<const volatile perf_event_mmap_page*>(pages_[i]);
+        uint32_t lock;
+        uint64_t count;
+        // The kernel bumps lock around updates of index and offset
+        do {
+            lock = page->lock;
+            asm volatile("" ::: "memory");
+            uint32_t index = page->index;
+            if (index == 0) {
+                return false;   // Not on the PMU right now
+            }
+            int64_t pmc = static_cast<int64_t>(rdpmc(index - 1));
+            uint16_t width = page->pmc_width;
+            pmc = (pmc << (64 - width)) >> (64 - width);
+            count = page->offset + pmc;
+            asm volatile("" ::: "memory");
+        } while (page->lock != lock);
+        values[i] = count;
+    }
+    return true;
+#else
+    (void)values;
+    return false;
+#endif
+}
+
+void PerfCounters::read(uint64_t* values) const {
+    if (rdpmc_ && read_rdpmc(values)) {
+        return;
+    }
+    // Layout of a PERF_FORMAT_GROUP read: nr, time_enabled, time_running, value[nr]
+    uint64_t buffer[3 + MAX_EVENTS];
+    size_t count = events_.size();
+    if (group_fd_ < 0 ||
+        ::read(group_fd_, buffer, sizeof(uint64_t) * (3 + count)) != static_cast<ssize_t>(sizeof(uint64_t) * (3 + count))) {
+        memset(values, 0, sizeof(uint64_t) * count);
+        return;
+    }
+    uint64_t enabled = buffer[1];
+    uint64_t running = buffer[2];
+    for (size_t i = 0; i < count; i++) {
+        values[i] = running > 0 && running < enabled
+                  ? static_cast<uint64_t>(static_cast<double>(buffer[3 + i]) * enabled / running)
+                  : buffer[3 + i];
+    }
+}
+
+const char* PerfCounters::event_name(Event event) {
+    switch (event) {
+        case CYCLES: return "cycles";
+        case INSTRUCTIONS: return "instructions";
+        case LLC_MISSES: return "LLC misses";
+        case BRANCH_MISSES: return "branch misses";
+    }
+    return "unknown";
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+/**
+ * Hardware performance counters of the calling thread (perf_event_open)
+ *
+ * The events are opened as one group, so they are scheduled onto the PMU
+ * together and a single read() returns all of them for the same interval.
+ * Only user-space work is counted. Where the kernel allows it (x86 with
+ * rdpmc enabled for the event), read() takes the counts with rdpmc from
+ * user space instead of a read() system call, which makes it cheap enough
+ * for per-packet probes. Counters are often unavailable (no PMU in
+ * a VM, perf_event_paranoid, seccomp); available() is then false and read()
+ * returns zeros, so callers need no separate code path.
+ */
+class PerfCounters {
+public:
+    enum Event {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        BRANCH_MISSES
+    };
+
+    static constexpr size_t MAX_EVENTS = 8;
+
+    /**
+     * Open and start the counters for the calling thread
+     * @throws std::runtime_error with more than MAX_EVENTS events
+     */
+    explicit PerfCounters(std::initializer_list<Event> events);
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return group_fd_ >= 0; }
+
+    size_t size() const { return events_.size(); }
+
+    /**
+     * Current counts, in the order the events were given
+     * With the system call, counts are scaled up if the group was
+     * multiplexed off the PMU for part of the time.
+     */
+    void read(uint64_t* values) const;
+
+    /**
+     * Short name of an event for reports, e.g. "cycles"
+     */
+    static const char* event_name(Event event);
+
+private:
+    std::vector<Event> events_;
+    std::vector<int> fds_;
+    std::vector<void*> pages_;  // perf_event_mmap_page per event, for rdpmc
+    int group_fd_ = -1;
+    bool rdpmc_ = false;
+
+    /**
+     * Map each event's control page; rdpmc_ is set only if every event allows rdpmc
+     */
+    void map_pages();
+
+    bool read_rdpmc(uint64_t* values) const;
+};
@@ -0,0 +1,415 @@
+#include "packet_types.h"
+#include "pitch_generator.h"
+#include "shm_ring.h"
+#include "traffic_shaper.h"
+#include <zmq.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <netinet/in.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Synthetic PITCH feed source (pitch_generator.h)
+ *
+ * Sends every packet on both lines, like the exchange's A and B feeds:
+ * - udp: to the multicast group on PORT1 and PORT2, for zmq_bridge or
+ *   packet_logger (multicast loopback by default)
+ * - zmq: bridge frames on the bridge's PUSH endpoints, in place of zmq_bridge
+ * - shm: bridge frames into the bridge's shared-memory segment, in place of
+ *   zmq_bridge --transport shm
+ */
+
+namespace {
+
+volatile bool running = true;
+
+const char* const ENDPOINTS[2] = {"ipc:///tmp/cboe_port1.ipc", "ipc:///tmp/cboe_port2.ipc"};
+const uint16_t PORTS[2] = {Config::PORT1, Config::PORT2};
+
+struct Options {
+    PitchGeneratorOptions feed;
+    std::string transport = "udp";
+    std::string interface_ip = "127.0.0.1";   // Multicast interface for udp
+    int lines = 2;
+    uint64_t packets = 0;                     // 0 = until Ctrl+C
+    bool paced = false;
+    RateProfile profile;
+    uint32_t batch = 0;                       // Packets per sendmmsg call or bridge frame, 0 = auto
+    uint32_t burst = 0;                       // Shaper bucket size, 0 = 32 or one batch
+    std::vector<std::string> loss;            // UNIT:PERCENT settings
+    std::vector<std::string> reorder;
+    std::string shm_name = "/cboe_bridge";
+    size_t shm_bytes = 32 * 1024 * 1024;
+};
+
+struct Totals {
+    uint64_t packets = 0;
+    uint64_t messages = 0;
+    uint64_t dropped = 0;     // Datagrams or frame records refused by the transport
+    uint64_t lost = 0;        // Packets left out of a line on purpose (--loss)
+    uint64_t reordered = 0;   // Packets sent one place late on a line (--reorder)
+    double seconds = 0;       // Sending time, transport setup excluded
+};
+
+void signal_handler(int signal) {
+    std::cout << "\nReceived signal " << signal << ", stopping feed..." << std::endl;
+    running = false;
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --transport udp|zmq|shm      Multicast datagrams, or bridge frames over ZeroMQ or shared memory (default udp)" << std::endl;
+    std::cout << "  --units LIST                 Units to generate, e.g. 1,2,3 (default 1)" << std::endl;
+    std::cout << "  --symbols N                  Symbols per unit (default 100)" << std::endl;
+    std::cout << "  --messages N                 Most messages per packet (default 8)" << std::endl;
+    std::cout << "  --packet-bytes N             Largest packet (default 1400)" << std::endl;
+    std::cout << "  --pool N                     Packets generated up front and cycled (default 65536)" << std::endl;
+    std::cout << "  --seed N                     Random seed (default 1)" << std::endl;
+    std::cout << "  --send-stamp                 Append the send time to every packet, for receiver latency" << std::endl;
+    std::cout << "  --packets N                  Packets to send, 0 = until Ctrl+C (default 0)" << std::endl;
+    std::cout << "  --rate N                     Packets per second, same as --profile constant:N (default unpaced)" << std::endl;
+    std::cout << "  --profile SPEC               Rate profile: constant:RATE, step:R1,R2,...:MS," << std::endl;
+    std::cout << "                               auction:BASE:PEAK:MS or trace:FILE" << std::endl;
+    std::cout << "  --burst N                    Most packets sent back to back when paced (default 32 or one batch)" << std::endl;
+    std::cout << "  --loss UNIT:PERCENT          Leave out packets of a unit, on each line independently" << std::endl;
+    std::cout << "  --reorder UNIT:PERCENT       Send packets of a unit after the unit's next packet" << std::endl;
+    std::cout << "  --batch N                    Packets per sendmmsg call or bridge frame (default 32, 1 when paced)" << std::endl;
+    std::cout << "  --lines 1|2                  Send on line A only, or on A and B (default 2)" << std::endl;
+    std::cout << "  --interface IP               Multicast interface for udp (default 127.0.0.1)" << std::endl;
+    std::cout << "  --shm-name NAME              Shared-memory segment, as zmq_bridge (default /cboe_bridge)" << std::endl;
+    std::cout << "  --shm-bytes N                Ring size per line, as zmq_bridge (default 33554432)" << std::endl;
+    std::cout << "  -h, --help                   Show this help message" << std::endl;
+}
+
+uint64_t realtime_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Frame a batch of packets as zmq_bridge does for one line
+ */
+void build_frame(std::vector<char>& frame, const PitchFeedGenerator::Packet* const* packets, size_t count,
+                 int line, uint64_t& bridge_sequence) {
+    frame.clear();
+    uint64_t now = realtime_ns();
+    for (size_t i = 0; i < count; i++) {
+        BridgeHeader header;
+        header.magic = Config::BRIDGE_HEADER_MAGIC;
+        header.payload_length = packets[i]->length;
+        header.ingress_port = PORTS[line];
+        header.src_port = 0;
+        header.src_ip = htonl(INADDR_LOOPBACK);
+        header.rx_timestamp_ns = now;
+        header.bridge_sequence = ++bridge_sequence;
+        const char* bytes = reinterpret_cast<const char*>(&header);
+        frame.insert(frame.end(), bytes, bytes + sizeof(header));
+        frame.insert(frame.end(), packets[i]->data, packets[i]->data + packets[i]->length);
+    }
+}
+
+/**
+ * Take batches from the generator, pace them and hand each line's share to
+ * send(line, packets, count) until opts.packets are sent or Ctrl+C; send
+ * returns the packets it dropped
+ */
+template <typename Send>
+Totals feed(const Options& opts, PitchFeedGenerator& generator, Send&& send) {
+    using Clock = std::chrono::steady_clock;
+    Totals totals;
+    std::unique_ptr<TrafficShaper> shaper;
+    if (opts.paced) {
+        shaper = std::make_unique<TrafficShaper>(opts.profile, opts.burst ? opts.burst : std::max<uint32_t>(opts.batch, 32));
+    }
+    FeedImpairment impairment(opts.feed.seed);
+    for (const std::string& setting : opts.loss) {
+        impairment.set_loss(setting);
+    }
+    for (const std::string& setting : opts.reorder) {
+        impairment.set_reorder(setting);
+    }
+
+    std::vector<const PitchFeedGenerator::Packet*> batch(opts.batch);
+    std::vector<const PitchFeedGenerator::Packet*> line_batch;
+    line_batch.reserve(opts.batch + 256);
+    auto send_lines = [&](bool last) {
+        for (int line = 0; line < opts.lines; line++) {
+            if (!impairment.enabled()) {
+                if (!batch.empty()) {
+                    totals.dropped += send(line, batch.data(), batch.size());
+                }
+                continue;
+            }
+            line_batch.clear();
+            for (const PitchFeedGenerator::Packet* packet : batch) {
+                impairment.apply(line, packet, line_batch);
+            }
+            if (last) {
+                impairment.flush(line, line_batch);
+            }
+            if (!line_batch.empty()) {
+                totals.dropped += send(line, line_batch.data(), line_batch.size());
+            }
+        }
+    };
+
+    auto start = Clock::now();
+    auto next_report = start + std::chrono::seconds(1);
+    uint64_t reported = 0;
+    while (running && (opts.packets == 0 || totals.packets < opts.packets)) {
+        size_t count = opts.batch;
+        if (opts.packets != 0) {
+            count = std::min<uint64_t>(count, opts.packets - totals.packets);
+        }
+        if (shaper) {
+            shaper->acquire(count);
+        }
+        batch.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            batch[i] = &generator.next();
+            totals.messages += batch[i]->count;
+        }
+        send_lines(false);
+        totals.packets += count;
+
+        auto now = Clock::now();
+        if (now >= next_report) {
+            std::cout << "Rate: " << (totals.packets - reported) << " pps";
+            if (shaper) {
+                std::cout << " (profile " << static_cast<uint64_t>(shaper->current_rate()) << " pps)";
+            }
+            std::cout << " | Total: " << totals.packets << " | Dropped: " << totals.dropped << std::endl;
+            reported = totals.packets;
+            next_report += std::chrono::seconds(1);
+        }
+    }
+    // Packets held back for reordering still go out
+    batch.clear();
+    send_lines(true);
+    totals.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    totals.lost = impairment.statistics().lost;
+    totals.reordered = impairment.statistics().reordered;
+    return totals;
+}
+
+Totals run_udp(const Options& opts, PitchFeedGenerator& generator) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        throw std::runtime_error("socket: " + std::string(strerror(errno)));
+    }
+    int loop = 1;
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    struct in_addr interface_addr;
+    interface_addr.s_addr = inet_addr(opts.interface_ip.c_str());
+    setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &interface_addr, sizeof(interface_addr));
+    int bufsize = 8 * 1024 * 1024;
+    setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+
+    struct sockaddr_in destinations[2];
+    for (int line = 0; line < 2; line++) {
+        memset(&destinations[line], 0, sizeof(destinations[line]));
+        destinations[line].sin_family = AF_INET;
+        destinations[line].sin_addr.s_addr = inet_addr(Config::MULTICAST_IP);
+        destinations[line].sin_port = htons(PORTS[line]);
+    }
+
+    std::vector<struct mmsghdr> messages;
+    std::vector<struct iovec> iovecs;
+    Totals totals = feed(opts, generator, [&](int line, const PitchFeedGenerator::Packet* const* packets, size_t n) {
+        messages.resize(n);
+        iovecs.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            iovecs[i] = {packets[i]->data, packets[i]->length};
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_hdr.msg_name = &destinations[line];
+            messages[i].msg_hdr.msg_namelen = sizeof(destinations[line]);
+            messages[i].msg_hdr.msg_iov = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+        size_t sent = 0;
+        while (sent < n) {
+            int result = sendmmsg(sock, messages.data() + sent, n - sent, 0);
+            if (result < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            sent += static_cast<size_t>(result);
+        }
+        return static_cast<uint64_t>(n - sent);
+    });
+    close(sock);
+    return totals;
+}
+
+Totals run_zmq(const Options& opts, PitchFeedGenerator& generator) {
+    void* context = zmq_ctx_new();
+    void* sockets[2] = {nullptr, nullptr};
+    for (int line = 0; line < opts.lines; line++) {
+        sockets[line] = zmq_socket(context, ZMQ_PUSH);
+        int hwm = 1000000;
+        zmq_setsockopt(sockets[line], ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        if (zmq_bind(sockets[line], ENDPOINTS[line]) != 0) {
+            throw std::runtime_error(std::string("Cannot bind ") + ENDPOINTS[line] + ": " + zmq_strerror(zmq_errno()));
+        }
+    }
+    // PULL sockets already waiting reconnect within their reconnect interval
+    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+    std::vector<char> frame;
+    uint64_t bridge_sequence[2] = {0, 0};
+    Totals totals = feed(opts, generator, [&](int line, const PitchFeedGenerator::Packet* const* packets, size_t count) {
+        build_frame(frame, packets, count, line, bridge_sequence[line]);
+        if (zmq_send(sockets[line], frame.data(), frame.size(), ZMQ_DONTWAIT) < 0) {
+            return static_cast<uint64_t>(count);
+        }
+        return uint64_t{0};
+    });
+
+    for (void* socket : sockets) {
+        if (socket) {
+            zmq_close(socket);
+        }
+    }
+    zmq_ctx_destroy(context);
+    return totals;
+}
+
+Totals run_shm(const Options& opts, PitchFeedGenerator& generator) {
+    std::unique_ptr<ShmChannel> channel = ShmChannel::create(opts.shm_name, 2, opts.shm_bytes);
+    std::vector<char> frame;
+    uint64_t bridge_sequence[2] = {0, 0};
+    return feed(opts, generator, [&](int line, const PitchFeedGenerator::Packet* const* packets, size_t count) {
+        build_frame(frame, packets, count, line, bridge_sequence[line]);
+        bool written = channel->write(line, frame.data(), frame.size());
+        channel->notify();
+        return written ? uint64_t{0} : static_cast<uint64_t>(count);
+    });
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                print_usage(argv[0]);
+                return 0;
+            } else if (arg == "--transport" && i + 1 < argc) {
+                opts.transport = argv[++i];
+                if (opts.transport != "udp" && opts.transport != "zmq" && opts.transport != "shm") {
+                    std::cerr << "--transport must be udp, zmq or shm" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--units" && i + 1 < argc) {
+                opts.feed.units.clear();
+                std::stringstream list(argv[++i]);
+                std::string item;
+                while (std::getline(list, item, ',')) {
+                    opts.feed.units.push_back(static_cast<uint8_t>(std::stoul(item)));
+                }
+            } else if (arg == "--symbols" && i + 1 < argc) {
+                opts.feed.symbols = std::stoul(argv[++i]);
+            } else if (arg == "--messages" && i + 1 < argc) {
+                opts.feed.max_messages = std::stoul(argv[++i]);
+            } else if (arg == "--packet-bytes" && i + 1 < argc) {
+                opts.feed.max_packet_bytes = std::stoul(argv[++i]);
+            } else if (arg == "--pool" && i + 1 < argc) {
+                opts.feed.pool_packets = std::stoull(argv[++i]);
+            } else if (arg == "--seed" && i + 1 < argc) {
+                opts.feed.seed = std::stoul(argv[++i]);
+            } else if (arg == "--send-stamp") {
+                opts.feed.send_stamp = true;
+            } else if (arg == "--packets" && i + 1 < argc) {
+                opts.packets = std::stoull(argv[++i]);
+            } else if (arg == "--rate" && i + 1 < argc) {
+                opts.profile = RateProfile::parse(std::string("constant:") + argv[++i]);
+                opts.paced = true;
+            } else if (arg == "--profile" && i + 1 < argc) {
+                opts.profile = RateProfile::parse(argv[++i]);
+                opts.paced = true;
+            } else if (arg == "--burst" && i + 1 < argc) {
+                opts.burst = std::stoul(argv[++i]);
+            } else if (arg == "--loss" && i + 1 < argc) {
+                opts.loss.push_back(argv[++i]);
+            } else if (arg == "--reorder" && i + 1 < argc) {
+                opts.reorder.push_back(argv[++i]);
+            } else if (arg == "--batch" && i + 1 < argc) {
+                opts.batch = std::max<uint32_t>(std::stoul(argv[++i]), 1);
+            } else if (arg == "--lines" && i + 1 < argc) {
+                opts.lines = std::clamp(std::stoi(argv[++i]), 1, 2);
+            } else if (arg == "--interface" && i + 1 < argc) {
+                opts.interface_ip = argv[++i];
+            } else if (arg == "--shm-name" && i + 1 < argc) {
+                opts.shm_name = argv[++i];
+            } else if (arg == "--shm-bytes" && i + 1 < argc) {
+                opts.shm_bytes = std::stoull(argv[++i]);
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+
+        if (opts.batch == 0) {
+            opts.batch = opts.paced ? 1 : 32;
+        }
+
+        signal(SIGINT, signal_handler);
+        signal(SIGTERM, signal_handler);
+
+        auto generated = std::chrono::steady_clock::now();
+        PitchFeedGenerator generator(opts.feed);
+        double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - generated).count();
+        std::cout << "PITCH feed: " << opts.feed.units.size() << " units x " << opts.feed.symbols << " symbols, pool of "
+                  << generator.pool_packets() << " packets / " << generator.pool_messages() << " messages ("
+                  << generator.pool_bytes() / 1024 << "KB, built in " << static_cast<int>(build_ms) << "ms)" << std::endl;
+        std::cout << "Sending over " << opts.transport << " on " << opts.lines << " line(s), "
+                  << (opts.paced ? "up to " + std::to_string(static_cast<uint64_t>(opts.profile.peak_rate())) + " pps"
+                                 : std::string("unpaced")) << std::endl;
+
+        Totals totals;
+        if (opts.transport == "zmq") {
+            totals = run_zmq(opts, generator);
+        } else if (opts.transport == "shm") {
+            totals = run_shm(opts, generator);
+        } else {
+            totals = run_udp(opts, generator);
+        }
+        double seconds = std::max(totals.seconds, 1e-9);
+
+        std::cout << "Sent " << totals.packets << " packets (" << totals.messages << " messages) per line in "
+                  << seconds << "s: " << static_cast<uint64_t>(totals.packets / seconds) << " pps, "
+                  << static_cast<uint64_t>(totals.messages / seconds) << " messages/s, " << totals.dropped
+                  << " dropped" << std::endl;
+        if (totals.lost != 0 || totals.reordered != 0) {
+            std::cout << "Impairment: " << totals.lost << " packets left out of a line, " << totals.reordered
+                      << " reordered" << std::endl;
+        }
+        std::cout << "Next sequence per unit:";
+        for (uint8_t unit : opts.feed.units) {
+            std::cout << " " << static_cast<int>(unit) << ":" << generator.next_sequence(unit);
+        }
+        std::cout << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
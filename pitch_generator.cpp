@@ -0,0 +1,243 @@
+#include "pitch_generator.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr uint64_t TICK = 100;                  // $0.01 with 4 implied decimals
+constexpr uint32_t LOT = 100;
+constexpr uint32_t MAX_SYMBOLS = 26 * 26 * 26;  // Three letters per unit
+constexpr uint32_t MAX_ORDERS_PER_SYMBOL = 20;  // Adds turn into deletes beyond this depth
+
+struct Symbol {
+    char name[6];
+    uint64_t base_price;
+};
+
+struct Order {
+    uint64_t id;
+    uint32_t symbol;
+    char side;
+    uint32_t quantity;
+    uint64_t price;
+};
+
+/**
+ * Book of one unit; live holds every order that is still resting
+ */
+struct UnitBook {
+    uint8_t unit;
+    std::vector<Symbol> symbols;
+    std::vector<Order> live;
+    uint64_t next_order_id;
+    uint64_t next_execution_id = 1;
+};
+
+template <typename Message>
+void append(std::vector<char>& out, const Message& message) {
+    const char* bytes = reinterpret_cast<const char*>(&message);
+    out.insert(out.end(), bytes, bytes + sizeof(message));
+}
+
+template <typename Message>
+Message make_message(uint8_t type, uint32_t time_offset) {
+    Message message{};
+    message.length = sizeof(Message);
+    message.message_type = type;
+    message.time_offset = time_offset;
+    return message;
+}
+
+/**
+ * Remove live[index] (order does not matter)
+ */
+void retire(UnitBook& book, size_t index) {
+    book.live[index] = book.live.back();
+    book.live.pop_back();
+}
+
+void append_add(UnitBook& book, std::mt19937_64& rng, uint32_t time_offset, std::vector<char>& out) {
+    Order order;
+    order.id = book.next_order_id++;
+    order.symbol = static_cast<uint32_t>(rng() % book.symbols.size());
+    order.side = (rng() & 1) ? 'B' : 'S';
+    order.quantity = LOT * static_cast<uint32_t>(1 + rng() % 10);
+    uint64_t offset = TICK * (1 + rng() % 50);
+    const Symbol& symbol = book.symbols[order.symbol];
+    order.price = order.side == 'B' ? symbol.base_price - offset : symbol.base_price + offset;
+    book.live.push_back(order);
+
+    auto message = make_message<PitchAddOrderMessage>(PitchMessageType::ADD_ORDER, time_offset);
+    message.order_id = order.id;
+    message.side = order.side;
+    message.quantity = order.quantity;
+    memcpy(message.symbol, symbol.name, sizeof(message.symbol));
+    message.price = order.price;
+    append(out, message);
+}
+
+void append_delete(UnitBook& book, size_t index, uint32_t time_offset, std::vector<char>& out) {
+    auto message = make_message<PitchDeleteOrderMessage>(PitchMessageType::DELETE_ORDER, time_offset);
+    message.order_id = book.live[index].id;
+    append(out, message);
+    retire(book, index);
+}
+
+/**
+ * Append one message that is consistent with the book
+ */
+void append_message(UnitBook& book, std::mt19937_64& rng, uint32_t time_offset, std::vector<char>& out) {
+    uint32_t roll = static_cast<uint32_t>(rng() % 100);
+    if (book.live.empty() || roll < 40) {
+        if (book.live.size() < book.symbols.size() * MAX_ORDERS_PER_SYMBOL) {
+            append_add(book, rng, time_offset, out);
+            return;
+        }
+        roll = 80;   // Book is deep enough: delete instead
+    }
+
+    size_t index = rng() % book.live.size();
+    Order& order = book.live[index];
+    if (roll < 55) {
+        auto message = make_message<PitchModifyOrderMessage>(PitchMessageType::MODIFY_ORDER, time_offset);
+        order.quantity = LOT * static_cast<uint32_t>(1 + rng() % 10);
+        order.price = (rng() & 1) ? order.price + TICK : std::max(order.price - TICK, TICK);
+        message.order_id = order.id;
+        message.quantity = order.quantity;
+        message.price = order.price;
+        append(out, message);
+    } else if (roll < 65) {
+        // Reducing by the whole remainder removes the order
+        auto message = make_message<PitchReduceSizeMessage>(PitchMessageType::REDUCE_SIZE, time_offset);
+        uint32_t cancelled = LOT * static_cast<uint32_t>(1 + rng() % (order.quantity / LOT));
+        message.order_id = order.id;
+        message.cancelled_quantity = cancelled;
+        append(out, message);
+        order.quantity -= cancelled;
+        if (order.quantity == 0) {
+            retire(book, index);
+        }
+    } else if (roll < 80) {
+        auto message = make_message<PitchOrderExecutedMessage>(PitchMessageType::ORDER_EXECUTED, time_offset);
+        uint32_t executed = std::min(order.quantity, LOT * static_cast<uint32_t>(1 + rng() % 3));
+        message.order_id = order.id;
+        message.executed_quantity = executed;
+        message.execution_id = book.next_execution_id++;
+        message.trade_condition = ' ';
+        append(out, message);
+        order.quantity -= executed;
+        if (order.quantity == 0) {
+            retire(book, index);
+        }
+    } else if (roll < 95) {
+        append_delete(book, index, time_offset, out);
+    } else {
+        // Execution against a non-displayed order
+        const Symbol& symbol = book.symbols[rng() % book.symbols.size()];
+        auto message = make_message<PitchTradeMessage>(PitchMessageType::TRADE, time_offset);
+        message.order_id = 0;
+        message.side = (rng() & 1) ? 'B' : 'S';
+        message.quantity = LOT * static_cast<uint32_t>(1 + rng() % 5);
+        memcpy(message.symbol, symbol.name, sizeof(message.symbol));
+        message.price = symbol.base_price;
+        message.execution_id = book.next_execution_id++;
+        message.trade_condition = ' ';
+        append(out, message);
+    }
+}
+
+} // namespace
+
+PitchFeedGenerator::PitchFeedGenerator(const PitchGeneratorOptions& options) : send_stamp_(options.send_stamp) {
+    size_t trailer = send_stamp_ ? sizeof(SendStamp) : 0;
+    // Largest message is a Trade
+    if (options.units.empty() || options.symbols == 0 || options.symbols > MAX_SYMBOLS ||
+        options.max_messages == 0 || options.max_messages > 255 || options.pool_packets == 0 ||
+        options.max_packet_bytes < sizeof(CboeSequencedUnitHeader) + sizeof(PitchTradeMessage) + trailer ||
+        options.max_packet_bytes > static_cast<size_t>(Config::MAX_BUF)) {
+        throw std::runtime_error("invalid feed generator options (units, symbols 1-" + std::to_string(MAX_SYMBOLS) +
+                                 ", max messages 1-255, packet bytes " +
+                                 std::to_string(sizeof(CboeSequencedUnitHeader) + sizeof(PitchTradeMessage) + trailer) + "-" +
+                                 std::to_string(Config::MAX_BUF) + ")");
+    }
+
+    std::mt19937_64 rng(options.seed);
+    std::vector<UnitBook> books;
+    for (uint8_t unit : options.units) {
+        UnitBook book;
+        book.unit = unit;
+        book.next_order_id = (static_cast<uint64_t>(unit) << 48) + 1;
+        for (uint32_t i = 0; i < options.symbols; i++) {
+            Symbol symbol;
+            symbol.name[0] = static_cast<char>('A' + unit % 26);
+            symbol.name[1] = static_cast<char>('A' + i / (26 * 26));
+            symbol.name[2] = static_cast<char>('A' + i / 26 % 26);
+            symbol.name[3] = static_cast<char>('A' + i % 26);
+            symbol.name[4] = ' ';
+            symbol.name[5] = ' ';
+            symbol.base_price = TICK * (1000 + rng() % 49000);   // $10 - $500
+            book.symbols.push_back(symbol);
+        }
+        books.push_back(std::move(book));
+    }
+
+    // Offsets and metadata first; pointers once storage_ stops growing
+    struct Span {
+        size_t offset;
+        uint8_t unit;
+        uint8_t count;
+    };
+    std::vector<Span> spans;
+    uint64_t clock_ns = 0;
+    std::vector<char> message;
+
+    auto build_packet = [&](UnitBook& book, uint32_t wanted, bool closing) {
+        Span span = {storage_.size(), book.unit, 0};
+        storage_.resize(storage_.size() + sizeof(CboeSequencedUnitHeader));
+        clock_ns += 200 + rng() % 2000;
+        uint32_t time_offset = static_cast<uint32_t>(clock_ns % 1000000000);
+        while (span.count < wanted && !(closing && book.live.empty())) {
+            message.clear();
+            if (closing) {
+                append_delete(book, book.live.size() - 1, time_offset, message);
+            } else {
+                append_message(book, rng, time_offset, message);
+            }
+            storage_.insert(storage_.end(), message.begin(), message.end());
+            span.count++;
+            // Stop while the largest message still fits
+            if (storage_.size() - span.offset + sizeof(PitchTradeMessage) + trailer > options.max_packet_bytes) {
+                break;
+            }
+        }
+        CboeSequencedUnitHeader header = {static_cast<uint16_t>(storage_.size() - span.offset), span.count,
+                                          book.unit, 0};
+        memcpy(storage_.data() + span.offset, &header, sizeof(header));
+        if (send_stamp_) {
+            SendStamp stamp = {Config::SEND_STAMP_MAGIC, 0};
+            append(storage_, stamp);
+        }
+        pool_messages_ += span.count;
+        spans.push_back(span);
+    };
+
+    for (size_t i = 0; i < options.pool_packets; i++) {
+        build_packet(books[rng() % books.size()], static_cast<uint32_t>(1 + rng() % options.max_messages), false);
+    }
+    // Empty every book so the next pass through the pool starts clean
+    for (UnitBook& book : books) {
+        while (!book.live.empty()) {
+            build_packet(book, options.max_messages, true);
+        }
+    }
+
+    for (const Span& span : spans) {
+        uint16_t length;
+        memcpy(&length, storage_.data() + span.offset, sizeof(length));
+        packets_.push_back({storage_.data() + span.offset, static_cast<uint16_t>(length + trailer), span.unit,
+                            span.count});
+    }
+    next_sequence_.fill(1);
+}
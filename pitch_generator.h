@@ -0,0 +1,95 @@
+#pragma once
+
+#include "packet_types.h"
+#include "tsc_clock.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Settings of a synthetic PITCH feed
+ */
+struct PitchGeneratorOptions {
+    std::vector<uint8_t> units = {1};
+    uint32_t symbols = 100;             // Per unit
+    uint32_t max_messages = 8;          // Per packet; each packet holds 1..max_messages
+    size_t max_packet_bytes = 1400;     // Datagram size limit, unit header included
+    size_t pool_packets = 65536;        // Packets generated up front and then cycled
+    uint32_t seed = 1;
+    bool send_stamp = false;            // Append a SendStamp to every packet, for latency measurement
+};
+
+/**
+ * Synthetic Multicast PITCH feed built from a consistent order book
+ *
+ * Each unit has its own symbols and book. Orders are added, then modified,
+ * reduced, executed or deleted, so every message refers to a live order.
+ * Trades against non-displayed orders are mixed in. The packets are
+ * generated once into a pool. After the pool, every order still resting is
+ * deleted, so the pool leaves each book empty and can be replayed in a loop.
+ *
+ * next() only stamps the unit's next sequence number into the pool packet,
+ * so packets come out at memory speed. Packets of the different units are
+ * interleaved, and each unit numbers its messages from 1 without gaps.
+ * Time messages are not generated: time offsets count nanoseconds into a
+ * synthetic second.
+ *
+ * With send_stamp set, each packet is followed by a SendStamp outside its
+ * hdr_length, and next() also writes the current TSC into it.
+ */
+class PitchFeedGenerator {
+public:
+    struct Packet {
+        char* data;             // CboeSequencedUnitHeader followed by the messages
+        uint16_t length;        // Including the SendStamp, if any
+        uint8_t unit;
+        uint8_t count;          // Messages in the packet
+    };
+
+    /**
+     * Generate the pool
+     * @throws std::runtime_error on invalid options
+     */
+    explicit PitchFeedGenerator(const PitchGeneratorOptions& options);
+
+    PitchFeedGenerator(const PitchFeedGenerator&) = delete;
+    PitchFeedGenerator& operator=(const PitchFeedGenerator&) = delete;
+
+    /**
+     * Next packet of the feed, with its sequence number (and send time) stamped
+     * The data stays valid until the pool comes round to it again.
+     */
+    const Packet& next() {
+        Packet& packet = packets_[cursor_];
+        if (++cursor_ == packets_.size()) {
+            cursor_ = 0;
+        }
+        uint32_t& sequence = next_sequence_[packet.unit];
+        memcpy(packet.data + offsetof(CboeSequencedUnitHeader, hdr_sequence), &sequence, sizeof(sequence));
+        sequence += packet.count;
+        if (send_stamp_) {
+            uint64_t now = TscClock::now();
+            memcpy(packet.data + packet.length - sizeof(now), &now, sizeof(now));
+        }
+        return packet;
+    }
+
+    /**
+     * Sequence the next packet of a unit will carry
+     */
+    uint32_t next_sequence(uint8_t unit) const { return next_sequence_[unit]; }
+
+    size_t pool_packets() const { return packets_.size(); }
+    size_t pool_bytes() const { return storage_.size(); }
+    uint64_t pool_messages() const { return pool_messages_; }
+
+private:
+    std::vector<char> storage_;
+    std::vector<Packet> packets_;
+    size_t cursor_ = 0;
+    uint64_t pool_messages_ = 0;
+    bool send_stamp_;
+    std::array<uint32_t, 256> next_sequence_;
+};
@@ -0,0 +1,384 @@
+#include "runtime_config.h"
+#include <atomic>
+#include <csignal>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::string trim(const std::string& s) {
+    size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = s.find_last_not_of(" \t\r");
+    return s.substr(first, last - first + 1);
+}
+
+bool parse_bool(const std::string& value) {
+    if (value == "true" || value == "1" || value == "yes" || value == "on") return true;
+    if (value == "false" || value == "0" || value == "no" || value == "off") return false;
+    throw std::invalid_argument("expected a boolean");
+}
+
+std::vector<int> parse_int_list(const std::string& value) {
+    std::vector<int> result;
+    std::istringstream iss(value);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        item = trim(item);
+        if (!item.empty()) {
+            result.push_back(std::stoi(item));
+        }
+    }
+    return result;
+}
+
+/**
+ * Spin servers: comma-separated "unit@host:port" entries
+ */
+std::vector<SpinServer> parse_spin_servers(const std::string& value) {
+    std::vector<SpinServer> servers;
+    std::istringstream iss(value);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        item = trim(item);
+        if (item.empty()) {
+            continue;
+        }
+        size_t at = item.find('@');
+        size_t colon = item.rfind(':');
+        if (at == std::string::npos || colon == std::string::npos || colon < at) {
+            throw std::invalid_argument("expected unit@host:port");
+        }
+        int unit = std::stoi(item.substr(0, at));
+        if (unit < 1 || unit > 255) {
+            throw std::out_of_range("unit must be 1-255");
+        }
+        SpinServer server;
+        server.unit = static_cast<uint8_t>(unit);
+        server.host = item.substr(at + 1, colon - at - 1);
+        server.port = static_cast<uint16_t>(std::stoul(item.substr(colon + 1)));
+        servers.push_back(server);
+    }
+    return servers;
+}
+
+/**
+ * ZeroMQ wait strategy: "spin", "spin_poll" or "poll"
+ */
+ZmqWaitStrategy parse_wait_strategy(const std::string& value) {
+    if (value == "spin") return ZmqWaitStrategy::SPIN;
+    if (value == "spin_poll") return ZmqWaitStrategy::SPIN_THEN_POLL;
+    if (value == "poll") return ZmqWaitStrategy::POLL;
+    throw std::invalid_argument("expected spin, spin_poll or poll");
+}
+
+/**
+ * Bridge transport: "zmq" or "shm"
+ */
+ZmqTransport parse_transport(const std::string& value) {
+    if (value == "zmq") return ZmqTransport::ZMQ;
+    if (value == "shm") return ZmqTransport::SHM;
+    throw std::invalid_argument("expected zmq or shm");
+}
+
+/**
+ * ZeroMQ pattern: "pull" or "sub"
+ */
+ZmqPattern parse_pattern(const std::string& value) {
+    if (value == "pull") return ZmqPattern::PULL;
+    if (value == "sub") return ZmqPattern::SUB;
+    throw std::invalid_argument("expected pull or sub");
+}
+
+/**
+ * Unit filter: "all" or a comma-separated list of unit ids
+ */
+std::bitset<256> parse_units(const std::string& value) {
+    std::bitset<256> units;
+    if (value == "all") {
+        return units.set();
+    }
+    for (int unit : parse_int_list(value)) {
+        if (unit < 0 || unit > 255) {
+            throw std::out_of_range("unit must be 0-255");
+        }
+        units.set(unit);
+    }
+    return units;
+}
+
+void apply_setting(RuntimeConfig& config, const std::string& key, const std::string& value) {
+    if (key == "multicast_ip") config.multicast_ip = value;
+    else if (key == "interface_ip") config.interface_ip = value;
+    else if (key == "port1") config.port1 = static_cast<uint16_t>(std::stoul(value));
+    else if (key == "port2") config.port2 = static_cast<uint16_t>(std::stoul(value));
+    else if (key == "socket_buffer_bytes") config.socket_buffer_bytes = std::stoi(value);
+    else if (key == "receive_cpu") config.receive_cpu = std::stoi(value);
+    else if (key == "measure_send_latency") config.measure_send_latency = parse_bool(value);
+    else if (key == "writer_cpus") config.writer_cpus = parse_int_list(value);
+    else if (key == "log_file") config.log_file = value;
+    else if (key == "log_file_size") config.log_file_size = std::stoull(value);
+    else if (key == "log_file_count") config.log_file_count = std::stoi(value);
+    else if (key == "async_queue_size") config.async_queue_size = std::stoull(value);
+    else if (key == "async_threads") config.async_threads = std::stoi(value);
+    else if (key == "block_on_full_queue") config.block_on_full_queue = parse_bool(value);
+    else if (key == "checkpoint_file") config.checkpoint_file = value;
+    else if (key == "checkpoint_interval_ms") config.checkpoint_interval_ms = std::stoi(value);
+    else if (key == "checkpoint_max_age_s") config.checkpoint_max_age_s = std::stoi(value);
+    else if (key == "zmq_wait_strategy") config.zmq_wait_strategy = parse_wait_strategy(value);
+    else if (key == "zmq_spin_iterations") config.zmq_spin_iterations = static_cast<uint32_t>(std::stoul(value));
+    else if (key == "zmq_poll_timeout_ms") config.zmq_poll_timeout_ms = std::stoi(value);
+    else if (key == "zmq_transport") config.zmq_transport = parse_transport(value);
+    else if (key == "shm_name") config.shm_name = value;
+    else if (key == "zmq_pattern") config.zmq_pattern = parse_pattern(value);
+    else if (key == "zmq_units") config.zmq_units = parse_units(value);
+    else if (key == "zmq_shards") config.zmq_shards = std::stoi(value);
+    else if (key == "zmq_shard_queue_packets") config.zmq_shard_queue_packets = std::stoull(value);
+    else if (key == "max_sequence_jump") config.max_sequence_jump = static_cast<uint32_t>(std::stoul(value));
+    else if (key == "max_pending_sequences") config.max_pending_sequences = std::stoull(value);
+    else if (key == "grp_host") config.grp_host = value;
+    else if (key == "grp_port") config.grp_port = static_cast<uint16_t>(std::stoul(value));
+    else if (key == "grp_session_sub_id") config.grp_session_sub_id = value;
+    else if (key == "grp_username") config.grp_username = value;
+    else if (key == "grp_password") config.grp_password = value;
+    else if (key == "grp_request_delay_ms") config.grp_request_delay_ms = std::stoi(value);
+    else if (key == "grp_requests_per_second") config.grp_requests_per_second = std::stod(value);
+    else if (key == "grp_max_count") config.grp_max_count = static_cast<uint32_t>(std::stoul(value));
+    else if (key == "grp_multicast_ip") config.grp_multicast_ip = value;
+    else if (key == "grp_multicast_port") config.grp_multicast_port = static_cast<uint16_t>(std::stoul(value));
+    else if (key == "spin_servers") config.spin_servers = parse_spin_servers(value);
+    else if (key == "spin_session_sub_id") config.spin_session_sub_id = value;
+    else if (key == "spin_username") config.spin_username = value;
+    else if (key == "spin_password") config.spin_password = value;
+    else if (key == "spin_on_start") config.spin_on_start = parse_bool(value);
+    else if (key == "spin_min_gap") config.spin_min_gap = static_cast<uint32_t>(std::stoul(value));
+    else if (key == "spin_max_buffered") config.spin_max_buffered = std::stoull(value);
+    else if (key == "spin_timeout_ms") config.spin_timeout_ms = std::stoi(value);
+    else if (key == "skip_heartbeats") config.skip_heartbeats = parse_bool(value);
+    else if (key == "max_logged_payload") config.max_logged_payload = static_cast<uint16_t>(std::stoul(value));
+    else if (key == "line_arbitration") config.line_arbitration = parse_bool(value);
+    else if (key == "stats_interval") config.stats_interval = std::stoull(value);
+    else if (key == "flush_interval") config.flush_interval = std::stoull(value);
+    else if (key == "logged_units") config.logged_units = parse_units(value);
+    else if (key == "shutdown_drain_ms") config.shutdown_drain_ms = std::stoi(value);
+    else throw std::invalid_argument("unknown key");
+}
+
+// Current snapshot plus every snapshot ever published (see publish_runtime_config)
+std::atomic<const RuntimeConfig*> g_current_config{nullptr};
+std::mutex g_retired_mutex;
+std::vector<std::unique_ptr<RuntimeConfig>> g_retired_configs;
+
+const RuntimeConfig* default_config() {
+    static const RuntimeConfig defaults;
+    return &defaults;
+}
+
+} // namespace
+
+std::vector<std::string> RuntimeConfig::apply_reloadable(const RuntimeConfig& other) {
+    std::vector<std::string> ignored;
+    auto check = [&ignored](bool differs, const char* name) {
+        if (differs) ignored.push_back(name);
+    };
+    check(multicast_ip != other.multicast_ip, "multicast_ip");
+    check(interface_ip != other.interface_ip, "interface_ip");
+    check(port1 != other.port1 || port2 != other.port2, "port1/port2");
+    check(socket_buffer_bytes != other.socket_buffer_bytes, "socket_buffer_bytes");
+    check(measure_send_latency != other.measure_send_latency, "measure_send_latency");
+    check(receive_cpu != other.receive_cpu || writer_cpus != other.writer_cpus, "receive_cpu/writer_cpus");
+    check(log_file != other.log_file || log_file_size != other.log_file_size ||
+          log_file_count != other.log_file_count, "log_file/log_file_size/log_file_count");
+    check(async_queue_size != other.async_queue_size || async_threads != other.async_threads ||
+          block_on_full_queue != other.block_on_full_queue, "async writer settings");
+    check(checkpoint_file != other.checkpoint_file || checkpoint_interval_ms != other.checkpoint_interval_ms ||
+          checkpoint_max_age_s != other.checkpoint_max_age_s, "checkpoint settings");
+    check(zmq_wait_strategy != other.zmq_wait_strategy || zmq_spin_iterations != other.zmq_spin_iterations ||
+          zmq_poll_timeout_ms != other.zmq_poll_timeout_ms, "zmq wait settings");
+    check(zmq_transport != other.zmq_transport || shm_name != other.shm_name, "zmq_transport/shm_name");
+    check(zmq_pattern != other.zmq_pattern || zmq_units != other.zmq_units, "zmq_pattern/zmq_units");
+    check(zmq_shards != other.zmq_shards || zmq_shard_queue_packets != other.zmq_shard_queue_packets,
+          "zmq_shards/zmq_shard_queue_packets");
+    check(max_sequence_jump != other.max_sequence_jump || max_pending_sequences != other.max_pending_sequences,
+          "sequence tracker limits");
+    check(grp_host != other.grp_host || grp_port != other.grp_port || grp_session_sub_id != other.grp_session_sub_id ||
+          grp_username != other.grp_username || grp_password != other.grp_password ||
+          grp_request_delay_ms != other.grp_request_delay_ms || grp_requests_per_second != other.grp_requests_per_second ||
+          grp_max_count != other.grp_max_count || grp_multicast_ip != other.grp_multicast_ip ||
+          grp_multicast_port != other.grp_multicast_port, "gap request settings");
+    check(spin_servers != other.spin_servers || spin_session_sub_id != other.spin_session_sub_id ||
+          spin_username != other.spin_username || spin_password != other.spin_password ||
+          spin_on_start != other.spin_on_start || spin_min_gap != other.spin_min_gap ||
+          spin_max_buffered != other.spin_max_buffered || spin_timeout_ms != other.spin_timeout_ms, "spin settings");
+    check(skip_heartbeats != other.skip_heartbeats || max_logged_payload != other.max_logged_payload ||
+          line_arbitration != other.line_arbitration, "feed policy settings");
+
+    stats_interval = other.stats_interval;
+    flush_interval = other.flush_interval;
+    logged_units = other.logged_units;
+    shutdown_drain_ms = other.shutdown_drain_ms;
+    return ignored;
+}
+
+RuntimeConfig load_runtime_config(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open config file: " + path);
+    }
+
+    RuntimeConfig config;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        line = trim(line);
+        if (line.empty()) {
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": expected key = value");
+        }
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+        try {
+            apply_setting(config, key, value);
+        } catch (const std::exception& e) {
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": " + key + ": " + e.what());
+        }
+    }
+
+    if (config.stats_interval == 0 || config.flush_interval == 0) {
+        throw std::runtime_error(path + ": stats_interval and flush_interval must be non-zero");
+    }
+    if (config.shutdown_drain_ms < 0) {
+        throw std::runtime_error(path + ": shutdown_drain_ms must not be negative");
+    }
+    if (config.grp_requests_per_second <= 0 || config.grp_max_count == 0 || config.grp_max_count > 65535) {
+        throw std::runtime_error(path + ": grp_requests_per_second must be positive and grp_max_count 1-65535");
+    }
+    if (!config.grp_multicast_ip.empty() && config.grp_multicast_port == 0) {
+        throw std::runtime_error(path + ": grp_multicast_ip needs grp_multicast_port");
+    }
+    if (config.max_sequence_jump == 0 || config.max_pending_sequences == 0) {
+        throw std::runtime_error(path + ": max_sequence_jump and max_pending_sequences must be non-zero");
+    }
+    if (config.zmq_poll_timeout_ms <= 0) {
+        throw std::runtime_error(path + ": zmq_poll_timeout_ms must be positive");
+    }
+    if (config.shm_name.size() < 2 || config.shm_name[0] != '/' || config.shm_name.find('/', 1) != std::string::npos) {
+        throw std::runtime_error(path + ": shm_name must be a single '/name' component");
+    }
+    if (config.zmq_shards < 1 || config.zmq_shards > 64 || config.zmq_shard_queue_packets == 0) {
+        throw std::runtime_error(path + ": zmq_shards must be 1-64 and zmq_shard_queue_packets non-zero");
+    }
+    if (config.zmq_pattern == ZmqPattern::SUB && config.zmq_units.none()) {
+        throw std::runtime_error(path + ": zmq_units must name at least one unit");
+    }
+    if (config.checkpoint_interval_ms <= 0) {
+        throw std::runtime_error(path + ": checkpoint_interval_ms must be positive");
+    }
+    return config;
+}
+
+const RuntimeConfig& runtime_config() {
+    const RuntimeConfig* config = g_current_config.load(std::memory_order_acquire);
+    return config ? *config : *default_config();
+}
+
+void publish_runtime_config(std::unique_ptr<RuntimeConfig> config) {
+    std::lock_guard<std::mutex> lock(g_retired_mutex);
+    g_current_config.store(config.get(), std::memory_order_release);
+    g_retired_configs.push_back(std::move(config));
+}
+
+std::string shard_file_name(const std::string& path, int shard) {
+    if (shard == 0 || path.empty()) {
+        return path;
+    }
+    std::string tag = ".shard" + std::to_string(shard);
+    size_t slash = path.rfind('/');
+    size_t dot = path.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash) || dot == slash + 1 || dot == 0) {
+        return path + tag;
+    }
+    return path.substr(0, dot) + tag + path.substr(dot);
+}
+
+bool pin_current_thread(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return true;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+ConfigReloader::ConfigReloader(std::string path) : path_(std::move(path)), running_(false) {
+}
+
+ConfigReloader::~ConfigReloader() {
+    stop();
+}
+
+void ConfigReloader::block_reload_signal() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &set, nullptr);
+}
+
+void ConfigReloader::start() {
+    running_ = true;
+    thread_ = std::thread(&ConfigReloader::reload_loop, this);
+}
+
+void ConfigReloader::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void ConfigReloader::reload_loop() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+
+    while (running_) {
+        // Short timeout so stop() is honored promptly
+        timespec timeout{0, 200 * 1000 * 1000};
+        if (sigtimedwait(&set, nullptr, &timeout) != SIGHUP) {
+            continue;
+        }
+
+        try {
+            RuntimeConfig loaded = load_runtime_config(path_);
+            auto next = std::make_unique<RuntimeConfig>(runtime_config());
+            for (const auto& name : next->apply_reloadable(loaded)) {
+                std::cerr << "Config reload: " << name << " changed but requires a restart; ignored" << std::endl;
+            }
+            std::cout << "Config reloaded from " << path_ << ": stats every " << next->stats_interval
+                      << " packets, flush every " << next->flush_interval << " packets, "
+                      << next->logged_units.count() << " units logged" << std::endl;
+            publish_runtime_config(std::move(next));
+        } catch (const std::exception& e) {
+            std::cerr << "Config reload failed, keeping current settings: " << e.what() << std::endl;
+        }
+    }
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "packet_types.h"
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Spin server serving the snapshot of one unit
+ */
+struct SpinServer {
+    uint8_t unit = 0;
+    std::string host;
+    uint16_t port = 0;
+
+    bool operator==(const SpinServer& other) const {
+        return unit == other.unit && host == other.host && port == other.port;
+    }
+};
+
+/**
+ * How the ZeroMQ receive loop waits for data
+ */
+enum class ZmqWaitStrategy {
+    SPIN,             // Never block; lowest latency, one core at 100%
+    SPIN_THEN_POLL,   // Spin for zmq_spin_iterations empty passes, then block in zmq_poll
+    POLL              // Block in zmq_poll whenever both sockets are drained
+};
+
+/**
+ * How packet_logger_zmq receives frames from zmq_bridge
+ */
+enum class ZmqTransport {
+    ZMQ,              // ZeroMQ PULL sockets over IPC
+    SHM               // Shared-memory rings (shm_ring.h)
+};
+
+/**
+ * ZeroMQ socket pattern packet_logger_zmq uses against zmq_bridge
+ */
+enum class ZmqPattern {
+    PULL,             // Every frame of the port (bridge in PUSH mode)
+    SUB               // Only the zmq_units topics (bridge started with --pub)
+};
+
+/**
+ * Settings loaded from the optional configuration file
+ * Defaults mirror the Config namespace, so running without a file behaves
+ * exactly like the compiled-in configuration.
+ *
+ * File format: one "key = value" per line, '#' starts a comment.
+ */
+struct RuntimeConfig {
+    // ---- Structural: read once at startup ----
+    std::string multicast_ip = Config::MULTICAST_IP;
+    std::string interface_ip = "0.0.0.0";        // Interface used to join the groups
+    uint16_t port1 = Config::PORT1;
+    uint16_t port2 = Config::PORT2;
+    int socket_buffer_bytes = 64 * 1024 * 1024;
+    int receive_cpu = -1;                         // -1 = no pinning
+    bool measure_send_latency = false;            // Time pitch_feed --send-stamp datagrams (benchmarks)
+    std::vector<int> writer_cpus;                 // Empty = no pinning
+
+    std::string log_file = "packets_binary.log";
+    size_t log_file_size = Config::LOG_FILE_SIZE;
+    int log_file_count = Config::LOG_FILE_COUNT;
+    size_t async_queue_size = Config::ASYNC_QUEUE_SIZE;
+    int async_threads = Config::ASYNC_THREADS;
+    bool block_on_full_queue = true;              // false = overrun oldest entries
+
+    std::string checkpoint_file = "sequence_checkpoint.bin"; // Empty = no checkpoints
+    int checkpoint_interval_ms = Config::CHECKPOINT_INTERVAL_MS;
+    int checkpoint_max_age_s = Config::CHECKPOINT_MAX_AGE_S;
+
+    ZmqWaitStrategy zmq_wait_strategy = ZmqWaitStrategy::SPIN_THEN_POLL;  // packet_logger_zmq only
+    uint32_t zmq_spin_iterations = 10000;         // Empty passes before SPIN_THEN_POLL blocks
+    int zmq_poll_timeout_ms = 100;                // Longest block, so shutdown is noticed
+    ZmqTransport zmq_transport = ZmqTransport::ZMQ;
+    std::string shm_name = "/cboe_bridge";        // Segment name for ZmqTransport::SHM
+    ZmqPattern zmq_pattern = ZmqPattern::PULL;
+    std::bitset<256> zmq_units = std::bitset<256>().set();  // Topics subscribed with ZmqPattern::SUB
+    int zmq_shards = 1;                           // Processing threads; unit u goes to shard u % zmq_shards
+    size_t zmq_shard_queue_packets = 8192;        // Packets queued per receive thread and shard
+
+    uint32_t max_sequence_jump = Config::MAX_SEQUENCE_JUMP;
+    size_t max_pending_sequences = Config::MAX_PENDING_SEQUENCES;   // Per tracker
+
+    // Gap Request Proxy session (empty host = no gap recovery)
+    std::string grp_host;
+    uint16_t grp_port = 18000;
+    std::string grp_session_sub_id = "0001";
+    std::string grp_username;
+    std::string grp_password;
+    int grp_request_delay_ms = 5;                 // Give the other line this long to fill a gap first
+    double grp_requests_per_second = 10;          // Per unit
+    uint32_t grp_max_count = 1000;                // Messages per gap request
+    std::string grp_multicast_ip;                 // Gap response group the GRP retransmits on (empty = session only)
+    uint16_t grp_multicast_port = 0;
+
+    // Spin servers for snapshot recovery ("unit@host:port" list; empty = no spins)
+    std::vector<SpinServer> spin_servers;
+    std::string spin_session_sub_id = "0001";
+    std::string spin_username;
+    std::string spin_password;
+    bool spin_on_start = true;                    // Spin when a unit is first seen mid-session
+    uint32_t spin_min_gap = 100000;               // Gaps at least this long are spun instead of requested
+    size_t spin_max_buffered = 1000000;           // Live packets held per spin before giving up
+    int spin_timeout_ms = 30000;
+
+    // Feed policy knobs (honored by RuntimeFeedPolicy builds only)
+    bool skip_heartbeats = Config::SKIP_HEARTBEATS;
+    uint16_t max_logged_payload = Config::MAX_LOGGED_PAYLOAD;
+    bool line_arbitration = Config::LINE_ARBITRATION;
+
+    // ---- Reloadable on SIGHUP ----
+    uint64_t stats_interval = Config::STATS_INTERVAL;
+    uint64_t flush_interval = Config::FLUSH_INTERVAL;
+    std::bitset<256> logged_units = std::bitset<256>().set(); // Units written to the binary log
+    int shutdown_drain_ms = 2000;                 // packet_logger_zmq: longest wait for queued frames at shutdown
+
+    /**
+     * Copy the reloadable knobs of another configuration into this one
+     * @return Names of structural settings that differ and were not applied
+     */
+    std::vector<std::string> apply_reloadable(const RuntimeConfig& other);
+};
+
+/**
+ * Parse a configuration file on top of the defaults
+ * @throws std::runtime_error on unreadable files, unknown keys or bad values
+ */
+RuntimeConfig load_runtime_config(const std::string& path);
+
+/**
+ * Current immutable configuration snapshot
+ * Lock-free: a single acquire load, safe to call per packet from any thread.
+ */
+const RuntimeConfig& runtime_config();
+
+/**
+ * Publish a new snapshot; readers switch to it on their next runtime_config() call
+ * Retired snapshots are kept alive for the life of the process, so references
+ * held by in-flight readers never dangle. Reloads are rare, so this is bounded
+ * in practice.
+ */
+void publish_runtime_config(std::unique_ptr<RuntimeConfig> config);
+
+/**
+ * File name used by one processing shard of packet_logger_zmq
+ * Shard 0 keeps the configured name, so a single shard reads and writes the
+ * same files as before; shard N inserts ".shardN" before the extension
+ * (packets_binary.log -> packets_binary.shard1.log).
+ */
+std::string shard_file_name(const std::string& path, int shard);
+
+/**
+ * Pin the calling thread to the given CPUs (no-op for an empty list)
+ * @return false if the affinity could not be applied
+ */
+bool pin_current_thread(const std::vector<int>& cpus);
+
+/**
+ * Reloads the configuration file on SIGHUP from a dedicated thread
+ * SIGHUP must be blocked in every thread (see block_reload_signal) so it is
+ * consumed by sigtimedwait here rather than delivered asynchronously.
+ */
+class ConfigReloader {
+public:
+    explicit ConfigReloader(std::string path);
+    ~ConfigReloader();
+
+    void start();
+    void stop();
+
+    /**
+     * Block SIGHUP in the calling thread; call before creating any thread
+     */
+    static void block_reload_signal();
+
+private:
+    std::string path_;
+    std::atomic<bool> running_;
+    std::thread thread_;
+
+    void reload_loop();
+};
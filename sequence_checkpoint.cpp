@@ -0,0 +1,325 @@
+#include "sequence_checkpoint.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char CHECKPOINT_MAGIC[8] = {'C', 'B', 'O', 'E', 'S', 'E', 'Q', 'C'};
+constexpr uint32_t CHECKPOINT_VERSION = 2;    // 2 added each tracker's epoch and End of Session flag
+
+/**
+ * FNV-1a over the serialized body; detects torn or corrupted files
+ */
+uint32_t fnv1a(const std::string& data) {
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/**
+ * Bounds-checked cursor over a serialized checkpoint
+ */
+class Cursor {
+public:
+    Cursor(const std::string& data, const std::string& path) : data_(data), path_(path) {}
+
+    template <typename T>
+    T get() {
+        T value;
+        if (offset_ + sizeof(T) > data_.size()) {
+            throw std::runtime_error("Truncated checkpoint file: " + path_);
+        }
+        std::memcpy(&value, data_.data() + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return value;
+    }
+
+    size_t offset() const { return offset_; }
+
+private:
+    const std::string& data_;
+    const std::string& path_;
+    size_t offset_ = 0;
+};
+
+std::string directory_of(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos) {
+        return ".";
+    }
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+std::string errno_text() {
+    return std::strerror(errno);
+}
+
+/**
+ * Shared loop of for_each_log_record and for_each_log_record_with_payload
+ * Without with_payload the payloads are skipped and the visitor gets nullptr.
+ */
+template <typename Visit>
+bool read_log_records(const std::string& path, bool with_payload, Visit&& visit) {
+    std::vector<char> buffer(1024 * 1024);
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    file.open(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    BinaryLogRecord record;
+    std::vector<char> payload;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(BinaryLogRecord))) {
+        if (with_payload) {
+            payload.resize(record.payload_length);
+            if (!file.read(payload.data(), record.payload_length)) {
+                break;
+            }
+        } else if (!file.ignore(record.payload_length)) {
+            break;
+        }
+        // spdlog terminates every entry with an end-of-line separator
+        if (file.peek() == '\n') {
+            file.get();
+        }
+        if (!visit(record, with_payload ? payload.data() : nullptr)) {
+            break;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+void write_checkpoint(const std::string& path, const SequenceCheckpoint& checkpoint) {
+    std::string data;
+    data.append(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    put(data, CHECKPOINT_VERSION);
+    put(data, checkpoint.layout_fingerprint);
+    put(data, checkpoint.timestamp_ns);
+    put(data, static_cast<uint32_t>(checkpoint.trackers.size()));
+    for (const auto& [index, tracker] : checkpoint.trackers) {
+        put(data, index);
+        put(data, tracker.last_confirmed_seq);
+        put(data, tracker.highest_seen_seq);
+        put(data, static_cast<uint32_t>(tracker.pending_sequences.size()));
+        for (const auto& entry : tracker.pending_sequences) {
+            put(data, entry.first);
+        }
+    }
+    for (size_t t = 0; t < checkpoint.trackers.size(); t++) {
+        put(data, t < checkpoint.epochs.size() ? checkpoint.epochs[t] : 0u);
+        put(data, static_cast<uint8_t>(t < checkpoint.session_ended.size() && checkpoint.session_ended[t]));
+    }
+    put(data, fnv1a(data));
+
+    std::string tmp_path = path + ".tmp";
+    int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create " + tmp_path + ": " + errno_text());
+    }
+
+    const char* p = data.data();
+    size_t remaining = data.size();
+    while (remaining > 0) {
+        ssize_t n = ::write(fd, p, remaining);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::string error = errno_text();
+            ::close(fd);
+            throw std::runtime_error("Cannot write " + tmp_path + ": " + error);
+        }
+        p += n;
+        remaining -= static_cast<size_t>(n);
+    }
+
+    if (::fsync(fd) != 0) {
+        std::string error = errno_text();
+        ::close(fd);
+        throw std::runtime_error("Cannot fsync " + tmp_path + ": " + error);
+    }
+    ::close(fd);
+
+    if (::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Cannot rename " + tmp_path + " to " + path + ": " + errno_text());
+    }
+
+    // Make the rename itself durable
+    int dir_fd = ::open(directory_of(path).c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+bool read_checkpoint(const std::string& path, SequenceCheckpoint& checkpoint) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    if (data.size() < sizeof(CHECKPOINT_MAGIC) + sizeof(uint32_t) ||
+        std::memcmp(data.data(), CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        throw std::runtime_error("Not a sequence checkpoint file: " + path);
+    }
+
+    uint32_t stored_checksum;
+    std::memcpy(&stored_checksum, data.data() + data.size() - sizeof(uint32_t), sizeof(uint32_t));
+    std::string body = data.substr(0, data.size() - sizeof(uint32_t));
+    if (fnv1a(body) != stored_checksum) {
+        throw std::runtime_error("Checksum mismatch in checkpoint file: " + path);
+    }
+
+    Cursor cursor(body, path);
+    for (size_t i = 0; i < sizeof(CHECKPOINT_MAGIC); i++) {
+        cursor.get<char>();
+    }
+    uint32_t version = cursor.get<uint32_t>();
+    if (version != 1 && version != CHECKPOINT_VERSION) {
+        throw std::runtime_error("Unsupported checkpoint version " + std::to_string(version) + ": " + path);
+    }
+
+    checkpoint = SequenceCheckpoint();
+    checkpoint.layout_fingerprint = cursor.get<uint32_t>();
+    checkpoint.timestamp_ns = cursor.get<uint64_t>();
+    uint32_t tracker_count = cursor.get<uint32_t>();
+    for (uint32_t t = 0; t < tracker_count; t++) {
+        uint16_t index = cursor.get<uint16_t>();
+        SequenceTracker tracker;
+        tracker.last_confirmed_seq = cursor.get<uint32_t>();
+        tracker.highest_seen_seq = cursor.get<uint32_t>();
+        uint32_t pending_count = cursor.get<uint32_t>();
+        for (uint32_t p = 0; p < pending_count; p++) {
+            tracker.pending_sequences.emplace_hint(tracker.pending_sequences.end(), cursor.get<uint32_t>(), true);
+        }
+        checkpoint.trackers.emplace_back(index, std::move(tracker));
+    }
+    // Version 1 checkpoints leave every tracker in epoch 0 without an End of Session
+    checkpoint.epochs.assign(tracker_count, 0);
+    checkpoint.session_ended.assign(tracker_count, false);
+    if (version >= 2) {
+        for (uint32_t t = 0; t < tracker_count; t++) {
+            checkpoint.epochs[t] = cursor.get<uint32_t>();
+            checkpoint.session_ended[t] = cursor.get<uint8_t>() != 0;
+        }
+    }
+
+    if (cursor.offset() != body.size()) {
+        throw std::runtime_error("Trailing data in checkpoint file: " + path);
+    }
+    return true;
+}
+
+std::vector<std::string> log_segments_newest_first(const std::string& log_file, int max_count) {
+    // spdlog's rotating sink names segments "base.N.ext": packets_binary.1.log
+    std::string stem = log_file;
+    std::string extension;
+    size_t dot = log_file.find_last_of('.');
+    size_t slash = log_file.find_last_of('/');
+    if (dot != std::string::npos && dot != 0 && (slash == std::string::npos || dot > slash + 1)) {
+        stem = log_file.substr(0, dot);
+        extension = log_file.substr(dot);
+    }
+
+    std::vector<std::string> segments;
+    for (int i = 0; i < max_count; i++) {
+        std::string segment = (i == 0) ? log_file : stem + "." + std::to_string(i) + extension;
+        struct stat st;
+        if (::stat(segment.c_str(), &st) != 0) {
+            break;
+        }
+        segments.push_back(segment);
+    }
+    return segments;
+}
+
+bool for_each_log_record(const std::string& path, const std::function<bool(const BinaryLogRecord&)>& visit) {
+    return read_log_records(path, false, [&](const BinaryLogRecord& record, const char*) { return visit(record); });
+}
+
+bool for_each_log_record_with_payload(const std::string& path,
+                                      const std::function<bool(const BinaryLogRecord&, const char*)>& visit) {
+    return read_log_records(path, true, visit);
+}
+
+CheckpointWriter::CheckpointWriter(std::string path, CommitGate commit_gate)
+    : path_(std::move(path)), commit_gate_(std::move(commit_gate)), has_pending_(false), running_(false),
+      written_(0), failed_(0), skipped_(0) {
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    stop();
+}
+
+void CheckpointWriter::start() {
+    running_ = true;
+    thread_ = std::thread(&CheckpointWriter::write_loop, this);
+}
+
+void CheckpointWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+bool CheckpointWriter::offer(SequenceCheckpoint&& checkpoint) {
+    std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || has_pending_) {
+        return false;
+    }
+    pending_ = std::move(checkpoint);
+    has_pending_ = true;
+    lock.unlock();
+    cv_.notify_one();
+    return true;
+}
+
+void CheckpointWriter::write_loop() {
+    while (true) {
+        SequenceCheckpoint checkpoint;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return has_pending_ || !running_; });
+            if (!has_pending_) {
+                return; // Stopped with nothing left to write
+            }
+            checkpoint = std::move(pending_);
+            has_pending_ = false;
+        }
+
+        if (commit_gate_ && !commit_gate_(checkpoint.timestamp_ns)) {
+            skipped_++;
+            std::cerr << "Checkpoint skipped: its marker did not reach the log; keeping the previous one" << std::endl;
+            continue;
+        }
+        try {
+            write_checkpoint(path_, checkpoint);
+            written_++;
+        } catch (const std::exception& e) {
+            failed_++;
+            std::cerr << "Checkpoint write failed: " << e.what() << std::endl;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "packet_types.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * Point-in-time copy of the sequence trackers
+ * timestamp_ns identifies the CHECKPOINT record logged with it, which splits
+ * the logged packets into "before" and "after" the checkpoint.
+ */
+struct SequenceCheckpoint {
+    uint64_t timestamp_ns = 0;
+    uint32_t layout_fingerprint = 0;                            // See BasicSequenceManager::layout_fingerprint
+    std::vector<std::pair<uint16_t, SequenceTracker>> trackers; // Tracker index -> state
+    std::vector<uint32_t> epochs;                               // Parallel to trackers: session epoch
+    std::vector<bool> session_ended;                            // Parallel to trackers: End of Session seen
+};
+
+/**
+ * Write a checkpoint atomically: temporary file, fsync, rename, fsync directory
+ * A crash at any point leaves either the previous or the new checkpoint.
+ * @throws std::runtime_error on I/O failure
+ */
+void write_checkpoint(const std::string& path, const SequenceCheckpoint& checkpoint);
+
+/**
+ * Read a checkpoint written by write_checkpoint
+ * @return false if the file does not exist
+ * @throws std::runtime_error on truncated or corrupt files
+ */
+bool read_checkpoint(const std::string& path, SequenceCheckpoint& checkpoint);
+
+/**
+ * Segments of a rotated binary log, newest first (base file, then .1, .2, ...)
+ * Only segments that exist are returned.
+ */
+std::vector<std::string> log_segments_newest_first(const std::string& log_file, int max_count);
+
+/**
+ * Visit the record headers of a binary log segment in order (payloads are skipped)
+ * The visitor returns false to stop early.
+ * @return false if the file could not be opened
+ */
+bool for_each_log_record(const std::string& path, const std::function<bool(const BinaryLogRecord&)>& visit);
+
+/**
+ * Like for_each_log_record, but also hands the visitor the stored payload
+ * (record.payload_length bytes, so only the part within max_logged_payload)
+ */
+bool for_each_log_record_with_payload(const std::string& path,
+                                      const std::function<bool(const BinaryLogRecord&, const char*)>& visit);
+
+/**
+ * Writes checkpoints to disk from a background thread
+ * The packet thread hands over a snapshot with offer(), which never blocks:
+ * if the writer is busy with the previous snapshot the offer is declined and
+ * the caller simply tries again at its next interval.
+ */
+class CheckpointWriter {
+public:
+    /**
+     * Called with a snapshot's timestamp before the snapshot is written; false
+     * skips it, so the file keeps the previous checkpoint
+     */
+    using CommitGate = std::function<bool(uint64_t timestamp_ns)>;
+
+    explicit CheckpointWriter(std::string path, CommitGate commit_gate = nullptr);
+    ~CheckpointWriter();
+
+    void start();
+
+    /**
+     * Stop the thread after writing any snapshot still pending
+     */
+    void stop();
+
+    /**
+     * Hand a snapshot to the writer thread
+     * @return false if the writer was busy and the snapshot was not taken
+     */
+    bool offer(SequenceCheckpoint&& checkpoint);
+
+    uint64_t get_written_count() const { return written_; }
+    uint64_t get_failed_count() const { return failed_; }
+    uint64_t get_skipped_count() const { return skipped_; }
+
+private:
+    std::string path_;
+    CommitGate commit_gate_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    SequenceCheckpoint pending_;
+    bool has_pending_;
+    bool running_;
+    std::thread thread_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> failed_;
+    std::atomic<uint64_t> skipped_;
+
+    void write_loop();
+};
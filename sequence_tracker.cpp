@@ -1,14 +1,28 @@
 #include "sequence_tracker.h"
 #include <algorithm>
 #include <limits>
+#include <stdexcept>
 
-OrderStatus SequenceManager::determine_order_status(uint32_t seq, uint8_t count, int port, uint8_t unit) {
+template <typename FeedPolicy>
+BasicSequenceManager<FeedPolicy>::BasicSequenceManager(const FeedPolicy& policy) : policy_(policy) {
+}
+
+template <typename FeedPolicy>
+OrderStatus BasicSequenceManager<FeedPolicy>::determine_order_status(uint32_t seq, uint8_t count, int port, uint8_t unit,
+                                                                     uint8_t session_events, bool may_reset) {
     if (seq == 0) {
         return OrderStatus::UNSEQUENCED;
     }
 
-    auto key = std::make_pair(port, static_cast<int>(unit));
-    auto& tracker = trackers_[key];
+    size_t index = tracker_index(port, unit);
+    auto& tracker = trackers_[index];
+    active_.set(index);
+    
+    // The packet itself is sequenced normally; the next session starts over at the bottom
+    bool session_ended = session_ended_.test(index);
+    if (session_events & SessionEvent::END_OF_SESSION) {
+        session_ended_.set(index);
+    }
 
     uint32_t message_count = (count > 0) ? static_cast<uint32_t>(count) : 1;
 
@@ -28,6 +42,21 @@ OrderStatus SequenceManager::determine_order_status(uint32_t seq, uint8_t count,
     
     uint32_t expected = tracker.last_confirmed_seq + 1;
     
+    // Back at the start of the sequence space: session rollover or sequence reset
+    if (may_reset && seq < expected && seq <= Config::SESSION_START_WINDOW) {
+        uint32_t position = std::max(tracker.last_confirmed_seq, tracker.highest_seen_seq);
+        bool cleared = (session_events & SessionEvent::UNIT_CLEAR) && position - seq > Config::SESSION_START_WINDOW;
+        if (session_ended || cleared || position - seq >= Config::SESSION_RESET_MIN_JUMP) {
+            start_new_epoch(port, unit);
+            tracker.last_confirmed_seq = seq + message_count - 1;
+            tracker.highest_seen_seq = seq + message_count - 1;
+            if (session_events & SessionEvent::END_OF_SESSION) {
+                session_ended_.set(index);
+            }
+            return OrderStatus::SEQUENCED_RESET;
+        }
+    }
+    
     // Exactly what we expected
     if (seq == expected) {
         tracker.last_confirmed_seq = seq + message_count - 1;
@@ -60,20 +89,193 @@ OrderStatus SequenceManager::determine_order_status(uint32_t seq, uint8_t count,
     }
     // Later than expected - early arrival
     else {
-        for (uint32_t i = 0; i < message_count; i++) {
-            tracker.pending_sequences[seq + i] = true;
+        uint32_t position = std::max(tracker.highest_seen_seq, tracker.last_confirmed_seq);
+        uint32_t first = seq;
+        
+        // A jump this far is only believed once a few consecutive packets agree;
+        // until then the packet costs nothing but a counter
+        if (seq > position && seq - position > max_jump_) {
+            Quarantine& quarantine = quarantine_[index];
+            if (quarantine.hits == 0 || seq != quarantine.next_seq) {
+                quarantine.first_seq = seq;
+                quarantine.hits = 0;
+            }
+            quarantine.hits++;
+            quarantine.next_seq = seq + message_count;
+            if (quarantine.hits < Config::QUARANTINE_CONFIRM_PACKETS) {
+                protection_.quarantined_packets++;
+                return OrderStatus::SEQUENCED_QUARANTINED;
+            }
+            first = quarantine.first_seq;  // The quarantined packets become pending as well
+            quarantine = Quarantine();
+            protection_.jumps_accepted++;
+        }
+        
+        if (report_gaps_) {
+            // Only the part beyond everything seen so far is new; earlier holes were already reported
+            uint32_t first_missing = std::max(expected, position + 1);
+            if (first > first_missing) {
+                new_gaps_.push_back({unit, first_missing, first - 1});
+            }
         }
-        tracker.highest_seen_seq = std::max(tracker.highest_seen_seq, seq + message_count - 1);
+        uint32_t last = seq + message_count - 1;
+        for (uint64_t s = first; s <= last; s++) {
+            tracker.pending_sequences[static_cast<uint32_t>(s)] = true;
+        }
+        tracker.highest_seen_seq = std::max(tracker.highest_seen_seq, last);
+        enforce_pending_budget(tracker);
         return OrderStatus::SEQUENCED_OUT_OF_ORDER_EARLY;
     }
 }
 
-const SequenceTracker* SequenceManager::get_tracker(int port, uint8_t unit) const {
-    auto key = std::make_pair(port, static_cast<int>(unit));
-    auto it = trackers_.find(key);
-    return (it != trackers_.end()) ? &it->second : nullptr;
+template <typename FeedPolicy>
+void BasicSequenceManager<FeedPolicy>::enforce_pending_budget(SequenceTracker& tracker) {
+    auto& pending = tracker.pending_sequences;
+    while (pending.size() > max_pending_) {
+        // Give up on the oldest hole and confirm the run that follows it
+        uint32_t oldest = pending.begin()->first;
+        protection_.holes_abandoned++;
+        protection_.messages_abandoned += oldest - tracker.last_confirmed_seq - 1;
+        tracker.last_confirmed_seq = oldest - 1;
+        while (!pending.empty() && pending.begin()->first == tracker.last_confirmed_seq + 1) {
+            tracker.last_confirmed_seq++;
+            pending.erase(pending.begin());
+        }
+    }
+}
+
+template <typename FeedPolicy>
+void BasicSequenceManager<FeedPolicy>::start_new_epoch(int port, uint8_t unit) {
+    size_t index = tracker_index(port, unit);
+    trackers_[index] = SequenceTracker();
+    active_.set(index);
+    session_ended_.reset(index);
+    quarantine_[index] = Quarantine();
+    epochs_[index]++;
+}
+
+template <typename FeedPolicy>
+const SequenceTracker* BasicSequenceManager<FeedPolicy>::get_tracker(int port, uint8_t unit) const {
+    size_t index = tracker_index(port, unit);
+    return active_.test(index) ? &trackers_[index] : nullptr;
+}
+
+template <typename FeedPolicy>
+void BasicSequenceManager<FeedPolicy>::clear() {
+    for (size_t i = 0; i < MAX_TRACKERS; i++) {
+        if (active_.test(i)) {
+            trackers_[i] = SequenceTracker();
+        }
+    }
+    active_.reset();
+    epochs_.fill(0);
+    session_ended_.reset();
+    quarantine_.fill(Quarantine());
+}
+
+template <typename FeedPolicy>
+std::vector<SequenceIntervalSet::Range> BasicSequenceManager<FeedPolicy>::missing_ranges(uint8_t unit, uint32_t first, uint32_t last) const {
+    SequenceIntervalSet received;
+    int lines = policy_.line_arbitration() ? 1 : 2;
+    for (int line = 0; line < lines; line++) {
+        size_t index = line * UNITS_PER_LINE + unit;
+        if (!active_.test(index)) {
+            continue;
+        }
+        const SequenceTracker& tracker = trackers_[index];
+        if (tracker.last_confirmed_seq >= first) {
+            received.insert(first, std::min(tracker.last_confirmed_seq, last));
+        }
+        for (auto it = tracker.pending_sequences.lower_bound(first);
+             it != tracker.pending_sequences.end() && it->first <= last; ++it) {
+            received.insert(it->first, it->first);
+        }
+    }
+    return received.missing(first, last);
+}
+
+template <typename FeedPolicy>
+bool BasicSequenceManager<FeedPolicy>::is_tracking_unit(uint8_t unit) const {
+    int lines = policy_.line_arbitration() ? 1 : 2;
+    for (int line = 0; line < lines; line++) {
+        if (active_.test(line * UNITS_PER_LINE + unit)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename FeedPolicy>
+void BasicSequenceManager<FeedPolicy>::splice_snapshot(uint8_t unit, uint32_t sequence) {
+    if (sequence == 0) {
+        return; // Empty image: the next live packet starts the trackers as usual
+    }
+    int lines = policy_.line_arbitration() ? 1 : 2;
+    for (int line = 0; line < lines; line++) {
+        size_t index = line * UNITS_PER_LINE + unit;
+        SequenceTracker& tracker = trackers_[index];
+        active_.set(index);
+        
+        tracker.last_confirmed_seq = std::max(tracker.last_confirmed_seq, sequence);
+        tracker.highest_seen_seq = std::max(tracker.highest_seen_seq, sequence);
+        auto& pending = tracker.pending_sequences;
+        pending.erase(pending.begin(), pending.upper_bound(tracker.last_confirmed_seq));
+        while (!pending.empty() && pending.begin()->first == tracker.last_confirmed_seq + 1) {
+            tracker.last_confirmed_seq++;
+            pending.erase(pending.begin());
+        }
+    }
+}
+
+template <typename FeedPolicy>
+uint32_t BasicSequenceManager<FeedPolicy>::layout_fingerprint() const {
+    uint32_t arbitration = policy_.line_arbitration() ? 1u : 0u;
+    return (static_cast<uint32_t>(policy_.port1()) ^ (static_cast<uint32_t>(policy_.port2()) << 16)) ^ (arbitration << 31);
+}
+
+template <typename FeedPolicy>
+void BasicSequenceManager<FeedPolicy>::save_state(SequenceCheckpoint& checkpoint) const {
+    checkpoint.layout_fingerprint = layout_fingerprint();
+    checkpoint.trackers.clear();
+    checkpoint.epochs.clear();
+    checkpoint.session_ended.clear();
+    checkpoint.trackers.reserve(active_.count());
+    checkpoint.epochs.reserve(active_.count());
+    for (size_t i = 0; i < MAX_TRACKERS; i++) {
+        if (active_.test(i)) {
+            checkpoint.trackers.emplace_back(static_cast<uint16_t>(i), trackers_[i]);
+            checkpoint.epochs.push_back(epochs_[i]);
+            checkpoint.session_ended.push_back(session_ended_.test(i));
+        }
+    }
+}
+
+template <typename FeedPolicy>
+size_t BasicSequenceManager<FeedPolicy>::restore_state(const SequenceCheckpoint& checkpoint) {
+    if (checkpoint.layout_fingerprint != layout_fingerprint()) {
+        throw std::runtime_error("checkpoint was taken with different ports or line arbitration");
+    }
+    for (const auto& entry : checkpoint.trackers) {
+        if (entry.first >= MAX_TRACKERS) {
+            throw std::runtime_error("checkpoint tracker index out of range");
+        }
+    }
+
+    clear();
+    for (size_t t = 0; t < checkpoint.trackers.size(); t++) {
+        const auto& [index, tracker] = checkpoint.trackers[t];
+        trackers_[index] = tracker;
+        active_.set(index);
+        if (t < checkpoint.epochs.size()) {
+            epochs_[index] = checkpoint.epochs[t];
+        }
+        if (t < checkpoint.session_ended.size()) {
+            session_ended_.set(index, checkpoint.session_ended[t]);
+        }
+    }
+    return checkpoint.trackers.size();
 }
 
-void SequenceManager::clear() {
-    trackers_.clear();
-}
\ No newline at end of file
+// Explicit instantiations for every supported feed policy
+template class BasicSequenceManager<DefaultFeedPolicy>;
+template class BasicSequenceManager<RuntimeFeedPolicy>;
\ No newline at end of file
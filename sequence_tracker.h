@@ -1,23 +1,82 @@
 #pragma once
 
 #include "packet_types.h"
-#include <map>
-#include <utility>
+#include "feed_policy.h"
+#include "sequence_checkpoint.h"
+#include "interval_set.h"
+#include <array>
+#include <bitset>
+#include <vector>
+
+/**
+ * Newly detected run of missing messages on one tracker
+ */
+struct SequenceGap {
+    uint8_t unit;
+    uint32_t first;
+    uint32_t last;
+};
 
 /**
  * Manages sequence tracking for CBOE packet ordering
+ * Trackers live in a flat table indexed by (line, unit); with line
+ * arbitration enabled both ports share one tracker per unit.
  */
-class SequenceManager {
+template <typename FeedPolicy>
+class BasicSequenceManager {
 public:
+    explicit BasicSequenceManager(const FeedPolicy& policy = FeedPolicy());
+
     /**
      * Determine order status for a packet
+     * A packet that goes back to the start of the sequence space begins a new
+     * session epoch on its tracker (SEQUENCED_RESET) when its sequence is at
+     * most SESSION_START_WINDOW and either an End of Session was seen on the
+     * tracker, it carries a Unit Clear and the tracker is more than
+     * SESSION_START_WINDOW past it (late copies from the other line are not
+     * resets), or the tracker is at least SESSION_RESET_MIN_JUMP past it.
      * @param seq Sequence number
      * @param count Message count in packet
      * @param port Port number
      * @param unit Unit identifier
+     * @param session_events SessionEvent flags found in the packet
+     * @param may_reset false for packets that are not live traffic (gap
+     *                  retransmissions, warm-restart replay): a late one with a
+     *                  low sequence is then a late or duplicate packet, never
+     *                  SEQUENCED_RESET, and the tracker is left in its epoch
      * @return OrderStatus enum value
      */
-    OrderStatus determine_order_status(uint32_t seq, uint8_t count, int port, uint8_t unit);
+    OrderStatus determine_order_status(uint32_t seq, uint8_t count, int port, uint8_t unit,
+                                       uint8_t session_events = SessionEvent::NONE, bool may_reset = true);
+    
+    /**
+     * Counters of the protection against implausible sequence numbers
+     */
+    struct ProtectionStats {
+        uint64_t quarantined_packets = 0;   // Forward jumps beyond max_jump not (yet) believed
+        uint64_t jumps_accepted = 0;        // Quarantined jumps confirmed by consecutive packets
+        uint64_t holes_abandoned = 0;       // Holes given up to stay within the pending budget
+        uint64_t messages_abandoned = 0;
+    };
+    
+    /**
+     * Bound the work and memory a single tracker can be made to spend
+     * @param max_jump Forward jump beyond the highest sequence seen that is quarantined
+     * @param max_pending Out-of-order entries kept before the oldest hole is given up
+     */
+    void set_limits(uint32_t max_jump, size_t max_pending) { max_jump_ = max_jump; max_pending_ = max_pending; }
+    
+    const ProtectionStats& get_protection_stats() const { return protection_; }
+    
+    /**
+     * Drop a tracker's state and count a new session epoch for it
+     */
+    void start_new_epoch(int port, uint8_t unit);
+    
+    /**
+     * Session epochs started on a tracker since the trackers were last cleared
+     */
+    uint32_t get_epoch(int port, uint8_t unit) const { return epochs_[tracker_index(port, unit)]; }
     
     /**
      * Get statistics for a specific port/unit combination
@@ -32,8 +91,87 @@ public:
     /**
      * Get total number of tracked units
      */
-    size_t get_tracker_count() const { return trackers_.size(); }
+    size_t get_tracker_count() const { return active_.count(); }
+    
+    /**
+     * Record a SequenceGap whenever a packet skips ahead of everything seen so far
+     */
+    void set_gap_reporting(bool enabled) { report_gaps_ = enabled; }
+    
+    /**
+     * Move gaps detected since the last call into gaps
+     */
+    void take_gaps(std::vector<SequenceGap>& gaps) { gaps.swap(new_gaps_); new_gaps_.clear(); }
+    
+    /**
+     * Messages of [first, last] that no line has delivered for this unit yet
+     */
+    std::vector<SequenceIntervalSet::Range> missing_ranges(uint8_t unit, uint32_t first, uint32_t last) const;
+    
+    /**
+     * True if any line has a tracker for this unit
+     */
+    bool is_tracking_unit(uint8_t unit) const;
+    
+    /**
+     * Align every line of a unit with a snapshot that covers messages up to sequence
+     * Confirms everything up to sequence, drops pending entries it covers and
+     * confirms any pending run that now follows on. Lines that never saw the
+     * unit start tracking it at sequence.
+     */
+    void splice_snapshot(uint8_t unit, uint32_t sequence);
+    
+    /**
+     * Identifier of the tracker table layout (ports and arbitration mode)
+     * Checkpoints are only valid for a manager with the same fingerprint.
+     */
+    uint32_t layout_fingerprint() const;
+    
+    /**
+     * Copy the state of every active tracker into a checkpoint
+     * Includes each tracker's session epoch and End of Session flag.
+     */
+    void save_state(SequenceCheckpoint& checkpoint) const;
+    
+    /**
+     * Replace all tracking data with the contents of a checkpoint
+     * @return Number of trackers restored
+     * @throws std::runtime_error if the checkpoint layout does not match
+     */
+    size_t restore_state(const SequenceCheckpoint& checkpoint);
 
 private:
-    std::map<std::pair<int, int>, SequenceTracker> trackers_;
-};
\ No newline at end of file
+    static constexpr size_t UNITS_PER_LINE = 256;
+    static constexpr size_t MAX_TRACKERS = 2 * UNITS_PER_LINE;
+
+    FeedPolicy policy_;
+    std::array<SequenceTracker, MAX_TRACKERS> trackers_;
+    std::bitset<MAX_TRACKERS> active_;
+    std::array<uint32_t, MAX_TRACKERS> epochs_{};
+    std::bitset<MAX_TRACKERS> session_ended_;   // End of Session seen in the current epoch
+    
+    // Run of consecutive packets beyond max_jump_ seen so far on a tracker
+    struct Quarantine {
+        uint32_t first_seq = 0;
+        uint32_t next_seq = 0;
+        int hits = 0;
+    };
+    std::array<Quarantine, MAX_TRACKERS> quarantine_{};
+    uint32_t max_jump_ = Config::MAX_SEQUENCE_JUMP;
+    size_t max_pending_ = Config::MAX_PENDING_SEQUENCES;
+    ProtectionStats protection_;
+    
+    /**
+     * Give up the oldest holes until the tracker is within max_pending_ entries
+     */
+    void enforce_pending_budget(SequenceTracker& tracker);
+    bool report_gaps_ = false;
+    std::vector<SequenceGap> new_gaps_;
+
+    size_t tracker_index(int port, uint8_t unit) const {
+        size_t line = policy_.line_arbitration() ? 0 : static_cast<size_t>(policy_.line_for_port(port));
+        return line * UNITS_PER_LINE + unit;
+    }
+};
+
+using SequenceManager = BasicSequenceManager<ActiveFeedPolicy>;
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "interval_set.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Duplicate and loss detection over a sliding window of message sequences
+ *
+ * A bitmap remembers which of the last 2^window_bits sequences below the
+ * highest one seen have arrived, so memory stays constant however long the
+ * stream runs. Sequences skipped by a forward jump are kept as open gaps in
+ * a SequenceIntervalSet; a late arrival closes its part of a gap, and gaps
+ * still open when they slide out of the window are counted as lost. Within
+ * the window every count is exact; a sequence older than the window is only
+ * counted as stale, since it can no longer be told from a duplicate.
+ *
+ * Counting starts at the first sequence recorded. Not thread-safe.
+ */
+class SequenceWindow {
+public:
+    // Classification of one packet, by its most significant message
+    enum class Result {
+        IN_ORDER,       // Continues the stream
+        GAP,            // Skipped ahead: sequences are missing before it
+        LATE,           // Filled (part of) an open gap
+        DUPLICATE,      // Every message was seen before
+        STALE           // Older than the window
+    };
+
+    // Message counts
+    struct Statistics {
+        uint64_t received = 0;      // Distinct messages
+        uint64_t duplicates = 0;
+        uint64_t late = 0;          // Received after a later sequence
+        uint64_t stale = 0;         // Arrived below the window
+        uint64_t lost = 0;          // Gaps that left the window unfilled
+    };
+
+    explicit SequenceWindow(int window_bits = 20)
+        : size_(1ULL << std::max(window_bits, 6)), bits_(size_ / 64, 0) {}
+
+    /**
+     * Record a packet of count messages starting at first
+     * Packets without messages (count 0) are not recorded.
+     */
+    Result record(uint32_t first, uint32_t count) {
+        if (count == 0) {
+            return Result::IN_ORDER;
+        }
+        uint64_t begin = first;
+        uint64_t end = begin + count;   // Exclusive
+        if (!started_) {
+            next_ = begin;
+            started_ = true;
+        }
+
+        uint64_t previous_next = next_;
+        bool gap = false;
+        if (begin > next_) {
+            gaps_.insert(static_cast<uint32_t>(next_), static_cast<uint32_t>(begin - 1));
+            gap = true;
+        }
+        if (end > next_) {
+            advance(end);
+        }
+
+        uint64_t fresh = 0, late = 0, duplicates = 0, stale = 0;
+        for (uint64_t seq = begin; seq < end; seq++) {
+            if (seq + size_ < next_) {
+                stale++;
+            } else if (test(seq)) {
+                duplicates++;
+            } else {
+                set(seq);
+                fresh++;
+                if (seq < previous_next) {
+                    late++;
+                    gaps_.erase(static_cast<uint32_t>(seq), static_cast<uint32_t>(seq));
+                }
+            }
+        }
+        stats_.received += fresh;
+        stats_.late += late;
+        stats_.duplicates += duplicates;
+        stats_.stale += stale;
+
+        if (late != 0) {
+            return Result::LATE;
+        }
+        if (fresh == 0) {
+            return stale != 0 ? Result::STALE : Result::DUPLICATE;
+        }
+        return gap ? Result::GAP : Result::IN_ORDER;
+    }
+
+    const Statistics& statistics() const { return stats_; }
+
+    /**
+     * Messages lost so far: closed gaps plus gaps still open in the window
+     */
+    uint64_t missing() const { return stats_.lost + gaps_.covered(); }
+
+    /**
+     * Gaps that may still be filled
+     */
+    const SequenceIntervalSet& open_gaps() const { return gaps_; }
+
+    /**
+     * Highest sequence recorded (0 before the first packet)
+     */
+    uint64_t highest() const { return started_ ? next_ - 1 : 0; }
+
+private:
+    uint64_t size_;
+    std::vector<uint64_t> bits_;
+    uint64_t next_ = 0;             // One past the highest sequence recorded
+    bool started_ = false;
+    SequenceIntervalSet gaps_;
+    Statistics stats_;
+
+    bool test(uint64_t seq) const { return bits_[(seq & (size_ - 1)) / 64] >> (seq % 64) & 1; }
+    void set(uint64_t seq) { bits_[(seq & (size_ - 1)) / 64] |= 1ULL << (seq % 64); }
+    void clear(uint64_t seq) { bits_[(seq & (size_ - 1)) / 64] &= ~(1ULL << (seq % 64)); }
+
+    /**
+     * Move the top of the window to new_next: gaps that fall below the
+     * window are closed as lost, and the reused bitmap slots are cleared
+     */
+    void advance(uint64_t new_next) {
+        uint64_t new_base = new_next > size_ ? new_next - size_ : 0;
+        if (!gaps_.empty() && gaps_.min() < new_base) {
+            uint64_t open = gaps_.covered();
+            gaps_.erase(gaps_.min(), static_cast<uint32_t>(new_base - 1));
+            stats_.lost += open - gaps_.covered();
+        }
+        if (new_next - next_ >= size_) {
+            std::fill(bits_.begin(), bits_.end(), 0);
+        } else {
+            for (uint64_t seq = next_; seq < new_next; seq++) {
+                clear(seq);
+            }
+        }
+        next_ = new_next;
+    }
+};
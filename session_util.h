@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+/**
+ * Helpers shared by the TCP session clients (GRP and spin server)
+ */
+
+/**
+ * Copy a login field, right-padded with spaces and cut to size
+ */
+inline void copy_padded(char* dest, size_t size, const std::string& value) {
+    std::memset(dest, ' ', size);
+    std::memcpy(dest, value.data(), std::min(size, value.size()));
+}
+
+/**
+ * Wake the session thread polling an eventfd
+ */
+inline void signal_event(int fd) {
+    uint64_t one = 1;
+    ssize_t ignored = ::write(fd, &one, sizeof(one));
+    (void)ignored;
+}
+
+/**
+ * Reset an eventfd after its wakeup was seen
+ */
+inline void clear_event(int fd) {
+    uint64_t value;
+    ssize_t ignored = ::read(fd, &value, sizeof(value));
+    (void)ignored;
+}
@@ -0,0 +1,233 @@
+#include "shm_ring.h"
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Segment header; the lane control blocks and then the lane data follow
+struct ShmChannel::Header {
+    std::atomic<uint64_t> magic;                    // Stored last by the producer
+    uint32_t lanes;
+    uint64_t lane_bytes;
+    std::atomic<int32_t> producer_pid;
+    alignas(64) std::atomic<int32_t> consumer_pid;
+    alignas(64) std::atomic<uint32_t> consumer_sleeping;
+    std::atomic<uint32_t> wake_seq;                 // Futex word
+};
+
+namespace {
+
+constexpr size_t DATA_ALIGN = 4096;
+
+size_t data_offset(int lanes, size_t header_size, size_t lane_size) {
+    size_t control = header_size + lane_size * static_cast<size_t>(lanes);
+    return (control + DATA_ALIGN - 1) & ~(DATA_ALIGN - 1);
+}
+
+// Liveness locks: the producer holds byte 0 of the file, the consumer byte 1
+constexpr off_t PRODUCER_LOCK = 0;
+constexpr off_t CONSUMER_LOCK = 1;
+
+bool lock_byte(int fd, off_t offset) {
+    struct flock lock = {};
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = offset;
+    lock.l_len = 1;
+    return fcntl(fd, F_OFD_SETLK, &lock) == 0;
+}
+
+bool byte_locked(int fd, off_t offset) {
+    struct flock lock = {};
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = offset;
+    lock.l_len = 1;
+    return fcntl(fd, F_OFD_GETLK, &lock) == 0 && lock.l_type != F_UNLCK;
+}
+
+long futex(std::atomic<uint32_t>& word, int op, uint32_t value, const struct timespec* timeout) {
+    // Not FUTEX_PRIVATE_FLAG: the word is shared between processes
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), op, value, timeout, nullptr, 0);
+}
+
+} // namespace
+
+ShmChannel::ShmChannel(void* base, size_t size, int fd, bool producer)
+    : base_(base), size_(size), fd_(fd), producer_(producer), header_(static_cast<Header*>(base)),
+      lanes_(static_cast<int>(header_->lanes)), lane_bytes_(header_->lane_bytes) {
+    char* bytes = static_cast<char*>(base);
+    for (int i = 0; i < lanes_; i++) {
+        lane_headers_[i] = reinterpret_cast<Lane*>(bytes + sizeof(Header) + i * sizeof(Lane));
+        lane_data_[i] = bytes + data_offset(lanes_, sizeof(Header), sizeof(Lane)) + i * lane_bytes_;
+        // A consumer resumes where the previous one stopped; the producer starts at the head
+        cursors_[i].position = producer ? lane_head(i).load() : lane_tail(i).load();
+        cursors_[i].cached_tail = lane_tail(i).load();
+    }
+}
+
+ShmChannel::~ShmChannel() {
+    if (producer_) {
+        header_->producer_pid.store(0);
+    } else {
+        header_->consumer_pid.store(0);
+    }
+    munmap(base_, size_);
+    close(fd_);
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::create(const std::string& name, int lanes, size_t lane_bytes) {
+    if (lanes < 1 || lanes > MAX_LANES) {
+        throw std::runtime_error("shared memory channel needs 1-" + std::to_string(MAX_LANES) + " lanes");
+    }
+    size_t bytes = DATA_ALIGN;
+    while (bytes < lane_bytes) {
+        bytes <<= 1;
+    }
+    size_t size = data_offset(lanes, sizeof(Header), sizeof(Lane)) + bytes * lanes;
+
+    // A fresh file each time, so a consumer still mapping the old one notices the restart
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("shm_open " + name + ": " + strerror(errno));
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) < 0) {
+        int error = errno;
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("ftruncate " + name + ": " + strerror(error));
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED || !lock_byte(fd, PRODUCER_LOCK)) {
+        int error = errno;
+        if (base != MAP_FAILED) {
+            munmap(base, size);
+        }
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("mmap/lock " + name + ": " + strerror(error));
+    }
+
+    // ftruncate zero-fills, so the positions and flags start at zero
+    Header* header = static_cast<Header*>(base);
+    header->lanes = static_cast<uint32_t>(lanes);
+    header->lane_bytes = bytes;
+    header->producer_pid.store(getpid());
+    header->magic.store(MAGIC, std::memory_order_release);
+    return std::unique_ptr<ShmChannel>(new ShmChannel(base, size, fd, true));
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::attach(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < DATA_ALIGN) {
+        close(fd);
+        return nullptr;   // Still being set up
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error("mmap " + name + ": " + strerror(error));
+    }
+
+    Header* header = static_cast<Header*>(base);
+    if (header->magic.load(std::memory_order_acquire) != MAGIC) {
+        munmap(base, size);
+        close(fd);
+        return nullptr;   // Not initialised yet
+    }
+    if (header->lanes < 1 || header->lanes > MAX_LANES ||
+        data_offset(static_cast<int>(header->lanes), sizeof(Header), sizeof(Lane)) + header->lane_bytes * header->lanes != size) {
+        munmap(base, size);
+        close(fd);
+        throw std::runtime_error(name + " is not a ring segment of this version");
+    }
+    if (!lock_byte(fd, CONSUMER_LOCK)) {
+        munmap(base, size);
+        close(fd);
+        throw std::runtime_error(name + " already has a consumer");
+    }
+    header->consumer_pid.store(getpid());
+    return std::unique_ptr<ShmChannel>(new ShmChannel(base, size, fd, false));
+}
+
+bool ShmChannel::write(int lane, const char* data, size_t len) {
+    Cursor& cursor = cursors_[lane];
+    size_t need = record_size(len);
+    if (need > lane_bytes_ / 2) {
+        return false;   // Could never be placed without wrapping over unread data
+    }
+    size_t offset = cursor.position & (lane_bytes_ - 1);
+    size_t room_to_end = lane_bytes_ - offset;
+    size_t total = (need <= room_to_end) ? need : room_to_end + need;
+    if (cursor.position + total - cursor.cached_tail > lane_bytes_) {
+        cursor.cached_tail = lane_tail(lane).load(std::memory_order_acquire);
+        if (cursor.position + total - cursor.cached_tail > lane_bytes_) {
+            return false;
+        }
+    }
+
+    char* ring = lane_data_[lane];
+    if (need > room_to_end) {
+        uint32_t marker = WRAP_MARKER;
+        memcpy(ring + offset, &marker, sizeof(marker));
+        cursor.position += room_to_end;
+        offset = 0;
+    }
+    uint32_t length = static_cast<uint32_t>(len);
+    memcpy(ring + offset, &length, sizeof(length));
+    memcpy(ring + offset + sizeof(length), data, len);
+    cursor.position += need;
+    lane_head(lane).store(cursor.position, std::memory_order_release);
+    return true;
+}
+
+void ShmChannel::notify() {
+    // Pairs with the fence in wait(): either the consumer sees the new head
+    // before sleeping, or this load sees it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->consumer_sleeping.load(std::memory_order_relaxed)) {
+        header_->wake_seq.fetch_add(1, std::memory_order_relaxed);
+        futex(header_->wake_seq, FUTEX_WAKE, INT_MAX, nullptr);
+    }
+}
+
+void ShmChannel::wait(int timeout_ms) {
+    header_->consumer_sleeping.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    uint32_t seq = header_->wake_seq.load(std::memory_order_relaxed);
+    for (int i = 0; i < lanes_; i++) {
+        if (lane_head(i).load(std::memory_order_acquire) != cursors_[i].position) {
+            header_->consumer_sleeping.store(0, std::memory_order_relaxed);
+            return;
+        }
+    }
+    struct timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    futex(header_->wake_seq, FUTEX_WAIT, seq, &timeout);
+    header_->consumer_sleeping.store(0, std::memory_order_relaxed);
+}
+
+bool ShmChannel::peer_alive() const {
+    if (producer_) {
+        // Before the first consumer attaches there is nobody to lose
+        return header_->consumer_pid.load() == 0 || byte_locked(fd_, CONSUMER_LOCK);
+    }
+    return byte_locked(fd_, PRODUCER_LOCK);
+}
+
+pid_t ShmChannel::producer_pid() const {
+    return header_->producer_pid.load();
+}
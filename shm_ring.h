@@ -0,0 +1,159 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * Shared-memory transport between zmq_bridge and packet_logger_zmq
+ *
+ * A /dev/shm segment holds one single-producer single-consumer ring per lane
+ * (one lane per UDP port). Messages are bridge frames, stored as a 4-byte
+ * length and the frame bytes, padded to 8 bytes; a frame that would cross
+ * the end of a lane is preceded by a wrap marker. Head (producer) and tail
+ * (consumer) positions live on separate cache lines; the producer works
+ * from a private copy of the tail and only reloads it when the lane looks
+ * full, and the consumer publishes its tail once per read() batch.
+ *
+ * An idle consumer sleeps on a futex in the segment header; the producer
+ * wakes it from notify(), which costs one fence and one load while the
+ * consumer is awake. Each side holds a lock on its own byte of the segment
+ * file, which the kernel drops when the process exits however it dies, so
+ * the other side can tell a crashed peer from a slow one.
+ *
+ * The producer creates the segment (replacing any previous one) and the
+ * consumer attaches to it by name; a consumer that outlives a producer
+ * re-attaches to the next segment created under the same name.
+ */
+class ShmChannel {
+public:
+    static constexpr uint64_t MAGIC = 0x31474e4952424d43ULL;  // "CMBRING1"
+    static constexpr int MAX_LANES = 8;
+
+    ~ShmChannel();
+
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    /**
+     * Create a segment for writing (producer)
+     * @param lane_bytes Ring size per lane; rounded up to a power of two
+     * @throws std::runtime_error if the segment cannot be created
+     */
+    static std::unique_ptr<ShmChannel> create(const std::string& name, int lanes, size_t lane_bytes);
+
+    /**
+     * Attach to a segment for reading (consumer)
+     * @return nullptr if no producer has created the segment yet
+     * @throws std::runtime_error if the segment exists but is not a ring
+     */
+    static std::unique_ptr<ShmChannel> attach(const std::string& name);
+
+    // ---- Producer ----
+
+    /**
+     * Append one message to a lane
+     * @return false if the lane is full (the message is not written)
+     */
+    bool write(int lane, const char* data, size_t len);
+
+    /**
+     * Wake the consumer if it is sleeping; call after a burst of writes
+     */
+    void notify();
+
+    // ---- Consumer ----
+
+    /**
+     * Call fn(data, len) for every message waiting in a lane, then free them
+     * @return Number of messages delivered
+     */
+    template <typename Fn>
+    size_t read(int lane, Fn&& fn);
+
+    /**
+     * Sleep until the producer notifies or timeout_ms passes
+     * Returns at once if any lane already has data.
+     */
+    void wait(int timeout_ms);
+
+    // ---- Either side ----
+
+    /**
+     * True while the process on the other end exists (or has not attached yet)
+     */
+    bool peer_alive() const;
+
+    int lanes() const { return lanes_; }
+    size_t lane_bytes() const { return lane_bytes_; }
+    pid_t producer_pid() const;
+
+private:
+    struct Header;
+    struct Lane;
+
+    // Producer/consumer private cursors, one per lane
+    struct Cursor {
+        uint64_t position = 0;       // Own head (producer) or tail (consumer)
+        uint64_t cached_tail = 0;    // Producer: last tail read from the lane
+    };
+
+    ShmChannel(void* base, size_t size, int fd, bool producer);
+
+    static constexpr uint32_t WRAP_MARKER = 0xFFFFFFFFu;
+    static size_t record_size(size_t len) { return (sizeof(uint32_t) + len + 7) & ~size_t(7); }
+
+    void* base_;
+    size_t size_;
+    int fd_;                         // Kept open for the liveness locks
+    bool producer_;
+    Header* header_;
+    int lanes_;
+    size_t lane_bytes_;
+    Lane* lane_headers_[MAX_LANES];
+    char* lane_data_[MAX_LANES];
+    Cursor cursors_[MAX_LANES];
+
+    std::atomic<uint64_t>& lane_head(int lane);
+    std::atomic<uint64_t>& lane_tail(int lane);
+};
+
+// Lane control block: producer and consumer positions on separate cache lines
+struct ShmChannel::Lane {
+    alignas(64) std::atomic<uint64_t> head;    // Bytes ever written (producer)
+    alignas(64) std::atomic<uint64_t> tail;    // Bytes ever consumed (consumer)
+};
+
+inline std::atomic<uint64_t>& ShmChannel::lane_head(int lane) { return lane_headers_[lane]->head; }
+inline std::atomic<uint64_t>& ShmChannel::lane_tail(int lane) { return lane_headers_[lane]->tail; }
+
+template <typename Fn>
+size_t ShmChannel::read(int lane, Fn&& fn) {
+    Cursor& cursor = cursors_[lane];
+    uint64_t head = lane_head(lane).load(std::memory_order_acquire);
+    if (head == cursor.position) {
+        return 0;
+    }
+
+    const char* data = lane_data_[lane];
+    size_t mask = lane_bytes_ - 1;
+    size_t delivered = 0;
+    while (cursor.position != head) {
+        size_t offset = cursor.position & mask;
+        uint32_t len;
+        memcpy(&len, data + offset, sizeof(len));
+        if (len == WRAP_MARKER) {
+            cursor.position += lane_bytes_ - offset;
+            continue;
+        }
+        fn(data + offset + sizeof(len), static_cast<size_t>(len));
+        cursor.position += record_size(len);
+        delivered++;
+    }
+    lane_tail(lane).store(cursor.position, std::memory_order_release);
+    return delivered;
+}
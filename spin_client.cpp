@@ -0,0 +1,404 @@
+#include "spin_client.h"
+#include "session_util.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr auto HEARTBEAT_INTERVAL = std::chrono::seconds(1);
+
+} // namespace
+
+SpinClient::SpinClient(const RuntimeConfig& config, int wakeup_fd)
+    : servers_(config.spin_servers),
+      session_sub_id_(config.spin_session_sub_id),
+      username_(config.spin_username),
+      password_(config.spin_password),
+      timeout_(config.spin_timeout_ms),
+      command_event_fd_(-1),
+      events_ready_(false),
+      wakeup_fd_(wakeup_fd),
+      running_(false) {
+    command_event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (command_event_fd_ < 0) {
+        throw std::runtime_error("Failed to create spin eventfd: " + std::string(strerror(errno)));
+    }
+}
+
+SpinClient::~SpinClient() {
+    stop();
+    if (command_event_fd_ >= 0) close(command_event_fd_);
+}
+
+void SpinClient::start() {
+    running_ = true;
+    thread_ = std::thread(&SpinClient::run, this);
+}
+
+void SpinClient::stop() {
+    running_ = false;
+    if (thread_.joinable()) {
+        signal_event(command_event_fd_);
+        thread_.join();
+    }
+    for (auto& session : sessions_) {
+        if (session.sock >= 0) {
+            close(session.sock);
+        }
+    }
+    sessions_.clear();
+}
+
+bool SpinClient::request_spin(uint8_t unit) {
+    auto it = std::find_if(servers_.begin(), servers_.end(), [unit](const SpinServer& s) { return s.unit == unit; });
+    if (it == servers_.end()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(command_mutex_);
+        commands_.push_back({unit, false});
+    }
+    signal_event(command_event_fd_);
+    return true;
+}
+
+void SpinClient::cancel_spin(uint8_t unit) {
+    {
+        std::lock_guard<std::mutex> lock(command_mutex_);
+        commands_.push_back({unit, true});
+    }
+    signal_event(command_event_fd_);
+}
+
+void SpinClient::take_events(std::vector<Event>& events) {
+    std::lock_guard<std::mutex> lock(event_mutex_);
+    events.swap(events_);
+    events_.clear();
+    events_ready_.store(false, std::memory_order_relaxed);
+}
+
+void SpinClient::run() {
+    std::vector<struct pollfd> fds;
+
+    while (running_) {
+        accept_commands();
+
+        fds.resize(sessions_.size() + 1);
+        fds[0].fd = command_event_fd_;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < sessions_.size(); i++) {
+            const Session& session = sessions_[i];
+            fds[i + 1].fd = session.sock;
+            fds[i + 1].events = POLLIN;
+            if (session.state == State::CONNECTING || !session.outbound.empty()) {
+                fds[i + 1].events |= POLLOUT;
+            }
+            fds[i + 1].revents = 0;
+        }
+
+        // Short timeout keeps heartbeats and spin deadlines on schedule
+        int ready = poll(fds.data(), fds.size(), 50);
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "Spin poll error: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            clear_event(command_event_fd_);
+        }
+
+        for (size_t i = 0; i < sessions_.size(); i++) {
+            Session& session = sessions_[i];
+            short revents = (ready > 0) ? fds[i + 1].revents : 0;
+            if (session.sock < 0 || !revents) {
+                continue;
+            }
+            if (session.state == State::CONNECTING && (revents & (POLLOUT | POLLERR | POLLHUP))) {
+                int error = 0;
+                socklen_t len = sizeof(error);
+                getsockopt(session.sock, SOL_SOCKET, SO_ERROR, &error, &len);
+                if (error != 0) {
+                    finish_session(session, false, "connect failed: " + std::string(strerror(error)));
+                    continue;
+                }
+                session.state = State::LOGGING_IN;
+
+                GrpLoginMessage login{};
+                login.length = sizeof(GrpLoginMessage);
+                login.message_type = GrpMessageType::LOGIN;
+                copy_padded(login.session_sub_id, sizeof(login.session_sub_id), session_sub_id_);
+                copy_padded(login.username, sizeof(login.username), username_);
+                copy_padded(login.filler, sizeof(login.filler), "");
+                copy_padded(login.password, sizeof(login.password), password_);
+                queue_packet(session, reinterpret_cast<const char*>(&login), sizeof(login));
+            } else if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                read_inbound(session);
+            }
+        }
+
+        auto now = Clock::now();
+        for (auto& session : sessions_) {
+            if (session.sock < 0) {
+                continue;
+            }
+            if (now > session.deadline) {
+                finish_session(session, false, "timed out");
+                continue;
+            }
+            if (session.state == State::CONNECTING) {
+                continue;
+            }
+            if (session.outbound.empty() && now - session.last_sent >= HEARTBEAT_INTERVAL) {
+                queue_packet(session, nullptr, 0);
+            }
+            flush_outbound(session);
+        }
+
+        sessions_.erase(std::remove_if(sessions_.begin(), sessions_.end(),
+                                       [](const Session& s) { return s.sock < 0; }),
+                        sessions_.end());
+    }
+}
+
+void SpinClient::accept_commands() {
+    std::vector<Command> commands;
+    {
+        std::lock_guard<std::mutex> lock(command_mutex_);
+        commands.swap(commands_);
+    }
+    for (const auto& command : commands) {
+        auto session = std::find_if(sessions_.begin(), sessions_.end(), [&](const Session& s) {
+            return s.sock >= 0 && s.server.unit == command.unit;
+        });
+        if (command.cancel) {
+            if (session != sessions_.end()) {
+                finish_session(*session, false, "cancelled");
+            }
+            continue;
+        }
+        if (session != sessions_.end()) {
+            continue; // One spin per unit at a time
+        }
+        auto server = std::find_if(servers_.begin(), servers_.end(), [&](const SpinServer& s) {
+            return s.unit == command.unit;
+        });
+        if (server != servers_.end()) {
+            stats_.spins_requested++;
+            open_session(*server);
+        }
+    }
+}
+
+void SpinClient::open_session(const SpinServer& server) {
+    sessions_.emplace_back();
+    Session& session = sessions_.back();
+    session.server = server;
+    session.deadline = Clock::now() + timeout_;
+    session.last_sent = Clock::now();
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* result = nullptr;
+    std::string port = std::to_string(server.port);
+    int rc = getaddrinfo(server.host.c_str(), port.c_str(), &hints, &result);
+    if (rc != 0 || !result) {
+        finish_session(session, false, "cannot resolve " + server.host + ": " + gai_strerror(rc));
+        return;
+    }
+
+    session.sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (session.sock < 0) {
+        freeaddrinfo(result);
+        finish_session(session, false, "socket failed: " + std::string(strerror(errno)));
+        return;
+    }
+    int nodelay = 1;
+    setsockopt(session.sock, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+
+    rc = ::connect(session.sock, result->ai_addr, result->ai_addrlen);
+    freeaddrinfo(result);
+    if (rc < 0 && errno != EINPROGRESS) {
+        finish_session(session, false, "connect failed: " + std::string(strerror(errno)));
+    }
+}
+
+void SpinClient::finish_session(Session& session, bool success, const std::string& reason) {
+    if (session.sock >= 0) {
+        close(session.sock);
+        session.sock = -1;
+    }
+    const SpinServer& server = session.server;
+    if (success) {
+        stats_.spins_finished++;
+        deliver({Event::Type::FINISHED, server.unit, server.port, session.image_sequence, std::string()});
+    } else {
+        stats_.spins_failed++;
+        deliver({Event::Type::FAILED, server.unit, server.port, 0, reason});
+    }
+}
+
+void SpinClient::queue_packet(Session& session, const char* message, size_t len) {
+    CboeSequencedUnitHeader header{};
+    header.hdr_length = htole16(static_cast<uint16_t>(sizeof(header) + len));
+    header.hdr_count = message ? 1 : 0;
+    header.hdr_unit = 0;
+    header.hdr_sequence = 0;
+    session.outbound.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (message) {
+        session.outbound.append(message, len);
+    }
+}
+
+bool SpinClient::flush_outbound(Session& session) {
+    while (!session.outbound.empty()) {
+        ssize_t n = ::send(session.sock, session.outbound.data(), session.outbound.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            finish_session(session, false, "send failed: " + std::string(strerror(errno)));
+            return false;
+        }
+        session.outbound.erase(0, static_cast<size_t>(n));
+        session.last_sent = Clock::now();
+    }
+    return true;
+}
+
+bool SpinClient::read_inbound(Session& session) {
+    char buffer[64 * 1024];
+    while (true) {
+        ssize_t n = ::recv(session.sock, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            session.inbound.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0) {
+            finish_session(session, false, "closed by server");
+            return false;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        finish_session(session, false, "receive failed: " + std::string(strerror(errno)));
+        return false;
+    }
+
+    // Split the stream into sequenced units: unit 0 carries session messages,
+    // units of the spun unit carry the image
+    size_t offset = 0;
+    std::string& inbound = session.inbound;
+    while (inbound.size() - offset >= sizeof(CboeSequencedUnitHeader)) {
+        const auto* header = reinterpret_cast<const CboeSequencedUnitHeader*>(inbound.data() + offset);
+        uint16_t length = le16toh_safe(header->hdr_length);
+        if (length < sizeof(CboeSequencedUnitHeader)) {
+            finish_session(session, false, "malformed packet length " + std::to_string(length));
+            return false;
+        }
+        if (inbound.size() - offset < length) {
+            break;
+        }
+
+        if (header->hdr_unit == 0) {
+            size_t message_offset = offset + sizeof(CboeSequencedUnitHeader);
+            while (message_offset + sizeof(CboeMessageHeader) <= offset + length) {
+                const auto* message = reinterpret_cast<const CboeMessageHeader*>(inbound.data() + message_offset);
+                if (message->length < sizeof(CboeMessageHeader) || message_offset + message->length > offset + length) {
+                    break;
+                }
+                if (!handle_message(session, inbound.data() + message_offset, message->length)) {
+                    return false;
+                }
+                message_offset += message->length;
+            }
+        } else if (session.state == State::RECEIVING && header->hdr_unit == session.server.unit) {
+            stats_.image_packets++;
+            deliver({Event::Type::IMAGE_PACKET, session.server.unit, session.server.port, 0,
+                     std::string(inbound.data() + offset, length)});
+        }
+        offset += length;
+    }
+    inbound.erase(0, offset);
+    return true;
+}
+
+bool SpinClient::handle_message(Session& session, const char* message, size_t len) {
+    uint8_t type = reinterpret_cast<const CboeMessageHeader*>(message)->message_type;
+    int unit = session.server.unit;
+
+    if (type == GrpMessageType::LOGIN_RESPONSE && len >= sizeof(GrpLoginResponseMessage)) {
+        const auto* response = reinterpret_cast<const GrpLoginResponseMessage*>(message);
+        if (session.state != State::LOGGING_IN) {
+            return true;
+        }
+        if (response->status != 'A') {
+            finish_session(session, false, "login rejected with status '" + std::string(1, static_cast<char>(response->status)) + "'");
+            return false;
+        }
+        session.state = State::AWAITING_IMAGE;
+    } else if (type == SpinMessageType::IMAGE_AVAILABLE && len >= sizeof(SpinImageAvailableMessage)) {
+        if (session.state != State::AWAITING_IMAGE) {
+            return true;
+        }
+        const auto* available = reinterpret_cast<const SpinImageAvailableMessage*>(message);
+        session.image_sequence = le32toh_safe(available->sequence);
+
+        SpinRequestMessage request{};
+        request.length = sizeof(SpinRequestMessage);
+        request.message_type = SpinMessageType::REQUEST;
+        request.sequence = htole32(session.image_sequence);
+        queue_packet(session, reinterpret_cast<const char*>(&request), sizeof(request));
+        session.state = State::REQUESTED;
+    } else if (type == SpinMessageType::RESPONSE && len >= sizeof(SpinResponseMessage)) {
+        if (session.state != State::REQUESTED) {
+            return true;
+        }
+        const auto* response = reinterpret_cast<const SpinResponseMessage*>(message);
+        if (response->status == 'A') {
+            session.state = State::RECEIVING;
+            std::cout << "Spin of unit " << unit << " accepted: " << le32toh_safe(response->order_count)
+                      << " messages up to sequence " << session.image_sequence << std::endl;
+        } else if (response->status == 'O') {
+            session.state = State::AWAITING_IMAGE; // Image aged out; take the next offer
+        } else {
+            finish_session(session, false, "spin request rejected with status '" + std::string(1, static_cast<char>(response->status)) + "'");
+            return false;
+        }
+    } else if (type == SpinMessageType::FINISHED && len >= sizeof(SpinFinishedMessage)) {
+        if (session.state != State::RECEIVING) {
+            return true;
+        }
+        const auto* finished = reinterpret_cast<const SpinFinishedMessage*>(message);
+        session.image_sequence = le32toh_safe(finished->sequence);
+        finish_session(session, true, std::string());
+        return false;
+    }
+    return true;
+}
+
+void SpinClient::deliver(Event&& event) {
+    {
+        std::lock_guard<std::mutex> lock(event_mutex_);
+        events_.push_back(std::move(event));
+        events_ready_.store(true, std::memory_order_relaxed);
+    }
+    signal_event(wakeup_fd_);
+}
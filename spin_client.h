@@ -0,0 +1,132 @@
+#pragma once
+
+#include "packet_types.h"
+#include "runtime_config.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Asynchronous spin server client for snapshot recovery
+ *
+ * A spin replays the current image of a unit (the open orders) over TCP,
+ * which is far cheaper than requesting a large gap message by message. Each
+ * spin opens its own session to the unit's server from spin_servers: log in,
+ * wait for a Spin Image Available offer, request that image, then receive
+ * image packets until Spin Finished. The session is closed afterwards.
+ *
+ * The packet thread starts spins (request_spin) and collects events
+ * (take_events); neither call waits on the network. Image packets are
+ * handed over as they arrive, followed by exactly one FINISHED or FAILED
+ * event per spin.
+ */
+class SpinClient {
+public:
+    struct Event {
+        enum class Type { IMAGE_PACKET, FINISHED, FAILED };
+        Type type;
+        uint8_t unit;
+        uint16_t port;          // Spin server port, logged as the packet's port
+        uint32_t sequence;      // FINISHED: image is current up to this sequence
+        std::string packet;     // IMAGE_PACKET: one sequenced unit; FAILED: reason
+    };
+
+    struct Statistics {
+        std::atomic<uint64_t> spins_requested{0};
+        std::atomic<uint64_t> spins_finished{0};
+        std::atomic<uint64_t> spins_failed{0};
+        std::atomic<uint64_t> image_packets{0};
+    };
+
+    /**
+     * @param wakeup_fd eventfd signalled whenever events become available
+     */
+    SpinClient(const RuntimeConfig& config, int wakeup_fd);
+    ~SpinClient();
+
+    void start();
+    void stop();
+
+    /**
+     * Start a spin of a unit (packet thread)
+     * @return false if no spin server is configured for the unit
+     */
+    bool request_spin(uint8_t unit);
+
+    /**
+     * Abandon a running spin; a FAILED event follows
+     */
+    void cancel_spin(uint8_t unit);
+
+    /**
+     * True when events are waiting (one relaxed load)
+     */
+    bool has_events() const { return events_ready_.load(std::memory_order_relaxed); }
+
+    /**
+     * Move all waiting events into events (packet thread)
+     */
+    void take_events(std::vector<Event>& events);
+
+    const Statistics& get_statistics() const { return stats_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State { CONNECTING, LOGGING_IN, AWAITING_IMAGE, REQUESTED, RECEIVING };
+
+    struct Session {
+        SpinServer server;
+        int sock = -1;
+        State state = State::CONNECTING;
+        std::string outbound;
+        std::string inbound;
+        uint32_t image_sequence = 0;
+        Clock::time_point deadline;
+        Clock::time_point last_sent;
+    };
+
+    struct Command {
+        uint8_t unit;
+        bool cancel;
+    };
+
+    // Settings (copied at construction)
+    std::vector<SpinServer> servers_;
+    std::string session_sub_id_;
+    std::string username_;
+    std::string password_;
+    std::chrono::milliseconds timeout_;
+
+    // Packet thread -> client thread
+    std::mutex command_mutex_;
+    std::vector<Command> commands_;
+    int command_event_fd_;
+
+    // Client thread -> packet thread
+    std::mutex event_mutex_;
+    std::vector<Event> events_;
+    std::atomic<bool> events_ready_;
+    int wakeup_fd_;
+
+    std::atomic<bool> running_;
+    std::thread thread_;
+    Statistics stats_;
+
+    // Client thread state
+    std::vector<Session> sessions_;
+
+    void run();
+    void accept_commands();
+    void open_session(const SpinServer& server);
+    void finish_session(Session& session, bool success, const std::string& reason);
+    void queue_packet(Session& session, const char* message, size_t len);
+    bool flush_outbound(Session& session);
+    bool read_inbound(Session& session);
+    bool handle_message(Session& session, const char* message, size_t len);
+    void deliver(Event&& event);
+};
@@ -0,0 +1,387 @@
+#include "packet_types.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * Local stand-in for a CBOE spin server
+ *
+ * Serves one unit's image over TCP. The image is built from recorded binary
+ * logs: every complete sequenced packet of the unit contributes its messages,
+ * and the image is current up to the highest sequence found (or --image-seq).
+ * After login the server offers the image with Spin Image Available once a
+ * second; a matching Spin Request is answered with the image in unsequenced
+ * packets of the unit, followed by Spin Finished.
+ */
+
+volatile sig_atomic_t running = 1;
+
+void signal_handler(int signal) {
+    std::cout << "\nReceived signal " << signal << ", stopping spin stand-in..." << std::endl;
+    running = 0;
+}
+
+struct Options {
+    uint16_t port = 19001;
+    uint8_t unit = 1;
+    uint32_t image_sequence = 0;       // 0 = highest sequence in the logs
+    uint32_t messages_per_packet = 10;
+    std::vector<std::string> image_files;
+};
+
+struct Session {
+    int fd;
+    bool logged_in = false;
+    std::string inbound;
+    std::string outbound;
+    std::chrono::steady_clock::time_point last_sent;
+    std::chrono::steady_clock::time_point last_offer;
+};
+
+struct Statistics {
+    uint64_t sessions = 0;
+    uint64_t spins = 0;
+    uint64_t rejected = 0;
+    uint64_t messages_sent = 0;
+};
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " --image FILE [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --image FILE                 Binary log to build the image from (repeatable, oldest first)" << std::endl;
+    std::cout << "  -u, --unit N                 Unit served (default 1)" << std::endl;
+    std::cout << "  -p, --port N                 TCP port to listen on (default 19001)" << std::endl;
+    std::cout << "  --image-seq N                Only include messages up to sequence N" << std::endl;
+    std::cout << "  --messages-per-packet N      Image messages per packet (default 10)" << std::endl;
+    std::cout << "  -h, --help                   Show this help message" << std::endl;
+}
+
+void append_packet(std::string& out, uint8_t unit, uint32_t sequence, uint8_t count, const std::string& messages) {
+    CboeSequencedUnitHeader header{};
+    header.hdr_length = htole16(static_cast<uint16_t>(sizeof(header) + messages.size()));
+    header.hdr_count = count;
+    header.hdr_unit = unit;
+    header.hdr_sequence = htole32(sequence);
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.append(messages);
+}
+
+template <typename Message>
+std::string as_bytes(const Message& message) {
+    return std::string(reinterpret_cast<const char*>(&message), sizeof(message));
+}
+
+/**
+ * Collect the unit's messages by sequence number from recorded binary logs
+ * Packets logged with a truncated payload are skipped; the image then has a hole.
+ * @return false if a file could not be opened
+ */
+bool load_image(const Options& opts, std::map<uint32_t, std::string>& image) {
+    for (const auto& path : opts.image_files) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            std::cerr << "Cannot open " << path << std::endl;
+            return false;
+        }
+
+        BinaryLogRecord record;
+        std::string payload;
+        while (file.read(reinterpret_cast<char*>(&record), sizeof(BinaryLogRecord))) {
+            payload.resize(record.payload_length);
+            if (!file.read(&payload[0], record.payload_length)) {
+                break;
+            }
+            if (file.peek() == '\n') {
+                file.get();
+            }
+
+            if (record.unit != opts.unit || record.sequence == 0 ||
+                record.payload_length != record.length || record.length < sizeof(CboeSequencedUnitHeader)) {
+                continue;
+            }
+
+            uint32_t sequence = record.sequence;
+            size_t pos = sizeof(CboeSequencedUnitHeader);
+            for (uint8_t i = 0; i < record.count && pos + sizeof(CboeMessageHeader) <= payload.size(); i++) {
+                uint8_t length = static_cast<uint8_t>(payload[pos]);
+                if (length < sizeof(CboeMessageHeader) || pos + length > payload.size()) {
+                    break;
+                }
+                if (opts.image_sequence == 0 || sequence <= opts.image_sequence) {
+                    image.emplace(sequence, payload.substr(pos, length));
+                }
+                sequence++;
+                pos += length;
+            }
+        }
+    }
+    return true;
+}
+
+/**
+ * Queue the whole image as unsequenced packets of the unit
+ */
+void append_image(Session& session, const Options& opts, const std::map<uint32_t, std::string>& image,
+                  Statistics& stats) {
+    std::string messages;
+    uint8_t count = 0;
+    for (const auto& entry : image) {
+        messages += entry.second;
+        if (++count == opts.messages_per_packet) {
+            append_packet(session.outbound, opts.unit, 0, count, messages);
+            messages.clear();
+            count = 0;
+        }
+    }
+    if (count > 0) {
+        append_packet(session.outbound, opts.unit, 0, count, messages);
+    }
+    stats.messages_sent += image.size();
+}
+
+void handle_message(Session& session, const Options& opts, const char* message, size_t len,
+                    const std::map<uint32_t, std::string>& image, uint32_t image_sequence, Statistics& stats) {
+    uint8_t type = reinterpret_cast<const CboeMessageHeader*>(message)->message_type;
+
+    if (type == GrpMessageType::LOGIN && len >= sizeof(GrpLoginMessage)) {
+        const auto* login = reinterpret_cast<const GrpLoginMessage*>(message);
+        std::cout << "Login from session " << std::string(login->session_sub_id, 4)
+                  << " user " << std::string(login->username, 4) << std::endl;
+        GrpLoginResponseMessage response{};
+        response.length = sizeof(response);
+        response.message_type = GrpMessageType::LOGIN_RESPONSE;
+        response.status = 'A';
+        append_packet(session.outbound, 0, 0, 1, as_bytes(response));
+        session.logged_in = true;
+    } else if (type == SpinMessageType::REQUEST && len >= sizeof(SpinRequestMessage) && session.logged_in) {
+        const auto* request = reinterpret_cast<const SpinRequestMessage*>(message);
+        uint32_t sequence = le32toh_safe(request->sequence);
+        bool accepted = (sequence == image_sequence);
+
+        SpinResponseMessage response{};
+        response.length = sizeof(response);
+        response.message_type = SpinMessageType::RESPONSE;
+        response.sequence = request->sequence;
+        response.order_count = htole32(accepted ? static_cast<uint32_t>(image.size()) : 0);
+        response.status = accepted ? 'A' : 'O';
+        append_packet(session.outbound, 0, 0, 1, as_bytes(response));
+
+        if (!accepted) {
+            stats.rejected++;
+            return;
+        }
+        stats.spins++;
+        append_image(session, opts, image, stats);
+
+        SpinFinishedMessage finished{};
+        finished.length = sizeof(finished);
+        finished.message_type = SpinMessageType::FINISHED;
+        finished.sequence = htole32(image_sequence);
+        append_packet(session.outbound, 0, 0, 1, as_bytes(finished));
+        std::cout << "Spin served: " << image.size() << " messages up to sequence " << image_sequence << std::endl;
+    }
+}
+
+/**
+ * Parse complete sequenced units from the session's input buffer
+ * @return false if the stream is malformed
+ */
+bool handle_input(Session& session, const Options& opts, const std::map<uint32_t, std::string>& image,
+                  uint32_t image_sequence, Statistics& stats) {
+    size_t offset = 0;
+    while (session.inbound.size() - offset >= sizeof(CboeSequencedUnitHeader)) {
+        const auto* header = reinterpret_cast<const CboeSequencedUnitHeader*>(session.inbound.data() + offset);
+        uint16_t length = le16toh_safe(header->hdr_length);
+        if (length < sizeof(CboeSequencedUnitHeader)) {
+            return false;
+        }
+        if (session.inbound.size() - offset < length) {
+            break;
+        }
+
+        size_t pos = offset + sizeof(CboeSequencedUnitHeader);
+        size_t end = offset + length;
+        while (pos + sizeof(CboeMessageHeader) <= end) {
+            uint8_t message_length = static_cast<uint8_t>(session.inbound[pos]);
+            if (message_length < sizeof(CboeMessageHeader) || pos + message_length > end) {
+                break;
+            }
+            handle_message(session, opts, session.inbound.data() + pos, message_length, image, image_sequence, stats);
+            pos += message_length;
+        }
+        offset = end;
+    }
+    session.inbound.erase(0, offset);
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg == "--image" && i + 1 < argc) {
+            opts.image_files.push_back(argv[++i]);
+        } else if ((arg == "-u" || arg == "--unit") && i + 1 < argc) {
+            opts.unit = static_cast<uint8_t>(std::clamp(std::stoi(argv[++i]), 1, 255));
+        } else if ((arg == "-p" || arg == "--port") && i + 1 < argc) {
+            opts.port = static_cast<uint16_t>(std::stoul(argv[++i]));
+        } else if (arg == "--image-seq" && i + 1 < argc) {
+            opts.image_sequence = std::stoul(argv[++i]);
+        } else if (arg == "--messages-per-packet" && i + 1 < argc) {
+            opts.messages_per_packet = std::clamp<uint32_t>(std::stoul(argv[++i]), 1, 255);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (opts.image_files.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::map<uint32_t, std::string> image;
+    if (!load_image(opts, image)) {
+        return 1;
+    }
+    uint32_t image_sequence = opts.image_sequence;
+    if (image_sequence == 0 && !image.empty()) {
+        image_sequence = image.rbegin()->first;
+    }
+    uint64_t holes = image.empty() ? 0 : (static_cast<uint64_t>(image.rbegin()->first) - image.begin()->first + 1) - image.size();
+
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(opts.port);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener, 8) < 0) {
+        std::cerr << "Failed to listen on port " << opts.port << ": " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    std::cout << "========================================" << std::endl;
+    std::cout << "CBOE Spin Server Stand-in" << std::endl;
+    std::cout << "========================================" << std::endl;
+    std::cout << "Listening on TCP port " << opts.port << std::endl;
+    std::cout << "Unit: " << static_cast<int>(opts.unit) << std::endl;
+    std::cout << "Image: " << image.size() << " messages up to sequence " << image_sequence
+              << " (" << holes << " missing from the recording)" << std::endl;
+    std::cout << "Press Ctrl+C to stop" << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    std::vector<Session> sessions;
+    Statistics stats;
+
+    while (running) {
+        std::vector<pollfd> fds;
+        fds.push_back({listener, POLLIN, 0});
+        for (const auto& session : sessions) {
+            short events = POLLIN;
+            if (!session.outbound.empty()) events |= POLLOUT;
+            fds.push_back({session.fd, events, 0});
+        }
+
+        int ready = poll(fds.data(), fds.size(), 100);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+            if (fd >= 0) {
+                int nodelay = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+                auto now = std::chrono::steady_clock::now();
+                sessions.push_back({fd, false, "", "", now, now - std::chrono::seconds(1)});
+                stats.sessions++;
+                std::cout << "Session connected" << std::endl;
+            }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < sessions.size(); i++) {
+            Session& session = sessions[i];
+            short revents = (i + 1 < fds.size()) ? fds[i + 1].revents : 0;
+            bool alive = true;
+
+            if (revents & (POLLIN | POLLHUP | POLLERR)) {
+                char buffer[64 * 1024];
+                ssize_t n = recv(session.fd, buffer, sizeof(buffer), 0);
+                if (n > 0) {
+                    session.inbound.append(buffer, static_cast<size_t>(n));
+                    alive = handle_input(session, opts, image, image_sequence, stats);
+                } else if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    alive = false;
+                }
+            }
+
+            // Offer the image once a second, heartbeat otherwise
+            if (alive && session.logged_in && session.outbound.empty()) {
+                if (now - session.last_offer >= std::chrono::seconds(1)) {
+                    SpinImageAvailableMessage available{};
+                    available.length = sizeof(available);
+                    available.message_type = SpinMessageType::IMAGE_AVAILABLE;
+                    available.sequence = htole32(image_sequence);
+                    append_packet(session.outbound, 0, 0, 1, as_bytes(available));
+                    session.last_offer = now;
+                } else if (now - session.last_sent >= std::chrono::seconds(1)) {
+                    append_packet(session.outbound, 0, 0, 0, "");
+                }
+            }
+
+            while (alive && !session.outbound.empty()) {
+                ssize_t n = send(session.fd, session.outbound.data(), session.outbound.size(), MSG_NOSIGNAL);
+                if (n > 0) {
+                    session.outbound.erase(0, static_cast<size_t>(n));
+                    session.last_sent = now;
+                } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    break;
+                } else if (!(n < 0 && errno == EINTR)) {
+                    alive = false;
+                }
+            }
+
+            if (!alive) {
+                std::cout << "Session disconnected" << std::endl;
+                close(session.fd);
+                sessions.erase(sessions.begin() + static_cast<long>(i));
+                fds.erase(fds.begin() + static_cast<long>(i) + 1);
+                i--;
+            }
+        }
+    }
+
+    for (const auto& session : sessions) {
+        close(session.fd);
+    }
+    close(listener);
+
+    std::cout << "Spin stand-in stopped. Sessions: " << stats.sessions
+              << ", spins: " << stats.spins << " (" << stats.rejected << " rejected)"
+              << ", messages sent: " << stats.messages_sent << std::endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * Bounded single-producer single-consumer queue of fixed-size slots
+ * The producer fills the slot returned by claim() in place and makes it
+ * visible with publish(); the consumer reads front() and frees it with pop().
+ * Head and tail sit on separate cache lines, and each side keeps a private
+ * copy of the other's position, reloading it only when the queue looks full
+ * (producer) or empty (consumer).
+ */
+template <typename T>
+class SpscQueue {
+public:
+    /**
+     * @param capacity Number of slots; rounded up to a power of two
+     */
+    explicit SpscQueue(size_t capacity) {
+        size_t slots = 1;
+        while (slots < capacity) {
+            slots <<= 1;
+        }
+        slots_.reset(new T[slots]);
+        mask_ = slots - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // ---- Producer ----
+
+    /**
+     * Slot to fill next
+     * @return nullptr while the queue is full
+     */
+    T* claim() {
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        if (head - cached_tail_ > mask_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head - cached_tail_ > mask_) {
+                return nullptr;
+            }
+        }
+        return &slots_[head & mask_];
+    }
+
+    /**
+     * Hand the claimed slot to the consumer
+     */
+    void publish() { head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    // ---- Consumer ----
+
+    /**
+     * Oldest published slot
+     * @return nullptr while the queue is empty
+     */
+    T* front() {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == cached_head_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail == cached_head_) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & mask_];
+    }
+
+    /**
+     * Release the slot returned by front()
+     */
+    void pop() { tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    /**
+     * True if nothing is published (exact only on the consumer side)
+     */
+    bool empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    std::unique_ptr<T[]> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<uint64_t> head_{0};
+    uint64_t cached_tail_ = 0;     // Producer's copy of tail_
+    alignas(64) std::atomic<uint64_t> tail_{0};
+    uint64_t cached_head_ = 0;     // Consumer's copy of head_
+};
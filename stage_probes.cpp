@@ -0,0 +1,107 @@
+#include "stage_probes.h"
+
+#ifdef STAGE_PROBES
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+const char* const STAGE_NAMES[] = {"receive", "validate", "decode", "sequence", "log-enqueue"};
+
+std::mutex g_threads_mutex;
+std::vector<StageCounters*> g_threads;     // Never freed: totals outlive their threads
+std::atomic<uint64_t> g_packets{0};
+
+} // namespace
+
+StageCounters::StageCounters()
+    : counters_({PerfCounters::CYCLES, PerfCounters::INSTRUCTIONS, PerfCounters::LLC_MISSES,
+                 PerfCounters::BRANCH_MISSES}) {
+    calibrate();
+}
+
+void StageCounters::calibrate() {
+    constexpr int ROUNDS = 1000;
+    uint64_t start[EVENTS], end[EVENTS];
+    for (int i = 0; i < EVENTS; i++) {
+        overhead_[i] = UINT64_MAX;
+    }
+    for (int round = 0; round < ROUNDS; round++) {
+        counters_.read(start);
+        counters_.read(end);
+        for (int i = 0; i < EVENTS; i++) {
+            if (end[i] >= start[i]) {
+                overhead_[i] = std::min(overhead_[i], end[i] - start[i]);
+            }
+        }
+    }
+    for (int i = 0; i < EVENTS; i++) {
+        if (overhead_[i] == UINT64_MAX) {
+            overhead_[i] = 0;
+        }
+    }
+}
+
+StageCounters& StageCounters::for_thread() {
+    thread_local StageCounters* counters = nullptr;
+    if (!counters) {
+        counters = new StageCounters();
+        std::lock_guard<std::mutex> lock(g_threads_mutex);
+        g_threads.push_back(counters);
+    }
+    return *counters;
+}
+
+void StageCounters::add(Stage stage, const uint64_t* start, const uint64_t* end) {
+    auto& totals = totals_[static_cast<size_t>(stage)];
+    for (int i = 0; i < EVENTS; i++) {
+        // A read that fell back from rdpmc to the system call can go backwards
+        if (end[i] >= start[i] + overhead_[i]) {
+            uint64_t delta = end[i] - start[i] - overhead_[i];
+            totals[i].store(totals[i].load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+        }
+    }
+}
+
+void stage_probe_count_packet() {
+    g_packets.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<std::string> stage_probe_report() {
+    std::vector<std::string> lines;
+    uint64_t packets = g_packets.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(g_threads_mutex);
+    bool available = false;
+    uint64_t totals[static_cast<size_t>(Stage::COUNT)][StageCounters::EVENTS] = {};
+    for (const StageCounters* thread : g_threads) {
+        available |= thread->available();
+        for (size_t stage = 0; stage < static_cast<size_t>(Stage::COUNT); stage++) {
+            for (int i = 0; i < StageCounters::EVENTS; i++) {
+                totals[stage][i] += thread->totals_[stage][i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    if (!available) {
+        lines.push_back("STAGE PROBES: hardware counters unavailable (perf_event_open not permitted or no PMU)");
+        return lines;
+    }
+
+    double divisor = packets > 0 ? static_cast<double>(packets) : 1.0;
+    for (size_t stage = 0; stage < static_cast<size_t>(Stage::COUNT); stage++) {
+        std::ostringstream oss;
+        oss << "STAGE " << std::left << std::setw(11) << STAGE_NAMES[stage] << std::right << std::fixed
+            << std::setprecision(1) << " per packet: " << totals[stage][0] / divisor << " cycles, "
+            << totals[stage][1] / divisor << " instructions, " << std::setprecision(3)
+            << totals[stage][2] / divisor << " LLC misses, " << totals[stage][3] / divisor << " branch misses";
+        lines.push_back(oss.str());
+    }
+    lines.push_back("STAGE PROBES: " + std::to_string(packets) + " packets on " + std::to_string(g_threads.size()) +
+                    " threads");
+    return lines;
+}
+
+#endif
@@ -0,0 +1,117 @@
+#pragma once
+
+/**
+ * Hardware counter probes per pipeline stage (build with -DSTAGE_PROBES)
+ *
+ * STAGE_PROBE(stage) opens a scope that reads the calling thread's counter
+ * group (cycles, instructions, LLC misses, branch misses) and attributes the
+ * difference to the stage when STAGE_PROBE_END(stage) is reached or the
+ * enclosing block is left. STAGE_PROBE_PACKET() counts one processed packet,
+ * which the per-packet costs in stage_probe_report() are divided by.
+ *
+ * Without STAGE_PROBES every macro expands to nothing, so production builds
+ * carry no trace of the instrumentation.
+ */
+
+#ifdef STAGE_PROBES
+
+#include "perf_counters.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class Stage {
+    RECEIVE,        // recvmsg / zmq_msg_recv, including calls that find nothing
+    VALIDATE,
+    DECODE,         // Unit header fields and packet classification
+    SEQUENCE,       // Session events, order status and gap handling
+    LOG_ENQUEUE,    // BinaryLogger::log_packet
+    COUNT
+};
+
+/**
+ * Counter group and per-stage totals of one thread
+ * The cost of an empty probe is measured when the counters are opened and
+ * subtracted from every sample. Totals are only written by the owning thread
+ * and read by the report.
+ */
+class StageCounters {
+public:
+    static constexpr int EVENTS = 4;
+
+    /**
+     * Counters of the calling thread, opened on its first probe
+     */
+    static StageCounters& for_thread();
+
+    void read(uint64_t* values) const { counters_.read(values); }
+
+    void add(Stage stage, const uint64_t* start, const uint64_t* end);
+
+    bool available() const { return counters_.available(); }
+
+private:
+    friend std::vector<std::string> stage_probe_report();
+
+    PerfCounters counters_;
+    std::array<std::array<std::atomic<uint64_t>, EVENTS>, static_cast<size_t>(Stage::COUNT)> totals_{};
+    uint64_t overhead_[EVENTS] = {};
+
+    StageCounters();
+
+    /**
+     * Smallest counts seen across back-to-back reads
+     */
+    void calibrate();
+};
+
+/**
+ * Scoped probe; use through STAGE_PROBE / STAGE_PROBE_END
+ */
+class StageProbe {
+public:
+    explicit StageProbe(Stage stage) : counters_(StageCounters::for_thread()), stage_(stage) {
+        counters_.read(start_);
+    }
+
+    ~StageProbe() { stop(); }
+
+    void stop() {
+        if (running_) {
+            uint64_t end[StageCounters::EVENTS];
+            counters_.read(end);
+            counters_.add(stage_, start_, end);
+            running_ = false;
+        }
+    }
+
+private:
+    StageCounters& counters_;
+    Stage stage_;
+    bool running_ = true;
+    uint64_t start_[StageCounters::EVENTS];
+};
+
+/**
+ * Count one packet entering processing
+ */
+void stage_probe_count_packet();
+
+/**
+ * One line per stage with its cost per packet, summed over every thread
+ */
+std::vector<std::string> stage_probe_report();
+
+#define STAGE_PROBE(stage) StageProbe stage_probe_##stage(Stage::stage)
+#define STAGE_PROBE_END(stage) stage_probe_##stage.stop()
+#define STAGE_PROBE_PACKET() stage_probe_count_packet()
+
+#else
+
+#define STAGE_PROBE(stage) ((void)0)
+#define STAGE_PROBE_END(stage) ((void)0)
+#define STAGE_PROBE_PACKET() ((void)0)
+
+#endif
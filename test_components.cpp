@@ -0,0 +1,265 @@
+#include "packet_types.h"
+#include "binary_logger.h"
+#include "sequence_checkpoint.h"
+#include "sequence_tracker.h"
+#include "sequence_window.h"
+#include "shm_ring.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Behavior checks of the logger's stateful components
+ *
+ * Each test exercises one component through its public interface and
+ * reports every failed expectation; the exit status is non-zero if any
+ * failed. Temporary files go to /tmp and are removed.
+ */
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "  FAILED: " << what << std::endl;
+        g_failures++;
+    }
+}
+
+std::string temp_path(const std::string& name) {
+    return "/tmp/test_components_" + std::to_string(getpid()) + "_" + name;
+}
+
+uint64_t file_size(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+/**
+ * Build a sequenced unit packet carrying one (zeroed) Add Order message
+ */
+std::vector<char> make_packet(uint32_t sequence, uint8_t unit) {
+    const uint8_t message_length = 34;
+    std::vector<char> packet(sizeof(CboeSequencedUnitHeader) + message_length, 0);
+    CboeSequencedUnitHeader header{};
+    header.hdr_length = static_cast<uint16_t>(packet.size());
+    header.hdr_count = 1;
+    header.hdr_unit = unit;
+    header.hdr_sequence = sequence;
+    memcpy(packet.data(), &header, sizeof(header));
+    packet[sizeof(header)] = static_cast<char>(message_length);
+    packet[sizeof(header) + 1] = static_cast<char>(PitchMessageType::ADD_ORDER);
+    return packet;
+}
+
+void test_checkpoint_round_trip() {
+    std::cout << "Checkpoint round trip" << std::endl;
+    std::string path = temp_path("checkpoint.bin");
+
+    SequenceCheckpoint written;
+    written.timestamp_ns = 1700000000123456789ULL;
+    written.layout_fingerprint = 0xC0FFEE;
+    SequenceTracker first;
+    first.last_confirmed_seq = 41;
+    first.highest_seen_seq = 45;
+    first.pending_sequences = {{43, true}, {45, true}};
+    SequenceTracker second;
+    second.last_confirmed_seq = 900;
+    second.highest_seen_seq = 900;
+    written.trackers = {{3, first}, {260, second}};
+    written.epochs = {0, 2};
+    written.session_ended = {true, false};
+    write_checkpoint(path, written);
+
+    SequenceCheckpoint read;
+    check(read_checkpoint(path, read), "written checkpoint is found");
+    check(read.timestamp_ns == written.timestamp_ns, "timestamp survives");
+    check(read.layout_fingerprint == written.layout_fingerprint, "layout fingerprint survives");
+    check(read.trackers.size() == 2, "both trackers survive");
+    if (read.trackers.size() == 2) {
+        check(read.trackers[0].first == 3 && read.trackers[1].first == 260, "tracker indexes survive");
+        check(read.trackers[0].second.last_confirmed_seq == 41 && read.trackers[0].second.highest_seen_seq == 45,
+              "tracker positions survive");
+        check(read.trackers[0].second.pending_sequences == first.pending_sequences, "pending sequences survive");
+        check(read.trackers[1].second.pending_sequences.empty(), "empty pending set stays empty");
+    }
+    check(read.epochs == written.epochs, "epochs survive");
+    check(read.session_ended == written.session_ended, "session_ended flags survive");
+
+    // A truncated file is rejected rather than half-applied
+    check(truncate(path.c_str(), static_cast<off_t>(file_size(path) - 3)) == 0, "truncate checkpoint");
+    bool rejected = false;
+    try {
+        read_checkpoint(path, read);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    check(rejected, "truncated checkpoint throws");
+
+    remove(path.c_str());
+    check(!read_checkpoint(path, read), "missing checkpoint reads as absent");
+}
+
+void test_torn_record_truncation() {
+    std::cout << "Torn record truncation" << std::endl;
+    std::string path = temp_path("torn.log");
+
+    {
+        BinaryLogger logger(path, "test_torn_write");
+        for (uint32_t seq = 1; seq <= 100; seq++) {
+            std::vector<char> packet = make_packet(seq, 1);
+            logger.log_packet(seq, Config::PORT1, packet.data(), static_cast<uint16_t>(packet.size()), seq, 1, 1,
+                              PacketType::DATA, OrderStatus::SEQUENCED_IN_ORDER, 0);
+        }
+        logger.close(0);
+    }
+    uint64_t intact = file_size(path);
+    check(intact > 100 * sizeof(BinaryLogRecord), "log holds the records");
+
+    // An intact log is left alone
+    {
+        BinaryLogger logger(path, "test_torn_intact");
+        check(file_size(path) == intact, "intact log is not truncated");
+    }
+
+    // Crash in the middle of a record: its first bytes reached the file
+    std::vector<char> head(40);
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.read(head.data(), static_cast<std::streamsize>(head.size()));
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        out.write(head.data(), static_cast<std::streamsize>(head.size()));
+    }
+    check(file_size(path) == intact + head.size(), "torn record appended");
+    {
+        BinaryLogger logger(path, "test_torn_reopen");
+        check(file_size(path) == intact, "torn record cut off on open");
+    }
+
+    uint64_t records = 0;
+    for_each_log_record(path, [&records](const BinaryLogRecord&) {
+        records++;
+        return true;
+    });
+    check(records >= 100, "every record still reads back");
+
+    remove(path.c_str());
+    remove((path + ".index").c_str());
+}
+
+void test_sequence_window() {
+    std::cout << "SequenceWindow" << std::endl;
+    SequenceWindow window(6);   // 64 sequences
+
+    check(window.record(1, 1) == SequenceWindow::Result::IN_ORDER, "first packet is in order");
+    check(window.record(2, 2) == SequenceWindow::Result::IN_ORDER, "next packet is in order");
+    check(window.record(10, 1) == SequenceWindow::Result::GAP, "skip ahead is a gap");
+    check(window.missing() == 6, "gap 4-9 is missing");
+    check(window.record(5, 1) == SequenceWindow::Result::LATE, "gap fill is late");
+    check(window.missing() == 5, "late arrival closes its part of the gap");
+    check(window.record(5, 1) == SequenceWindow::Result::DUPLICATE, "repeat is a duplicate");
+    check(window.record(0, 0) == SequenceWindow::Result::IN_ORDER, "empty packet is not recorded");
+
+    // Jump far enough that the early gaps slide out of the window unfilled
+    check(window.record(200, 1) == SequenceWindow::Result::GAP, "far jump is a gap");
+    check(window.statistics().lost == 131, "gaps below the window are lost");
+    check(window.missing() == 194, "lost plus open gaps cover every unseen sequence");
+    check(window.highest() == 200, "highest sequence");
+    check(window.record(1, 1) == SequenceWindow::Result::STALE, "sequence below the window is stale");
+
+    const SequenceWindow::Statistics& stats = window.statistics();
+    check(stats.received == 6 && stats.duplicates == 1 && stats.late == 1 && stats.stale == 1,
+          "message counts");
+}
+
+void test_shm_ring() {
+    std::cout << "Shared-memory ring" << std::endl;
+    std::string name = "/test_components_" + std::to_string(getpid());
+
+    auto producer = ShmChannel::create(name, 2, 4096);
+    auto consumer = ShmChannel::attach(name);
+    check(consumer != nullptr, "consumer attaches");
+    if (!consumer) {
+        shm_unlink(name.c_str());
+        return;
+    }
+    check(consumer->lanes() == 2 && consumer->lane_bytes() == 4096, "consumer sees the layout");
+
+    // Messages come back in order, per lane
+    std::vector<std::string> received;
+    auto collect = [&received](const char* data, size_t len) { received.emplace_back(data, len); };
+    check(producer->write(0, "alpha", 5) && producer->write(0, "beta", 4) && producer->write(1, "gamma", 5),
+          "writes fit");
+    check(consumer->read(0, collect) == 2, "lane 0 delivers its messages");
+    check(received == std::vector<std::string>({"alpha", "beta"}), "lane 0 content and order");
+    received.clear();
+    check(consumer->read(1, collect) == 1 && received == std::vector<std::string>({"gamma"}), "lane 1 is separate");
+    check(consumer->read(0, collect) == 0, "read frees the messages");
+
+    // A full lane refuses writes until the consumer catches up, then wraps
+    std::string message(100, 'x');
+    int written = 0;
+    while (producer->write(0, message.data(), message.size())) {
+        written++;
+    }
+    check(written > 0 && written < 4096 / 100, "full lane refuses a write");
+    received.clear();
+    check(consumer->read(0, collect) == static_cast<size_t>(written), "full lane drains");
+    for (int i = 0; i < written; i++) {
+        message[0] = static_cast<char>('a' + i % 26);
+        check(producer->write(0, message.data(), message.size()), "write after drain fits");
+        received.clear();
+        consumer->read(0, collect);
+        check(received.size() == 1 && received[0] == message, "message across the wrap is intact");
+    }
+
+    consumer.reset();
+    producer.reset();
+    shm_unlink(name.c_str());
+}
+
+void test_reset_needs_live_traffic() {
+    std::cout << "Session reset only from live traffic" << std::endl;
+    SequenceManager manager;
+    int port = Config::PORT1;
+
+    check(manager.determine_order_status(1, 1, port, 1) == OrderStatus::SEQUENCED_FIRST, "first packet");
+    check(manager.determine_order_status(2, 1, port, 1, SessionEvent::END_OF_SESSION) ==
+          OrderStatus::SEQUENCED_IN_ORDER, "End of Session packet is in order");
+    check(manager.determine_order_status(1, 1, port, 1, SessionEvent::NONE, false) ==
+          OrderStatus::SEQUENCED_DUPLICATE, "retransmitted low sequence is a duplicate");
+    check(manager.get_epoch(port, 1) == 0, "retransmission keeps the epoch");
+    check(manager.determine_order_status(1, 1, port, 1) == OrderStatus::SEQUENCED_RESET,
+          "live low sequence after End of Session is a reset");
+    check(manager.get_epoch(port, 1) == 1, "reset starts a new epoch");
+}
+
+} // namespace
+
+int main() {
+    try {
+        test_checkpoint_round_trip();
+        test_torn_record_truncation();
+        test_sequence_window();
+        test_shm_ring();
+        test_reset_needs_live_traffic();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    if (g_failures != 0) {
+        std::cerr << g_failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All component tests passed" << std::endl;
+    return 0;
+}
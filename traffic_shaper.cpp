@@ -0,0 +1,246 @@
+#include "traffic_shaper.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+constexpr uint64_t AUCTION_LEAD_NS = 1000000000ULL;   // Base rate before the spike
+constexpr int AUCTION_DECAY_STEPS = 8;
+
+double parse_number(const std::string& text, const std::string& spec) {
+    try {
+        size_t used = 0;
+        double value = std::stod(text, &used);
+        if (used != text.size() || !std::isfinite(value) || value < 0) {
+            throw std::invalid_argument(text);
+        }
+        return value;
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("invalid number '" + text + "' in rate profile '" + spec + "'");
+    }
+}
+
+std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+RateProfile load_trace(const std::string& path, const std::string& spec) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("cannot read rate trace " + path);
+    }
+    RateProfile profile;
+    profile.repeat = true;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string micros, packets;
+        if (!(fields >> micros)) {
+            continue;
+        }
+        if (!(fields >> packets)) {
+            throw std::runtime_error("rate trace " + path + ": expected 'MICROSECONDS PACKETS' in '" + line + "'");
+        }
+        double duration_us = parse_number(micros, spec);
+        if (duration_us <= 0) {
+            throw std::runtime_error("rate trace " + path + ": interval must be longer than 0us");
+        }
+        profile.segments.push_back({static_cast<uint64_t>(duration_us * 1000),
+                                    parse_number(packets, spec) * 1e6 / duration_us});
+    }
+    if (profile.segments.empty()) {
+        throw std::runtime_error("rate trace " + path + " has no intervals");
+    }
+    return profile;
+}
+
+} // namespace
+
+RateProfile RateProfile::constant(double rate) {
+    RateProfile profile;
+    profile.segments.push_back({std::numeric_limits<uint64_t>::max(), rate});
+    return profile;
+}
+
+RateProfile RateProfile::parse(const std::string& spec) {
+    size_t colon = spec.find(':');
+    std::string kind = spec.substr(0, colon);
+    std::string rest = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    std::vector<std::string> fields = split(rest, ':');
+
+    RateProfile profile;
+    if (kind == "constant" && fields.size() == 1) {
+        profile = constant(parse_number(fields[0], spec));
+    } else if (kind == "step" && fields.size() == 2) {
+        uint64_t step_ns = static_cast<uint64_t>(parse_number(fields[1], spec) * 1e6);
+        for (const std::string& rate : split(fields[0], ',')) {
+            profile.segments.push_back({step_ns, parse_number(rate, spec)});
+        }
+    } else if (kind == "auction" && fields.size() == 3) {
+        double base = parse_number(fields[0], spec);
+        double peak = parse_number(fields[1], spec);
+        uint64_t spike_ns = static_cast<uint64_t>(parse_number(fields[2], spec) * 1e6);
+        profile.segments.push_back({AUCTION_LEAD_NS, base});
+        profile.segments.push_back({spike_ns, peak});
+        // Excess over the base halves every half spike length
+        for (int step = 1; step <= AUCTION_DECAY_STEPS; step++) {
+            profile.segments.push_back({spike_ns / 2, base + (peak - base) / (1 << step)});
+        }
+        profile.segments.push_back({spike_ns, base});
+    } else if (kind == "trace" && !rest.empty()) {
+        profile = load_trace(rest, spec);
+    } else {
+        throw std::runtime_error("invalid rate profile '" + spec +
+                                 "' (constant:RATE, step:R1,R2,...:MS, auction:BASE:PEAK:MS or trace:FILE)");
+    }
+
+    if (profile.segments.empty() || profile.peak_rate() <= 0) {
+        throw std::runtime_error("rate profile '" + spec + "' never sends");
+    }
+    if (!profile.repeat && profile.segments.back().rate <= 0) {
+        throw std::runtime_error("rate profile '" + spec + "' must not end at rate 0");
+    }
+    return profile;
+}
+
+double RateProfile::peak_rate() const {
+    double peak = 0;
+    for (const Segment& segment : segments) {
+        peak = std::max(peak, segment.rate);
+    }
+    return peak;
+}
+
+TrafficShaper::TrafficShaper(RateProfile profile, uint32_t burst)
+    : profile_(std::move(profile)), capacity_(std::max<uint32_t>(burst, 1)), tokens_(0),
+      sleep_threshold_ticks_(TscClock::from_ns(200000)) {
+    if (profile_.segments.empty()) {
+        throw std::runtime_error("traffic shaper needs a rate profile");
+    }
+    last_tsc_ = TscClock::now();
+    enter_segment(0, last_tsc_);
+}
+
+void TrafficShaper::enter_segment(size_t segment, uint64_t start_tsc) {
+    segment_ = segment;
+    const RateProfile::Segment& current = profile_.segments[segment];
+    tokens_per_tick_ = current.rate / 1e9 / TscClock::ticks_per_ns();
+    bool last = segment + 1 == profile_.segments.size();
+    if ((last && !profile_.repeat) || current.duration_ns == std::numeric_limits<uint64_t>::max()) {
+        segment_end_tsc_ = std::numeric_limits<uint64_t>::max();
+    } else {
+        segment_end_tsc_ = start_tsc + TscClock::from_ns(current.duration_ns);
+    }
+}
+
+void TrafficShaper::refill(uint64_t now) {
+    while (now >= segment_end_tsc_) {
+        tokens_ = std::min(capacity_, tokens_ + (segment_end_tsc_ - last_tsc_) * tokens_per_tick_);
+        last_tsc_ = segment_end_tsc_;
+        enter_segment((segment_ + 1) % profile_.segments.size(), last_tsc_);
+    }
+    if (now > last_tsc_) {
+        tokens_ = std::min(capacity_, tokens_ + (now - last_tsc_) * tokens_per_tick_);
+        last_tsc_ = now;
+    }
+}
+
+void TrafficShaper::acquire(uint32_t count) {
+    double needed = count;
+    // A request larger than the bucket waits until the bucket could hold it
+    double capacity = capacity_;
+    capacity_ = std::max(capacity_, needed);
+
+    for (;;) {
+        uint64_t now = TscClock::now();
+        refill(now);
+        if (tokens_ >= needed) {
+            tokens_ -= needed;
+            break;
+        }
+        uint64_t wait = tokens_per_tick_ > 0 ? static_cast<uint64_t>((needed - tokens_) / tokens_per_tick_)
+                                             : segment_end_tsc_ - now;
+        if (wait > sleep_threshold_ticks_) {
+            uint64_t sleep_ns = std::min<uint64_t>(TscClock::to_ns(wait - sleep_threshold_ticks_), 100000000);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_ns));
+        } else {
+            TscClock::pause();
+        }
+    }
+    capacity_ = capacity;
+}
+
+double TrafficShaper::current_rate() const {
+    return profile_.segments[segment_].rate;
+}
+
+FeedImpairment::FeedImpairment(uint32_t seed) : rng_(seed) {}
+
+void FeedImpairment::parse_setting(const std::string& setting, std::array<double, 256>& probabilities) {
+    size_t colon = setting.find(':');
+    try {
+        if (colon == std::string::npos) {
+            throw std::invalid_argument(setting);
+        }
+        unsigned long unit = std::stoul(setting.substr(0, colon));
+        double percent = std::stod(setting.substr(colon + 1));
+        if (unit > 255 || percent < 0 || percent > 100) {
+            throw std::invalid_argument(setting);
+        }
+        probabilities[unit] = percent / 100.0;
+    } catch (const std::logic_error&) {
+        throw std::runtime_error("invalid impairment '" + setting + "' (UNIT:PERCENT, unit 0-255, percent 0-100)");
+    }
+}
+
+void FeedImpairment::set_loss(const std::string& setting) {
+    parse_setting(setting, loss_);
+    enabled_ = true;
+}
+
+void FeedImpairment::set_reorder(const std::string& setting) {
+    parse_setting(setting, reorder_);
+    enabled_ = true;
+}
+
+void FeedImpairment::apply(int line, const PitchFeedGenerator::Packet* packet,
+                           std::vector<const PitchFeedGenerator::Packet*>& out) {
+    uint8_t unit = packet->unit;
+    if (loss_[unit] > 0 && roll_(rng_) < loss_[unit]) {
+        stats_.lost++;
+        return;
+    }
+    const PitchFeedGenerator::Packet*& held = held_[line][unit];
+    if (!held && reorder_[unit] > 0 && roll_(rng_) < reorder_[unit]) {
+        held = packet;
+        stats_.reordered++;
+        return;
+    }
+    out.push_back(packet);
+    if (held) {
+        out.push_back(held);
+        held = nullptr;
+    }
+}
+
+void FeedImpairment::flush(int line, std::vector<const PitchFeedGenerator::Packet*>& out) {
+    for (const PitchFeedGenerator::Packet*& held : held_[line]) {
+        if (held) {
+            out.push_back(held);
+            held = nullptr;
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "pitch_generator.h"
+#include "tsc_clock.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * Send rate over time, as a list of constant-rate segments
+ *
+ * Profiles are given as text:
+ * - constant:RATE              RATE packets per second throughout
+ * - step:R1,R2,...:MS          each rate for MS milliseconds, then the last one
+ * - auction:BASE:PEAK:MS       1s at BASE, PEAK for MS milliseconds, then a
+ *                              decay back to BASE over 4 x MS (an opening
+ *                              auction), then BASE
+ * - trace:FILE                 replay of a recorded rate, repeated; each line of
+ *                              FILE is "MICROSECONDS PACKETS", the packets sent
+ *                              in that interval ('#' starts a comment)
+ * A rate of 0 pauses sending for the segment.
+ */
+struct RateProfile {
+    struct Segment {
+        uint64_t duration_ns;
+        double rate;            // Packets per second
+    };
+
+    std::vector<Segment> segments;
+    bool repeat = false;        // Start over after the last segment instead of holding it
+
+    /**
+     * @throws std::runtime_error on a malformed profile or unreadable trace
+     */
+    static RateProfile parse(const std::string& spec);
+
+    static RateProfile constant(double rate);
+
+    /**
+     * Highest rate of any segment
+     */
+    double peak_rate() const;
+};
+
+/**
+ * Token bucket pacing to a RateProfile with TSC timing
+ *
+ * Tokens accrue at the rate of the current segment and are capped at the
+ * burst size, so a sender that falls behind catches up by at most one burst
+ * instead of the whole backlog. acquire() sleeps through most of a long wait
+ * and busy-waits on the TSC for the last part, which keeps the per-packet
+ * error well under a microsecond.
+ */
+class TrafficShaper {
+public:
+    /**
+     * @param burst Most packets sent back to back after an idle period
+     */
+    TrafficShaper(RateProfile profile, uint32_t burst);
+
+    /**
+     * Wait until count packets may be sent
+     */
+    void acquire(uint32_t count);
+
+    /**
+     * Rate of the segment in effect at the last acquire()
+     */
+    double current_rate() const;
+
+private:
+    RateProfile profile_;
+    double capacity_;
+    double tokens_;
+    uint64_t last_tsc_;
+    uint64_t segment_end_tsc_;
+    size_t segment_;
+    double tokens_per_tick_;
+    uint64_t sleep_threshold_ticks_;
+
+    /**
+     * Credit tokens up to now, moving through the segments that ended
+     */
+    void refill(uint64_t now);
+
+    void enter_segment(size_t segment, uint64_t start_tsc);
+};
+
+/**
+ * Per-unit loss and reordering of a feed, applied to each line separately
+ *
+ * A lost packet is not sent on that line; the other line may still carry
+ * it, as when one multicast feed drops. A reordered packet is held back and
+ * sent after the unit's next packet on the same line.
+ */
+class FeedImpairment {
+public:
+    static constexpr int LINES = 2;
+
+    struct Statistics {
+        uint64_t lost = 0;
+        uint64_t reordered = 0;
+    };
+
+    explicit FeedImpairment(uint32_t seed);
+
+    /**
+     * Parse "UNIT:PERCENT" and set the loss (or reorder) probability of that unit
+     * @throws std::runtime_error on a malformed setting
+     */
+    void set_loss(const std::string& setting);
+    void set_reorder(const std::string& setting);
+
+    bool enabled() const { return enabled_; }
+
+    /**
+     * Pass one packet through a line
+     * @param out Receives the packets to send now, in order (none, this one,
+     *            or this one followed by one held back earlier)
+     */
+    void apply(int line, const PitchFeedGenerator::Packet* packet, std::vector<const PitchFeedGenerator::Packet*>& out);
+
+    /**
+     * Release every packet still held back on a line
+     */
+    void flush(int line, std::vector<const PitchFeedGenerator::Packet*>& out);
+
+    Statistics statistics() const { return stats_; }
+
+private:
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> roll_{0.0, 1.0};
+    std::array<double, 256> loss_{};
+    std::array<double, 256> reorder_{};
+    std::array<std::array<const PitchFeedGenerator::Packet*, 256>, LINES> held_{};
+    bool enabled_ = false;
+    Statistics stats_;
+
+    static void parse_setting(const std::string& setting, std::array<double, 256>& probabilities);
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Time stamp counter, calibrated against steady_clock on first use
+ * Calibration sleeps for about 20ms, so threads that convert ticks on a hot
+ * path call calibrate() at startup, before they start receiving. Falls back
+ * to steady_clock nanoseconds on CPUs without rdtsc. On CPUs with an
+ * invariant TSC the counter is shared by every core and process of
+ * the host, so a TSC taken by one process can be compared with another's.
+ */
+class TscClock {
+public:
+    static uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return steady_ns();
+#endif
+    }
+
+    static void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    /**
+     * Counter ticks per nanosecond (measured once, over about 20ms)
+     */
+    static double ticks_per_ns() {
+        static const double ratio = [] {
+            uint64_t start_ns = steady_ns();
+            uint64_t start_ticks = now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            uint64_t end_ns = steady_ns();
+            uint64_t end_ticks = now();
+            return static_cast<double>(end_ticks - start_ticks) / static_cast<double>(end_ns - start_ns);
+        }();
+        return ratio;
+    }
+
+    /**
+     * Measure the tick rate now, if it has not been measured yet
+     */
+    static void calibrate() { ticks_per_ns(); }
+
+    static uint64_t from_ns(uint64_t ns) { return static_cast<uint64_t>(ns * ticks_per_ns()); }
+    static uint64_t to_ns(uint64_t ticks) { return static_cast<uint64_t>(ticks / ticks_per_ns()); }
+
+private:
+    static uint64_t steady_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
@@ -1,11 +1,21 @@
 #include "packet_types.h"
+#include "bridge_frame.h"
+#include "shm_ring.h"
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <csignal>
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <poll.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <cstddef>
 #include <cstring>
+#include <ctime>
 #include <zmq.h>
 
 volatile bool running = true;
@@ -25,6 +35,10 @@ int create_multicast_socket(uint16_t port) {
     int bufsize = 64 * 1024 * 1024;
     setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
     
+    // Kernel receive timestamps travel to the logger in the bridge header
+    int timestamps = 1;
+    setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &timestamps, sizeof(timestamps));
+    
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -48,7 +62,225 @@ int create_multicast_socket(uint16_t port) {
     return sock;
 }
 
-int main() {
+struct Options {
+    size_t batch_bytes = 16384;          // Send a frame once it holds this many bytes
+    uint32_t batch_packets = 64;         // ... or this many datagrams
+    uint32_t batch_us = 50;              // ... or its oldest datagram is this old
+    size_t pool_frames = 1024;           // Frame buffers per port lent to ZeroMQ
+    size_t zero_copy_min = 1024;         // Smaller frames are cheaper to copy than to lend
+    bool pub = false;                    // PUB sockets with a 1-byte unit topic instead of PUSH
+    bool shm = false;                    // Shared-memory rings instead of ZeroMQ
+    std::string shm_name = "/cboe_bridge";
+    size_t shm_bytes = 32 * 1024 * 1024; // Ring size per port
+};
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --batch-packets N            Datagrams per ZMQ frame, 1 disables batching (default 64)" << std::endl;
+    std::cout << "  --batch-bytes N              Send a frame once it reaches N bytes (default 16384)" << std::endl;
+    std::cout << "  --batch-us N                 Longest a datagram waits for its frame to fill (default 50)" << std::endl;
+    std::cout << "  --pool-frames N              Frame buffers per port queued in ZeroMQ at most (default 1024)" << std::endl;
+    std::cout << "  --zero-copy-min N            Send frames of at least N bytes without copying (default 1024)" << std::endl;
+    std::cout << "  --pub                        Publish each frame under its unit as topic, for SUB loggers" << std::endl;
+    std::cout << "  --transport zmq|shm          ZeroMQ IPC sockets or shared-memory rings (default zmq)" << std::endl;
+    std::cout << "  --shm-name NAME              Shared-memory segment, as shm_name in the logger (default /cboe_bridge)" << std::endl;
+    std::cout << "  --shm-bytes N                Ring size per port, rounded up to a power of two (default 33554432)" << std::endl;
+    std::cout << "  -h, --help                   Show this help message" << std::endl;
+}
+
+/**
+ * One UDP port forwarded to one PUSH (or PUB) socket, or to one lane of the ring
+ * In PUB mode a frame only holds datagrams of one unit, sent as a two-part
+ * message: the unit byte (the topic SUB sockets filter on), then the frame.
+ * Bridge sequences then count per unit, so a logger subscribed to some
+ * units sees no gaps from the others.
+ */
+struct Line {
+    int sock;
+    void* push;
+    ShmChannel* ring;                // Set with --transport shm (push is then unused)
+    int lane;
+    uint16_t port;
+    size_t zero_copy_min;
+    bool pub;
+    BridgeBatcher batch;
+    uint8_t batch_unit = 0;          // Unit of the datagrams in batch (PUB mode)
+    uint64_t bridge_sequence[256] = {};   // Indexed by unit in PUB mode, [0] otherwise
+    uint64_t packets = 0;
+    uint64_t frames = 0;
+    uint64_t frames_dropped = 0;     // zmq_msg_send hit the high water mark (EAGAIN), or the ring was full
+    uint64_t packets_dropped = 0;    // Datagrams in those frames
+    uint64_t pool_exhausted = 0;     // Datagrams dropped with every frame buffer still queued
+};
+
+/**
+ * Scratch space for one recvmmsg call
+ */
+struct ReceiveBatch {
+    static constexpr unsigned int SIZE = 64;
+    
+    char buffers[SIZE][Config::MAX_BUF];
+    char control[SIZE][CMSG_SPACE(sizeof(struct timespec))];
+    struct sockaddr_in senders[SIZE];
+    struct iovec iovs[SIZE];
+    struct mmsghdr msgs[SIZE];
+    
+    ReceiveBatch() {
+        for (unsigned int i = 0; i < SIZE; i++) {
+            iovs[i] = {buffers[i], sizeof(buffers[i])};
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+    
+    void prepare() {
+        for (unsigned int i = 0; i < SIZE; i++) {
+            msgs[i].msg_hdr.msg_name = &senders[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+            msgs[i].msg_hdr.msg_control = control[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+            msgs[i].msg_hdr.msg_flags = 0;
+        }
+    }
+};
+
+/**
+ * Send the line's batch
+ * Large frames are lent to ZeroMQ and returned to the pool by its free
+ * callback; below zero_copy_min, the content allocation and cross-thread
+ * release cost more than copying, so the frame is copied and the buffer kept.
+ */
+void send_batch(Line& line) {
+    uint32_t packets = line.batch.packets();
+    size_t size = line.batch.size();
+    bool sent;
+    if (line.pub) {
+        // PUB never blocks; a subscriber at its high water mark loses the
+        // frame, which its logger reports as a bridge sequence gap
+        zmq_send(line.push, &line.batch_unit, 1, ZMQ_SNDMORE);
+    }
+    if (line.ring) {
+        sent = line.ring->write(line.lane, line.batch.data(), size);
+        line.batch.clear();
+    } else if (size < line.zero_copy_min) {
+        sent = zmq_send(line.push, line.batch.data(), size, ZMQ_DONTWAIT) >= 0;
+        line.batch.clear();
+    } else {
+        zmq_msg_t msg;
+        zmq_msg_init_data(&msg, line.batch.take(), size, FramePool::release, &line.batch.pool());
+        sent = zmq_msg_send(&msg, line.push, ZMQ_DONTWAIT) >= 0;
+        if (!sent) {
+            zmq_msg_close(&msg);   // Releases the buffer
+        }
+    }
+    if (!sent) {
+        line.frames_dropped++;
+        line.packets_dropped += packets;
+        return;
+    }
+    line.frames++;
+}
+
+void print_drops(const Line& line) {
+    std::cout << "  Port " << line.port << ": " << line.frames << " frames sent, " << line.frames_dropped
+              << " frames (" << line.packets_dropped << " packets) dropped "
+              << (line.ring ? "with the ring full, " : "at the high water mark, ")
+              << line.pool_exhausted << " packets dropped with no free frame buffer" << std::endl;
+}
+
+/**
+ * Receive everything waiting on a line (up to one recvmmsg) and batch it
+ * @return Number of datagrams received
+ */
+int receive_datagrams(Line& line, ReceiveBatch& scratch) {
+    scratch.prepare();
+    int received = recvmmsg(line.sock, scratch.msgs, ReceiveBatch::SIZE, MSG_DONTWAIT, nullptr);
+    if (received <= 0) {
+        return 0;
+    }
+    
+    auto now = BridgeBatcher::Clock::now();
+    for (int i = 0; i < received; i++) {
+        struct msghdr& msg = scratch.msgs[i].msg_hdr;
+        BridgeHeader header{};
+        header.magic = Config::BRIDGE_HEADER_MAGIC;
+        header.payload_length = static_cast<uint16_t>(scratch.msgs[i].msg_len);
+        header.ingress_port = line.port;
+        header.src_port = ntohs(scratch.senders[i].sin_port);
+        header.src_ip = scratch.senders[i].sin_addr.s_addr;
+        uint8_t unit = 0;
+        if (scratch.msgs[i].msg_len >= sizeof(CboeSequencedUnitHeader)) {
+            unit = static_cast<uint8_t>(scratch.buffers[i][offsetof(CboeSequencedUnitHeader, hdr_unit)]);
+        }
+        // Counted even if dropped, so the logger sees the loss
+        header.bridge_sequence = ++line.bridge_sequence[line.pub ? unit : 0];
+        if (line.pub && !line.batch.empty() && unit != line.batch_unit) {
+            send_batch(line);
+        }
+        line.batch_unit = unit;
+        if (!line.batch.ready()) {
+            line.pool_exhausted++;
+            continue;
+        }
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                struct timespec ts;
+                memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                header.rx_timestamp_ns = static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+            }
+        }
+        if (line.batch.add(header, scratch.buffers[i], now)) {
+            send_batch(line);
+        }
+    }
+    line.packets += received;
+    return received;
+}
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg == "--batch-packets" && i + 1 < argc) {
+            opts.batch_packets = std::max<uint32_t>(std::stoul(argv[++i]), 1);
+        } else if (arg == "--batch-bytes" && i + 1 < argc) {
+            opts.batch_bytes = std::max<size_t>(std::stoul(argv[++i]), 1);
+        } else if (arg == "--batch-us" && i + 1 < argc) {
+            opts.batch_us = std::stoul(argv[++i]);
+        } else if (arg == "--pool-frames" && i + 1 < argc) {
+            opts.pool_frames = std::max<size_t>(std::stoul(argv[++i]), 1);
+        } else if (arg == "--zero-copy-min" && i + 1 < argc) {
+            opts.zero_copy_min = std::stoul(argv[++i]);
+        } else if (arg == "--pub") {
+            opts.pub = true;
+        } else if (arg == "--transport" && i + 1 < argc) {
+            std::string transport = argv[++i];
+            if (transport != "zmq" && transport != "shm") {
+                std::cerr << "--transport must be zmq or shm" << std::endl;
+                return 1;
+            }
+            opts.shm = transport == "shm";
+        } else if (arg == "--shm-name" && i + 1 < argc) {
+            opts.shm_name = argv[++i];
+        } else if (arg == "--shm-bytes" && i + 1 < argc) {
+            opts.shm_bytes = std::stoull(argv[++i]);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (opts.pub && opts.shm) {
+        std::cerr << "--pub applies to the ZeroMQ transport only" << std::endl;
+        return 1;
+    }
+    
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
@@ -56,7 +288,15 @@ int main() {
     std::cout << "CBOE UDP to ZMQ Bridge" << std::endl;
     std::cout << "========================================" << std::endl;
     std::cout << "UDP Input: " << Config::MULTICAST_IP << ":" << Config::PORT1 << "," << Config::PORT2 << std::endl;
-    std::cout << "ZMQ Output: ipc:///tmp/cboe_port1.ipc, ipc:///tmp/cboe_port2.ipc" << std::endl;
+    if (opts.shm) {
+        std::cout << "Output: shared memory " << opts.shm_name << ", one lane per port" << std::endl;
+    } else {
+        std::cout << "ZMQ Output: ipc:///tmp/cboe_port1.ipc, ipc:///tmp/cboe_port2.ipc"
+                  << (opts.pub ? " (PUB, unit topics)" : "") << std::endl;
+    }
+    std::cout << "Framing: " << sizeof(BridgeHeader) << "-byte BridgeHeader per datagram, up to "
+              << opts.batch_packets << " datagrams / " << opts.batch_bytes << " bytes / "
+              << opts.batch_us << "us per frame" << std::endl;
     std::cout << "Press Ctrl+C to stop" << std::endl;
     std::cout << "========================================" << std::endl;
     
@@ -69,72 +309,115 @@ int main() {
         return 1;
     }
     
-    // Create ZMQ context and PUSH sockets for reliable delivery
-    void* context = zmq_ctx_new();
-    void* push1 = zmq_socket(context, ZMQ_PUSH);
-    void* push2 = zmq_socket(context, ZMQ_PUSH);
-    
-    int hwm = 1000000;
-    zmq_setsockopt(push1, ZMQ_SNDHWM, &hwm, sizeof(hwm));
-    zmq_setsockopt(push2, ZMQ_SNDHWM, &hwm, sizeof(hwm));
-    
-    zmq_bind(push1, "ipc:///tmp/cboe_port1.ipc");
-    zmq_bind(push2, "ipc:///tmp/cboe_port2.ipc");
-    
-    std::cout << "PUSH/PULL Bridge started - forwarding UDP to ZMQ" << std::endl;
+    // Create ZMQ context and PUSH sockets for reliable delivery, or the rings
+    void* context = nullptr;
+    void* push1 = nullptr;
+    void* push2 = nullptr;
+    std::unique_ptr<ShmChannel> ring;
+    if (opts.shm) {
+        try {
+            ring = ShmChannel::create(opts.shm_name, 2, opts.shm_bytes);
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to create shared memory: " << e.what() << std::endl;
+            return 1;
+        }
+        std::cout << "Shared-memory bridge started - " << ring->lane_bytes() << " bytes per lane" << std::endl;
+    } else {
+        context = zmq_ctx_new();
+        push1 = zmq_socket(context, opts.pub ? ZMQ_PUB : ZMQ_PUSH);
+        push2 = zmq_socket(context, opts.pub ? ZMQ_PUB : ZMQ_PUSH);
+        
+        int hwm = 1000000;
+        zmq_setsockopt(push1, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        zmq_setsockopt(push2, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+        
+        zmq_bind(push1, "ipc:///tmp/cboe_port1.ipc");
+        zmq_bind(push2, "ipc:///tmp/cboe_port2.ipc");
+        
+        std::cout << (opts.pub ? "PUB/SUB" : "PUSH/PULL") << " Bridge started - forwarding UDP to ZMQ" << std::endl;
+    }
     
-    char buffer[2048];
-    struct sockaddr_in sender_addr;
-    socklen_t sender_len = sizeof(sender_addr);
-    fd_set read_fds;
-    struct timeval timeout;
+    // Large frames are sent zero-copy from these pools; they outlive the context below.
+    // Frames are always copied into the ring, so one buffer per port suffices there.
+    std::chrono::microseconds max_delay(opts.batch_us);
+    size_t pool_frames = opts.shm ? 1 : opts.pool_frames;
+    FramePool pool1(BridgeBatcher::buffer_size(opts.batch_bytes), pool_frames);
+    FramePool pool2(BridgeBatcher::buffer_size(opts.batch_bytes), pool_frames);
+    Line lines[2] = {
+        {udp_sock1, push1, ring.get(), 0, Config::PORT1, opts.zero_copy_min, opts.pub, {pool1, opts.batch_bytes, opts.batch_packets, max_delay}},
+        {udp_sock2, push2, ring.get(), 1, Config::PORT2, opts.zero_copy_min, opts.pub, {pool2, opts.batch_bytes, opts.batch_packets, max_delay}},
+    };
+    struct pollfd fds[2] = {{udp_sock1, POLLIN, 0}, {udp_sock2, POLLIN, 0}};
+    auto scratch = std::make_unique<ReceiveBatch>();
     uint64_t packets_forwarded = 0;
+    uint64_t next_report = 100000;
     
     while (running) {
-        FD_ZERO(&read_fds);
-        FD_SET(udp_sock1, &read_fds);
-        FD_SET(udp_sock2, &read_fds);
-        
-        timeout.tv_sec = 0;
-        timeout.tv_usec = 1000; // 1ms timeout
-        
-        int max_fd = std::max(udp_sock1, udp_sock2) + 1;
-        int activity = select(max_fd, &read_fds, nullptr, nullptr, &timeout);
-        
-        if (activity < 0) break;
-        if (activity == 0) continue;
-        
-        // Forward from port 30501
-        if (FD_ISSET(udp_sock1, &read_fds)) {
-            ssize_t len = recvfrom(udp_sock1, buffer, sizeof(buffer), MSG_DONTWAIT,
-                                 (struct sockaddr*)&sender_addr, &sender_len);
-            if (len > 0) {
-                zmq_send(push1, buffer, len, ZMQ_DONTWAIT);
-                packets_forwarded++;
-            }
+        int received = 0;
+        for (Line& line : lines) {
+            received += receive_datagrams(line, *scratch);
         }
+        packets_forwarded += received;
         
-        // Forward from port 30502
-        if (FD_ISSET(udp_sock2, &read_fds)) {
-            ssize_t len = recvfrom(udp_sock2, buffer, sizeof(buffer), MSG_DONTWAIT,
-                                 (struct sockaddr*)&sender_addr, &sender_len);
-            if (len > 0) {
-                zmq_send(push2, buffer, len, ZMQ_DONTWAIT);
-                packets_forwarded++;
+        auto now = BridgeBatcher::Clock::now();
+        for (Line& line : lines) {
+            if (line.batch.expired(now)) {
+                send_batch(line);
             }
         }
+        if (ring) {
+            ring->notify();
+        }
         
         // Status every 100K packets
-        if (packets_forwarded % 100000 == 0 && packets_forwarded > 0) {
+        if (packets_forwarded >= next_report) {
             std::cout << "Forwarded " << packets_forwarded << " packets" << std::endl;
+            for (const Line& line : lines) {
+                if (line.frames_dropped || line.pool_exhausted) {
+                    print_drops(line);
+                }
+            }
+            next_report += 100000;
+        }
+        
+        if (received > 0) {
+            continue;
+        }
+        
+        // Idle: sleep until a datagram arrives or the oldest partial frame falls due
+        auto wake = now + std::chrono::milliseconds(100);
+        for (const Line& line : lines) {
+            if (!line.batch.empty()) {
+                wake = std::min(wake, line.batch.deadline());
+            }
+        }
+        auto wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wake - now).count();
+        struct timespec timeout = {wait_ns / 1000000000, wait_ns % 1000000000};
+        if (ppoll(fds, 2, &timeout, nullptr) < 0 && errno != EINTR) {
+            break;
         }
     }
     
-    std::cout << "Bridge stopped. Total packets forwarded: " << packets_forwarded << std::endl;
+    std::cout << "Bridge stopped. Total packets received: " << packets_forwarded << std::endl;
+    for (Line& line : lines) {
+        if (!line.batch.empty()) {
+            send_batch(line);
+        }
+        print_drops(line);
+    }
     
-    // Cleanup
+    // Cleanup; queued frames get a second to drain and are released to the
+    // pools (still alive here) by zmq_ctx_destroy. The ring stays in
+    // /dev/shm for the logger to drain and is replaced on the next start.
     close(udp_sock1);
     close(udp_sock2);
+    if (ring) {
+        ring->notify();
+        return 0;
+    }
+    int linger = 1000;
+    zmq_setsockopt(push1, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_setsockopt(push2, ZMQ_LINGER, &linger, sizeof(linger));
     zmq_close(push1);
     zmq_close(push2);
     zmq_ctx_destroy(context);
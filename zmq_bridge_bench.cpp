@@ -0,0 +1,286 @@
+#include "packet_types.h"
+#include "bridge_frame.h"
+#include "shm_ring.h"
+#include <zmq.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/mman.h>
+
+/**
+ * Throughput / latency curve of zmq_bridge batching
+ *
+ * For each batch size, a sender thread frames synthetic datagrams exactly as
+ * zmq_bridge does (BridgeBatcher, zero-copy sends from a FramePool) and
+ * pushes them over an IPC PUSH/PULL pair; the receiver splits the frames
+ * (for_each_bridge_record) and measures the delay from "arrival" at the
+ * bridge to delivery. Run with --rate to see
+ * the latency cost of batching at a given offered load, or without it for
+ * the maximum rate. --transport shm runs the same sweep over a
+ * shared-memory ring (shm_ring.h) instead of ZeroMQ.
+ */
+
+namespace {
+
+const char* ENDPOINT = "ipc:///tmp/cboe_bridge_bench.ipc";
+const char* SHM_NAME = "/cboe_bridge_bench";
+
+struct Options {
+    uint64_t packets = 1000000;
+    uint64_t rate = 0;                   // Datagrams per second, 0 = as fast as possible
+    uint32_t payload = 64;
+    size_t batch_bytes = 16384;
+    uint32_t batch_us = 50;
+    size_t pool_frames = 1024;
+    size_t zero_copy_min = 1024;
+    bool shm = false;
+    size_t shm_bytes = 32 * 1024 * 1024;
+    std::vector<uint32_t> batch_sizes = {1, 2, 4, 8, 16, 32, 64, 128, 256};
+};
+
+struct Result {
+    uint64_t frames = 0;
+    double seconds = 0;
+    std::vector<uint32_t> latencies_ns;
+};
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --packets N                  Datagrams per run (default 1000000)" << std::endl;
+    std::cout << "  --rate N                     Offered datagrams per second, 0 = unpaced (default 0)" << std::endl;
+    std::cout << "  --payload N                  Datagram size in bytes (default 64)" << std::endl;
+    std::cout << "  --batch-sizes LIST           Datagrams per frame to sweep (default 1,2,4,...,256)" << std::endl;
+    std::cout << "  --batch-bytes N              Frame size limit, as zmq_bridge (default 16384)" << std::endl;
+    std::cout << "  --batch-us N                 Frame age limit, as zmq_bridge (default 50)" << std::endl;
+    std::cout << "  --pool-frames N              Frame buffers lent to ZeroMQ, as zmq_bridge (default 1024)" << std::endl;
+    std::cout << "  --zero-copy-min N            Copy smaller frames, as zmq_bridge (default 1024)" << std::endl;
+    std::cout << "  --transport zmq|shm          ZeroMQ IPC or a shared-memory ring (default zmq)" << std::endl;
+    std::cout << "  --shm-bytes N                Ring size, as zmq_bridge (default 33554432)" << std::endl;
+    std::cout << "  -h, --help                   Show this help message" << std::endl;
+}
+
+void send_frame(void* push, BridgeBatcher& batch, size_t zero_copy_min) {
+    size_t size = batch.size();
+    if (size < zero_copy_min) {
+        zmq_send(push, batch.data(), size, 0);
+        batch.clear();
+    } else {
+        zmq_msg_t msg;
+        zmq_msg_init_data(&msg, batch.take(), size, FramePool::release, &batch.pool());
+        if (zmq_msg_send(&msg, push, 0) < 0) {
+            zmq_msg_close(&msg);
+        }
+    }
+}
+
+/**
+ * Split a received frame and record each datagram's delay
+ */
+void record_frame(const char* frame, size_t size, Result& result) {
+    uint64_t delivered = now_ns();
+    for_each_bridge_record(frame, size, [&](const BridgeHeader& header, const char*) {
+        result.latencies_ns.push_back(static_cast<uint32_t>(
+            std::min<uint64_t>(delivered - header.rx_timestamp_ns, UINT32_MAX)));
+    });
+}
+
+/**
+ * Drive a BridgeBatcher with opts.packets datagrams; send(batch) ships a due frame
+ */
+template <typename Send>
+uint64_t feed_batches(const Options& opts, BridgeBatcher& batch, Send&& send) {
+    std::vector<char> payload(opts.payload, 0x5a);
+    BridgeHeader header{};
+    header.magic = Config::BRIDGE_HEADER_MAGIC;
+    header.payload_length = static_cast<uint16_t>(opts.payload);
+    header.ingress_port = Config::PORT1;
+
+    uint64_t frames = 0;
+    uint64_t interval_ns = opts.rate ? 1000000000ULL / opts.rate : 0;
+    uint64_t start = now_ns();
+    for (uint64_t i = 0; i < opts.packets; i++) {
+        if (interval_ns) {
+            // Pace the offered load; partial frames still go out on their timer
+            uint64_t due = start + i * interval_ns;
+            while (now_ns() < due) {
+                if (batch.expired(BridgeBatcher::Clock::now())) {
+                    send(batch);
+                    frames++;
+                }
+            }
+        }
+        while (!batch.ready()) {
+            std::this_thread::yield();   // Every frame buffer is queued; the bridge would drop here
+        }
+        header.rx_timestamp_ns = now_ns();
+        header.bridge_sequence = i + 1;
+        if (batch.add(header, payload.data(), BridgeBatcher::Clock::now())) {
+            send(batch);
+            frames++;
+        }
+    }
+    if (!batch.empty()) {
+        send(batch);
+        frames++;
+    }
+    return frames;
+}
+
+Result run_shm(const Options& opts, uint32_t batch_packets) {
+    std::unique_ptr<ShmChannel> producer = ShmChannel::create(SHM_NAME, 1, opts.shm_bytes);
+    std::unique_ptr<ShmChannel> consumer = ShmChannel::attach(SHM_NAME);
+    if (!consumer) {
+        throw std::runtime_error(std::string("cannot attach to ") + SHM_NAME);
+    }
+
+    Result result;
+    result.latencies_ns.reserve(opts.packets);
+
+    // The receiver spins like packet_logger_zmq with zmq_wait_strategy = spin
+    std::thread receiver([&]() {
+        while (result.latencies_ns.size() < opts.packets) {
+            consumer->read(0, [&](const char* frame, size_t size) {
+                record_frame(frame, size, result);
+            });
+        }
+    });
+
+    FramePool pool(BridgeBatcher::buffer_size(opts.batch_bytes), 1);
+    BridgeBatcher batch(pool, opts.batch_bytes, batch_packets, std::chrono::microseconds(opts.batch_us));
+    uint64_t start = now_ns();
+    result.frames = feed_batches(opts, batch, [&](BridgeBatcher& due) {
+        while (!producer->write(0, due.data(), due.size())) {
+            std::this_thread::yield();   // Ring full; the bridge would drop here
+        }
+        due.clear();
+    });
+    receiver.join();
+    result.seconds = (now_ns() - start) / 1e9;
+    shm_unlink(SHM_NAME);
+    return result;
+}
+
+Result run(void* context, const Options& opts, uint32_t batch_packets) {
+    void* pull = zmq_socket(context, ZMQ_PULL);
+    void* push = zmq_socket(context, ZMQ_PUSH);
+    int hwm = 100000;
+    zmq_setsockopt(pull, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(push, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_bind(pull, ENDPOINT);
+    zmq_connect(push, ENDPOINT);
+
+    Result result;
+    result.latencies_ns.reserve(opts.packets);
+
+    std::thread receiver([&]() {
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        while (result.latencies_ns.size() < opts.packets && zmq_msg_recv(&frame, pull, 0) >= 0) {
+            record_frame(static_cast<const char*>(zmq_msg_data(&frame)), zmq_msg_size(&frame), result);
+        }
+        zmq_msg_close(&frame);
+    });
+
+    FramePool pool(BridgeBatcher::buffer_size(opts.batch_bytes), opts.pool_frames);
+    BridgeBatcher batch(pool, opts.batch_bytes, batch_packets, std::chrono::microseconds(opts.batch_us));
+    uint64_t start = now_ns();
+    result.frames = feed_batches(opts, batch, [&](BridgeBatcher& due) {
+        send_frame(push, due, opts.zero_copy_min);
+    });
+    receiver.join();
+    result.seconds = (now_ns() - start) / 1e9;
+
+    // Everything was received, so no frame still references the pool
+    zmq_close(push);
+    zmq_close(pull);
+    return result;
+}
+
+double percentile_us(std::vector<uint32_t>& values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index] / 1000.0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (arg == "--packets" && i + 1 < argc) {
+            opts.packets = std::max<uint64_t>(std::stoull(argv[++i]), 1);
+        } else if (arg == "--rate" && i + 1 < argc) {
+            opts.rate = std::stoull(argv[++i]);
+        } else if (arg == "--payload" && i + 1 < argc) {
+            opts.payload = std::clamp<uint32_t>(std::stoul(argv[++i]), 1, Config::MAX_BUF);
+        } else if (arg == "--batch-bytes" && i + 1 < argc) {
+            opts.batch_bytes = std::max<size_t>(std::stoul(argv[++i]), 1);
+        } else if (arg == "--batch-us" && i + 1 < argc) {
+            opts.batch_us = std::stoul(argv[++i]);
+        } else if (arg == "--pool-frames" && i + 1 < argc) {
+            opts.pool_frames = std::max<size_t>(std::stoul(argv[++i]), 1);
+        } else if (arg == "--zero-copy-min" && i + 1 < argc) {
+            opts.zero_copy_min = std::stoul(argv[++i]);
+        } else if (arg == "--transport" && i + 1 < argc) {
+            std::string transport = argv[++i];
+            if (transport != "zmq" && transport != "shm") {
+                std::cerr << "--transport must be zmq or shm" << std::endl;
+                return 1;
+            }
+            opts.shm = transport == "shm";
+        } else if (arg == "--shm-bytes" && i + 1 < argc) {
+            opts.shm_bytes = std::stoull(argv[++i]);
+        } else if (arg == "--batch-sizes" && i + 1 < argc) {
+            opts.batch_sizes.clear();
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                opts.batch_sizes.push_back(std::max<uint32_t>(std::stoul(item), 1));
+            }
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::cout << "zmq_bridge batching over " << (opts.shm ? "shared memory" : "ZeroMQ IPC") << ": " << opts.packets << " x " << opts.payload << "-byte datagrams, "
+              << (opts.rate ? std::to_string(opts.rate) + " pps offered" : std::string("unpaced"))
+              << ", frame limits " << opts.batch_bytes << " bytes / " << opts.batch_us << "us" << std::endl;
+    std::cout << std::setw(8) << "batch" << std::setw(10) << "frames" << std::setw(12) << "kpps"
+              << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::setw(12) << "p99.9 us" << std::endl;
+
+    void* context = zmq_ctx_new();
+    for (uint32_t batch_packets : opts.batch_sizes) {
+        Result result = opts.shm ? run_shm(opts, batch_packets) : run(context, opts, batch_packets);
+        double kpps = result.latencies_ns.size() / result.seconds / 1000.0;
+        std::cout << std::setw(8) << batch_packets << std::setw(10) << result.frames
+                  << std::setw(12) << std::fixed << std::setprecision(0) << kpps
+                  << std::setw(10) << std::setprecision(1) << percentile_us(result.latencies_ns, 0.50)
+                  << std::setw(10) << percentile_us(result.latencies_ns, 0.99)
+                  << std::setw(12) << percentile_us(result.latencies_ns, 0.999) << std::endl;
+    }
+    zmq_ctx_destroy(context);
+    return 0;
+}
@@ -1,9 +1,10 @@
+#include "pitch_generator.h"
+#include "traffic_shaper.h"
 #include <zmq.h>
 #include <iostream>
 #include <chrono>
 #include <thread>
 #include <vector>
-#include <random>
 #include <atomic>
 #include <csignal>
 #include <cstring>
@@ -13,6 +14,9 @@ constexpr int TARGET_RATE_PER_THREAD = 250000; // 250k per thread = 1M total
 
 std::atomic<bool> running(true);
 
+// Rate profile of each thread (traffic_shaper.h)
+RateProfile thread_profile = RateProfile::constant(TARGET_RATE_PER_THREAD);
+
 // Per-thread statistics
 struct ThreadStats {
     std::atomic<uint64_t> packets_sent{0};
@@ -45,35 +49,20 @@ void publisher_thread(int thread_id) {
     zmq_bind(pub1, endpoint1.c_str());
     zmq_bind(pub2, endpoint2.c_str());
     
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> size_dist(40, 200);
-    std::uniform_int_distribution<> data_dist(0, 255);
-    
-    uint32_t sequence = thread_id * 10000000; // Unique sequence per thread
-    
-    auto start_time = std::chrono::steady_clock::now();
-    auto next_send_time = start_time;
+    // Each thread publishes its own unit; a refused send leaves a sequence gap
+    PitchGeneratorOptions feed;
+    feed.units = {static_cast<uint8_t>(thread_id + 1)};
+    feed.seed = thread_id + 1;
+    feed.pool_packets = 16384;
+    feed.send_stamp = true;
+    PitchFeedGenerator generator(feed);
+    TrafficShaper shaper(thread_profile, 1);
     
     while (running) {
-        // Generate packet
-        int packet_size = size_dist(gen);
-        char packet_data[256];
-        
-        // CBOE-like header with thread-specific sequence
-        uint16_t length = packet_size;
-        uint8_t count = 1 + (sequence % 5);
-        uint8_t unit = thread_id + 1;
-        
-        memcpy(packet_data, &length, sizeof(length));
-        memcpy(packet_data + 2, &count, sizeof(count));
-        memcpy(packet_data + 3, &unit, sizeof(unit));
-        memcpy(packet_data + 4, &sequence, sizeof(sequence));
-        
-        // Fill with random data
-        for (int i = 8; i < packet_size; i++) {
-            packet_data[i] = static_cast<char>(data_dist(gen));
-        }
+        shaper.acquire(1);
+        const PitchFeedGenerator::Packet& packet = generator.next();
+        const char* packet_data = packet.data;
+        int packet_size = packet.length;
         
         // Send to both publishers
         int result1 = zmq_send(pub1, packet_data, packet_size, ZMQ_DONTWAIT);
@@ -81,7 +70,6 @@ void publisher_thread(int thread_id) {
         
         if (result1 > 0 && result2 > 0) {
             thread_stats[thread_id].packets_sent++;
-            sequence++;
         } else {
             if (result1 == -1 && zmq_errno() == EAGAIN) {
                 thread_stats[thread_id].dropped_packets++;
@@ -91,10 +79,6 @@ void publisher_thread(int thread_id) {
             }
             thread_stats[thread_id].send_errors++;
         }
-        
-        // Rate limiting for 250k pps per thread
-        next_send_time += std::chrono::nanoseconds(4000); // 4μs = 250k pps
-        std::this_thread::sleep_until(next_send_time);
     }
     
     zmq_close(pub1);
@@ -149,14 +133,29 @@ void stats_thread() {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--profile" && i + 1 < argc) {
+                thread_profile = RateProfile::parse(argv[++i]);
+            } else {
+                std::cerr << "Usage: " << argv[0] << " [--profile SPEC]" << std::endl;
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
     std::cout << "Multi-threaded ZMQ Publisher for 1M pps" << std::endl;
     std::cout << "Threads: " << NUM_THREADS << std::endl;
-    std::cout << "Target per thread: " << TARGET_RATE_PER_THREAD << " pps" << std::endl;
-    std::cout << "Total target: " << (NUM_THREADS * TARGET_RATE_PER_THREAD) << " pps" << std::endl;
+    std::cout << "Target per thread: up to " << (int)thread_profile.peak_rate() << " pps" << std::endl;
+    std::cout << "Total target: up to " << (int)(NUM_THREADS * thread_profile.peak_rate()) << " pps" << std::endl;
     
     // Initialize thread stats
     for (int i = 0; i < NUM_THREADS; i++) {
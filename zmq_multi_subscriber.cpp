@@ -1,3 +1,5 @@
+#include "latency_histogram.h"
+#include "sequence_window.h"
 #include <zmq.h>
 #include <iostream>
 #include <chrono>
@@ -5,7 +7,6 @@
 #include <vector>
 #include <atomic>
 #include <csignal>
-#include <unordered_set>
 #include <cstring>
 
 constexpr int NUM_THREADS = 4;
@@ -18,7 +19,9 @@ struct ThreadStats {
     std::atomic<uint64_t> receive_errors{0};
     std::atomic<uint64_t> duplicate_packets{0};
     std::atomic<uint64_t> out_of_order_packets{0};
-    std::atomic<uint64_t> missing_packets{0};
+    std::atomic<uint64_t> missing_packets{0};   // Messages, exact within the sequence window
+    std::atomic<uint64_t> stale_messages{0};    // Older than the sequence window
+    LatencyHistogram latency[2];    // Per endpoint, from the publisher's send stamps; read after join
     int thread_id;
 };
 
@@ -54,47 +57,42 @@ void subscriber_thread(int thread_id) {
     zmq_setsockopt(sub1, ZMQ_SUBSCRIBE, "", 0);
     zmq_setsockopt(sub2, ZMQ_SUBSCRIBE, "", 0);
     
-    char buffer[2048];
-    std::unordered_set<uint32_t> seen_sequences;
-    uint32_t last_sequence = 0;
-    uint32_t expected_sequence = thread_id * 10000000; // Match publisher start
+    char buffers[2][2048];
+    SequenceWindow sequences;   // Constant memory however long the run
     
     while (running) {
         // Try to receive from both sockets
-        int size1 = zmq_recv(sub1, buffer, sizeof(buffer), ZMQ_DONTWAIT);
-        int size2 = zmq_recv(sub2, buffer, sizeof(buffer), ZMQ_DONTWAIT);
+        int size1 = zmq_recv(sub1, buffers[0], sizeof(buffers[0]), ZMQ_DONTWAIT);
+        int size2 = zmq_recv(sub2, buffers[1], sizeof(buffers[1]), ZMQ_DONTWAIT);
+        uint64_t receive_tsc = TscClock::now();
         
         // Process received packets
-        for (int size : {size1, size2}) {
+        for (int endpoint = 0; endpoint < 2; endpoint++) {
+            int size = endpoint == 0 ? size1 : size2;
+            const char* buffer = buffers[endpoint];
             if (size > 0) {
                 thread_stats[thread_id].packets_received++;
                 
+                uint64_t send_tsc;
+                if (read_send_stamp(buffer, size, send_tsc)) {
+                    thread_stats[thread_id].latency[endpoint].add(send_stamp_latency_ns(send_tsc, receive_tsc));
+                }
+                
                 // Extract sequence number from packet
                 if (size >= 8) {
+                    uint8_t count = static_cast<uint8_t>(buffer[2]);
                     uint32_t sequence;
                     memcpy(&sequence, buffer + 4, sizeof(sequence));
                     
-                    // Check for duplicates
-                    if (seen_sequences.find(sequence) != seen_sequences.end()) {
+                    // Sequences number messages: the packet covers [sequence, sequence + count)
+                    SequenceWindow::Result result = sequences.record(sequence, count);
+                    if (result == SequenceWindow::Result::DUPLICATE || result == SequenceWindow::Result::STALE) {
                         thread_stats[thread_id].duplicate_packets++;
-                    } else {
-                        seen_sequences.insert(sequence);
-                    }
-                    
-                    // Check for out-of-order
-                    if (sequence < last_sequence) {
+                    } else if (result == SequenceWindow::Result::LATE) {
                         thread_stats[thread_id].out_of_order_packets++;
                     }
-                    
-                    // Calculate missing packets
-                    if (sequence > expected_sequence) {
-                        thread_stats[thread_id].missing_packets += (sequence - expected_sequence);
-                        expected_sequence = sequence + 1;
-                    } else if (sequence == expected_sequence) {
-                        expected_sequence++;
-                    }
-                    
-                    last_sequence = sequence;
+                    thread_stats[thread_id].missing_packets = sequences.missing();
+                    thread_stats[thread_id].stale_messages = sequences.statistics().stale;
                 }
             } else if (size == -1) {
                 int err = zmq_errno();
@@ -188,6 +186,8 @@ int main() {
         thread_stats[i].thread_id = i;
     }
     
+    TscClock::calibrate();
+    
     // Start subscriber threads
     std::vector<std::thread> subscribers;
     for (int i = 0; i < NUM_THREADS; i++) {
@@ -220,7 +220,8 @@ int main() {
         
         std::cout << "Thread " << i << ": " << received << " received, " 
                  << missing << " missing, " << duplicates << " duplicates, "
-                 << ooo << " out-of-order, " << errors << " errors" << std::endl;
+                 << ooo << " out-of-order, " << errors << " errors, "
+                 << thread_stats[i].stale_messages.load() << " older than the sequence window" << std::endl;
         
         total_received += received;
         total_errors += errors;
@@ -236,5 +237,17 @@ int main() {
     double loss_rate = (double)total_missing / (total_received + total_missing) * 100.0;
     std::cout << "Overall loss rate: " << loss_rate << "%" << std::endl;
     
+    // One-way latency from the publishers' send stamps
+    std::cout << "\n=== Latency (send to receive) ===" << std::endl;
+    LatencyHistogram total_latency;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        for (int endpoint = 0; endpoint < 2; endpoint++) {
+            std::cout << "Thread " << i << " port" << (endpoint + 1) << ": "
+                     << thread_stats[i].latency[endpoint].summary() << std::endl;
+            total_latency.merge(thread_stats[i].latency[endpoint]);
+        }
+    }
+    std::cout << "TOTAL: " << total_latency.summary() << std::endl;
+    
     return 0;
 }
\ No newline at end of file
@@ -1,112 +1,467 @@
 #include "zmq_network_handler.h"
 #include "packet_types.h"
+#include "bridge_frame.h"
+#include "shm_ring.h"
+#include "stage_probes.h"
 #include <iostream>
 #include <chrono>
 #include <cstring>
 
-ZmqNetworkHandler::ZmqNetworkHandler() : running_(false), context_(nullptr), subscriber_(nullptr), subscriber2_(nullptr) {
+namespace {
+
+const char* const ENDPOINTS[ZmqNetworkHandler::LINES] = {"ipc:///tmp/cboe_port1.ipc", "ipc:///tmp/cboe_port2.ipc"};
+const int PORTS[ZmqNetworkHandler::LINES] = {Config::PORT1, Config::PORT2};
+
+} // namespace
+
+ZmqNetworkHandler::ZmqNetworkHandler() : running_(false), capturing_(false), context_(nullptr) {
+    const RuntimeConfig& config = runtime_config();
+    wait_strategy_ = config.zmq_wait_strategy;
+    spin_iterations_ = config.zmq_spin_iterations;
+    poll_timeout_ms_ = config.zmq_poll_timeout_ms;
+    transport_ = config.zmq_transport;
+    shm_name_ = config.shm_name;
+    pattern_ = config.zmq_pattern;
+    units_ = config.zmq_units;
+    measure_latency_ = config.measure_send_latency;
+    for (int i = 0; i < LINES; ++i) {
+        lines_[i].next_packet_id = i;
+        lines_[i].next_bridge_sequence.fill(1);
+    }
 }
 
 ZmqNetworkHandler::~ZmqNetworkHandler() {
     stop_capture();
 }
 
-void ZmqNetworkHandler::capture_loop() {
+const char* ZmqNetworkHandler::wait_strategy_name(ZmqWaitStrategy strategy) {
+    switch (strategy) {
+        case ZmqWaitStrategy::SPIN: return "spin";
+        case ZmqWaitStrategy::SPIN_THEN_POLL: return "spin_poll";
+        case ZmqWaitStrategy::POLL: return "poll";
+    }
+    return "unknown";
+}
+
+bool ZmqNetworkHandler::open_socket(int line) {
+    bool sub = pattern_ == ZmqPattern::SUB;
+    void* socket = zmq_socket(context_, sub ? ZMQ_SUB : ZMQ_PULL);
+    if (!socket) {
+        std::cerr << "Failed to create ZMQ " << (sub ? "SUB" : "PULL") << " socket for port" << (line + 1) << std::endl;
+        return false;
+    }
+
+    // Optimize the socket for 1M pps
+    int hwm = RECEIVE_HWM;
+    zmq_setsockopt(socket, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+    int timeout = 0;
+    zmq_setsockopt(socket, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // One subscription per unit topic; the empty prefix matches them all
+    if (sub && units_.all()) {
+        zmq_setsockopt(socket, ZMQ_SUBSCRIBE, "", 0);
+    } else if (sub) {
+        for (int unit = 0; unit < 256; ++unit) {
+            if (units_.test(unit)) {
+                uint8_t topic = static_cast<uint8_t>(unit);
+                zmq_setsockopt(socket, ZMQ_SUBSCRIBE, &topic, 1);
+            }
+        }
+    }
+
+    zmq_connect(socket, ENDPOINTS[line]);
+    lines_[line].socket = socket;
+    return true;
+}
+
+void ZmqNetworkHandler::receive_loop(int line) {
     try {
-        // Create ZMQ context
-        context_ = zmq_ctx_new();
-        if (!context_) {
-            std::cerr << "Failed to create ZMQ context" << std::endl;
-            return;
+        Line& state = lines_[line];
+        LineCounters& counters = counters_[line];
+        bool sub = pattern_ == ZmqPattern::SUB;
+        zmq_pollitem_t item = {state.socket, 0, ZMQ_POLLIN, 0};
+
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        uint64_t idle_spins = 0;
+        uint64_t polls = 0;
+        uint32_t empty_passes = 0;
+        int topic = -1;   // Topic part awaiting its frame (SUB)
+        bool failed = false;
+
+        // Drain the socket until EAGAIN (or, when stopping, until the line is finished)
+        auto receive_pending = [&](bool stopping) {
+            while (true) {
+                if (stopping) {
+                    check_drain_deadline(line);
+                    if (state.finished) {
+                        return true;
+                    }
+                }
+                STAGE_PROBE(RECEIVE);
+                int size = zmq_msg_recv(&frame, state.socket, ZMQ_DONTWAIT);
+                STAGE_PROBE_END(RECEIVE);
+                if (size < 0) {
+                    int error = zmq_errno();
+                    if (error == EINTR) {
+                        continue;
+                    }
+                    if (error != EAGAIN) {
+                        std::cerr << "ZMQ port" << (line + 1) << " error: " << zmq_strerror(error) << std::endl;
+                        return false;
+                    }
+                    return true;
+                }
+                if (sub && topic < 0 && zmq_msg_more(&frame)) {
+                    topic = size > 0 ? *static_cast<const uint8_t*>(zmq_msg_data(&frame)) : 0;
+                    continue;
+                }
+                if (size > 0) {
+                    deliver_frame(line, PORTS[line], static_cast<const char*>(zmq_msg_data(&frame)), size,
+                                  topic < 0 ? 0 : static_cast<uint8_t>(topic));
+                }
+                topic = -1;
+                state.receives++;
+            }
+        };
+
+        while (running_ && !failed) {
+            uint64_t received_before = state.receives;
+            failed = !receive_pending(false);
+
+            if (state.receives != received_before) {
+                empty_passes = 0;
+                publish_statistics(line);
+                continue;
+            }
+
+            counters.idle_spins.store(++idle_spins, std::memory_order_relaxed);
+            if (wait_strategy_ == ZmqWaitStrategy::SPIN ||
+                (wait_strategy_ == ZmqWaitStrategy::SPIN_THEN_POLL && ++empty_passes < spin_iterations_)) {
+                continue;
+            }
+
+            // Block until the socket is readable; the timeout bounds how
+            // long stop_capture waits for this thread
+            counters.polls.store(++polls, std::memory_order_relaxed);
+            if (zmq_poll(&item, 1, poll_timeout_ms_) < 0 && zmq_errno() != EINTR) {
+                std::cerr << "ZMQ poll error: " << zmq_strerror(zmq_errno()) << std::endl;
+                break;
+            }
         }
-        
-        // Create separate PULL sockets for each port
-        subscriber_ = zmq_socket(context_, ZMQ_PULL);
-        subscriber2_ = zmq_socket(context_, ZMQ_PULL);
-        if (!subscriber_ || !subscriber2_) {
-            std::cerr << "Failed to create ZMQ PULL sockets" << std::endl;
-            return;
+
+        // Shutdown: deliver what the bridge received before the stop
+        if (!failed) {
+            uint64_t delivered_before = state.packets;
+            state.stopping = true;
+            receive_pending(true);
+            state.drained = state.packets - delivered_before;
+            publish_statistics(line);
         }
-        
-        // Optimize both sockets for 1M pps
-        int hwm = 10000000;
-        zmq_setsockopt(subscriber_, ZMQ_RCVHWM, &hwm, sizeof(hwm));
-        zmq_setsockopt(subscriber2_, ZMQ_RCVHWM, &hwm, sizeof(hwm));
-        
-        int timeout = 0;
-        zmq_setsockopt(subscriber_, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
-        zmq_setsockopt(subscriber2_, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
-        
-        // Connect each socket to its own endpoint
-        zmq_connect(subscriber_, "ipc:///tmp/cboe_port1.ipc");
-        zmq_connect(subscriber2_, "ipc:///tmp/cboe_port2.ipc");
-        
-        std::cout << "ZMQ PULL sockets connected to separate endpoints" << std::endl;
-        std::cout << "High water mark: " << hwm << " messages" << std::endl;
-        
-        char buffer[2048];
-        int packet_id = 0;
-        
+        zmq_msg_close(&frame);
+
+    } catch (const std::exception& e) {
+        std::cerr << "ZMQ Error: " << e.what() << std::endl;
+    }
+}
+
+void ZmqNetworkHandler::shm_capture_loop() {
+    try {
+        std::cout << "Shared-memory transport: " << shm_name_ << std::endl;
+        std::cout << "Wait strategy: " << wait_strategy_name(wait_strategy_) << std::endl;
+
+        // Both lanes are read by this one thread; idle and poll counts go to line 0
+        std::unique_ptr<ShmChannel> channel;
+        pid_t abandoned_producer = -1;   // Segment left behind by a bridge that exited
+        uint64_t idle_spins = 0;
+        uint64_t polls = 0;
+        uint32_t empty_passes = 0;
+
+        auto drain = [&](bool stopping) {
+            bool received = false;
+            for (int i = 0; i < LINES; ++i) {
+                if (stopping) {
+                    check_drain_deadline(i);
+                    if (lines_[i].finished) {
+                        continue;   // Stop consuming the lane
+                    }
+                }
+                size_t frames = channel->read(i, [&](const char* frame, size_t size) {
+                    if (stopping) {
+                        check_drain_deadline(i);
+                    }
+                    deliver_frame(i, PORTS[i], frame, size);
+                });
+                if (frames > 0) {
+                    lines_[i].receives += frames;
+                    publish_statistics(i);
+                    received = true;
+                }
+            }
+            return received;
+        };
+
         while (running_) {
-            // Poll both sockets
-            int size1 = zmq_recv(subscriber_, buffer, sizeof(buffer), ZMQ_DONTWAIT);
-            if (size1 > 0 && callback_) {
-                callback_(packet_id++, Config::PORT1, buffer, size1, "zmq_push");
+            if (!channel) {
+                // The bridge creates the segment; until then (or until it
+                // replaces a dead one) check back every poll timeout
+                channel = ShmChannel::attach(shm_name_);
+                if (channel && (channel->lanes() < LINES || channel->producer_pid() == abandoned_producer)) {
+                    channel.reset();
+                }
+                if (!channel) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(poll_timeout_ms_));
+                    continue;
+                }
+                std::cout << "Attached to " << shm_name_ << ": " << channel->lanes() << " lanes of "
+                          << channel->lane_bytes() << " bytes, zmq_bridge pid " << channel->producer_pid() << std::endl;
+            }
+
+            if (drain(false)) {
+                empty_passes = 0;
+                continue;
             }
-            
-            int size2 = zmq_recv(subscriber2_, buffer, sizeof(buffer), ZMQ_DONTWAIT);
-            if (size2 > 0 && callback_) {
-                callback_(packet_id++, Config::PORT2, buffer, size2, "zmq_push");
+
+            counters_[0].idle_spins.store(++idle_spins, std::memory_order_relaxed);
+            bool block = wait_strategy_ == ZmqWaitStrategy::POLL ||
+                         (wait_strategy_ == ZmqWaitStrategy::SPIN_THEN_POLL && ++empty_passes >= spin_iterations_);
+
+            // A lock query per pass would slow spinning down, so only check
+            // the bridge before blocking or every 1024 empty passes
+            if ((block || (idle_spins & 1023) == 0) && !channel->peer_alive()) {
+                drain(false);   // Frames written just before it exited
+                abandoned_producer = channel->producer_pid();
+                std::cerr << "zmq_bridge left " << shm_name_ << "; waiting for a new segment" << std::endl;
+                channel.reset();
+                continue;
             }
-            
-            // Check for errors
-            if (size1 == -1 && zmq_errno() != EAGAIN) {
-                std::cerr << "ZMQ port1 error: " << zmq_strerror(zmq_errno()) << std::endl;
-                break;
+            if (block) {
+                counters_[0].polls.store(++polls, std::memory_order_relaxed);
+                channel->wait(poll_timeout_ms_);
             }
-            if (size2 == -1 && zmq_errno() != EAGAIN) {
-                std::cerr << "ZMQ port2 error: " << zmq_strerror(zmq_errno()) << std::endl;
-                break;
+        }
+
+        // Shutdown: read both lanes until a pass finds them empty or finished
+        if (channel) {
+            uint64_t delivered_before[LINES];
+            for (int i = 0; i < LINES; ++i) {
+                delivered_before[i] = lines_[i].packets;
+                lines_[i].stopping = true;
+            }
+            while (drain(true)) {
+            }
+            for (int i = 0; i < LINES; ++i) {
+                lines_[i].drained = lines_[i].packets - delivered_before[i];
+                publish_statistics(i);
             }
         }
-        
+
     } catch (const std::exception& e) {
-        std::cerr << "ZMQ Error: " << e.what() << std::endl;
+        std::cerr << "Shared-memory transport error: " << e.what() << std::endl;
+    }
+}
+
+void ZmqNetworkHandler::check_drain_deadline(int line) {
+    Line& state = lines_[line];
+    auto now = std::chrono::steady_clock::now();
+    if (!state.discarding && now >= drain_deadline_) {
+        state.discarding = true;
+    }
+    if (now >= drain_deadline_ + std::chrono::milliseconds(Config::SHUTDOWN_DISCARD_MS)) {
+        state.finished = true;
+    }
+}
+
+void ZmqNetworkHandler::count_shutdown_lost(Line& state, const char* datagram, size_t len) {
+    uint8_t unit = 0;
+    if (len >= sizeof(CboeSequencedUnitHeader)) {
+        unit = static_cast<uint8_t>(datagram[offsetof(CboeSequencedUnitHeader, hdr_unit)]);
+    }
+    state.shutdown_lost++;
+    state.shutdown_lost_by_unit[unit]++;
+}
+
+void ZmqNetworkHandler::publish_statistics(int line) {
+    const Line& state = lines_[line];
+    LineCounters& counters = counters_[line];
+    counters.receives.store(state.receives, std::memory_order_relaxed);
+    counters.packets.store(state.packets, std::memory_order_relaxed);
+    counters.bridge_lost.store(state.bridge_lost, std::memory_order_relaxed);
+    counters.unframed.store(state.unframed, std::memory_order_relaxed);
+    counters.drained.store(state.drained, std::memory_order_relaxed);
+    counters.shutdown_lost.store(state.shutdown_lost, std::memory_order_relaxed);
+}
+
+ZmqNetworkHandler::Statistics ZmqNetworkHandler::get_statistics() const {
+    Statistics totals;
+    for (const LineCounters& counters : counters_) {
+        totals.receives += counters.receives.load(std::memory_order_relaxed);
+        totals.packets += counters.packets.load(std::memory_order_relaxed);
+        totals.idle_spins += counters.idle_spins.load(std::memory_order_relaxed);
+        totals.polls += counters.polls.load(std::memory_order_relaxed);
+        totals.bridge_lost += counters.bridge_lost.load(std::memory_order_relaxed);
+        totals.unframed += counters.unframed.load(std::memory_order_relaxed);
+        totals.drained += counters.drained.load(std::memory_order_relaxed);
+        totals.shutdown_lost += counters.shutdown_lost.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+std::array<uint64_t, 256> ZmqNetworkHandler::shutdown_lost_by_unit() const {
+    std::array<uint64_t, 256> totals{};
+    for (const Line& line : lines_) {
+        for (size_t unit = 0; unit < totals.size(); ++unit) {
+            totals[unit] += line.shutdown_lost_by_unit[unit];
+        }
+    }
+    return totals;
+}
+
+void ZmqNetworkHandler::deliver_frame(int line, uint16_t port, const char* frame, size_t size, uint8_t topic) {
+    Line& state = lines_[line];
+
+    // Frames from a bridge without headers carry one raw datagram
+    uint16_t magic = 0;
+    if (size >= sizeof(BridgeHeader)) {
+        memcpy(&magic, frame, sizeof(magic));
+    }
+    uint64_t receive_tsc = 0;
+    auto record_latency = [&](const char* payload, size_t len) {
+        uint64_t send_tsc;
+        if (measure_latency_ && read_send_stamp(payload, len, send_tsc)) {
+            if (receive_tsc == 0) {
+                receive_tsc = TscClock::now();
+            }
+            state.latency.add(send_stamp_latency_ns(send_tsc, receive_tsc));
+        }
+    };
+
+    if (state.finished) {
+        return;
+    }
+    if (magic != Config::BRIDGE_HEADER_MAGIC) {
+        state.unframed++;
+        record_latency(frame, size);
+        if (state.discarding) {
+            count_shutdown_lost(state, frame, size);
+            return;
+        }
+        state.packets++;
+        if (callback_) {
+            callback_({static_cast<int>(state.next_packet_id), port, frame, static_cast<int>(size), 0, 0, 0, 0, line});
+        }
+        state.next_packet_id += LINES;
+        return;
+    }
+
+    bool intact = for_each_bridge_record(frame, size, [&](const BridgeHeader& header, const char* payload) {
+        if (state.finished || (state.stopping && header.rx_timestamp_ns > stop_ns_)) {
+            state.finished = true;  // Received after the stop, and so is everything behind it
+            return;
+        }
+        // A lower sequence means the bridge restarted and numbers from 1 again
+        uint64_t& expected = state.next_bridge_sequence[topic];
+        if (header.bridge_sequence > expected) {
+            state.bridge_lost += header.bridge_sequence - expected;
+        }
+        expected = header.bridge_sequence + 1;
+        record_latency(payload, header.payload_length);
+        if (state.discarding) {
+            count_shutdown_lost(state, payload, header.payload_length);
+            return;
+        }
+        state.packets++;
+        if (callback_) {
+            callback_({static_cast<int>(state.next_packet_id), header.ingress_port, payload, header.payload_length,
+                       header.src_ip, header.src_port, header.rx_timestamp_ns, header.bridge_sequence, line});
+        }
+        state.next_packet_id += LINES;
+    });
+    if (!intact) {
+        std::cerr << "ZMQ port" << (line + 1) << ": truncated bridge frame of " << size << " bytes" << std::endl;
     }
 }
 
-void ZmqNetworkHandler::start_capture(PacketCallback callback) {
+void ZmqNetworkHandler::start_capture(ZmqPacketCallback callback) {
     callback_ = callback;
     running_ = true;
-    
+    capturing_ = true;
+
     std::cout << "Starting ZMQ high-performance packet capture..." << std::endl;
     std::cout << "Target rate: 100k packets/second" << std::endl;
-    
-    // Start capture in separate thread
-    capture_thread_ = std::thread(&ZmqNetworkHandler::capture_loop, this);
+    if (measure_latency_) {
+        TscClock::calibrate();  // Before the receive threads meet their first stamped frame
+    }
+
+    if (transport_ == ZmqTransport::SHM) {
+        shm_thread_ = std::thread(&ZmqNetworkHandler::shm_capture_loop, this);
+        return;
+    }
+
+    context_ = zmq_ctx_new();
+    if (!context_) {
+        std::cerr << "Failed to create ZMQ context" << std::endl;
+        return;
+    }
+    for (int i = 0; i < LINES; ++i) {
+        if (!open_socket(i)) {
+            return;
+        }
+    }
+
+    bool sub = pattern_ == ZmqPattern::SUB;
+    std::cout << "ZMQ " << (sub ? "SUB" : "PULL") << " sockets connected to separate endpoints, one receive thread each";
+    if (sub) {
+        std::cout << ", " << (units_.all() ? std::string("all") : std::to_string(units_.count())) << " unit topics";
+    }
+    std::cout << std::endl;
+    std::cout << "High water mark: " << RECEIVE_HWM << " messages" << std::endl;
+    std::cout << "Wait strategy: " << wait_strategy_name(wait_strategy_) << std::endl;
+
+    // Each socket is used only by its own thread from here on
+    for (int i = 0; i < LINES; ++i) {
+        lines_[i].thread = std::thread(&ZmqNetworkHandler::receive_loop, this, i);
+    }
 }
 
-void ZmqNetworkHandler::stop_capture() {
-    running_ = false;
-    
-    if (capture_thread_.joinable()) {
-        capture_thread_.join();
+void ZmqNetworkHandler::stop_capture(int drain_timeout_ms) {
+    if (!capturing_) {
+        return;
     }
-    
-    if (subscriber_) {
-        zmq_close(subscriber_);
-        subscriber_ = nullptr;
+    capturing_ = false;
+    drain_deadline_ = std::chrono::steady_clock::now() + std::chrono::milliseconds(drain_timeout_ms);
+    stop_ns_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    running_ = false;
+
+    if (shm_thread_.joinable()) {
+        shm_thread_.join();
     }
-    
-    if (subscriber2_) {
-        zmq_close(subscriber2_);
-        subscriber2_ = nullptr;
+    for (Line& line : lines_) {
+        if (line.thread.joinable()) {
+            line.thread.join();
+        }
+        if (line.socket) {
+            zmq_close(line.socket);
+            line.socket = nullptr;
+        }
     }
-    
+
     if (context_) {
         zmq_ctx_destroy(context_);
         context_ = nullptr;
     }
-    
-    std::cout << "ZMQ capture stopped" << std::endl;
-}
\ No newline at end of file
+
+    Statistics stats = get_statistics();
+    std::cout << "ZMQ capture stopped: " << stats.packets << " packets in " << stats.receives << " receives, "
+              << stats.idle_spins << " idle spins, " << stats.polls << " polls, "
+              << stats.bridge_lost << " lost at the bridge, " << stats.unframed << " unframed" << std::endl;
+    std::cout << "ZMQ drain: " << stats.drained << " packets delivered after the stop, " << stats.shutdown_lost
+              << " still queued at the " << drain_timeout_ms << "ms deadline" << std::endl;
+    for (int i = 0; i < LINES; ++i) {
+        if (lines_[i].latency.count() != 0) {
+            std::cout << "ZMQ latency port" << (i + 1) << " (send stamp to receipt): " << lines_[i].latency.summary()
+                      << std::endl;
+        }
+    }
+}
@@ -1,4 +1,9 @@
 #pragma once
+#include "runtime_config.h"
+#include "latency_histogram.h"
+#include <array>
+#include <bitset>
+#include <chrono>
 #include <functional>
 #include <string>
 #include <cstdint>
@@ -6,23 +11,189 @@
 #include <atomic>
 #include <zmq.h>
 
-using PacketCallback = std::function<void(int packet_id, int port, const char* buffer, int len, const std::string& src_ip)>;
+/**
+ * One packet received over ZeroMQ, decoded from the zmq_bridge frame
+ * Frames without a BridgeHeader (older bridges) carry the socket's port and
+ * zeros for the receive metadata.
+ */
+struct ZmqPacket {
+    int packet_id;
+    uint16_t port;              // Ingress UDP port at the bridge
+    const char* data;           // Datagram payload
+    int len;
+    uint32_t src_ip;            // Network byte order
+    uint16_t src_port;
+    uint64_t rx_timestamp_ns;   // Kernel receive time at the bridge, 0 if unknown
+    uint64_t bridge_sequence;
+    int line;                   // Endpoint (0 or 1) the packet was received on
+};
 
+using ZmqPacketCallback = std::function<void(const ZmqPacket& packet)>;
+
+/**
+ * Receives packets from the two ZeroMQ PULL sockets fed by zmq_bridge
+ * Each socket has its own receive thread, so the callback is called from
+ * two threads at once and must be safe for that (see PacketShards); calls
+ * for one line are never concurrent. Batched frames are split into their
+ * datagrams (see bridge_frame.h). A thread drains its socket until EAGAIN;
+ * when a pass finds nothing, it waits as set by zmq_wait_strategy.
+ * Gaps in the bridge sequence of a socket are counted as bridge losses.
+ * Packet ids are unique across lines: line N numbers N, N+2, N+4, ...
+ *
+ * With zmq_pattern = sub the sockets are SUB sockets subscribed to the
+ * zmq_units topics of a zmq_bridge started with --pub. Each message is then
+ * a 1-byte unit topic followed by a frame, and bridge sequences are tracked
+ * per unit, so several loggers can split the units between them.
+ *
+ * With zmq_transport = shm the same frames are read from the two lanes of a
+ * shared-memory ring (shm_ring.h) instead, by a single thread; blocking
+ * waits use the ring's futex, and a bridge that exits is replaced by the
+ * next one to create the segment.
+ *
+ * With measure_send_latency set, datagrams carrying a SendStamp (pitch_feed
+ * --send-stamp and the test publishers) add their one-way latency to the
+ * line's histogram, which stop_capture() reports.
+ *
+ * stop_capture() drains before it returns: each thread keeps handing queued
+ * frames to the callback until its socket (or lane) is empty or it reaches a
+ * datagram the bridge received after the stop, which ends the drain since
+ * everything behind it was sent later too. Frames still queued when the
+ * drain deadline passes are read and counted as lost at shutdown, not
+ * delivered, for at most Config::SHUTDOWN_DISCARD_MS. zmq_disconnect is
+ * no help here: libzmq discards the frames a disconnected pipe still holds.
+ */
 class ZmqNetworkHandler {
 public:
+    static constexpr int LINES = 2;
+    static constexpr int RECEIVE_HWM = 10000000;    // ZMQ_RCVHWM of each line's socket, in messages
+
+    struct Statistics {
+        uint64_t receives = 0;      // Frames received (one per bridge batch)
+        uint64_t packets = 0;       // Datagrams handed to the callback
+        uint64_t idle_spins = 0;    // Passes that found the socket empty
+        uint64_t polls = 0;         // Blocking zmq_poll (or ring futex) waits
+        uint64_t bridge_lost = 0;   // Frames the bridge numbered but never delivered
+        uint64_t unframed = 0;      // Frames without a BridgeHeader
+        uint64_t drained = 0;       // Datagrams delivered after stop_capture() was called
+        uint64_t shutdown_lost = 0; // Datagrams received by the bridge before the stop, still queued at the deadline
+    };
+
     ZmqNetworkHandler();
     ~ZmqNetworkHandler();
+
+    void start_capture(ZmqPacketCallback callback);
     
-    void start_capture(PacketCallback callback);
-    void stop_capture();
-    
+    /**
+     * Drain the sockets, stop the receive threads and close the sockets
+     * Returns once every thread has found its socket empty; the callback is
+     * not called afterwards. Does nothing if capture is not running.
+     * @param drain_timeout_ms Longest time spent delivering queued frames;
+     *                         0 counts everything still queued as lost
+     */
+    void stop_capture(int drain_timeout_ms = 0);
+
+    /**
+     * Totals over both lines (counters are published once per productive pass)
+     */
+    Statistics get_statistics() const;
+
+    /**
+     * Statistics::shutdown_lost split by the unit in each datagram's header
+     * (unit 0 for datagrams too short to have one); call after stop_capture()
+     */
+    std::array<uint64_t, 256> shutdown_lost_by_unit() const;
+
+    /**
+     * Name used for the strategy in the configuration file
+     */
+    static const char* wait_strategy_name(ZmqWaitStrategy strategy);
+
 private:
+    // Counters of one line, written by its receive thread only
+    struct alignas(64) LineCounters {
+        std::atomic<uint64_t> receives{0};
+        std::atomic<uint64_t> packets{0};
+        std::atomic<uint64_t> idle_spins{0};
+        std::atomic<uint64_t> polls{0};
+        std::atomic<uint64_t> bridge_lost{0};
+        std::atomic<uint64_t> unframed{0};
+        std::atomic<uint64_t> drained{0};
+        std::atomic<uint64_t> shutdown_lost{0};
+    };
+
+    // Receive thread state of one line
+    struct Line {
+        void* socket = nullptr;
+        std::thread thread;
+        uint32_t next_packet_id = 0;
+        std::array<uint64_t, 256> next_bridge_sequence;   // [unit topic, or 0]
+        uint64_t receives = 0;
+        uint64_t packets = 0;
+        uint64_t bridge_lost = 0;
+        uint64_t unframed = 0;
+        uint64_t drained = 0;
+        uint64_t shutdown_lost = 0;
+        bool stopping = false;      // In the final pass after stop_capture()
+        bool discarding = false;    // Past the drain deadline: count frames, do not deliver
+        bool finished = false;      // Final pass reached the stop time or the discard limit
+        std::array<uint64_t, 256> shutdown_lost_by_unit{};
+        LatencyHistogram latency;   // Send stamp to receipt, read after the thread is joined
+    };
+
     std::atomic<bool> running_;
-    PacketCallback callback_;
+    bool capturing_;
+    std::chrono::steady_clock::time_point drain_deadline_;   // Set before running_ is cleared
+    uint64_t stop_ns_ = 0;      // CLOCK_REALTIME of the stop, compared with BridgeHeader::rx_timestamp_ns
+    ZmqPacketCallback callback_;
     void* context_;
-    void* subscriber_;
-    void* subscriber2_;
-    std::thread capture_thread_;
-    
-    void capture_loop();
-};
\ No newline at end of file
+    std::thread shm_thread_;
+    Line lines_[LINES];
+    LineCounters counters_[LINES];
+
+    // Wait settings (copied at construction)
+    ZmqWaitStrategy wait_strategy_;
+    uint32_t spin_iterations_;
+    int poll_timeout_ms_;
+    ZmqTransport transport_;
+    std::string shm_name_;
+    ZmqPattern pattern_;
+    std::bitset<256> units_;
+    bool measure_latency_;      // RuntimeConfig::measure_send_latency
+
+    /**
+     * Create, subscribe and connect the socket of a line
+     * @return false if the socket cannot be created
+     */
+    bool open_socket(int line);
+
+    void receive_loop(int line);
+    void shm_capture_loop();
+
+    /**
+     * Past the drain deadline, switch a line to counting instead of delivering,
+     * and finish its final pass once the discard limit has passed too
+     */
+    void check_drain_deadline(int line);
+
+    /**
+     * Count a datagram that was read but not delivered at shutdown
+     */
+    void count_shutdown_lost(Line& state, const char* datagram, size_t len);
+
+    /**
+     * Store a line's counters into counters_
+     */
+    void publish_statistics(int line);
+
+    /**
+     * Hand every datagram of a received frame to the callback
+     * A discarding line counts the datagrams as lost at shutdown instead. In
+     * the final pass, a datagram the bridge received after the stop finishes
+     * the line and is neither delivered nor counted.
+     * Send stamps are timed against one TSC read per frame.
+     * @param line Socket index (0 or 1), for bridge loss accounting
+     * @param port Port reported for frames without a BridgeHeader
+     * @param topic Unit topic the frame was published under (0 without one)
+     */
+    void deliver_frame(int line, uint16_t port, const char* frame, size_t size, uint8_t topic = 0);
+};
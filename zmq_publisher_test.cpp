@@ -1,8 +1,9 @@
+#include "pitch_generator.h"
+#include "traffic_shaper.h"
 #include <zmq.h>
 #include <iostream>
 #include <chrono>
 #include <thread>
-#include <random>
 #include <atomic>
 #include <csignal>
 #include <cstring>
@@ -40,7 +41,24 @@ void stats_thread() {
     }
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Constant 100k pps unless a profile is given (traffic_shaper.h)
+    RateProfile profile = RateProfile::constant(100000);
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg == "--profile" && i + 1 < argc) {
+                profile = RateProfile::parse(argv[++i]);
+            } else {
+                std::cerr << "Usage: " << argv[0] << " [--profile SPEC]" << std::endl;
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
@@ -57,38 +75,24 @@ int main() {
     
     std::cout << "ZMQ Test Publisher started" << std::endl;
     std::cout << "Publishing to: ipc:///tmp/cboe_port1.ipc, ipc:///tmp/cboe_port2.ipc" << std::endl;
-    std::cout << "Target rate: 100k packets/second" << std::endl;
+    std::cout << "Target rate: up to " << (int)profile.peak_rate() << " packets/second" << std::endl;
     
     // Start stats thread
     std::thread stats(stats_thread);
     
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<> size_dist(40, 200);
-    std::uniform_int_distribution<> data_dist(0, 255);
+    // Unit 1 PITCH feed with consistent sequence numbers and send stamps
+    PitchGeneratorOptions feed;
+    feed.send_stamp = true;
+    PitchFeedGenerator generator(feed);
+    TrafficShaper shaper(profile, 1);
     
     auto start_time = std::chrono::steady_clock::now();
     
     while (running) {
-        // Generate packet
-        int packet_size = size_dist(gen);
-        char packet_data[256];
-        
-        // CBOE-like header
-        uint16_t length = packet_size;
-        uint8_t count = 1 + (packets_sent % 5);
-        uint8_t unit = 1;
-        uint32_t sequence = packets_sent.load();
-        
-        memcpy(packet_data, &length, sizeof(length));
-        memcpy(packet_data + 2, &count, sizeof(count));
-        memcpy(packet_data + 3, &unit, sizeof(unit));
-        memcpy(packet_data + 4, &sequence, sizeof(sequence));
-        
-        // Fill with random data
-        for (int i = 8; i < packet_size; i++) {
-            packet_data[i] = static_cast<char>(data_dist(gen));
-        }
+        shaper.acquire(1);
+        const PitchFeedGenerator::Packet& packet = generator.next();
+        const char* packet_data = packet.data;
+        int packet_size = packet.length;
         
         // Send to both publishers
         int result1 = zmq_send(pub1, packet_data, packet_size, ZMQ_DONTWAIT);
@@ -99,9 +103,6 @@ int main() {
         } else {
             send_errors++;
         }
-        
-        // Rate limiting for 100k pps
-        std::this_thread::sleep_for(std::chrono::nanoseconds(10000)); // 10μs = 100k pps
     }
     
     stats.join();
@@ -1,21 +1,23 @@
+#include "latency_histogram.h"
+#include "sequence_window.h"
 #include <zmq.h>
 #include <iostream>
 #include <chrono>
 #include <thread>
 #include <atomic>
 #include <csignal>
-#include <unordered_set>
 #include <cstring>
 
 std::atomic<bool> running(true);
 std::atomic<uint64_t> packets_received(0);
+std::atomic<uint64_t> messages_received(0);   // Distinct sequences, counted once across both sockets
+std::atomic<uint64_t> missing_messages(0);
 std::atomic<uint64_t> receive_errors(0);
 std::atomic<uint64_t> duplicate_packets(0);
 std::atomic<uint64_t> out_of_order_packets(0);
 
-std::unordered_set<uint32_t> seen_sequences;
-uint32_t last_sequence = 0;
-uint32_t expected_sequence = 0;
+SequenceWindow sequences;        // Both sockets; written by the receive loop only
+LatencyHistogram latency[2];    // Per endpoint, from the publisher's send stamps
 
 void signal_handler(int signal) {
     std::cout << "\nReceived signal " << signal << ", stopping subscriber..." << std::endl;
@@ -37,10 +39,8 @@ void stats_thread() {
         
         if (duration >= 1000) {
             double rate = (double)packets_this_second * 1000.0 / duration;
-            uint64_t missing = expected_sequence - current_count;
-            
             std::cout << "Rate: " << (int)rate << " pps | Total: " << current_count 
-                     << " | Missing: " << missing
+                     << " | Missing: " << missing_messages.load()
                      << " | Dups: " << duplicate_packets.load()
                      << " | OOO: " << out_of_order_packets.load()
                      << " | Errors: " << receive_errors.load() << std::endl;
@@ -80,42 +80,43 @@ int main() {
     
     // Start stats thread
     std::thread stats(stats_thread);
+    TscClock::calibrate();
     
-    char buffer[2048];
+    char buffers[2][2048];
     
     while (running) {
         // Try to receive from both sockets
-        int size1 = zmq_recv(sub1, buffer, sizeof(buffer), ZMQ_DONTWAIT);
-        int size2 = zmq_recv(sub2, buffer, sizeof(buffer), ZMQ_DONTWAIT);
+        int size1 = zmq_recv(sub1, buffers[0], sizeof(buffers[0]), ZMQ_DONTWAIT);
+        int size2 = zmq_recv(sub2, buffers[1], sizeof(buffers[1]), ZMQ_DONTWAIT);
+        uint64_t receive_tsc = TscClock::now();
         
         // Process received packets
-        for (int size : {size1, size2}) {
+        for (int endpoint = 0; endpoint < 2; endpoint++) {
+            int size = endpoint == 0 ? size1 : size2;
+            const char* buffer = buffers[endpoint];
             if (size > 0) {
                 packets_received++;
                 
+                uint64_t send_tsc;
+                if (read_send_stamp(buffer, size, send_tsc)) {
+                    latency[endpoint].add(send_stamp_latency_ns(send_tsc, receive_tsc));
+                }
+                
                 // Extract sequence number from packet
                 if (size >= 8) {
+                    uint8_t count = static_cast<uint8_t>(buffer[2]);
                     uint32_t sequence;
                     memcpy(&sequence, buffer + 4, sizeof(sequence));
                     
-                    // Check for duplicates
-                    if (seen_sequences.find(sequence) != seen_sequences.end()) {
+                    // Sequences number messages: the packet covers [sequence, sequence + count)
+                    SequenceWindow::Result result = sequences.record(sequence, count);
+                    if (result == SequenceWindow::Result::DUPLICATE || result == SequenceWindow::Result::STALE) {
                         duplicate_packets++;
-                    } else {
-                        seen_sequences.insert(sequence);
-                    }
-                    
-                    // Check for out-of-order
-                    if (sequence < last_sequence) {
+                    } else if (result == SequenceWindow::Result::LATE) {
                         out_of_order_packets++;
                     }
-                    
-                    // Update expected sequence
-                    if (sequence > expected_sequence) {
-                        expected_sequence = sequence;
-                    }
-                    
-                    last_sequence = sequence;
+                    messages_received = sequences.statistics().received;
+                    missing_messages = sequences.missing();
                 }
             } else if (size == -1) {
                 int err = zmq_errno();
@@ -134,17 +135,23 @@ int main() {
     stats.join();
     
     uint64_t total_received = packets_received.load();
-    uint64_t total_missing = expected_sequence - total_received;
-    double loss_rate = (double)total_missing / expected_sequence * 100.0;
+    const SequenceWindow::Statistics& sequence_stats = sequences.statistics();
+    uint64_t total_missing = sequences.missing();
+    uint64_t expected = sequence_stats.received + total_missing;
+    double loss_rate = expected ? (double)total_missing / expected * 100.0 : 0.0;
     
     std::cout << "\nFinal Stats:" << std::endl;
     std::cout << "Total received: " << total_received << std::endl;
-    std::cout << "Expected packets: " << expected_sequence << std::endl;
-    std::cout << "Missing packets: " << total_missing << std::endl;
+    std::cout << "Expected messages: " << expected << " (up to sequence " << sequences.highest() << ")" << std::endl;
+    std::cout << "Missing messages: " << total_missing << " (" << sequences.open_gaps().covered()
+              << " in gaps that may still fill)" << std::endl;
     std::cout << "Loss rate: " << loss_rate << "%" << std::endl;
     std::cout << "Duplicate packets: " << duplicate_packets.load() << std::endl;
     std::cout << "Out-of-order packets: " << out_of_order_packets.load() << std::endl;
+    std::cout << "Messages older than the sequence window: " << sequence_stats.stale << std::endl;
     std::cout << "Receive errors: " << receive_errors.load() << std::endl;
+    std::cout << "Latency port1: " << latency[0].summary() << std::endl;
+    std::cout << "Latency port2: " << latency[1].summary() << std::endl;
     
     zmq_close(sub1);
     zmq_close(sub2);